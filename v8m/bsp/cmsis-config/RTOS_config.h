@@ -33,10 +33,17 @@
  * and a time stamp. */
 #define configLOGGING_INCLUDE_TIME_AND_TASK_NAME 1
 
+/* Set to 1 to format log messages in the logging task. The calling task only
+ * records the format string, a time stamp and the arguments in a ring of
+ * configLOGGING_DEFERRED_BUFFER_SIZE bytes. */
+#define configLOGGING_DEFERRED_FORMATTING  0
+#define configLOGGING_DEFERRED_BUFFER_SIZE 2048
+
 // somehow 300 tick per second gives similar timing (~85%) as 1000 did on the FPGA, so with this 1 ms to 1 tick can be
 // kept...
 #define configTICK_RATE_HZ       ((uint32_t)300) /* Scheduler polling rate of 1000 Hz */
 #define configMINIMAL_STACK_SIZE 4096
+#define configMAX_TASK_NAME_LEN  16 /* Terminator included, also bounds the task names kept by the logging task */
 #define configUSE_16_BIT_TICKS   0
 #define portTICK_TYPE_IS_ATOMIC  1
 
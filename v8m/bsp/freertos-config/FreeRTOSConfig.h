@@ -46,13 +46,15 @@ extern uint32_t SystemCoreClock;
 
 #define configUSE_PREEMPTION                    1
 #define configUSE_PORT_OPTIMISED_TASK_SELECTION 0
-#define configUSE_TICKLESS_IDLE                 0
+#ifndef POWER_IDLE
+#define POWER_IDLE                              0 /* Set by the POWER_IDLE CMake option, see power_idle.h. */
+#endif
+#define configUSE_TICKLESS_IDLE                 POWER_IDLE
 #define configCPU_CLOCK_HZ                      ( ( unsigned long ) SystemCoreClock )
 // this is commented out so freeRTOS uses cpu clock for systick
 //#define configSYSTICK_CLOCK_HZ                  ( ( unsigned long ) 100000 )    // ruomor has it that FVP runs around 100kHz systic clock  /* freeRTOS port uses CPU systick counter and that runs from the CPU clock */
 #define configMS_TO_RTOS_TICK( ms )             ( ms ) /* Tick rate is 1000 Hz, so 1 tick is 1 ms */
 #define configMAX_PRIORITIES                    56
-#define configMAX_TASK_NAME_LEN                 16
 #define configIDLE_SHOULD_YIELD                 1
 #define configUSE_TASK_NOTIFICATIONS            1
 #define configTASK_NOTIFICATION_ARRAY_ENTRIES   3
@@ -138,6 +140,17 @@ See http://www.FreeRTOS.org/RTOS-Cortex-M3-M4.html. */
 
 /* A header file that defines trace macro can be included here. */
 
+#if POWER_IDLE
+/* Tickless idle: the sleep state is chosen from the deadlines of the kernel and
+ * of the audio and NPU interrupts, see power_idle.h. */
+extern void power_idle_pre_sleep( uint32_t * idle_ticks );
+extern void power_idle_post_sleep( uint32_t idle_ticks );
+extern void power_idle_ticks_skipped( uint32_t ticks );
+#define configPRE_SLEEP_PROCESSING( xIdleTime )     power_idle_pre_sleep( &( xIdleTime ) )
+#define configPOST_SLEEP_PROCESSING( xIdleTime )    power_idle_post_sleep( xIdleTime )
+#define traceINCREASE_TICK_COUNT( xTicksToJump )    power_idle_ticks_skipped( xTicksToJump )
+#endif
+
 // FIXME: this is just to build freeRTOS demo
 
 /* The address of an echo server that will be used by the two demo echo client
@@ -11,3 +11,7 @@
 #define MEM_SIZE      (20 * 1024)
 
 #define LWIP_NO_STDINT_H 0
+
+/* The Secure Sockets receive dispatcher is woken through a loopback socket. */
+#define LWIP_NETIF_LOOPBACK 1
+#define LWIP_HAVE_LOOPIF    1
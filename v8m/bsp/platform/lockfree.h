@@ -0,0 +1,344 @@
+/* Copyright (c) 2023, Arm Limited and Contributors. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef LOCKFREE_H
+#define LOCKFREE_H
+
+/*
+ * Lock-free primitives for state shared between tasks and interrupt handlers.
+ *
+ * Everything is inline and built on the __atomic builtins of GCC and Clang, so
+ * the same code runs on Armv8-M Mainline (LDREX/STREX) and on a host. Only
+ * 32-bit atomics are used: Armv8-M has no 64-bit exclusive access, wider
+ * values are published with a seqlock.
+ *
+ * On a single core a task which spins on a primitive held by a lower priority
+ * task never lets it finish. The primitives which may spin take a wait
+ * function, called between attempts, which should block for a tick (or yield
+ * on a multi-core host). Pass NULL only when the other side cannot be
+ * preempted by the waiter, e.g. an interrupt handler writing and a task
+ * reading.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Called between two attempts of a spinning operation. */
+typedef void (*lockfree_wait_t)(void);
+
+/* -----------------------------------------------------------------------------
+ *  Counter
+ * -----------------------------------------------------------------------------
+ */
+
+typedef struct {
+    uint32_t value;
+} lockfree_counter_t;
+
+#define LOCKFREE_COUNTER_INIT {0U}
+
+/* Add to the counter, return the new value. */
+static inline uint32_t lockfree_counter_add(lockfree_counter_t *counter, uint32_t n)
+{
+    return __atomic_add_fetch(&counter->value, n, __ATOMIC_RELAXED);
+}
+
+/* Subtract from the counter, return the new value. */
+static inline uint32_t lockfree_counter_sub(lockfree_counter_t *counter, uint32_t n)
+{
+    return __atomic_sub_fetch(&counter->value, n, __ATOMIC_RELAXED);
+}
+
+static inline uint32_t lockfree_counter_load(const lockfree_counter_t *counter)
+{
+    return __atomic_load_n(&counter->value, __ATOMIC_RELAXED);
+}
+
+/* Reset the counter to 0, return its value before. */
+static inline uint32_t lockfree_counter_take(lockfree_counter_t *counter)
+{
+    return __atomic_exchange_n(&counter->value, 0U, __ATOMIC_RELAXED);
+}
+
+/* -----------------------------------------------------------------------------
+ *  Ticket lock
+ *
+ *  A spinlock granted in the order it was requested. Not for interrupt
+ *  handlers: one which preempts the holder never gets the lock.
+ * -----------------------------------------------------------------------------
+ */
+
+typedef struct {
+    uint32_t next;
+    uint32_t owner;
+} lockfree_ticket_lock_t;
+
+#define LOCKFREE_TICKET_LOCK_INIT {0U, 0U}
+
+static inline void lockfree_ticket_lock_acquire(lockfree_ticket_lock_t *lock, lockfree_wait_t wait)
+{
+    uint32_t ticket = __atomic_fetch_add(&lock->next, 1U, __ATOMIC_RELAXED);
+
+    while (__atomic_load_n(&lock->owner, __ATOMIC_ACQUIRE) != ticket) {
+        if (wait != NULL) {
+            wait();
+        }
+    }
+}
+
+static inline bool lockfree_ticket_lock_try_acquire(lockfree_ticket_lock_t *lock)
+{
+    uint32_t owner = __atomic_load_n(&lock->owner, __ATOMIC_RELAXED);
+    uint32_t expected = owner;
+
+    return __atomic_compare_exchange_n(
+        &lock->next, &expected, owner + 1U, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED);
+}
+
+static inline void lockfree_ticket_lock_release(lockfree_ticket_lock_t *lock)
+{
+    uint32_t owner = __atomic_load_n(&lock->owner, __ATOMIC_RELAXED);
+
+    __atomic_store_n(&lock->owner, owner + 1U, __ATOMIC_RELEASE);
+}
+
+/* -----------------------------------------------------------------------------
+ *  Seqlock
+ *
+ *  Publishes a value of any size from one writer at a time to any number of
+ *  readers, which never delay the writer. Readers copy the value and retry if
+ *  it was written meanwhile:
+ *
+ *      do {
+ *          seq = lockfree_seqlock_read_begin(&lock, wait);
+ *          copy = value;
+ *      } while (lockfree_seqlock_read_retry(&lock, seq));
+ * -----------------------------------------------------------------------------
+ */
+
+typedef struct {
+    uint32_t sequence; /* Odd while a write is in progress. */
+} lockfree_seqlock_t;
+
+#define LOCKFREE_SEQLOCK_INIT {0U}
+
+static inline void lockfree_seqlock_write_begin(lockfree_seqlock_t *lock)
+{
+    uint32_t sequence = __atomic_load_n(&lock->sequence, __ATOMIC_RELAXED);
+
+    __atomic_store_n(&lock->sequence, sequence + 1U, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+static inline void lockfree_seqlock_write_end(lockfree_seqlock_t *lock)
+{
+    uint32_t sequence = __atomic_load_n(&lock->sequence, __ATOMIC_RELAXED);
+
+    __atomic_store_n(&lock->sequence, sequence + 1U, __ATOMIC_RELEASE);
+}
+
+/* Wait for any write in progress to end, calling wait in between. */
+static inline uint32_t lockfree_seqlock_read_begin(const lockfree_seqlock_t *lock, lockfree_wait_t wait)
+{
+    uint32_t sequence;
+
+    while (((sequence = __atomic_load_n(&lock->sequence, __ATOMIC_ACQUIRE)) & 1U) != 0U) {
+        if (wait != NULL) {
+            wait();
+        }
+    }
+
+    return sequence;
+}
+
+/* True if the value read since lockfree_seqlock_read_begin() may be torn. */
+static inline bool lockfree_seqlock_read_retry(const lockfree_seqlock_t *lock, uint32_t sequence)
+{
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    return __atomic_load_n(&lock->sequence, __ATOMIC_RELAXED) != sequence;
+}
+
+/* -----------------------------------------------------------------------------
+ *  Single producer, single consumer queue
+ *
+ *  A ring of fixed size items. The producer and the consumer may each be a
+ *  task or an interrupt handler; neither ever waits for the other.
+ * -----------------------------------------------------------------------------
+ */
+
+typedef struct {
+    uint32_t head; /* Written by the producer only. */
+    uint32_t tail; /* Written by the consumer only. */
+    uint32_t mask;
+    size_t item_size;
+    uint8_t *items;
+} lockfree_spsc_queue_t;
+
+/* Size of the storage of a queue, capacity must be a power of 2. */
+#define LOCKFREE_SPSC_QUEUE_STORAGE_SIZE(capacity, item_size) ((size_t)(capacity) * (size_t)(item_size))
+
+/* Return false if capacity is not a power of 2. */
+static inline bool
+lockfree_spsc_queue_init(lockfree_spsc_queue_t *queue, void *storage, uint32_t capacity, size_t item_size)
+{
+    if ((capacity == 0U) || ((capacity & (capacity - 1U)) != 0U)) {
+        return false;
+    }
+
+    queue->head = 0U;
+    queue->tail = 0U;
+    queue->mask = capacity - 1U;
+    queue->item_size = item_size;
+    queue->items = (uint8_t *)storage;
+    return true;
+}
+
+/* Return false if the queue is full. */
+static inline bool lockfree_spsc_queue_push(lockfree_spsc_queue_t *queue, const void *item)
+{
+    uint32_t head = __atomic_load_n(&queue->head, __ATOMIC_RELAXED);
+    uint32_t tail = __atomic_load_n(&queue->tail, __ATOMIC_ACQUIRE);
+
+    if ((head - tail) > queue->mask) {
+        return false;
+    }
+
+    memcpy(&queue->items[(head & queue->mask) * queue->item_size], item, queue->item_size);
+    __atomic_store_n(&queue->head, head + 1U, __ATOMIC_RELEASE);
+    return true;
+}
+
+/* Return false if the queue is empty. */
+static inline bool lockfree_spsc_queue_pop(lockfree_spsc_queue_t *queue, void *item)
+{
+    uint32_t tail = __atomic_load_n(&queue->tail, __ATOMIC_RELAXED);
+    uint32_t head = __atomic_load_n(&queue->head, __ATOMIC_ACQUIRE);
+
+    if (head == tail) {
+        return false;
+    }
+
+    memcpy(item, &queue->items[(tail & queue->mask) * queue->item_size], queue->item_size);
+    __atomic_store_n(&queue->tail, tail + 1U, __ATOMIC_RELEASE);
+    return true;
+}
+
+static inline uint32_t lockfree_spsc_queue_count(const lockfree_spsc_queue_t *queue)
+{
+    return __atomic_load_n(&queue->head, __ATOMIC_ACQUIRE) - __atomic_load_n(&queue->tail, __ATOMIC_ACQUIRE);
+}
+
+/* -----------------------------------------------------------------------------
+ *  Multiple producers, single consumer queue
+ *
+ *  Producers, tasks or interrupt handlers, claim a slot with a compare and
+ *  swap and publish it when filled; they only retry when another producer
+ *  claimed the slot first. An item claimed by a preempted producer hides the
+ *  items behind it from the consumer until it is published, the order of the
+ *  claims is kept.
+ * -----------------------------------------------------------------------------
+ */
+
+typedef struct {
+    uint32_t head; /* Next slot to claim. */
+    uint32_t tail; /* Next slot to consume, written by the consumer only. */
+    uint32_t mask;
+    size_t item_size;
+    size_t slot_size;
+    uint8_t *slots;
+} lockfree_mpsc_queue_t;
+
+/* Each slot holds a sequence number before the item. */
+#define LOCKFREE_MPSC_QUEUE_SLOT_SIZE(item_size) \
+    ((sizeof(uint32_t) + (size_t)(item_size) + sizeof(uint32_t) - 1U) & ~(sizeof(uint32_t) - 1U))
+
+/* Size of the storage of a queue, capacity must be a power of 2. The storage
+ * must be aligned on 4 bytes. */
+#define LOCKFREE_MPSC_QUEUE_STORAGE_SIZE(capacity, item_size) \
+    ((size_t)(capacity) * LOCKFREE_MPSC_QUEUE_SLOT_SIZE(item_size))
+
+static inline uint32_t *lockfree_mpsc_queue_sequence(const lockfree_mpsc_queue_t *queue, uint32_t position)
+{
+    return (uint32_t *)(void *)&queue->slots[(position & queue->mask) * queue->slot_size];
+}
+
+/* Return false if capacity is not a power of 2. */
+static inline bool
+lockfree_mpsc_queue_init(lockfree_mpsc_queue_t *queue, void *storage, uint32_t capacity, size_t item_size)
+{
+    if ((capacity == 0U) || ((capacity & (capacity - 1U)) != 0U)) {
+        return false;
+    }
+
+    queue->head = 0U;
+    queue->tail = 0U;
+    queue->mask = capacity - 1U;
+    queue->item_size = item_size;
+    queue->slot_size = LOCKFREE_MPSC_QUEUE_SLOT_SIZE(item_size);
+    queue->slots = (uint8_t *)storage;
+
+    for (uint32_t i = 0U; i < capacity; i++) {
+        __atomic_store_n(lockfree_mpsc_queue_sequence(queue, i), i, __ATOMIC_RELAXED);
+    }
+
+    return true;
+}
+
+/* Return false if the queue is full. */
+static inline bool lockfree_mpsc_queue_push(lockfree_mpsc_queue_t *queue, const void *item)
+{
+    uint32_t position = __atomic_load_n(&queue->head, __ATOMIC_RELAXED);
+    uint32_t *sequence;
+
+    for (;;) {
+        sequence = lockfree_mpsc_queue_sequence(queue, position);
+        int32_t distance = (int32_t)(__atomic_load_n(sequence, __ATOMIC_ACQUIRE) - position);
+
+        if (distance == 0) {
+            /* The slot is free, claim it. */
+            if (__atomic_compare_exchange_n(
+                    &queue->head, &position, position + 1U, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                break;
+            }
+        } else if (distance < 0) {
+            /* The slot still holds the item of the previous lap. */
+            return false;
+        } else {
+            position = __atomic_load_n(&queue->head, __ATOMIC_RELAXED);
+        }
+    }
+
+    memcpy(sequence + 1, item, queue->item_size);
+    __atomic_store_n(sequence, position + 1U, __ATOMIC_RELEASE);
+    return true;
+}
+
+/* Return false if the queue is empty or its next item is not published yet. */
+static inline bool lockfree_mpsc_queue_pop(lockfree_mpsc_queue_t *queue, void *item)
+{
+    uint32_t position = queue->tail;
+    uint32_t *sequence = lockfree_mpsc_queue_sequence(queue, position);
+
+    if (__atomic_load_n(sequence, __ATOMIC_ACQUIRE) != (position + 1U)) {
+        return false;
+    }
+
+    memcpy(item, sequence + 1, queue->item_size);
+    /* Free the slot for the next lap. */
+    __atomic_store_n(sequence, position + queue->mask + 1U, __ATOMIC_RELEASE);
+    queue->tail = position + 1U;
+    return true;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LOCKFREE_H */
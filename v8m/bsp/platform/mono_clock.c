@@ -0,0 +1,50 @@
+/* Copyright (c) 2023, Arm Limited and Contributors. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "mono_clock.h"
+
+#include "device_cfg.h"
+#include "platform_base_address.h"
+#include "systimer_armv8-m_drv.h"
+
+/* All the timer frames show the same system counter. */
+#define MONO_CLOCK_FREQ_HZ SYSTIMER0_ARMV8M_DEFAULT_FREQ_HZ
+
+/* TF-M grants the frames of the system timers to the non-secure side. Only the
+ * counter of this one is read, the timer is left disabled. */
+static const struct systimer_armv8_m_dev_cfg_t mono_clock_timer_cfg = {
+    .base = SYSTIMER1_ARMV8_M_BASE_NS,
+    .default_freq_hz = MONO_CLOCK_FREQ_HZ,
+};
+
+static struct systimer_armv8_m_dev_data_t mono_clock_timer_data = {.is_initialized = false};
+
+static struct systimer_armv8_m_dev_t mono_clock_timer = {&mono_clock_timer_cfg, &mono_clock_timer_data};
+
+uint32_t mono_clock_get_freq(void)
+{
+    return MONO_CLOCK_FREQ_HZ;
+}
+
+uint64_t mono_clock_get_ticks(void)
+{
+    /* Reads high, low, high until the high word is stable: no lock is needed
+     * for a consistent 64-bit value. */
+    return systimer_armv8_m_get_counter_value(&mono_clock_timer);
+}
+
+uint64_t mono_clock_ticks_to_us(uint64_t ticks)
+{
+#if (MONO_CLOCK_FREQ_HZ % 1000000UL) == 0
+    return ticks / (MONO_CLOCK_FREQ_HZ / 1000000UL);
+#else
+    /* Split the conversion so that the multiplication does not overflow. */
+    return ((ticks / MONO_CLOCK_FREQ_HZ) * 1000000U) + (((ticks % MONO_CLOCK_FREQ_HZ) * 1000000U) / MONO_CLOCK_FREQ_HZ);
+#endif
+}
+
+uint64_t mono_clock_get_us(void)
+{
+    return mono_clock_ticks_to_us(mono_clock_get_ticks());
+}
@@ -0,0 +1,47 @@
+/* Copyright (c) 2023, Arm Limited and Contributors. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef MONO_CLOCK_H
+#define MONO_CLOCK_H
+
+/*
+ * Monotonic clock on the Armv8-M system counter.
+ *
+ * The counter is enabled by TF-M before the non-secure image starts, is 64-bit
+ * wide and keeps counting while the CPU sleeps. Reads take no lock and no
+ * kernel call, so the clock can be used from interrupt handlers and from tasks
+ * alike, and before the scheduler starts.
+ */
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Frequency of the counter in Hz.
+ */
+uint32_t mono_clock_get_freq(void);
+
+/**
+ * @brief Current value of the counter, in counter ticks since boot.
+ */
+uint64_t mono_clock_get_ticks(void);
+
+/**
+ * @brief Convert a number of counter ticks to microseconds.
+ */
+uint64_t mono_clock_ticks_to_us(uint64_t ticks);
+
+/**
+ * @brief Microseconds since boot.
+ */
+uint64_t mono_clock_get_us(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MONO_CLOCK_H */
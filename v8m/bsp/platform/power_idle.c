@@ -0,0 +1,184 @@
+/* Copyright (c) 2023, Arm Limited and Contributors. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "power_idle.h"
+
+#include "cmsis_os2.h"
+#include "print_log.h"
+#include CMSIS_device_header
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <string.h>
+
+typedef struct {
+    volatile uint32_t period_ticks; /* 0 if the source is not periodic. */
+    volatile uint32_t last_event_tick;
+    volatile bool event_while_asleep;
+    volatile uint32_t busy;
+} power_idle_source_state_t;
+
+static power_idle_source_state_t sources[POWER_IDLE_SOURCE_COUNT];
+static power_idle_stats_t stats;
+static power_idle_state_t sleep_state = POWER_IDLE_STATE_ACTIVE;
+static volatile bool asleep = false;
+
+/* Ticks until the earliest interrupt expected from the sources, 0 if one may
+ * come at any time. */
+static uint32_t ticks_to_next_event(uint32_t now, uint32_t limit)
+{
+    uint32_t next = limit;
+
+    for (uint32_t i = 0; i < POWER_IDLE_SOURCE_COUNT; i++) {
+        const power_idle_source_state_t *source = &sources[i];
+        uint32_t period = source->period_ticks;
+
+        if (source->busy != 0U) {
+            return 0U;
+        }
+
+        if (period != 0U) {
+            uint32_t elapsed = now - source->last_event_tick;
+            uint32_t remaining = (elapsed >= period) ? 0U : (period - elapsed);
+
+            if (remaining < next) {
+                next = remaining;
+            }
+        }
+    }
+
+    return next;
+}
+
+static power_idle_state_t select_state(uint32_t deadline_ticks)
+{
+#if POWER_IDLE
+    if (deadline_ticks >= POWER_IDLE_DEEP_SLEEP_MIN_TICKS) {
+        return POWER_IDLE_STATE_DEEP_SLEEP;
+    }
+#else
+    (void)deadline_ticks;
+#endif
+    return POWER_IDLE_STATE_SLEEP;
+}
+
+void power_idle_periodic_start(power_idle_source_t source, uint32_t period_us)
+{
+    uint64_t period_ticks = ((uint64_t)period_us * osKernelGetTickFreq()) / 1000000U;
+
+    sources[source].last_event_tick = osKernelGetTickCount();
+    /* Round down, waking up early only costs a shallower sleep. */
+    sources[source].period_ticks = (period_ticks == 0U) ? 1U : (uint32_t)period_ticks;
+}
+
+void power_idle_periodic_stop(power_idle_source_t source)
+{
+    sources[source].period_ticks = 0U;
+}
+
+void power_idle_event(power_idle_source_t source)
+{
+    /* The handler of an interrupt which ended a sleep runs before the kernel
+     * steps its tick count, the time is corrected in power_idle_ticks_skipped(). */
+    sources[source].last_event_tick = osKernelGetTickCount();
+    sources[source].event_while_asleep = asleep;
+}
+
+void power_idle_busy_begin(power_idle_source_t source)
+{
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    sources[source].busy++;
+    __set_PRIMASK(primask);
+}
+
+void power_idle_busy_end(power_idle_source_t source)
+{
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    if (sources[source].busy != 0U) {
+        sources[source].busy--;
+    }
+    __set_PRIMASK(primask);
+}
+
+void power_idle_pre_sleep(uint32_t *idle_ticks)
+{
+    uint32_t deadline = ticks_to_next_event(osKernelGetTickCount(), *idle_ticks);
+
+    sleep_state = select_state(deadline);
+    stats.entries[sleep_state]++;
+
+    if (sleep_state == POWER_IDLE_STATE_DEEP_SLEEP) {
+        SCB->SCR |= SCB_SCR_SLEEPDEEP_Msk;
+    }
+
+    asleep = true;
+}
+
+void power_idle_post_sleep(uint32_t idle_ticks)
+{
+    (void)idle_ticks;
+
+    if (sleep_state == POWER_IDLE_STATE_DEEP_SLEEP) {
+        SCB->SCR &= ~SCB_SCR_SLEEPDEEP_Msk;
+    }
+}
+
+void power_idle_ticks_skipped(uint32_t ticks)
+{
+    for (uint32_t i = 0; i < POWER_IDLE_SOURCE_COUNT; i++) {
+        if (sources[i].event_while_asleep) {
+            sources[i].last_event_tick += ticks;
+            sources[i].event_while_asleep = false;
+        }
+    }
+
+    stats.residency_ticks[sleep_state] += ticks;
+    stats.tick_interrupts_avoided += ticks;
+    sleep_state = POWER_IDLE_STATE_ACTIVE;
+    asleep = false;
+}
+
+void power_idle_get_stats(power_idle_stats_t *out)
+{
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    memcpy(out, &stats, sizeof(*out));
+    __set_PRIMASK(primask);
+
+    out->total_ticks = osKernelGetTickCount();
+    out->residency_ticks[POWER_IDLE_STATE_ACTIVE] = out->total_ticks
+                                                    - out->residency_ticks[POWER_IDLE_STATE_SLEEP]
+                                                    - out->residency_ticks[POWER_IDLE_STATE_DEEP_SLEEP];
+}
+
+static uint32_t permille(uint32_t part, uint32_t total)
+{
+    return (total == 0U) ? 0U : (uint32_t)(((uint64_t)part * 1000U) / total);
+}
+
+void power_idle_report(void)
+{
+    power_idle_stats_t report;
+    power_idle_get_stats(&report);
+
+    uint32_t active = permille(report.residency_ticks[POWER_IDLE_STATE_ACTIVE], report.total_ticks);
+    uint32_t sleep = permille(report.residency_ticks[POWER_IDLE_STATE_SLEEP], report.total_ticks);
+    uint32_t deep = permille(report.residency_ticks[POWER_IDLE_STATE_DEEP_SLEEP], report.total_ticks);
+
+    INFO_LOG("Power residency over %" PRIu32 " ticks: active %" PRIu32 ".%" PRIu32 "%%, sleep %" PRIu32 ".%" PRIu32
+             "%% (%" PRIu32 " entries), deep sleep %" PRIu32 ".%" PRIu32 "%% (%" PRIu32 " entries), %" PRIu32
+             " tick interrupts avoided\r\n",
+             report.total_ticks,
+             active / 10U,
+             active % 10U,
+             sleep / 10U,
+             sleep % 10U,
+             report.entries[POWER_IDLE_STATE_SLEEP],
+             deep / 10U,
+             deep % 10U,
+             report.entries[POWER_IDLE_STATE_DEEP_SLEEP],
+             report.tick_interrupts_avoided);
+}
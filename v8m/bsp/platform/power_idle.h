@@ -0,0 +1,138 @@
+/* Copyright (c) 2023, Arm Limited and Contributors. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef POWER_IDLE_H
+#define POWER_IDLE_H
+
+/*
+ * Low power idle policy.
+ *
+ * With tickless idle the kernel stops the tick when all tasks are blocked and
+ * calls power_idle_pre_sleep() with the number of ticks until the next task or
+ * timer deadline, which covers the MQTT keep-alive, the blink task and every
+ * other timeout. The audio interface and the NPU raise interrupts the kernel
+ * cannot foresee, so the drivers report them here. The sleep state is the
+ * deepest one whose wake-up fits before the earliest of these deadlines.
+ *
+ * The deadlines only choose between SLEEP and DEEP_SLEEP, they never shorten
+ * or skip a sleep: the interrupts end it when they come.
+ *
+ * All of it is behind the POWER_IDLE CMake option, off by default. Without it
+ * the kernel keeps its tick, the examples print no report and the sources are
+ * reported for nothing. Only the FreeRTOS build calls the hooks, see
+ * FreeRTOSConfig.h. With another kernel the report shows no sleep.
+ */
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Set to 1 by the POWER_IDLE CMake option to enable tickless idle and deep
+ * sleep. The SysTick is clocked by the CPU, so this is only safe on platforms
+ * which keep that clock running in deep sleep, like the FVP, otherwise the
+ * kernel misses its deadlines. */
+#ifndef POWER_IDLE
+#define POWER_IDLE 0
+#endif
+
+/* Shortest time to the next deadline, in ticks, for which deep sleep is worth
+ * its entry and exit latency. */
+#ifndef POWER_IDLE_DEEP_SLEEP_MIN_TICKS
+#define POWER_IDLE_DEEP_SLEEP_MIN_TICKS 6U
+#endif
+
+typedef enum {
+    POWER_IDLE_STATE_ACTIVE = 0, /* Running, or idle for less than a tickless sleep. */
+    POWER_IDLE_STATE_SLEEP,      /* WFI, the CPU clock is gated. */
+    POWER_IDLE_STATE_DEEP_SLEEP, /* WFI with SLEEPDEEP, the CPU power domain may be lowered. */
+    POWER_IDLE_STATE_COUNT
+} power_idle_state_t;
+
+/* Sources of interrupts the kernel does not know about. */
+typedef enum {
+    POWER_IDLE_SOURCE_AUDIO = 0, /* A block from the audio interface, periodic. */
+    POWER_IDLE_SOURCE_NPU,       /* Completion of an inference on the NPU. */
+    POWER_IDLE_SOURCE_COUNT
+} power_idle_source_t;
+
+typedef struct {
+    uint32_t total_ticks;                                /* Ticks since boot. */
+    uint32_t residency_ticks[POWER_IDLE_STATE_COUNT];    /* Whole ticks spent in each state. */
+    uint32_t entries[POWER_IDLE_STATE_COUNT];            /* Times each sleep state was entered. */
+    uint32_t tick_interrupts_avoided;                    /* Tick interrupts suppressed while sleeping. */
+} power_idle_stats_t;
+
+/**
+ * @brief Report that a source raises an interrupt every period from now on.
+ *
+ * @param source The source.
+ * @param period_us Time between two interrupts in microseconds.
+ */
+void power_idle_periodic_start(power_idle_source_t source, uint32_t period_us);
+
+/**
+ * @brief Report that a periodic source stopped.
+ */
+void power_idle_periodic_stop(power_idle_source_t source);
+
+/**
+ * @brief Report an interrupt of a periodic source, from its handler.
+ *
+ * The next interrupt is expected one period later.
+ */
+void power_idle_event(power_idle_source_t source);
+
+/**
+ * @brief Report that a source is processing and will raise an interrupt when
+ * done, at a time not known in advance. Calls can be nested and must be
+ * balanced with power_idle_busy_end().
+ */
+void power_idle_busy_begin(power_idle_source_t source);
+
+/**
+ * @brief Report that a source finished processing.
+ */
+void power_idle_busy_end(power_idle_source_t source);
+
+/**
+ * @brief Choose the sleep state for an idle period of the kernel.
+ *
+ * Called by the kernel with interrupts masked, before WFI.
+ *
+ * @param[in,out] idle_ticks Ticks until the next kernel deadline. Set to 0 to
+ * skip the sleep.
+ */
+void power_idle_pre_sleep(uint32_t *idle_ticks);
+
+/**
+ * @brief Restore the state changed by power_idle_pre_sleep(), after WFI.
+ *
+ * @param idle_ticks Ticks the kernel expected to be idle for.
+ */
+void power_idle_post_sleep(uint32_t idle_ticks);
+
+/**
+ * @brief Account the ticks the kernel skipped during the last sleep.
+ *
+ * Called by the kernel when it steps its tick count after a sleep.
+ */
+void power_idle_ticks_skipped(uint32_t ticks);
+
+/**
+ * @brief Copy the residency statistics.
+ */
+void power_idle_get_stats(power_idle_stats_t *stats);
+
+/**
+ * @brief Print the residency of each state and the tick interrupts avoided.
+ */
+void power_idle_report(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* POWER_IDLE_H */
@@ -21,6 +21,7 @@
 #include "ethos-u55.h"     /* Mem map and configuration definitions of the Ethos U55 */
 #include "ethosu_driver.h" /* Arm Ethos-U55 driver header */
 #include "hal.h"
+#include "power_idle.h"
 #include "smm_mps3.h"       /* Mem map for MPS3 peripherals. */
 #include "timer_mps3.h"     /* Timer functions. */
 #include "timing_adapter.h" /* Driver header of the timing adapter */
@@ -199,6 +200,8 @@ static void AudioEvent(mdh_sai_t *self, void *ctx, mdh_sai_transfer_complete_t c
         printf_err("Transfer cancelled\n");
     }
     if (code == MDH_SAI_TRANSFER_COMPLETE_DONE) {
+        power_idle_event(POWER_IDLE_SOURCE_AUDIO);
+
         if (event_fn) {
             event_fn(event_ptr);
         }
@@ -244,6 +247,10 @@ int AudioDrv_Setup(void (*event_handler)(void *), void *event_handler_ptr)
         return ret;
     }
 
+    /* One block of 16-bit mono samples completes every period. */
+    power_idle_periodic_start(POWER_IDLE_SOURCE_AUDIO,
+                              static_cast<uint32_t>((AUDIO_BLOCK_SIZE / 2U) * 1000000ULL / kAudioSampleFrequency));
+
     event_fn = event_handler;
     event_ptr = event_handler_ptr;
 
@@ -499,7 +506,10 @@ void ProcessAudio(ApplicationContext &ctx)
             }
 
             /* Run inference over this audio clip sliding window. */
-            if (!model.RunInference()) {
+            power_idle_busy_begin(POWER_IDLE_SOURCE_NPU);
+            bool inference_ok = model.RunInference();
+            power_idle_busy_end(POWER_IDLE_SOURCE_NPU);
+            if (!inference_ok) {
                 printf_err("Failed to run inference");
                 return;
             }
@@ -51,6 +51,7 @@ public:
         printf("DSP Source\r\n");
 
         set_audio_timestamp(1.0*outputSize / SAMPLE_RATE);
+        set_audio_capture_time(mDsp->getCurrentBufferTimestamp());
 
         int16_t *b=this->getWriteBuffer();
         int16_t *current = mDsp->getCurrentBuffer();
@@ -6,10 +6,17 @@
 #define _DSP_INTERFACE_H_
 
 #include "cmsis_os2.h"
+#include "lockfree.h"
+
+#include <cstdint>
 
 extern void set_audio_timestamp(float timestamp);
 extern float get_audio_timestamp();
 
+// Capture time of the audio being processed, in microseconds of mono_clock
+extern void set_audio_capture_time(uint64_t capture_time_us);
+extern uint64_t get_audio_capture_time();
+
 // Communication between DspAudioSource and ISR
 struct DspAudioSource { 
     public:
@@ -17,6 +24,9 @@ struct DspAudioSource {
 
     int16_t *getCurrentBuffer();
 
+    // Time at which the current buffer was filled, in microseconds
+    uint64_t getCurrentBufferTimestamp();
+
     void waitForNewBuffer();
 
     static void new_audio_block_received(void* ptr);
@@ -25,6 +35,8 @@ private:
     size_t block_count;
     size_t block_under_write = 0;
     size_t current_block = 0;
+    uint64_t current_block_timestamp_us = 0;
+    lockfree_seqlock_t timestamp_lock = LOCKFREE_SEQLOCK_INIT;
     int16_t* audiobuffer;
     osSemaphoreId_t semaphore = osSemaphoreNew(1, 0, NULL);
 };
@@ -48,4 +60,4 @@ private:
     size_t nbSamples;
 };
 
-#endif
\ No newline at end of file
+#endif
\ No newline at end of file
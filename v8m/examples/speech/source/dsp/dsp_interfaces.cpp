@@ -4,7 +4,9 @@
 
 #include "dsp_interfaces.h"
 #include "audio_config.h"
+#include "lockfree.h"
 #include "model_config.h"
+#include "mono_clock.h"
 #include "print_log.h"
 
 #include <cstddef>
@@ -13,25 +15,50 @@
 // For memcpy
 #include <cstring>
 
-extern "C" {
-#include "hal-toolbox/critical_section_api.h"
-}
-
+// Written by the DSP task, read by the ML task
 static float audio_timestamp = 0.0;
+static uint64_t audio_capture_time = 0;
+static lockfree_seqlock_t audio_timestamp_lock = LOCKFREE_SEQLOCK_INIT;
 
-void set_audio_timestamp(float timestamp) { 
-    hal_critical_section_enter();
+// The ML task runs at a higher priority than the DSP task, it must block to
+// let a write in progress finish.
+static void audio_timestamp_wait()
+{
+    osDelay(1);
+}
+
+void set_audio_timestamp(float timestamp) {
+    lockfree_seqlock_write_begin(&audio_timestamp_lock);
     audio_timestamp = timestamp;
-    hal_critical_section_exit();
+    lockfree_seqlock_write_end(&audio_timestamp_lock);
 }
 
 float get_audio_timestamp() {
-    hal_critical_section_enter();
-    float timestamp = audio_timestamp;
-    hal_critical_section_exit();
+    float timestamp;
+    uint32_t sequence;
+    do {
+        sequence = lockfree_seqlock_read_begin(&audio_timestamp_lock, audio_timestamp_wait);
+        timestamp = audio_timestamp;
+    } while (lockfree_seqlock_read_retry(&audio_timestamp_lock, sequence));
     return timestamp;
 }
 
+void set_audio_capture_time(uint64_t capture_time_us) {
+    lockfree_seqlock_write_begin(&audio_timestamp_lock);
+    audio_capture_time = capture_time_us;
+    lockfree_seqlock_write_end(&audio_timestamp_lock);
+}
+
+uint64_t get_audio_capture_time() {
+    uint64_t capture_time_us;
+    uint32_t sequence;
+    do {
+        sequence = lockfree_seqlock_read_begin(&audio_timestamp_lock, audio_timestamp_wait);
+        capture_time_us = audio_capture_time;
+    } while (lockfree_seqlock_read_retry(&audio_timestamp_lock, sequence));
+    return capture_time_us;
+}
+
 DspAudioSource::DspAudioSource(int16_t* audiobuffer, size_t block_count ):
         block_count{block_count},
         audiobuffer{audiobuffer} 
@@ -44,6 +71,18 @@ int16_t *DspAudioSource::getCurrentBuffer()
     return(audiobuffer+this->current_block*(AUDIO_BLOCK_SIZE/2));
 }
 
+uint64_t DspAudioSource::getCurrentBufferTimestamp()
+{
+    // Written by the ISR, which never waits for the task
+    uint64_t timestamp;
+    uint32_t sequence;
+    do {
+        sequence = lockfree_seqlock_read_begin(&this->timestamp_lock, NULL);
+        timestamp = this->current_block_timestamp_us;
+    } while (lockfree_seqlock_read_retry(&this->timestamp_lock, sequence));
+    return timestamp;
+}
+
 void DspAudioSource::waitForNewBuffer()
 {
     osSemaphoreAcquire(this->semaphore, osWaitForever);
@@ -55,6 +94,9 @@ void DspAudioSource::new_audio_block_received(void* ptr)
     
     // Update block ID
     self->current_block = self->block_under_write;
+    lockfree_seqlock_write_begin(&self->timestamp_lock);
+    self->current_block_timestamp_us = mono_clock_get_us();
+    lockfree_seqlock_write_end(&self->timestamp_lock);
     self->block_under_write = ((self->block_under_write + 1) % self->block_count);
 
     // Wakeup task waiting
@@ -18,6 +18,7 @@ extern "C" {
 }
 
 #include "audio_config.h"
+#include "power_idle.h"
 #include "print_log.h"
 
 // audio constants
@@ -45,6 +46,8 @@ static void AudioEvent(mdh_sai_t *self, void *ctx, mdh_sai_transfer_complete_t c
     }
 
     if (code == MDH_SAI_TRANSFER_COMPLETE_DONE) {
+        power_idle_event(POWER_IDLE_SOURCE_AUDIO);
+
         if (event_fn) {
             event_fn(event_ptr);
         }
@@ -89,6 +92,10 @@ static int AudioDrv_Setup(void (*event_handler)(void *), void *event_handler_ptr
         return ret;
     }
 
+    power_idle_periodic_start(
+        POWER_IDLE_SOURCE_AUDIO,
+        static_cast<uint32_t>((AUDIO_BLOCK_SIZE / (CHANNELS * (SAMPLE_BITS / 8U))) * 1000000ULL / SAMPLE_RATE));
+
     event_fn = event_handler;
     event_ptr = event_handler_ptr;
 
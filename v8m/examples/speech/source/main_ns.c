@@ -9,6 +9,7 @@
 #include "dsp_task.h"
 #include "mbedtls/platform.h"
 #include "ml_interface.h"
+#include "power_idle.h"
 
 #include <stdbool.h>
 #include <stdio.h>
@@ -30,6 +31,8 @@
 __asm("  .global __ARM_use_no_argv\n");
 #endif
 
+#define POWER_REPORT_PERIOD_MS 60000U
+
 extern uint32_t tfm_ns_interface_init(void);
 extern void vUARTLockInit(void);
 extern int endpoint_init(void);
@@ -103,9 +106,17 @@ void main_task(void *arg)
         printf("Failed to start endpoint task\r\n");
     }
 
+#if POWER_IDLE
+    const uint32_t report_interval = POWER_REPORT_PERIOD_MS * osKernelGetTickFreq() / 1000U;
+    while (1) {
+        osDelay(report_interval);
+        power_idle_report();
+    };
+#else
     while (1) {
         osDelay(osWaitForever);
     };
+#endif
     return;
 }
 
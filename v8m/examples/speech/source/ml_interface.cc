@@ -27,6 +27,8 @@
 #include "ethosu_driver.h" /* Arm Ethos-U55 driver header */
 #include "hal.h"
 #include "model_config.h"
+#include "mono_clock.h"
+#include "power_idle.h"
 #include "smm_mps3.h"       /* Mem map for MPS3 peripherals. */
 #include "timer_mps3.h"     /* Timer functions. */
 #include "timing_adapter.h" /* Driver header of the timing adapter */
@@ -256,6 +258,8 @@ void ProcessAudio(ApplicationContext &ctx, DSPML *dspMLConnection)
             // inference is starting and not to the time of the
             // beginning of the audio segment used for this inference.
             float currentTimeStamp = get_audio_timestamp();
+            // Capture time of the latest audio block read by the DSP
+            uint64_t captureTimeUs = get_audio_capture_time();
             info("Inference %i/%i\n", inferenceIndex + 1, maxNbInference);
 
             /* Run the pre-processing, inference and post-processing. */
@@ -266,7 +270,10 @@ void ProcessAudio(ApplicationContext &ctx, DSPML *dspMLConnection)
             info("Start running inference\n");
 
             /* Run inference over this audio clip sliding window. */
-            if (!model.RunInference()) {
+            power_idle_busy_begin(POWER_IDLE_SOURCE_NPU);
+            bool inference_ok = model.RunInference();
+            power_idle_busy_end(POWER_IDLE_SOURCE_NPU);
+            if (!inference_ok) {
                 printf_err("Failed to run inference");
                 return;
             }
@@ -279,7 +286,7 @@ void ProcessAudio(ApplicationContext &ctx, DSPML *dspMLConnection)
                 printf_err("Post-processing failed.");
             }
 
-            info("Inference done\n");
+            info("Inference done, %" PRIu64 " us after capture\n", mono_clock_get_us() - captureTimeUs);
 
             std::vector<ClassificationResult> classificationResult;
             auto &classifier = ctx.Get<AsrClassifier &>("classifier");
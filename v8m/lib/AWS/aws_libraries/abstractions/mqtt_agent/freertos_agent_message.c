@@ -37,6 +37,129 @@
 /* Header include. */
 #include "freertos_agent_message.h"
 #include "core_mqtt_agent_message_interface.h"
+#include "core_mqtt_agent.h"
+
+/*-----------------------------------------------------------*/
+
+static const uint32_t laneWeights[ MQTT_AGENT_LANE_COUNT ] = MQTT_AGENT_LANE_WEIGHTS;
+
+/*-----------------------------------------------------------*/
+
+static MQTTAgentLane_t prvCommandLane( const MQTTAgentCommand_t * pCommand )
+{
+    MQTTAgentLane_t lane = MQTT_AGENT_LANE_CONTROL;
+    const MQTTPublishInfo_t * pPublishInfo;
+
+    if( pCommand->commandType == PUBLISH )
+    {
+        pPublishInfo = ( const MQTTPublishInfo_t * ) pCommand->pArgs;
+        lane = MQTT_AGENT_LANE_TELEMETRY;
+
+        if( ( pPublishInfo != NULL ) &&
+            ( pPublishInfo->topicNameLength >= ( sizeof( MQTT_AGENT_OTA_TOPIC_PREFIX ) - 1U ) ) &&
+            ( strncmp( pPublishInfo->pTopicName,
+                       MQTT_AGENT_OTA_TOPIC_PREFIX,
+                       sizeof( MQTT_AGENT_OTA_TOPIC_PREFIX ) - 1U ) == 0 ) )
+        {
+            lane = MQTT_AGENT_LANE_OTA;
+        }
+    }
+
+    return lane;
+}
+
+/*-----------------------------------------------------------*/
+
+/* Make the oldest command of a lane visible to the agent. */
+static bool prvLaneHead( MQTTAgentMessageContext_t * pMsgCtx,
+                         uint32_t lane )
+{
+    if( pMsgCtx->headValid[ lane ] == false )
+    {
+        pMsgCtx->headValid[ lane ] = ( osMessageQueueGet( pMsgCtx->lanes[ lane ],
+                                                          &pMsgCtx->heads[ lane ],
+                                                          NULL,
+                                                          0U ) == osOK );
+    }
+
+    return pMsgCtx->headValid[ lane ];
+}
+
+/*-----------------------------------------------------------*/
+
+/* A command may only overtake older commands if neither is a control command.
+ * Sequence numbers grow within each lane, so comparing the heads is enough. */
+static bool prvMayTake( MQTTAgentMessageContext_t * pMsgCtx,
+                        uint32_t lane )
+{
+    uint32_t sequence = pMsgCtx->heads[ lane ].sequence;
+    uint32_t other;
+
+    for( other = 0U; other < MQTT_AGENT_LANE_COUNT; other++ )
+    {
+        if( ( other != lane ) &&
+            ( ( lane == MQTT_AGENT_LANE_CONTROL ) || ( other == MQTT_AGENT_LANE_CONTROL ) ) &&
+            prvLaneHead( pMsgCtx, other ) &&
+            ( ( int32_t ) ( pMsgCtx->heads[ other ].sequence - sequence ) < 0 ) )
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvRecordLatency( MQTTAgentLaneStats_t * pStats,
+                              uint32_t enqueuedTicks )
+{
+    uint32_t latencyMs = ( uint32_t ) ( ( ( uint64_t ) ( osKernelGetTickCount() - enqueuedTicks ) * 1000U ) /
+                                        osKernelGetTickFreq() );
+    uint32_t bucket = 0U;
+
+    while( ( bucket < ( MQTT_AGENT_LATENCY_BUCKETS - 1U ) ) && ( latencyMs >= ( 1UL << bucket ) ) )
+    {
+        bucket++;
+    }
+
+    pStats->received++;
+    pStats->latencyHistogram[ bucket ]++;
+
+    if( latencyMs > pStats->maxLatencyMs )
+    {
+        pStats->maxLatencyMs = latencyMs;
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+bool Agent_MessageContextInit( MQTTAgentMessageContext_t * pMsgCtx,
+                               uint32_t laneLength )
+{
+    bool created = false;
+    uint32_t lane;
+
+    if( pMsgCtx != NULL )
+    {
+        memset( pMsgCtx, 0x00, sizeof( MQTTAgentMessageContext_t ) );
+        created = true;
+
+        for( lane = 0U; lane < MQTT_AGENT_LANE_COUNT; lane++ )
+        {
+            pMsgCtx->lanes[ lane ] = osMessageQueueNew( laneLength, sizeof( MQTTAgentLaneItem_t ), NULL );
+            pMsgCtx->space[ lane ] = osSemaphoreNew( laneLength, laneLength, NULL );
+            pMsgCtx->credits[ lane ] = laneWeights[ lane ];
+            created = created && ( pMsgCtx->lanes[ lane ] != NULL ) && ( pMsgCtx->space[ lane ] != NULL );
+        }
+
+        pMsgCtx->sendMutex = osMutexNew( NULL );
+        pMsgCtx->pending = osSemaphoreNew( laneLength * MQTT_AGENT_LANE_COUNT, 0U, NULL );
+        created = created && ( pMsgCtx->sendMutex != NULL ) && ( pMsgCtx->pending != NULL );
+    }
+
+    return created;
+}
 
 /*-----------------------------------------------------------*/
 
@@ -45,10 +168,40 @@ bool Agent_MessageSend( MQTTAgentMessageContext_t * pMsgCtx,
                         uint32_t blockTimeMs )
 {
     osStatus_t queueStatus = osError;
+    MQTTAgentLaneItem_t item;
+    MQTTAgentLane_t lane;
 
-    if( ( pMsgCtx != NULL ) && ( pCommandToSend != NULL ) )
+    if( ( pMsgCtx != NULL ) && ( pCommandToSend != NULL ) && ( *pCommandToSend != NULL ) )
     {
-        queueStatus = osMessageQueuePut( pMsgCtx->queue, pCommandToSend, 0U, pdMS_TO_TICKS( blockTimeMs ) );
+        item.pCommand = *pCommandToSend;
+        lane = prvCommandLane( item.pCommand );
+
+        /* Only the lane of the command can be full, other traffic is not held up. */
+        if( osSemaphoreAcquire( pMsgCtx->space[ lane ], pdMS_TO_TICKS( blockTimeMs ) ) == osOK )
+        {
+            /* The lane has room, so the mutex is only held while the command is
+             * numbered and queued, which keeps the numbers in queue order. */
+            ( void ) osMutexAcquire( pMsgCtx->sendMutex, osWaitForever );
+            item.enqueuedTicks = osKernelGetTickCount();
+            item.sequence = pMsgCtx->nextSequence;
+            queueStatus = osMessageQueuePut( pMsgCtx->lanes[ lane ], &item, 0U, 0U );
+
+            if( queueStatus == osOK )
+            {
+                pMsgCtx->nextSequence++;
+            }
+
+            ( void ) osMutexRelease( pMsgCtx->sendMutex );
+
+            if( queueStatus == osOK )
+            {
+                ( void ) osSemaphoreRelease( pMsgCtx->pending );
+            }
+            else
+            {
+                ( void ) osSemaphoreRelease( pMsgCtx->space[ lane ] );
+            }
+        }
     }
 
     return ( queueStatus == osOK ) ? true : false;
@@ -60,12 +213,59 @@ bool Agent_MessageReceive( MQTTAgentMessageContext_t * pMsgCtx,
                            MQTTAgentCommand_t ** pReceivedCommand,
                            uint32_t blockTimeMs )
 {
-    osStatus_t queueStatus = osError;
+    bool received = false;
+    uint32_t lane;
+    uint32_t round;
 
-    if( ( pMsgCtx != NULL ) && ( pReceivedCommand != NULL ) )
+    if( ( pMsgCtx != NULL ) && ( pReceivedCommand != NULL ) &&
+        ( osSemaphoreAcquire( pMsgCtx->pending, pdMS_TO_TICKS( blockTimeMs ) ) == osOK ) )
     {
-        queueStatus = osMessageQueueGet( pMsgCtx->queue, pReceivedCommand, NULL, pdMS_TO_TICKS( blockTimeMs ) );
+        /* A command is queued in one of the lanes. Take it from the highest
+         * priority lane that has credits left and whose oldest command is not
+         * held back by a barrier; once no such lane has a command, start a new
+         * round with fresh credits. The oldest command of all can always be
+         * taken, so the second round succeeds. */
+        for( round = 0U; ( round < 2U ) && ( received == false ); round++ )
+        {
+            for( lane = 0U; ( lane < MQTT_AGENT_LANE_COUNT ) && ( received == false ); lane++ )
+            {
+                received = ( pMsgCtx->credits[ lane ] > 0U ) &&
+                           prvLaneHead( pMsgCtx, lane ) &&
+                           prvMayTake( pMsgCtx, lane );
+            }
+
+            if( received == true )
+            {
+                lane--;
+                pMsgCtx->credits[ lane ]--;
+                prvRecordLatency( &pMsgCtx->stats[ lane ], pMsgCtx->heads[ lane ].enqueuedTicks );
+                *pReceivedCommand = pMsgCtx->heads[ lane ].pCommand;
+                pMsgCtx->headValid[ lane ] = false;
+                ( void ) osSemaphoreRelease( pMsgCtx->space[ lane ] );
+            }
+            else
+            {
+                memcpy( pMsgCtx->credits, laneWeights, sizeof( laneWeights ) );
+            }
+        }
     }
 
-    return ( queueStatus == osOK ) ? true : false;
+    return received;
+}
+
+/*-----------------------------------------------------------*/
+
+bool Agent_MessageGetLaneStats( const MQTTAgentMessageContext_t * pMsgCtx,
+                                MQTTAgentLane_t lane,
+                                MQTTAgentLaneStats_t * pStats )
+{
+    bool copied = false;
+
+    if( ( pMsgCtx != NULL ) && ( pStats != NULL ) && ( lane < MQTT_AGENT_LANE_COUNT ) )
+    {
+        *pStats = pMsgCtx->stats[ lane ];
+        copied = true;
+    }
+
+    return copied;
 }
@@ -41,10 +41,22 @@
 #include "freertos_command_pool.h"
 #include "freertos_agent_message.h"
 
+/* Atomic operations. */
+#include "bootstrap/mbed_atomic.h"
+
 /*-----------------------------------------------------------*/
 
-#define QUEUE_NOT_INITIALIZED    ( 0U )
-#define QUEUE_INITIALIZED        ( 1U )
+#define POOL_NOT_INITIALIZED    ( 0U )
+#define POOL_INITIALIZED        ( 1U )
+
+/**
+ * @brief Event flag set when a command is released while a task waits for one.
+ */
+#define POOL_COMMAND_RELEASED   ( 1U )
+
+#if ( MQTT_COMMAND_CONTEXTS_POOL_SIZE > 32U ) || ( MQTT_COMMAND_CONTEXTS_POOL_SIZE == 0U )
+    #error "MQTT_COMMAND_CONTEXTS_POOL_SIZE must be between 1 and 32."
+#endif
 
 /**
  * @brief The pool of command structures used to hold information on commands (such
@@ -54,44 +66,87 @@
 static MQTTAgentCommand_t commandStructurePool[ MQTT_COMMAND_CONTEXTS_POOL_SIZE ];
 
 /**
- * @brief The message context used to guard the pool of MQTTAgentCommand_t structures.
- * This is implemented with a queue. Structures may be obtained by receiving a 
- * pointer from the queue, and returned by sending the pointer back into it.
+ * @brief Bitmap of the free structures in the pool, bit n for commandStructurePool[ n ].
+ * Structures are obtained and returned with atomic operations, the kernel is only
+ * involved when a task has to wait for the pool to refill.
+ */
+static volatile uint32_t freeCommands = 0U;
+
+/**
+ * @brief Number of tasks waiting for a structure to be released.
+ */
+static volatile uint32_t waitingTasks = 0U;
+
+/**
+ * @brief Wakes up tasks waiting for a structure.
+ */
+static osEventFlagsId_t commandReleasedFlags = NULL;
+
+/**
+ * @brief Pool usage counters, see Agent_GetPoolStats().
  */
-static MQTTAgentMessageContext_t commandStructMessageCtx;
+static volatile uint32_t commandsInUse = 0U;
+static volatile uint32_t commandsHighWaterMark = 0U;
+static volatile uint32_t poolExhaustedCount = 0U;
 
 /**
- * @brief Initialization status of the queue.
+ * @brief Initialization status of the pool.
  */
-static volatile uint8_t initStatus = QUEUE_NOT_INITIALIZED;
+static volatile uint8_t initStatus = POOL_NOT_INITIALIZED;
 
 /*-----------------------------------------------------------*/
 
-void Agent_InitializePool( void )
+/**
+ * @brief Take the lowest free structure from the bitmap.
+ *
+ * @return The structure, or NULL if the pool is empty.
+ */
+static MQTTAgentCommand_t * prvTakeCommand( void )
 {
-    size_t i;
-    MQTTAgentCommand_t * pCommand;
-    bool commandAdded = false;
+    uint32_t current = core_util_atomic_load_u32( &freeCommands );
+    uint32_t index;
+    uint32_t inUse;
+    uint32_t highWaterMark;
 
-    if( initStatus == QUEUE_NOT_INITIALIZED )
+    while( current != 0U )
     {
-        memset( ( void * ) commandStructurePool, 0x00, sizeof( commandStructurePool ) );
-        commandStructMessageCtx.queue =  osMessageQueueNew( MQTT_COMMAND_CONTEXTS_POOL_SIZE,
-                                                            sizeof( MQTTAgentCommand_t * ),
-                                                            NULL);
-        configASSERT( (uint32_t) commandStructMessageCtx.queue );
+        index = ( uint32_t ) __builtin_ctz( current );
 
-        /* Populate the queue. */
-        for( i = 0; i < MQTT_COMMAND_CONTEXTS_POOL_SIZE; i++ )
+        /* On failure current is updated with the latest bitmap. */
+        if( core_util_atomic_cas_u32( &freeCommands, &current, current & ~( 1UL << index ) ) )
         {
-            /* Store the address as a variable. */
-            pCommand = &commandStructurePool[ i ];
-            /* Send the pointer to the queue. */
-            commandAdded = Agent_MessageSend( &commandStructMessageCtx, &pCommand, 0U );
-            configASSERT( commandAdded );
+            inUse = core_util_atomic_incr_u32( &commandsInUse, 1U );
+            highWaterMark = core_util_atomic_load_u32( &commandsHighWaterMark );
+
+            while( ( inUse > highWaterMark ) &&
+                   !core_util_atomic_cas_u32( &commandsHighWaterMark, &highWaterMark, inUse ) )
+            {
+            }
+
+            return &commandStructurePool[ index ];
         }
+    }
+
+    return NULL;
+}
 
-        initStatus = QUEUE_INITIALIZED;
+/*-----------------------------------------------------------*/
+
+void Agent_InitializePool( void )
+{
+    if( initStatus == POOL_NOT_INITIALIZED )
+    {
+        memset( ( void * ) commandStructurePool, 0x00, sizeof( commandStructurePool ) );
+
+        commandReleasedFlags = osEventFlagsNew( NULL );
+        configASSERT( commandReleasedFlags != NULL );
+
+        /* Every structure starts free. */
+        core_util_atomic_store_u32( &freeCommands,
+                                    ( MQTT_COMMAND_CONTEXTS_POOL_SIZE == 32U ) ?
+                                    UINT32_MAX : ( ( 1UL << MQTT_COMMAND_CONTEXTS_POOL_SIZE ) - 1UL ) );
+
+        initStatus = POOL_INITIALIZED;
     }
 }
 
@@ -100,15 +155,45 @@ void Agent_InitializePool( void )
 MQTTAgentCommand_t * Agent_GetCommand( uint32_t blockTimeMs )
 {
     MQTTAgentCommand_t * structToUse = NULL;
-    bool structRetrieved = false;
+    uint32_t startTicks;
+    uint32_t elapsedTicks;
+    uint32_t blockTicks = pdMS_TO_TICKS( blockTimeMs );
 
-    /* Check queue has been created. */
-    configASSERT( initStatus == QUEUE_INITIALIZED );
+    /* Check pool has been initialized. */
+    configASSERT( initStatus == POOL_INITIALIZED );
 
-    /* Retrieve a struct from the queue. */
-    structRetrieved = Agent_MessageReceive( &commandStructMessageCtx, &( structToUse ), blockTimeMs );
+    structToUse = prvTakeCommand();
 
-    if( !structRetrieved )
+    if( structToUse == NULL )
+    {
+        core_util_atomic_incr_u32( &poolExhaustedCount, 1U );
+        startTicks = osKernelGetTickCount();
+        elapsedTicks = 0U;
+
+        /* Register as a waiter before checking the pool again so that a
+         * structure released in between always sets the event flag. */
+        core_util_atomic_incr_u32( &waitingTasks, 1U );
+
+        while( ( ( structToUse = prvTakeCommand() ) == NULL ) && ( elapsedTicks < blockTicks ) )
+        {
+            ( void ) osEventFlagsWait( commandReleasedFlags,
+                                       POOL_COMMAND_RELEASED,
+                                       osFlagsWaitAny,
+                                       blockTicks - elapsedTicks );
+            elapsedTicks = osKernelGetTickCount() - startTicks;
+        }
+
+        /* Releases made while the flag is set are not counted, and a task
+         * finding it set when it starts to wait clears it alone. Pass the
+         * wake-up on while other tasks wait and structures are left. */
+        if( ( core_util_atomic_decr_u32( &waitingTasks, 1U ) != 0U ) &&
+            ( core_util_atomic_load_u32( &freeCommands ) != 0U ) )
+        {
+            ( void ) osEventFlagsSet( commandReleasedFlags, POOL_COMMAND_RELEASED );
+        }
+    }
+
+    if( structToUse == NULL )
     {
         LogError( ( "No command structure available." ) );
     }
@@ -121,21 +206,45 @@ MQTTAgentCommand_t * Agent_GetCommand( uint32_t blockTimeMs )
 bool Agent_ReleaseCommand( MQTTAgentCommand_t * pCommandToRelease )
 {
     bool structReturned = false;
+    uint32_t index;
 
-    configASSERT( initStatus == QUEUE_INITIALIZED );
+    configASSERT( initStatus == POOL_INITIALIZED );
 
     /* See if the structure being returned is actually from the pool. */
     if( ( pCommandToRelease >= commandStructurePool ) &&
         ( pCommandToRelease < ( commandStructurePool + MQTT_COMMAND_CONTEXTS_POOL_SIZE ) ) )
     {
-        structReturned = Agent_MessageSend( &commandStructMessageCtx, &pCommandToRelease, 0U );
+        index = ( uint32_t ) ( pCommandToRelease - commandStructurePool );
 
-        /* The send should not fail as the queue was created to hold every command
-         * in the pool. */
+        /* A structure can only be returned once. */
+        structReturned = ( core_util_atomic_fetch_or_u32( &freeCommands, 1UL << index ) & ( 1UL << index ) ) == 0U;
         configASSERT( structReturned );
+
+        if( structReturned )
+        {
+            core_util_atomic_decr_u32( &commandsInUse, 1U );
+
+            if( core_util_atomic_load_u32( &waitingTasks ) != 0U )
+            {
+                ( void ) osEventFlagsSet( commandReleasedFlags, POOL_COMMAND_RELEASED );
+            }
+        }
+
         LogDebug( ( "Returned Command Context %d to pool",
-                    ( int ) ( pCommandToRelease - commandStructurePool ) ) );
+                    ( int ) index ) );
     }
 
     return structReturned;
 }
+
+/*-----------------------------------------------------------*/
+
+void Agent_GetPoolStats( AgentCommandPoolStats_t * pStats )
+{
+    if( pStats != NULL )
+    {
+        pStats->inUse = core_util_atomic_load_u32( &commandsInUse );
+        pStats->highWaterMark = core_util_atomic_load_u32( &commandsHighWaterMark );
+        pStats->exhaustedCount = core_util_atomic_load_u32( &poolExhaustedCount );
+    }
+}
@@ -43,19 +43,104 @@
 /* Include MQTT agent messaging interface. */
 #include "core_mqtt_agent_message_interface.h"
 
+/**
+ * @brief Priority lanes of the agent message context.
+ *
+ * Commands are queued per lane so that a burst on one lane cannot delay the
+ * others: control covers connection management, subscriptions and pings, OTA
+ * covers publishes to reserved AWS IoT topics (jobs, streams) and telemetry
+ * covers every other publish.
+ *
+ * Only publishes are reordered among themselves. A control command is a
+ * barrier: it is taken after every command queued before it and before every
+ * command queued after it, so a disconnect or unsubscribe never overtakes the
+ * publishes a task queued earlier.
+ */
+typedef enum MQTTAgentLane
+{
+    MQTT_AGENT_LANE_CONTROL = 0,
+    MQTT_AGENT_LANE_OTA,
+    MQTT_AGENT_LANE_TELEMETRY,
+    MQTT_AGENT_LANE_COUNT
+} MQTTAgentLane_t;
+
+/**
+ * @brief Number of commands the agent takes from each lane, highest priority
+ * first, before the weights are replenished. Every lane gets a share of the
+ * agent so telemetry is slowed down, not starved, by the other lanes.
+ */
+#ifndef MQTT_AGENT_LANE_WEIGHTS
+    #define MQTT_AGENT_LANE_WEIGHTS    { 8U, 4U, 1U }
+#endif
+
+/**
+ * @brief Publishes to topics starting with this prefix go to the OTA lane.
+ */
+#ifndef MQTT_AGENT_OTA_TOPIC_PREFIX
+    #define MQTT_AGENT_OTA_TOPIC_PREFIX    "$aws/"
+#endif
+
+/**
+ * @brief Number of buckets of the queueing latency histograms. Bucket n counts
+ * the commands that waited less than 2^n milliseconds in their lane, the last
+ * bucket counts all the slower ones.
+ */
+#ifndef MQTT_AGENT_LATENCY_BUCKETS
+    #define MQTT_AGENT_LATENCY_BUCKETS    ( 10U )
+#endif
+
+/**
+ * @brief Statistics of a lane, updated by the agent when it takes a command.
+ */
+typedef struct MQTTAgentLaneStats
+{
+    uint32_t received;                                 /**< Commands taken from the lane. */
+    uint32_t maxLatencyMs;                             /**< Longest time a command waited in the lane. */
+    uint32_t latencyHistogram[ MQTT_AGENT_LATENCY_BUCKETS ];
+} MQTTAgentLaneStats_t;
+
+/**
+ * @brief Command queued in a lane.
+ */
+typedef struct MQTTAgentLaneItem
+{
+    MQTTAgentCommand_t * pCommand;
+    uint32_t enqueuedTicks;
+    uint32_t sequence;    /* Order in which the commands were queued, across all the lanes. */
+} MQTTAgentLaneItem_t;
+
 /**
  * @ingroup mqtt_agent_struct_types
  * @brief Context with which tasks may deliver messages to the agent.
  */
 struct MQTTAgentMessageContext
 {
-    osMessageQueueId_t queue;
+    osMessageQueueId_t lanes[ MQTT_AGENT_LANE_COUNT ];
+    osSemaphoreId_t space[ MQTT_AGENT_LANE_COUNT ];    /* Free slots of each lane. */
+    osMutexId_t sendMutex;                             /* Numbers the commands in the order they enter the lanes. */
+    uint32_t nextSequence;
+    osSemaphoreId_t pending;                           /* Commands queued in all the lanes. */
+    MQTTAgentLaneItem_t heads[ MQTT_AGENT_LANE_COUNT ]; /* Oldest command of each lane, taken out by the agent. */
+    bool headValid[ MQTT_AGENT_LANE_COUNT ];
+    uint32_t credits[ MQTT_AGENT_LANE_COUNT ];         /* Commands left to take from each lane in this round. */
+    MQTTAgentLaneStats_t stats[ MQTT_AGENT_LANE_COUNT ];
 };
 
 /*-----------------------------------------------------------*/
 
 /**
- * @brief Send a message to the specified context.
+ * @brief Create the lanes of a message context.
+ *
+ * @param[in] pMsgCtx An #MQTTAgentMessageContext_t.
+ * @param[in] laneLength Number of commands each lane can hold.
+ *
+ * @return `true` if the context was created, else `false`.
+ */
+bool Agent_MessageContextInit( MQTTAgentMessageContext_t * pMsgCtx,
+                               uint32_t laneLength );
+
+/**
+ * @brief Send a message to the specified context, in the lane matching the command.
  * Must be thread safe.
  *
  * @param[in] pMsgCtx An #MQTTAgentMessageContext_t.
@@ -69,8 +154,8 @@ bool Agent_MessageSend( MQTTAgentMessageContext_t * pMsgCtx,
                         uint32_t blockTimeMs );
 
 /**
- * @brief Receive a message from the specified context.
- * Must be thread safe.
+ * @brief Receive a message from the specified context, taking the lanes in
+ * weighted priority order. Only the agent task receives from a context.
  *
  * @param[in] pMsgCtx An #MQTTAgentMessageContext_t.
  * @param[in] pReceivedCommand Pointer to write address of received command.
@@ -82,4 +167,17 @@ bool Agent_MessageReceive( MQTTAgentMessageContext_t * pMsgCtx,
                            MQTTAgentCommand_t ** pReceivedCommand,
                            uint32_t blockTimeMs );
 
+/**
+ * @brief Read the statistics of a lane.
+ *
+ * @param[in] pMsgCtx An #MQTTAgentMessageContext_t.
+ * @param[in] lane The lane to read.
+ * @param[out] pStats Receives a copy of the statistics.
+ *
+ * @return `true` if the statistics were copied, else `false`.
+ */
+bool Agent_MessageGetLaneStats( const MQTTAgentMessageContext_t * pMsgCtx,
+                                MQTTAgentLane_t lane,
+                                MQTTAgentLaneStats_t * pStats );
+
 #endif /* FREERTOS_AGENT_MESSAGE_H */
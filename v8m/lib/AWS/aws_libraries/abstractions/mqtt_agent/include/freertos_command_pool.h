@@ -35,12 +35,22 @@
 #include "core_mqtt_agent.h"
 
 /**
- * @brief The number of structures to allocate in the command pool.
+ * @brief The number of structures to allocate in the command pool, at most 32.
  */
 #ifndef MQTT_COMMAND_CONTEXTS_POOL_SIZE
     #define MQTT_COMMAND_CONTEXTS_POOL_SIZE    ( 10U )
 #endif
 
+/**
+ * @brief Usage counters of the command pool.
+ */
+typedef struct AgentCommandPoolStats
+{
+    uint32_t inUse;          /**< Structures currently obtained from the pool. */
+    uint32_t highWaterMark;  /**< Largest number of structures obtained at the same time. */
+    uint32_t exhaustedCount; /**< Number of calls to Agent_GetCommand() that found the pool empty. */
+} AgentCommandPoolStats_t;
+
 /**
  * @brief Initialize the common task pool. Not thread safe.
  */
@@ -87,4 +97,11 @@ MQTTAgentCommand_t * Agent_GetCommand( uint32_t blockTimeMs );
  */
 bool Agent_ReleaseCommand( MQTTAgentCommand_t * pCommandToRelease );
 
+/**
+ * @brief Read the usage counters of the pool, e.g. to size MQTT_COMMAND_CONTEXTS_POOL_SIZE.
+ *
+ * @param[out] pStats Receives the counters.
+ */
+void Agent_GetPoolStats( AgentCommandPoolStats_t * pStats );
+
 #endif /* FREERTOS_COMMAND_POOL_H */
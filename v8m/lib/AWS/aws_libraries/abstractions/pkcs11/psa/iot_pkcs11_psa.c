@@ -37,12 +37,14 @@
 
 /* CMSIS includes. */
 #include "cmsis_os2.h"
+#include "bootstrap/mbed_atomic.h"
 
 /* PKCS#11 includes. */
 #include "core_pkcs11_config.h"
 #include "core_pkcs11.h"
 #include "iot_pkcs11_psa_object_management.h"
 #include "iot_pkcs11_psa_input_format.h"
+#include "pkcs11_helpers.h"
 
 /* Crypto include. */
 #include "iot_crypto.h"
@@ -76,6 +78,17 @@
 /**
  * @brief Helper definitions.
  */
+/* Size of the open-addressed label and PAL handle indexes of the object list.
+ * Must be a power of two and at least twice the number of objects so probe
+ * sequences stay short. Entries hold application handles. */
+#define pkcs11OBJECT_INDEX_SIZE        ( 16U )
+#define pkcs11OBJECT_INDEX_EMPTY       ( 0U )
+#define pkcs11OBJECT_INDEX_DELETED     ( 0xFFU )
+
+#if ( ( pkcs11configMAX_NUM_OBJECTS * 2 ) > pkcs11OBJECT_INDEX_SIZE ) || ( pkcs11configMAX_NUM_OBJECTS >= pkcs11OBJECT_INDEX_DELETED )
+    #error "pkcs11configMAX_NUM_OBJECTS is too large for pkcs11OBJECT_INDEX_SIZE"
+#endif
+
 #define PKCS11_MODULE_IS_INITIALIZED    ( ( xP11Context.xIsInitialized == CK_TRUE ) ? CK_TRUE : CK_FALSE )
 #define PKCS11_SESSION_IS_OPEN( xSessionHandle )    ( ( ( ( P11SessionPtr_t ) xSessionHandle )->xOpened ) == CK_TRUE ? CKR_OK : CKR_SESSION_CLOSED )
 #define PKCS11_SESSION_IS_VALID( xSessionHandle )    ( ( ( P11SessionPtr_t ) xSessionHandle != NULL ) ? PKCS11_SESSION_IS_OPEN( xSessionHandle ) : CKR_SESSION_HANDLE_INVALID )
@@ -85,15 +98,27 @@ typedef struct P11Object_t
 {
     CK_OBJECT_HANDLE xHandle;                            /* The "PSA Handle". */
     CK_BYTE xLabel[ pkcs11configMAX_LABEL_LENGTH + 1 ]; /* Plus 1 for the null terminator. */
+    uint32_t ulLabelHash;                                /* Hash of the label, used by the label index. */
+    uint8_t ucLabelLength;                               /* Length of the label, without the null terminator. */
+    CK_BBOOL xKeyCached;                                 /* Whether uxKey and xKeyAlgorithm are valid. */
+    psa_key_handle_t uxKey;                              /* Opened PSA key of a key object, see prvGetObjectKey(). */
+    psa_algorithm_t xKeyAlgorithm;                       /* Algorithm the PSA key is restricted to. */
 } P11Object_t;
 
 /* This structure helps the aws_pkcs11_psa.c maintain a mapping of all objects in one place.
  * The ObjectList maintains a list of what object handles are available.
+ *
+ * Writers serialize on xMutex and bump ulSequence before and after every update,
+ * so lookups can read the list without taking the mutex and only fall back to it
+ * when they race with a writer.
  */
 typedef struct P11ObjectList_t
 {
-    osMutexId_t xMutex; /* Mutex that protects write operations to the xObjects array. */
+    osMutexId_t xMutex;   /* Mutex that protects write operations to the xObjects array. */
+    uint32_t ulSequence;  /* Odd while a writer is updating the list. */
     P11Object_t xObjects[ pkcs11configMAX_NUM_OBJECTS ];
+    uint8_t ucLabelIndex[ pkcs11OBJECT_INDEX_SIZE ];  /* Application handles hashed by label. */
+    uint8_t ucHandleIndex[ pkcs11OBJECT_INDEX_SIZE ]; /* Application handles hashed by PAL handle. */
 } P11ObjectList_t;
 
 /* PKCS #11 Module Object */
@@ -108,6 +133,10 @@ typedef struct P11Struct_t
  * Entropy/randomness and object lists are shared across PKCS #11 sessions. */
 static P11Struct_t xP11Context;
 
+/* Bumped after every change to the stored objects, see ulPkcs11GetObjectVersion().
+ * Kept out of xP11Context so it survives C_Finalize. */
+static uint32_t ulObjectVersion;
+
 /**
  * @brief Session structure.
  */
@@ -127,7 +156,7 @@ typedef struct P11Session
     psa_key_handle_t uxSignKey;
     CK_MECHANISM_TYPE xSignMechanism;      /* Mechanism of the sign operation in progress. Set during C_SignInit. */
     psa_algorithm_t xSignAlgorithm; /* Signature algorithm that is compatible with the type of key. */
-    psa_hash_operation_t *pxHashOperationHandle;   /* hash operation handle in PSA crypto service. */
+    psa_hash_operation_t xHashOperation;   /* hash operation in PSA crypto service, active while xOperationInProgress is CKM_SHA256. */
 } P11Session_t, * P11SessionPtr_t;
 
 /*
@@ -219,6 +248,235 @@ P11SessionPtr_t prvSessionPointerFromHandle( CK_SESSION_HANDLE xSession )
     return ( P11SessionPtr_t ) xSession; /*lint !e923 Allow casting integer type to pointer for handle. */
 }
 
+/**
+ * @brief Hashes an object label (FNV-1a).
+ */
+static uint32_t prvObjectLabelHash( const uint8_t * pcLabel,
+                                    size_t xLabelLength )
+{
+    uint32_t ulHash = 2166136261UL;
+    size_t x;
+
+    for( x = 0; x < xLabelLength; x++ )
+    {
+        ulHash ^= pcLabel[ x ];
+        ulHash *= 16777619UL;
+    }
+
+    return ulHash;
+}
+
+/**
+ * @brief Hashes a PAL handle.
+ */
+static uint32_t prvObjectHandleHash( CK_OBJECT_HANDLE xPalHandle )
+{
+    return ( uint32_t ) xPalHandle * 2654435761UL;
+}
+
+/**
+ * @brief Returns the length of a label, ignoring an optional null terminator.
+ */
+static size_t prvObjectLabelLength( const uint8_t * pcLabel,
+                                    size_t xLabelLength )
+{
+    const uint8_t * pcEnd = memchr( pcLabel, '\0', xLabelLength );
+
+    return ( pcEnd != NULL ) ? ( size_t ) ( pcEnd - pcLabel ) : xLabelLength;
+}
+
+/**
+ * @brief Adds an application handle to one of the object list indexes.
+ *
+ * Must be called with the object list mutex held. The index is always at least
+ * twice the size of the object list, so a free slot exists.
+ */
+static void prvObjectIndexInsert( uint8_t * pucIndex,
+                                  uint32_t ulHash,
+                                  uint8_t ucAppHandle )
+{
+    uint32_t ulProbe;
+    uint32_t ulSlot;
+
+    for( ulProbe = 0; ulProbe < pkcs11OBJECT_INDEX_SIZE; ulProbe++ )
+    {
+        ulSlot = ( ulHash + ulProbe ) & ( pkcs11OBJECT_INDEX_SIZE - 1U );
+
+        if( ( pucIndex[ ulSlot ] == pkcs11OBJECT_INDEX_EMPTY ) ||
+            ( pucIndex[ ulSlot ] == pkcs11OBJECT_INDEX_DELETED ) )
+        {
+            pucIndex[ ulSlot ] = ucAppHandle;
+            break;
+        }
+    }
+}
+
+/**
+ * @brief Removes an application handle from one of the object list indexes.
+ *
+ * Must be called with the object list mutex held.
+ */
+static void prvObjectIndexRemove( uint8_t * pucIndex,
+                                  uint32_t ulHash,
+                                  uint8_t ucAppHandle )
+{
+    uint32_t ulProbe;
+    uint32_t ulSlot;
+
+    for( ulProbe = 0; ulProbe < pkcs11OBJECT_INDEX_SIZE; ulProbe++ )
+    {
+        ulSlot = ( ulHash + ulProbe ) & ( pkcs11OBJECT_INDEX_SIZE - 1U );
+
+        if( pucIndex[ ulSlot ] == ucAppHandle )
+        {
+            /* Leave a marker so that probe sequences going through this slot stay intact. */
+            pucIndex[ ulSlot ] = pkcs11OBJECT_INDEX_DELETED;
+            break;
+        }
+        else if( pucIndex[ ulSlot ] == pkcs11OBJECT_INDEX_EMPTY )
+        {
+            break;
+        }
+    }
+}
+
+/**
+ * @brief Looks up the application handle of an object by PAL handle.
+ *
+ * Does not synchronize with writers, see prvObjectListReadBegin().
+ *
+ * @return The application handle, or CK_INVALID_HANDLE if no object was found.
+ */
+static CK_OBJECT_HANDLE prvObjectIndexFindHandle( CK_OBJECT_HANDLE xPalHandle )
+{
+    const P11ObjectList_t * pxList = &xP11Context.xObjectList;
+    uint32_t ulHash = prvObjectHandleHash( xPalHandle );
+    uint32_t ulProbe;
+    uint8_t ucAppHandle;
+
+    for( ulProbe = 0; ulProbe < pkcs11OBJECT_INDEX_SIZE; ulProbe++ )
+    {
+        ucAppHandle = pxList->ucHandleIndex[ ( ulHash + ulProbe ) & ( pkcs11OBJECT_INDEX_SIZE - 1U ) ];
+
+        if( ucAppHandle == pkcs11OBJECT_INDEX_EMPTY )
+        {
+            break;
+        }
+
+        if( ( ucAppHandle != pkcs11OBJECT_INDEX_DELETED ) &&
+            ( pxList->xObjects[ ucAppHandle - 1 ].xHandle == xPalHandle ) )
+        {
+            return ucAppHandle;
+        }
+    }
+
+    return CK_INVALID_HANDLE;
+}
+
+/**
+ * @brief Looks up the application handle of an object by label.
+ *
+ * Does not synchronize with writers, see prvObjectListReadBegin().
+ *
+ * @return The application handle, or CK_INVALID_HANDLE if no object was found.
+ */
+static CK_OBJECT_HANDLE prvObjectIndexFindLabel( const uint8_t * pcLabel,
+                                                 size_t xLabelLength )
+{
+    const P11ObjectList_t * pxList = &xP11Context.xObjectList;
+    const P11Object_t * pxObject;
+    uint32_t ulHash = prvObjectLabelHash( pcLabel, xLabelLength );
+    uint32_t ulProbe;
+    uint8_t ucAppHandle;
+
+    for( ulProbe = 0; ulProbe < pkcs11OBJECT_INDEX_SIZE; ulProbe++ )
+    {
+        ucAppHandle = pxList->ucLabelIndex[ ( ulHash + ulProbe ) & ( pkcs11OBJECT_INDEX_SIZE - 1U ) ];
+
+        if( ucAppHandle == pkcs11OBJECT_INDEX_EMPTY )
+        {
+            break;
+        }
+
+        if( ucAppHandle != pkcs11OBJECT_INDEX_DELETED )
+        {
+            pxObject = &pxList->xObjects[ ucAppHandle - 1 ];
+
+            if( ( pxObject->ulLabelHash == ulHash ) &&
+                ( pxObject->ucLabelLength == xLabelLength ) &&
+                ( pxObject->xHandle != CK_INVALID_HANDLE ) &&
+                ( 0 == memcmp( pcLabel, pxObject->xLabel, xLabelLength ) ) )
+            {
+                return ucAppHandle;
+            }
+        }
+    }
+
+    return CK_INVALID_HANDLE;
+}
+
+/**
+ * @brief Records that the stored objects may have changed.
+ *
+ * Called once a create, destroy or key generation returns, whether it succeeded
+ * or not, as a failed operation may still have updated part of the storage.
+ */
+static void prvObjectsChanged( void )
+{
+    ( void ) core_util_atomic_incr_u32( &ulObjectVersion, 1 );
+}
+
+uint32_t ulPkcs11GetObjectVersion( void )
+{
+    return core_util_atomic_load_u32( &ulObjectVersion );
+}
+
+/**
+ * @brief Marks the start of an update of the object list.
+ *
+ * Must be called with the object list mutex held.
+ */
+static void prvObjectListWriteBegin( void )
+{
+    ( void ) core_util_atomic_incr_u32( &xP11Context.xObjectList.ulSequence, 1 );
+}
+
+/**
+ * @brief Marks the end of an update of the object list.
+ */
+static void prvObjectListWriteEnd( void )
+{
+    ( void ) core_util_atomic_incr_u32( &xP11Context.xObjectList.ulSequence, 1 );
+}
+
+/**
+ * @brief Starts an unlocked read of the object list.
+ *
+ * @param[out] pulSequence   Sequence to pass to prvObjectListReadRetry().
+ *
+ * @return CK_TRUE if no writer is active and the read can go ahead.
+ */
+static CK_BBOOL prvObjectListReadBegin( uint32_t * pulSequence )
+{
+    *pulSequence = core_util_atomic_load_u32( &xP11Context.xObjectList.ulSequence );
+
+    return ( ( *pulSequence & 1U ) == 0U ) ? CK_TRUE : CK_FALSE;
+}
+
+/**
+ * @brief Checks whether an unlocked read raced with a writer.
+ *
+ * Readers that raced take the mutex and read again rather than spinning: a
+ * spinning high priority reader would starve the writer it is waiting for,
+ * while the mutex lets priority inheritance finish the update.
+ *
+ * @return CK_TRUE if the read must be repeated under the mutex.
+ */
+static CK_BBOOL prvObjectListReadRetry( uint32_t ulSequence )
+{
+    return ( core_util_atomic_load_u32( &xP11Context.xObjectList.ulSequence ) != ulSequence ) ? CK_TRUE : CK_FALSE;
+}
+
 /**
  * @brief Add an object that exists in NVM to the application object array.
  *
@@ -235,40 +493,56 @@ CK_RV prvAddObjectToList( CK_OBJECT_HANDLE xPalHandle,
 {
     CK_RV xResult = CKR_OK;
     osStatus_t xGotSemaphore;
-
-    CK_BBOOL xObjectFound = CK_FALSE;
+    P11Object_t * pxObject;
+    CK_OBJECT_HANDLE xAppHandle;
     int lInsertIndex = -1;
-    int lSearchIndex = pkcs11configMAX_NUM_OBJECTS - 1;
+    int lSearchIndex;
 
     xGotSemaphore = osMutexAcquire( xP11Context.xObjectList.xMutex, osWaitForever );
 
     if( xGotSemaphore == osOK )
     {
-        for( lSearchIndex = pkcs11configMAX_NUM_OBJECTS - 1; lSearchIndex >= 0; lSearchIndex-- )
+        xAppHandle = prvObjectIndexFindHandle( xPalHandle );
+
+        if( xAppHandle != CK_INVALID_HANDLE )
         {
-            if( xP11Context.xObjectList.xObjects[ lSearchIndex ].xHandle == xPalHandle )
-            {
-                /* Object already exists in list. */
-                xObjectFound = CK_TRUE;
+            /* Object already exists in list. Its PSA key may have been
+             * re-imported, so drop the cached key handle. */
+            *pxAppHandle = xAppHandle;
 
-                /* Assign the object handle. */
-                *pxAppHandle = lSearchIndex + 1;
-                break;
-            }
-            else if( xP11Context.xObjectList.xObjects[ lSearchIndex ].xHandle == CK_INVALID_HANDLE )
+            if( xP11Context.xObjectList.xObjects[ xAppHandle - 1 ].xKeyCached == CK_TRUE )
             {
-                lInsertIndex = lSearchIndex;
+                prvObjectListWriteBegin();
+                xP11Context.xObjectList.xObjects[ xAppHandle - 1 ].xKeyCached = CK_FALSE;
+                prvObjectListWriteEnd();
             }
         }
-
-        if( xObjectFound == CK_FALSE )
+        else
         {
+            for( lSearchIndex = 0; lSearchIndex < pkcs11configMAX_NUM_OBJECTS; lSearchIndex++ )
+            {
+                if( xP11Context.xObjectList.xObjects[ lSearchIndex ].xHandle == CK_INVALID_HANDLE )
+                {
+                    lInsertIndex = lSearchIndex;
+                    break;
+                }
+            }
+
             if( lInsertIndex != -1 )
             {
                 if( xLabelLength < pkcs11configMAX_LABEL_LENGTH )
                 {
-                    xP11Context.xObjectList.xObjects[ lInsertIndex ].xHandle = xPalHandle;
-                    memcpy( xP11Context.xObjectList.xObjects[ lInsertIndex ].xLabel, pcLabel, xLabelLength );
+                    pxObject = &xP11Context.xObjectList.xObjects[ lInsertIndex ];
+
+                    prvObjectListWriteBegin();
+                    pxObject->xHandle = xPalHandle;
+                    memcpy( pxObject->xLabel, pcLabel, xLabelLength );
+                    pxObject->ucLabelLength = ( uint8_t ) prvObjectLabelLength( pcLabel, xLabelLength );
+                    pxObject->ulLabelHash = prvObjectLabelHash( pcLabel, pxObject->ucLabelLength );
+                    prvObjectIndexInsert( xP11Context.xObjectList.ucLabelIndex, pxObject->ulLabelHash, ( uint8_t ) ( lInsertIndex + 1 ) );
+                    prvObjectIndexInsert( xP11Context.xObjectList.ucHandleIndex, prvObjectHandleHash( xPalHandle ), ( uint8_t ) ( lInsertIndex + 1 ) );
+                    prvObjectListWriteEnd();
+
                     *pxAppHandle = lInsertIndex + 1;
                 }
                 else
@@ -295,6 +569,29 @@ CK_RV prvAddObjectToList( CK_OBJECT_HANDLE xPalHandle,
     return xResult;
 }
 
+/**
+ * @brief Copies out an object list entry given an application handle.
+ *
+ * Does not synchronize with writers, see prvObjectListReadBegin().
+ */
+static void prvObjectListReadByHandle( CK_OBJECT_HANDLE xAppHandle,
+                                       CK_OBJECT_HANDLE_PTR pxPalHandle,
+                                       uint8_t ** ppcLabel,
+                                       size_t * pxLabelLength )
+{
+    P11Object_t * pxObject = &xP11Context.xObjectList.xObjects[ xAppHandle - 1 ];
+
+    *ppcLabel = NULL;
+    *pxLabelLength = 0;
+    *pxPalHandle = pxObject->xHandle;
+
+    if( *pxPalHandle != CK_INVALID_HANDLE )
+    {
+        *ppcLabel = pxObject->xLabel;
+        *pxLabelLength = ( size_t ) pxObject->ucLabelLength + 1;
+    }
+}
+
 /**
  * @brief Looks up a PKCS #11 object's label and PAL handle given an application handle.
  *
@@ -309,23 +606,56 @@ void prvFindObjectInListByHandle( CK_OBJECT_HANDLE xAppHandle,
                                   uint8_t ** ppcLabel,
                                   size_t * pxLabelLength )
 {
-    int lIndex = xAppHandle - 1;
+    uint32_t ulSequence;
 
     *ppcLabel = NULL;
     *pxLabelLength = 0;
     *pxPalHandle = CK_INVALID_HANDLE;
 
-    if( lIndex < pkcs11configMAX_NUM_OBJECTS ) /* Check that handle is in bounds. */
+    /* Check that handle is in bounds. */
+    if( ( xAppHandle != CK_INVALID_HANDLE ) && ( xAppHandle <= pkcs11configMAX_NUM_OBJECTS ) )
     {
-        if( xP11Context.xObjectList.xObjects[ lIndex ].xHandle != CK_INVALID_HANDLE )
+        if( prvObjectListReadBegin( &ulSequence ) == CK_TRUE )
         {
-            *ppcLabel = xP11Context.xObjectList.xObjects[ lIndex ].xLabel;
-            *pxLabelLength = strlen( ( const char * ) xP11Context.xObjectList.xObjects[ lIndex ].xLabel ) + 1;
-            *pxPalHandle = xP11Context.xObjectList.xObjects[ lIndex ].xHandle;
+            prvObjectListReadByHandle( xAppHandle, pxPalHandle, ppcLabel, pxLabelLength );
+        }
+
+        if( ( ( ulSequence & 1U ) != 0U ) || ( prvObjectListReadRetry( ulSequence ) == CK_TRUE ) )
+        {
+            if( osMutexAcquire( xP11Context.xObjectList.xMutex, osWaitForever ) == osOK )
+            {
+                prvObjectListReadByHandle( xAppHandle, pxPalHandle, ppcLabel, pxLabelLength );
+                ( void ) osMutexRelease( xP11Context.xObjectList.xMutex );
+            }
+            else
+            {
+                *ppcLabel = NULL;
+                *pxLabelLength = 0;
+                *pxPalHandle = CK_INVALID_HANDLE;
+            }
         }
     }
 }
 
+/**
+ * @brief Looks up an object list entry given its label.
+ *
+ * Does not synchronize with writers, see prvObjectListReadBegin().
+ */
+static void prvObjectListReadByLabel( const uint8_t * pcLabel,
+                                      size_t xLabelLength,
+                                      CK_OBJECT_HANDLE_PTR pxPalHandle,
+                                      CK_OBJECT_HANDLE_PTR pxAppHandle )
+{
+    *pxAppHandle = prvObjectIndexFindLabel( pcLabel, xLabelLength );
+    *pxPalHandle = CK_INVALID_HANDLE;
+
+    if( *pxAppHandle != CK_INVALID_HANDLE )
+    {
+        *pxPalHandle = xP11Context.xObjectList.xObjects[ *pxAppHandle - 1 ].xHandle;
+    }
+}
+
 /**
  * @brief Searches the PKCS #11 module's object list for label and provides handle.
  *
@@ -341,20 +671,134 @@ void prvFindObjectInListByLabel( uint8_t * pcLabel,
                                  CK_OBJECT_HANDLE_PTR pxPalHandle,
                                  CK_OBJECT_HANDLE_PTR pxAppHandle )
 {
-    uint8_t ucIndex;
+    uint32_t ulSequence;
 
     *pxPalHandle = CK_INVALID_HANDLE;
     *pxAppHandle = CK_INVALID_HANDLE;
 
-    for( ucIndex = 0; ucIndex < pkcs11configMAX_NUM_OBJECTS; ucIndex++ )
+    xLabelLength = prvObjectLabelLength( pcLabel, xLabelLength );
+
+    if( prvObjectListReadBegin( &ulSequence ) == CK_TRUE )
     {
-        if( 0 == memcmp( pcLabel, xP11Context.xObjectList.xObjects[ ucIndex ].xLabel, xLabelLength ) )
+        prvObjectListReadByLabel( pcLabel, xLabelLength, pxPalHandle, pxAppHandle );
+    }
+
+    if( ( ( ulSequence & 1U ) != 0U ) || ( prvObjectListReadRetry( ulSequence ) == CK_TRUE ) )
+    {
+        if( osMutexAcquire( xP11Context.xObjectList.xMutex, osWaitForever ) == osOK )
         {
-            *pxPalHandle = xP11Context.xObjectList.xObjects[ ucIndex ].xHandle;
-            *pxAppHandle = ucIndex + 1; /* Zero is not a valid handle, so let's offset by 1. */
-            break;
+            prvObjectListReadByLabel( pcLabel, xLabelLength, pxPalHandle, pxAppHandle );
+            ( void ) osMutexRelease( xP11Context.xObjectList.xMutex );
+        }
+        else
+        {
+            *pxPalHandle = CK_INVALID_HANDLE;
+            *pxAppHandle = CK_INVALID_HANDLE;
+        }
+    }
+}
+
+/**
+ * @brief Looks up the PSA key handle and algorithm of a key object.
+ *
+ * The first lookup resolves the key through the PSA object management layer and
+ * queries its attributes from the secure side. The result is cached in the object
+ * list so that later C_SignInit() and C_VerifyInit() calls, typically one per TLS
+ * handshake, do not cross into the secure world. The cache entry is dropped when
+ * the object is destroyed or created again.
+ *
+ * @param[in] xAppHandle         Application handle of the key object.
+ * @param[out] puxKey            The PSA key handle.
+ * @param[out] pxAlgorithm       The algorithm the key is restricted to.
+ *
+ * @return CKR_OK on success, CKR_KEY_HANDLE_INVALID if the object is not a known
+ * key and CKR_FUNCTION_FAILED if its attributes can not be read.
+ */
+static CK_RV prvGetObjectKey( CK_OBJECT_HANDLE xAppHandle,
+                              psa_key_handle_t * puxKey,
+                              psa_algorithm_t * pxAlgorithm )
+{
+    CK_RV xResult = CKR_OK;
+    P11Object_t * pxObject;
+    psa_key_attributes_t xAttributes = PSA_KEY_ATTRIBUTES_INIT;
+    psa_key_handle_t uxKey = 0;
+    psa_algorithm_t xAlgorithm = 0;
+    CK_BBOOL xHit = CK_FALSE;
+    uint32_t ulSequence;
+
+    if( ( xAppHandle == CK_INVALID_HANDLE ) || ( xAppHandle > pkcs11configMAX_NUM_OBJECTS ) )
+    {
+        return CKR_KEY_HANDLE_INVALID;
+    }
+
+    pxObject = &xP11Context.xObjectList.xObjects[ xAppHandle - 1 ];
+
+    if( prvObjectListReadBegin( &ulSequence ) == CK_TRUE )
+    {
+        xHit = pxObject->xKeyCached;
+        uxKey = pxObject->uxKey;
+        xAlgorithm = pxObject->xKeyAlgorithm;
+
+        if( prvObjectListReadRetry( ulSequence ) == CK_TRUE )
+        {
+            xHit = CK_FALSE;
+        }
+    }
+
+    if( xHit == CK_FALSE )
+    {
+        if( osMutexAcquire( xP11Context.xObjectList.xMutex, osWaitForever ) != osOK )
+        {
+            return CKR_CANT_LOCK;
+        }
+
+        if( pxObject->xHandle == CK_INVALID_HANDLE )
+        {
+            xResult = CKR_KEY_HANDLE_INVALID;
+        }
+        else if( pxObject->xKeyCached == CK_TRUE )
+        {
+            uxKey = pxObject->uxKey;
+            xAlgorithm = pxObject->xKeyAlgorithm;
+        }
+        else
+        {
+            xResult = PKCS11PSAGetKeyHandle( pxObject->xLabel, pxObject->ucLabelLength + 1, &uxKey );
+
+            if( xResult != CKR_OK )
+            {
+                xResult = CKR_KEY_HANDLE_INVALID;
+            }
+            else if( psa_get_key_attributes( uxKey, &xAttributes ) != PSA_SUCCESS )
+            {
+                xResult = CKR_FUNCTION_FAILED;
+            }
+            else
+            {
+                xAlgorithm = psa_get_key_algorithm( &xAttributes );
+                psa_reset_key_attributes( &xAttributes );
+
+                prvObjectListWriteBegin();
+                pxObject->uxKey = uxKey;
+                pxObject->xKeyAlgorithm = xAlgorithm;
+                pxObject->xKeyCached = CK_TRUE;
+                prvObjectListWriteEnd();
+            }
+        }
+
+        if( osMutexRelease( xP11Context.xObjectList.xMutex ) != osOK )
+        {
+            PKCS11_WARNING_PRINT( ( "WARNING: Failed to release mutex in prvGetObjectKey.\r\n" ) );
         }
     }
+
+    if( xResult == CKR_OK )
+    {
+        *puxKey = uxKey;
+        *pxAlgorithm = xAlgorithm;
+    }
+
+    return xResult;
 }
 
 /**
@@ -1588,9 +2032,9 @@ CK_DEFINE_FUNCTION( CK_RV, C_CloseSession )( CK_SESSION_HANDLE xSession )
         {
             osMutexDelete( pxSession->xVerifyMutex );
         }
-        if( pxSession->pxHashOperationHandle != NULL )
+        if( pxSession->xOperationInProgress == CKM_SHA256 )
         {
-            vPortFree( pxSession->pxHashOperationHandle );
+            ( void ) psa_hash_abort( &pxSession->xHashOperation );
         }
         vPortFree( pxSession );
     }
@@ -1717,6 +2161,8 @@ CK_DECLARE_FUNCTION( CK_RV, C_CreateObject )( CK_SESSION_HANDLE xSession,
                 xResult = CKR_ATTRIBUTE_VALUE_INVALID;
                 break;
         }
+
+        prvObjectsChanged();
     }
 
     return xResult;
@@ -1735,8 +2181,9 @@ CK_RV prvDeleteObjectFromList( CK_OBJECT_HANDLE xAppHandle )
     CK_RV xResult = CKR_OK;
     osStatus_t xGotSemaphore = osError;
     int lIndex = xAppHandle - 1;
+    P11Object_t * pxObject;
 
-    if( lIndex >= pkcs11configMAX_NUM_OBJECTS )
+    if( ( xAppHandle == CK_INVALID_HANDLE ) || ( lIndex >= pkcs11configMAX_NUM_OBJECTS ) )
     {
         xResult = CKR_OBJECT_HANDLE_INVALID;
     }
@@ -1748,9 +2195,15 @@ CK_RV prvDeleteObjectFromList( CK_OBJECT_HANDLE xAppHandle )
 
     if( ( xGotSemaphore == osOK ) && ( xResult == CKR_OK ) )
     {
-        if( xP11Context.xObjectList.xObjects[ lIndex ].xHandle != CK_INVALID_HANDLE )
+        pxObject = &xP11Context.xObjectList.xObjects[ lIndex ];
+
+        if( pxObject->xHandle != CK_INVALID_HANDLE )
         {
-            memset( &xP11Context.xObjectList.xObjects[ lIndex ], 0, sizeof( P11Object_t ) );
+            prvObjectListWriteBegin();
+            prvObjectIndexRemove( xP11Context.xObjectList.ucLabelIndex, pxObject->ulLabelHash, ( uint8_t ) xAppHandle );
+            prvObjectIndexRemove( xP11Context.xObjectList.ucHandleIndex, prvObjectHandleHash( pxObject->xHandle ), ( uint8_t ) xAppHandle );
+            memset( pxObject, 0, sizeof( P11Object_t ) );
+            prvObjectListWriteEnd();
         }
         else
         {
@@ -1793,6 +2246,8 @@ CK_DEFINE_FUNCTION( CK_RV, C_DestroyObject )( CK_SESSION_HANDLE xSession,
             {
                 xResult = prvDeleteObjectFromList( xObject );
             }
+
+            prvObjectsChanged();
         }
     }
 
@@ -1816,7 +2271,7 @@ CK_DEFINE_FUNCTION( CK_RV, C_GetAttributeValue )( CK_SESSION_HANDLE xSession,
     mbedtls_ecp_keypair * pxKeyPair;
     CK_KEY_TYPE xPkcsKeyType = ( CK_KEY_TYPE ) ~0;
     CK_OBJECT_CLASS xClass;
-    uint8_t * pxObjectValue = NULL;
+    const uint8_t * pxObjectValue = NULL;
     uint8_t ucP256Oid[] = pkcs11DER_ENCODED_OID_P256;
     int lMbedTLSResult = 0;
     CK_OBJECT_HANDLE xPalHandle = CK_INVALID_HANDLE;
@@ -1824,9 +2279,8 @@ CK_DEFINE_FUNCTION( CK_RV, C_GetAttributeValue )( CK_SESSION_HANDLE xSession,
     psa_status_t uxStatus;
     mbedtls_ecp_group ecp_group;
     mbedtls_ecp_point ecp_point;
-    unsigned char ucGetData[pkcs11OBJECT_MAX_SIZE];
     uint8_t * pcLabel = NULL;
-    size_t ulLength = pkcs11OBJECT_MAX_SIZE;
+    size_t ulLength = 0;
     psa_algorithm_t key_algorithm;
 
     if( xResult == CKR_OK )
@@ -1845,11 +2299,7 @@ CK_DEFINE_FUNCTION( CK_RV, C_GetAttributeValue )( CK_SESSION_HANDLE xSession,
 
         if( xPalHandle != CK_INVALID_HANDLE )
         {
-            xResult = PKCS11PSAGetObjectValue( xPalHandle, ucGetData, &ulLength, &xIsPrivate );
-            if( xResult == CKR_OK )
-            {
-                pxObjectValue = ucGetData;
-            }
+            xResult = PKCS11PSABorrowObjectValue( xPalHandle, &pxObjectValue, &ulLength, &xIsPrivate );
         }
         else
         {
@@ -2035,8 +2485,8 @@ CK_DEFINE_FUNCTION( CK_RV, C_GetAttributeValue )( CK_SESSION_HANDLE xSession,
             }
         }
 
-        /* Free the buffer where object was stored. */
-        PKCS11PSAGetObjectValueCleanup( pxObjectValue, ulLength );
+        /* Release the staging buffer where object was read. */
+        PKCS11PSAReleaseObjectValue( pxObjectValue );
 
         /* Free the mbedTLS structure used to parse the key. */
         mbedtls_pk_free( &xKeyContext );
@@ -2514,7 +2964,6 @@ CK_DEFINE_FUNCTION( CK_RV, C_DigestInit )( CK_SESSION_HANDLE xSession,
                                            CK_MECHANISM_PTR pMechanism )
 {
     CK_RV xResult = PKCS11_SESSION_VALID_AND_MODULE_INITIALIZED( xSession );
-    psa_hash_operation_t* pxHandle = NULL;
     P11SessionPtr_t pxSession = prvSessionPointerFromHandle( xSession );
     psa_status_t uxStatus;
 
@@ -2531,27 +2980,26 @@ CK_DEFINE_FUNCTION( CK_RV, C_DigestInit )( CK_SESSION_HANDLE xSession,
         xResult = CKR_MECHANISM_INVALID;
     }
 
-    if( xResult == CKR_OK )
-    {
-        pxHandle = ( psa_hash_operation_t * )pvPortMalloc( sizeof( psa_hash_operation_t ) );
-        if( pxHandle == NULL )
-        {
-            xResult = CKR_HOST_MEMORY;
-        }
-    }
-
     /*
-     * Initialize the requested hash type
+     * Initialize the requested hash type. The operation lives in the session
+     * so that digests are streamed to the PSA crypto service without any
+     * allocation.
      */
     if ( xResult == CKR_OK )
     {
-        *pxHandle = psa_hash_operation_init();
+        if( pxSession->xOperationInProgress == CKM_SHA256 )
+        {
+            ( void ) psa_hash_abort( &pxSession->xHashOperation );
+            pxSession->xOperationInProgress = pkcs11NO_OPERATION;
+        }
+
+        pxSession->xHashOperation = psa_hash_operation_init();
 
         /*
          * Setup the hash object for the desired hash.
          * Currently only the SHA_256 algorithm is supported.
          */
-        uxStatus = psa_hash_setup( pxHandle, PSA_ALG_SHA_256 );
+        uxStatus = psa_hash_setup( &pxSession->xHashOperation, PSA_ALG_SHA_256 );
         if ( uxStatus != PSA_SUCCESS )
         {
             xResult = CKR_FUNCTION_FAILED;
@@ -2559,7 +3007,6 @@ CK_DEFINE_FUNCTION( CK_RV, C_DigestInit )( CK_SESSION_HANDLE xSession,
         else
         {
             pxSession->xOperationInProgress = pMechanism->mechanism;
-            pxSession->pxHashOperationHandle = pxHandle;
         }
     }
 
@@ -2585,8 +3032,7 @@ CK_DEFINE_FUNCTION( CK_RV, C_DigestUpdate )( CK_SESSION_HANDLE xSession,
 
     if( xResult == CKR_OK )
     {
-        if( ( pxSession->xOperationInProgress != CKM_SHA256 ) ||
-            ( pxSession->pxHashOperationHandle == NULL ) )
+        if( pxSession->xOperationInProgress != CKM_SHA256 )
         {
             xResult = CKR_OPERATION_NOT_INITIALIZED;
         }
@@ -2594,16 +3040,14 @@ CK_DEFINE_FUNCTION( CK_RV, C_DigestUpdate )( CK_SESSION_HANDLE xSession,
 
     if( xResult == CKR_OK )
     {
-        uxStatus = psa_hash_update( pxSession->pxHashOperationHandle, pPart, ulPartLen );
+        uxStatus = psa_hash_update( &pxSession->xHashOperation, pPart, ulPartLen );
         if( uxStatus != PSA_SUCCESS )
         {
-            uxStatus = psa_hash_abort( pxSession->pxHashOperationHandle );
+            uxStatus = psa_hash_abort( &pxSession->xHashOperation );
             if( uxStatus != PSA_SUCCESS )
             {
                 PKCS11_PRINT( ( "ERROR: psa_hash_abort error. \r\n" ) );
             }
-            vPortFree( pxSession->pxHashOperationHandle );
-            pxSession->pxHashOperationHandle = NULL;
             pxSession->xOperationInProgress = pkcs11NO_OPERATION;
             xResult = CKR_FUNCTION_FAILED;
         }
@@ -2617,6 +3061,7 @@ CK_DEFINE_FUNCTION( CK_RV, C_DigestFinal )( CK_SESSION_HANDLE xSession,
                                             CK_ULONG_PTR pulDigestLen )
 {
     psa_status_t uxStatus;
+    size_t xDigestLength;
     CK_RV xResult = PKCS11_SESSION_VALID_AND_MODULE_INITIALIZED( xSession );
     P11SessionPtr_t pxSession = prvSessionPointerFromHandle( xSession );
 
@@ -2652,14 +3097,18 @@ CK_DEFINE_FUNCTION( CK_RV, C_DigestFinal )( CK_SESSION_HANDLE xSession,
             }
             else
             {
-                uxStatus = psa_hash_finish( pxSession->pxHashOperationHandle, pDigest, *pulDigestLen, ( size_t * )pulDigestLen );
+                xDigestLength = 0;
+                uxStatus = psa_hash_finish( &pxSession->xHashOperation, pDigest, *pulDigestLen, &xDigestLength );
                 if( uxStatus != PSA_SUCCESS )
                 {
+                    ( void ) psa_hash_abort( &pxSession->xHashOperation );
                     xResult = CKR_FUNCTION_FAILED;
                 }
+                else
+                {
+                    *pulDigestLen = xDigestLength;
+                }
                 pxSession->xOperationInProgress = pkcs11NO_OPERATION;
-                vPortFree( pxSession->pxHashOperationHandle );
-                pxSession->pxHashOperationHandle = NULL;
             }
         }
     }
@@ -2700,7 +3149,7 @@ CK_DEFINE_FUNCTION( CK_RV, C_SignInit )( CK_SESSION_HANDLE xSession,
     CK_OBJECT_HANDLE xPalHandle;
     uint8_t * pcLabel = NULL;
     size_t xLabelLength = 0;
-    psa_status_t uxStatus;
+    psa_algorithm_t xKeyAlgorithm;
     psa_key_handle_t uxKeyHandle;
 
     /*lint !e9072 It's OK to have different parameter name. */
@@ -2742,25 +3191,11 @@ CK_DEFINE_FUNCTION( CK_RV, C_SignInit )( CK_SESSION_HANDLE xSession,
              */
             if ( xPalHandle == eAwsDevicePrivateKey )
             {
-                xResult = PKCS11PSAGetKeyHandle( pcLabel, xLabelLength, &uxKeyHandle );
+                xResult = prvGetObjectKey( xKey, &uxKeyHandle, &xKeyAlgorithm );
                 if ( xResult == CKR_OK )
                 {
                     pxSession->uxSignKey = uxKeyHandle;
-
-                    /* Get the key's algorithm. */
-                    psa_key_attributes_t key_attributes = PSA_KEY_ATTRIBUTES_INIT;
-                    psa_algorithm_t key_algorithm = 0;
-                    uxStatus = psa_get_key_attributes( uxKeyHandle, &key_attributes );
-                    if ( uxStatus == PSA_SUCCESS )
-                    {
-                        key_algorithm = psa_get_key_algorithm( &key_attributes );
-                        pxSession->xSignAlgorithm = key_algorithm;
-                        psa_reset_key_attributes( &key_attributes );
-                    }
-                    else
-                    {
-                        xResult = CKR_FUNCTION_FAILED;
-                    }
+                    pxSession->xSignAlgorithm = xKeyAlgorithm;
                 }
                 else
                 {
@@ -2995,7 +3430,7 @@ CK_DEFINE_FUNCTION( CK_RV, C_VerifyInit )( CK_SESSION_HANDLE xSession,
     CK_OBJECT_HANDLE xPalHandle = CK_INVALID_HANDLE;
     uint8_t * pcLabel = NULL;
     size_t xLabelLength = 0;
-    psa_status_t uxStatus;
+    psa_algorithm_t xKeyAlgorithm;
     psa_key_handle_t uxKeyHandle;
 
     pxSession = prvSessionPointerFromHandle( xSession );
@@ -3028,28 +3463,15 @@ CK_DEFINE_FUNCTION( CK_RV, C_VerifyInit )( CK_SESSION_HANDLE xSession,
     {
         if( osOK == osMutexAcquire( pxSession->xVerifyMutex, osWaitForever ) )
         {
-            xResult = PKCS11PSAGetKeyHandle( pcLabel, xLabelLength, &uxKeyHandle );
+            xResult = prvGetObjectKey( xKey, &uxKeyHandle, &xKeyAlgorithm );
             if( xResult == CKR_OK )
             {
                 pxSession->uxVerifyKey = uxKeyHandle;
-                psa_key_attributes_t key_attributes = PSA_KEY_ATTRIBUTES_INIT;
-                psa_algorithm_t key_algorithm = 0;
-                uxStatus = psa_get_key_attributes( uxKeyHandle, &key_attributes );
-                if ( uxStatus != PSA_SUCCESS )
-                {
-                    xResult = CKR_FUNCTION_FAILED;
-                }
-                else
-                {
-                    key_algorithm = psa_get_key_algorithm( &key_attributes );
-                    pxSession->xVerifyAlgorithm = key_algorithm;
-                    psa_reset_key_attributes( &key_attributes );
-                }
+                pxSession->xVerifyAlgorithm = xKeyAlgorithm;
             }
             else
             {
                 pxSession->uxVerifyKey = 0;
-                xResult = CKR_KEY_HANDLE_INVALID;
             }
 
             if ( osMutexRelease( pxSession->xVerifyMutex ) != osOK ) { 
@@ -3625,6 +4047,8 @@ CK_DEFINE_FUNCTION( CK_RV, C_GenerateKeyPair )( CK_SESSION_HANDLE xSession,
         {
             xResult = CKR_FUNCTION_FAILED;
         }
+
+        prvObjectsChanged();
     }
     return xResult;
 }
@@ -32,6 +32,7 @@
  */
 
 #include <string.h>
+#include "cmsis_os2.h"
 #include "iot_pkcs11_psa_object_management.h"
 #include "iot_pkcs11_psa_input_format.h"
 
@@ -45,6 +46,22 @@ extern int convert_pem_to_der( const unsigned char * pucInput, size_t xLen,
  */
 P11KeyConfig_t P11KeyConfig __attribute__(( section( "tasks_share" ) ));
 
+/*
+ * Staging buffer that object values are read into by PKCS11PSABorrowObjectValue().
+ * The last certificate read stays staged until an object is saved or removed.
+ */
+typedef struct
+{
+    osMutexId_t xMutex;         /* Held from borrow to release. */
+    CK_OBJECT_HANDLE xHandle;   /* Certificate held in ucData, eInvalidHandle if none. */
+    size_t xDataSize;
+    uint8_t ucData[ pkcs11OBJECT_STAGING_SIZE + 1 ]; /* Plus 1 to null terminate PEM data. */
+} P11ObjectStaging_t;
+
+static P11ObjectStaging_t xObjectStaging __attribute__(( section( "tasks_share" ) ));
+
+static void prvStagingInvalidate( void );
+
 /** Convert an ECC curve identifier from the Mbed TLS encoding to PSA.
  *
  * \note This function is provided solely for the convenience of
@@ -146,6 +163,8 @@ CK_OBJECT_HANDLE PKCS11PSASaveObject( CK_ATTRIBUTE_PTR pxClass,
     uint32_t ulKeyDataSize = 0;
     mbedtls_pk_type_t uxPrivateKeyTypePKCS11 = 0;
 
+    prvStagingInvalidate();
+
     if( ulDataSize <= pkcs11OBJECT_MAX_SIZE )
     {
         /*
@@ -424,62 +443,114 @@ CK_OBJECT_HANDLE PKCS11PSASaveObject( CK_ATTRIBUTE_PTR pxClass,
 }
 
 /**
-* @brief Helper function to get value of a certificate from PSA secure storage
+* @brief Locks the staging buffer, creating its mutex on first use.
+*/
+static CK_RV prvStagingLock( void )
+{
+    const osMutexAttr_t xMutexAttr =
+    {
+        "pkcs11-staging",
+        osMutexRecursive | osMutexPrioInherit,
+        NULL,
+        0U
+    };
+    int32_t lLock;
+
+    if( xObjectStaging.xMutex == NULL )
+    {
+        lLock = osKernelLock();
+
+        if( xObjectStaging.xMutex == NULL )
+        {
+            xObjectStaging.xMutex = osMutexNew( &xMutexAttr );
+        }
+
+        ( void ) osKernelRestoreLock( lLock );
+    }
+
+    if( ( xObjectStaging.xMutex == NULL ) ||
+        ( osMutexAcquire( xObjectStaging.xMutex, osWaitForever ) != osOK ) )
+    {
+        return CKR_CANT_LOCK;
+    }
+
+    return CKR_OK;
+}
+
+/**
+* @brief Drops the certificate held in the staging buffer.
+*
+* Called whenever objects are saved or removed so that a later borrow
+* reads the new value back from protected storage.
+*/
+static void prvStagingInvalidate( void )
+{
+    if( prvStagingLock() == CKR_OK )
+    {
+        xObjectStaging.xHandle = eInvalidHandle;
+        ( void ) osMutexRelease( xObjectStaging.xMutex );
+    }
+}
+
+/**
+* @brief Helper function to stage the value of a certificate from PSA secure storage
+*
+* The stored certificate is read into the staging buffer and, if it is PEM,
+* converted to DER in place: base64 decoding writes behind the position it
+* reads from, so the input is never overwritten before it has been consumed.
 *
 * @param[in]  uid          The uid value.
-* @param[out] pucData      Pointer to buffer for file data.
-* @param[out] pulDataSize  Size (in bytes) of data located in file.
-* @param[out] pIsPrivate   Boolean indicating if value is private (CK_TRUE)
-*                          or exportable (CK_FALSE)
+* @param[in]  xHandle      The object handle of the certificate.
 *
 * @return CKR_OK if operation was successful.  CKR_KEY_HANDLE_INVALID if
-* no such object handle was found, CKR_DEVICE_MEMORY if memory for
-* buffer could not be allocated, CKR_FUNCTION_FAILED for device driver
+* no such object handle was found, CKR_DEVICE_MEMORY if the certificate
+* does not fit the staging buffer, CKR_FUNCTION_FAILED for device driver
 * error.
 */
-static CK_RV PSAGetCertificateValue( psa_storage_uid_t uid,
-    uint8_t * pucData,
-    size_t * pulDataSize,
-    CK_BBOOL * pIsPrivate )
+static CK_RV PSAStageCertificateValue( psa_storage_uid_t uid,
+    CK_OBJECT_HANDLE xHandle )
 {
     CK_RV ulReturn = CKR_OBJECT_HANDLE_INVALID;
-    size_t ulDataSize = *pulDataSize;
     psa_status_t uxStatus;
-    uint8_t * pucBuffer;
+    size_t ulDataSize = pkcs11OBJECT_STAGING_SIZE;
     size_t ulReadDataLen = 0;
     struct psa_storage_info_t info = {0};
 
+    if( xObjectStaging.xHandle == xHandle )
+    {
+        return CKR_OK;
+    }
+
+    xObjectStaging.xHandle = eInvalidHandle;
+
     /* Get the size of the data associated with the certificate UID firstly. */
     uxStatus = psa_ps_get_info( uid, &info );
 
     if ( uxStatus == PSA_SUCCESS )
     {
-        /* Allocate buffer for object value */
-        pucBuffer = pvPortMalloc( info.size );
-
-        if ( pucBuffer != NULL )
+        if ( info.size <= pkcs11OBJECT_STAGING_SIZE )
         {
             /* Get the object value */
-            uxStatus = psa_ps_get( uid, 0, info.size, pucBuffer, &ulReadDataLen );
+            uxStatus = psa_ps_get( uid, 0, info.size, xObjectStaging.ucData, &ulReadDataLen );
             if ( uxStatus == PSA_SUCCESS )
             {
+                xObjectStaging.ucData[ ulReadDataLen ] = '\0';
+
                 /* Convert the certificate from PEM to DER format */
-                if ( convert_pem_to_der( pucBuffer, ulReadDataLen, pucData, &ulDataSize ) != 0 )
+                if ( convert_pem_to_der( xObjectStaging.ucData, ulReadDataLen, xObjectStaging.ucData, &ulDataSize ) != 0 )
                 {
                     /* Not PEM format, use as it is. */
                     ulDataSize = ulReadDataLen;
-                    memcpy( pucData, pucBuffer, ulDataSize );
                 }
 
-                *pulDataSize = ulDataSize;
-                *pIsPrivate = CK_FALSE;
+                xObjectStaging.xDataSize = ulDataSize;
+                xObjectStaging.xHandle = xHandle;
                 ulReturn = CKR_OK;
             }
             else
             {
                 ulReturn = CKR_FUNCTION_FAILED;
             }
-            vPortFree( pucBuffer );
         }
         else
         {
@@ -490,191 +561,181 @@ static CK_RV PSAGetCertificateValue( psa_storage_uid_t uid,
 }
 
 /**
-* @brief Gets the value of an object in storage, by handle.
+* @brief Helper function to export the value of a key into the staging buffer.
 *
-* Port-specific file access for cryptographic information.
+* @param[in]  uxKeyHandle  The PSA key.
+* @param[out] pIsPrivate   Set to CK_TRUE if the key can not be exported.
 *
-* This call dynamically allocates the buffer which object value
-* data is copied into.  PKCS11PSAGetObjectValueCleanup()
-* should be called after each use to free the dynamically allocated
-* buffer.
+* @return CKR_OK if operation was successful, CKR_FUNCTION_FAILED for
+* device driver error.
+*/
+static CK_RV PSAStageKeyValue( psa_key_handle_t uxKeyHandle,
+    CK_BBOOL * pIsPrivate )
+{
+    CK_RV ulReturn = CKR_FUNCTION_FAILED;
+    psa_status_t uxStatus;
+
+    /* Keys are not kept staged: their handles change when they are imported again. */
+    xObjectStaging.xHandle = eInvalidHandle;
+    xObjectStaging.xDataSize = 0;
+
+    uxStatus = psa_export_key( uxKeyHandle,
+                               xObjectStaging.ucData,
+                               pkcs11OBJECT_STAGING_SIZE,
+                               &xObjectStaging.xDataSize );
+    if ( uxStatus == PSA_ERROR_NOT_PERMITTED )
+    {
+        *pIsPrivate = CK_TRUE;
+        ulReturn = CKR_OK;
+    }
+    else if ( uxStatus == PSA_SUCCESS )
+    {
+        *pIsPrivate = CK_FALSE;
+        ulReturn = CKR_OK;
+    }
+
+    return ulReturn;
+}
+
+/**
+* @brief Borrows the value of an object in storage, by handle.
 *
-* @sa PKCS11PSAGetObjectValueCleanup
+* The value is read into a staging buffer owned by this module and no memory
+* is allocated. The staging buffer stays locked until
+* PKCS11PSAReleaseObjectValue() is called, which must happen after each
+* successful call.
 *
-* @param[in] pcFileName    The name of the file to be read.
-* @param[out] pucData     Pointer to buffer for file data.
-* @param[out] pulDataSize  Size (in bytes) of data located in file.
+* @sa PKCS11PSAReleaseObjectValue
+*
+* @param[in] xHandle       The handle of the object to read.
+* @param[out] ppucData     Set to the object value in the staging buffer.
+* @param[out] pulDataSize  Size (in bytes) of the object value.
 * @param[out] pIsPrivate   Boolean indicating if value is private (CK_TRUE)
 *                          or exportable (CK_FALSE)
 *
 * @return CKR_OK if operation was successful.  CKR_KEY_HANDLE_INVALID if
-* no such object handle was found, CKR_DEVICE_MEMORY if memory for
-* buffer could not be allocated, CKR_FUNCTION_FAILED for device driver
-* error.
+* no such object handle was found, CKR_DEVICE_MEMORY if the object does not
+* fit the staging buffer, CKR_CANT_LOCK if the staging buffer could not be
+* locked, CKR_FUNCTION_FAILED for device driver error.
 */
-CK_RV PKCS11PSAGetObjectValue( CK_OBJECT_HANDLE xHandle,
-    uint8_t * pucData,
+CK_RV PKCS11PSABorrowObjectValue( CK_OBJECT_HANDLE xHandle,
+    const uint8_t ** ppucData,
     size_t * pulDataSize,
     CK_BBOOL * pIsPrivate )
 {
     CK_RV ulReturn = CKR_OBJECT_HANDLE_INVALID;
-    psa_status_t uxStatus;
-    psa_key_type_t key_type;
-    size_t key_bits;
-    size_t buffer_size;
-    psa_key_attributes_t attributes = PSA_KEY_ATTRIBUTES_INIT;
 
-    /*
-     * Read client certificate.
-     */
-    if( xHandle == eAwsDeviceCertificate )
+    *ppucData = NULL;
+    *pulDataSize = 0;
+
+    if( prvStagingLock() != CKR_OK )
     {
-        /*
-         * return reference and size only if certificates are present in the device.
-         */
-        if( P11KeyConfig.xDeviceCertificateMark == pdTRUE )
-        {
-            ulReturn = PSAGetCertificateValue(PSA_DEVICE_CERTIFICATE_UID, pucData, pulDataSize, pIsPrivate);
-        }
+        return CKR_CANT_LOCK;
     }
 
     /*
-     * Read Jitp certificate.
+     * return reference and size only if the object is present in the device.
      */
-    if( xHandle == eAwsJitpCertificate )
+    if( ( xHandle == eAwsDeviceCertificate ) && ( P11KeyConfig.xDeviceCertificateMark == pdTRUE ) )
     {
-        /*
-         * return reference and size only if certificates are present in the device.
-         */
-        if( P11KeyConfig.xJitpCertificateMark == pdTRUE )
-        {
-            ulReturn = PSAGetCertificateValue(PSA_JITP_CERTIFICATE_UID, pucData, pulDataSize, pIsPrivate);
-        }
+        ulReturn = PSAStageCertificateValue( PSA_DEVICE_CERTIFICATE_UID, xHandle );
+        *pIsPrivate = CK_FALSE;
     }
-
-    /*
-     * Read Root certificate.
-     */
-    if( xHandle == eAwsRootCertificate )
+    else if( ( xHandle == eAwsJitpCertificate ) && ( P11KeyConfig.xJitpCertificateMark == pdTRUE ) )
     {
-        /*
-         * return reference and size only if certificates are present in the device.
-         */
-        if( P11KeyConfig.xRootCertificateMark  == pdTRUE )
-        {
-            ulReturn = PSAGetCertificateValue(PSA_ROOT_CERTIFICATE_UID, pucData, pulDataSize, pIsPrivate);
-        }
+        ulReturn = PSAStageCertificateValue( PSA_JITP_CERTIFICATE_UID, xHandle );
+        *pIsPrivate = CK_FALSE;
+    }
+    else if( ( xHandle == eAwsRootCertificate ) && ( P11KeyConfig.xRootCertificateMark == pdTRUE ) )
+    {
+        ulReturn = PSAStageCertificateValue( PSA_ROOT_CERTIFICATE_UID, xHandle );
+        *pIsPrivate = CK_FALSE;
+    }
+    else if( ( xHandle == eAwsDevicePrivateKey ) && ( P11KeyConfig.xDevicePrivateKeyMark == pdTRUE ) )
+    {
+        ulReturn = PSAStageKeyValue( P11KeyConfig.uxDevicePrivateKey, pIsPrivate );
+    }
+    else if( ( xHandle == eAwsDevicePublicKey ) && ( P11KeyConfig.xDevicePublicKeyMark == pdTRUE ) )
+    {
+        ulReturn = PSAStageKeyValue( P11KeyConfig.uxDevicePublicKey, pIsPrivate );
+    }
+    else if( ( xHandle == eAwsCodeVerifyingKey ) && ( P11KeyConfig.xCodeVerifyKeyMark == pdTRUE ) )
+    {
+        ulReturn = PSAStageKeyValue( P11KeyConfig.uxCodeVerifyKey, pIsPrivate );
     }
 
-    /*
-     * Read client key.
-     */
-    else if( xHandle == eAwsDevicePrivateKey )
+    if( ulReturn == CKR_OK )
     {
-        /*
-         * return reference and size only if key is present in the device and is not private
-         */
-        if( P11KeyConfig.xDevicePrivateKeyMark == pdTRUE )
-        {
-            uxStatus = psa_get_key_attributes( P11KeyConfig.uxDevicePrivateKey, &attributes );
-            if( uxStatus == PSA_SUCCESS )
-            {
-                key_type = psa_get_key_type( &attributes );
-                key_bits = psa_get_key_bits( &attributes );
-                buffer_size = PSA_EXPORT_KEY_OUTPUT_SIZE( key_type, key_bits );
-                uxStatus = psa_export_key( P11KeyConfig.uxDevicePrivateKey, pucData, buffer_size, pulDataSize );
-                if ( uxStatus == PSA_ERROR_NOT_PERMITTED )
-                {
-                    *pIsPrivate = CK_TRUE;
-                    ulReturn = CKR_OK;
-                }
-                else if ( uxStatus == PSA_SUCCESS )
-                {
-                    *pIsPrivate = CK_FALSE;
-                    ulReturn = CKR_OK;
-                }
-                else
-                {
-                    ulReturn = CKR_FUNCTION_FAILED;
-                }
-            }
-            else
-            {
-                ulReturn = CKR_FUNCTION_FAILED;
-            }
-        }
+        *ppucData = xObjectStaging.ucData;
+        *pulDataSize = xObjectStaging.xDataSize;
     }
+    else
+    {
+        ( void ) osMutexRelease( xObjectStaging.xMutex );
+    }
+
+    return ulReturn;
+}
 
-    else if( xHandle == eAwsDevicePublicKey )
+/**
+* @brief Release an object value borrowed with PKCS11PSABorrowObjectValue().
+*
+* @param[in] pucData       The value to release.
+*                          (*ppucData from PKCS11PSABorrowObjectValue())
+*/
+void PKCS11PSAReleaseObjectValue( const uint8_t * pucData )
+{
+    if( pucData != NULL )
     {
-        /*
-         * return reference and size only if key is present in the device and is not private
-         */
-        if( P11KeyConfig.xDevicePublicKeyMark == pdTRUE )
-        {
-            uxStatus = psa_get_key_attributes( P11KeyConfig.uxDevicePublicKey, &attributes );
-            if( uxStatus == PSA_SUCCESS )
-            {
-                key_type = psa_get_key_type( &attributes );
-                key_bits = psa_get_key_bits( &attributes );
-                buffer_size = PSA_EXPORT_KEY_OUTPUT_SIZE( key_type, key_bits );
-                uxStatus = psa_export_key( P11KeyConfig.uxDevicePublicKey, pucData, buffer_size, pulDataSize );
-                if ( uxStatus == PSA_ERROR_NOT_PERMITTED )
-                {
-                    *pIsPrivate = CK_TRUE;
-                    ulReturn = CKR_OK;
-                }
-                else if ( uxStatus == PSA_SUCCESS )
-                {
-                    *pIsPrivate = CK_FALSE;
-                    ulReturn = CKR_OK;
-                }
-                else
-                {
-                    ulReturn = CKR_FUNCTION_FAILED;
-                }
-            }
-            else
-            {
-                ulReturn = CKR_FUNCTION_FAILED;
-            }
-        }
+        ( void ) osMutexRelease( xObjectStaging.xMutex );
     }
+}
+
+/**
+* @brief Gets the value of an object in storage, by handle.
+*
+* Port-specific file access for cryptographic information.
+*
+* The object value is copied into the caller's buffer, prefer
+* PKCS11PSABorrowObjectValue() which avoids the copy.
+*
+* @sa PKCS11PSAGetObjectValueCleanup
+*
+* @param[in] xHandle       The handle of the object to read.
+* @param[out] pucData      Pointer to buffer for file data.
+* @param[in,out] pulDataSize  Size (in bytes) of pucData, updated with the size of
+*                          the data located in file.
+* @param[out] pIsPrivate   Boolean indicating if value is private (CK_TRUE)
+*                          or exportable (CK_FALSE)
+*
+* @return CKR_OK if operation was successful.  CKR_KEY_HANDLE_INVALID if
+* no such object handle was found, CKR_BUFFER_TOO_SMALL if pucData can not
+* hold the value, CKR_FUNCTION_FAILED for device driver error.
+*/
+CK_RV PKCS11PSAGetObjectValue( CK_OBJECT_HANDLE xHandle,
+    uint8_t * pucData,
+    size_t * pulDataSize,
+    CK_BBOOL * pIsPrivate )
+{
+    CK_RV ulReturn;
+    const uint8_t * pucValue;
+    size_t ulValueSize;
+
+    ulReturn = PKCS11PSABorrowObjectValue( xHandle, &pucValue, &ulValueSize, pIsPrivate );
 
-    else if( xHandle == eAwsCodeVerifyingKey )
+    if( ulReturn == CKR_OK )
     {
-        /*
-         * return reference and size only if key is present in the device and is not private
-         */
-        if( P11KeyConfig.xCodeVerifyKeyMark == pdTRUE )
+        if( ulValueSize <= *pulDataSize )
         {
-            uxStatus = psa_get_key_attributes( P11KeyConfig.uxCodeVerifyKey, &attributes );
-            if( uxStatus == PSA_SUCCESS )
-            {
-                key_type = psa_get_key_type( &attributes );
-                key_bits = psa_get_key_bits( &attributes );
-                buffer_size = PSA_EXPORT_KEY_OUTPUT_SIZE( key_type, key_bits );
-                uxStatus = psa_export_key( P11KeyConfig.uxCodeVerifyKey, pucData, buffer_size, pulDataSize );
-                if ( uxStatus == PSA_ERROR_NOT_PERMITTED )
-                {
-                    *pIsPrivate = CK_TRUE;
-                    ulReturn = CKR_OK;
-                }
-                else if ( uxStatus == PSA_SUCCESS )
-                {
-                    *pIsPrivate = CK_FALSE;
-                    ulReturn = CKR_OK;
-                }
-                else
-                {
-                    ulReturn = CKR_FUNCTION_FAILED;
-                }
-            }
-            else
-            {
-                ulReturn = CKR_FUNCTION_FAILED;
-            }
+            memcpy( pucData, pucValue, ulValueSize );
+            *pulDataSize = ulValueSize;
         }
+        else
+        {
+            ulReturn = CKR_BUFFER_TOO_SMALL;
+        }
+
+        PKCS11PSAReleaseObjectValue( pucValue );
     }
 
     return ulReturn;
@@ -776,6 +837,8 @@ CK_RV PKCS11PSARemoveObject(uint8_t * pcLable, size_t xLabelLength, bool permane
     CK_RV xResult = CKR_OK;
     psa_status_t uxStatus;
 
+    prvStagingInvalidate();
+
     if( memcmp( pcLable, pkcs11configLABEL_DEVICE_PRIVATE_KEY_FOR_TLS, xLabelLength ) == 0 )
     {
         if( P11KeyConfig.xDevicePrivateKeyMark == pdTRUE )
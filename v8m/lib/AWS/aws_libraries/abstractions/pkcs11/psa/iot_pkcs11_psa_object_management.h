@@ -79,6 +79,16 @@
  */
 #define pkcs11OBJECT_MAX_SIZE         ( 1300 )
 
+/**
+ * @brief Size of the buffer object values are staged in when read.
+ *
+ * Certificates are kept in protected storage as PEM, this must hold the PEM
+ * encoding of a pkcs11OBJECT_MAX_SIZE bytes DER certificate.
+ */
+#ifndef pkcs11OBJECT_STAGING_SIZE
+#define pkcs11OBJECT_STAGING_SIZE     ( 1920 )
+#endif
+
 /**
  * @brief The oject handle field is N/A/
  */
@@ -136,28 +146,60 @@ CK_OBJECT_HANDLE PKCS11PSASaveObject( CK_ATTRIBUTE_PTR pxClass,
     uint32_t ulDataSize,
     mbedtls_pk_context *pvContext );
 
+/**
+* @brief Borrows the value of an object in storage, by handle.
+*
+* The value is read into a staging buffer owned by the object management
+* and no memory is allocated. The staging buffer stays locked until
+* PKCS11PSAReleaseObjectValue() is called, which must happen after each
+* successful call.
+*
+* @sa PKCS11PSAReleaseObjectValue
+*
+* @param[in] xHandle       The handle of the object to read.
+* @param[out] ppucData     Set to the object value in the staging buffer.
+* @param[out] pulDataSize  Size (in bytes) of the object value.
+* @param[out] pIsPrivate   Boolean indicating if value is private (CK_TRUE)
+*                          or exportable (CK_FALSE)
+*
+* @return CKR_OK if operation was successful.  CKR_KEY_HANDLE_INVALID if
+* no such object handle was found, CKR_DEVICE_MEMORY if the object does not
+* fit the staging buffer, CKR_CANT_LOCK if the staging buffer could not be
+* locked, CKR_FUNCTION_FAILED for device driver error.
+*/
+CK_RV PKCS11PSABorrowObjectValue( CK_OBJECT_HANDLE xHandle,
+    const uint8_t ** ppucData,
+    size_t * pulDataSize,
+    CK_BBOOL * pIsPrivate );
+
+/**
+* @brief Release an object value borrowed with PKCS11PSABorrowObjectValue().
+*
+* @param[in] pucData       The value to release.
+*                          (*ppucData from PKCS11PSABorrowObjectValue())
+*/
+void PKCS11PSAReleaseObjectValue( const uint8_t * pucData );
+
 /**
 * @brief Gets the value of an object in storage, by handle.
 *
 * Port-specific file access for cryptographic information.
 *
-* This call dynamically allocates the buffer which object value
-* data is copied into.  PKCS11PSAGetObjectValueCleanup()
-* should be called after each use to free the dynamically allocated
-* buffer.
+* The object value is copied into the caller's buffer, prefer
+* PKCS11PSABorrowObjectValue() which avoids the copy.
 *
 * @sa PKCS11PSAGetObjectValueCleanup
 *
-* @param[in] pcFileName    The name of the file to be read.
+* @param[in] xHandle       The handle of the object to read.
 * @param[out] ppucData     Pointer to buffer for file data.
-* @param[out] pulDataSize  Size (in bytes) of data located in file.
+* @param[in,out] pulDataSize  Size (in bytes) of ppucData, updated with the size of
+*                          the data located in file.
 * @param[out] pIsPrivate   Boolean indicating if value is private (CK_TRUE)
 *                          or exportable (CK_FALSE)
 *
 * @return CKR_OK if operation was successful.  CKR_KEY_HANDLE_INVALID if
-* no such object handle was found, CKR_DEVICE_MEMORY if memory for
-* buffer could not be allocated, CKR_FUNCTION_FAILED for device driver
-* error.
+* no such object handle was found, CKR_BUFFER_TOO_SMALL if ppucData can not
+* hold the value, CKR_FUNCTION_FAILED for device driver error.
 */
 CK_RV PKCS11PSAGetObjectValue( CK_OBJECT_HANDLE xHandle,
     uint8_t * ppucData,
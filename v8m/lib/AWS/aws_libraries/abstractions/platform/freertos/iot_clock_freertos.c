@@ -57,14 +57,6 @@
 
 /*-----------------------------------------------------------*/
 
-/*
- * Time conversion constants.
- */
-#define _MILLISECONDS_PER_SECOND    ( 1000 )                                          /**< @brief Milliseconds per second. */
-#define _MILLISECONDS_PER_TICK      ( _MILLISECONDS_PER_SECOND / configTICK_RATE_HZ ) /**< Milliseconds per FreeRTOS tick. */
-
-/*-----------------------------------------------------------*/
-
 bool IotClock_GetTimestring(char *pBuffer,
                             size_t bufferSize,
                             size_t *pTimestringLength)
@@ -94,35 +86,30 @@ bool IotClock_GetTimestring(char *pBuffer,
 
 uint64_t IotClock_GetTimeMs( void )
 {
-    static uint32_t lastCount;
-    static uint64_t overflows = 0;
+    static uint32_t lastCount = 0;
+    static uint32_t overflows = 0;
+    uint32_t tickCount;
+    uint64_t ticks;
+    int32_t lock;
 
-    /* This is called by the scheduler but also by the logger so we need a mutex. */
-    /* We can do the creation here since this is guaranteed to be first called by the scheduler. */
-    static osMutexId_t mutex_id = 0;
-    if (!mutex_id)
-    {
-        mutex_id = osMutexNew(NULL);
-    }
+    /* Kept on the kernel tick, which the timers and delays of the libraries use.
+     * The kernel is locked so that the count and its overflows are updated
+     * together. Locking fails before the kernel starts, when no task runs. */
+    lock = osKernelLock();
 
-    osMutexAcquire(mutex_id, 0);
+    tickCount = osKernelGetTickCount();
 
-    uint32_t tickCount = osKernelGetTickCount();
-
-    if ( tickCount < lastCount )
+    if( tickCount < lastCount )
     {
         overflows++;
     }
 
     lastCount = tickCount;
+    ticks = ( ( uint64_t ) overflows << 32 ) | tickCount;
 
-    osMutexRelease(mutex_id);
-
-    uint64_t tickResult = tickCount;
-    tickResult = tickResult + overflows * UINT32_MAX;
+    ( void ) osKernelRestoreLock( lock );
 
-    /* Return the ticks converted to Milliseconds */
-    return ( tickResult * _MILLISECONDS_PER_TICK );
+    return ( ticks * 1000U ) / osKernelGetTickFreq();
 }
 /*-----------------------------------------------------------*/
 
@@ -60,7 +60,7 @@
 #include "iot_logging_setup.h"
 
 /* Provide a default value for the number of milliseconds for a socket poll.
- * This is a temporary workaround to deal with the lack of poll(). */
+ * This bounds the time taken by the receive task to notice a shutdown. */
 #ifndef IOT_NETWORK_SOCKET_POLL_MS
     #define IOT_NETWORK_SOCKET_POLL_MS    ( 1000 )
 #endif
@@ -91,8 +91,6 @@ typedef struct _networkConnection
     osThreadId_t receiveTask;                    /**< @brief Handle of the receive task, if any. */
     IotNetworkReceiveCallback_t receiveCallback; /**< @brief Network receive callback, if any. */
     void * pReceiveContext;                      /**< @brief The context for the receive callback. */
-    bool bufferedByteValid;                      /**< @brief Used to determine if the buffered byte is valid. */
-    uint8_t bufferedByte;                        /**< @brief A single byte buffered from a receive, since FreeRTOS Secure Sockets does not have poll(). */
 } _networkConnection_t;
 
 /*-----------------------------------------------------------*/
@@ -150,18 +148,12 @@ static void _networkReceiveTask( void * pArgument )
 
     while( true )
     {
-        /* No buffered byte should be in the connection. */
-        configASSERT( pNetworkConnection->bufferedByteValid == false );
-
-        /* Block and wait for 1 byte of data. This simulates the behavior of poll().
-         * THIS IS A TEMPORARY WORKAROUND AND DOES NOT PROVIDE THREAD-SAFETY AGAINST
-         * MULTIPLE CALLS OF RECEIVE. */
+        /* Block until data can be received, without consuming it, so that the
+         * receive callback reads whole records from the socket. */
         do
         {
-            socketStatus = SOCKETS_Recv( pNetworkConnection->socket,
-                                         &( pNetworkConnection->bufferedByte ),
-                                         1,
-                                         0 );
+            socketStatus = SOCKETS_Poll( pNetworkConnection->socket,
+                                         IOT_NETWORK_SOCKET_POLL_MS );
 
             connectionFlags = osEventFlagsGet( pNetworkConnection->connectionFlags );
 
@@ -169,17 +161,13 @@ static void _networkReceiveTask( void * pArgument )
             {
                 socketStatus = SOCKETS_ECLOSED;
             }
+        } while( socketStatus == 0 );
 
-            /* Check for timeout. Some ports return 0, some return EWOULDBLOCK. */
-        } while( ( socketStatus == 0 ) || ( socketStatus == SOCKETS_EWOULDBLOCK ) );
-
-        if( socketStatus <= 0 )
+        if( socketStatus < 0 )
         {
             break;
         }
 
-        pNetworkConnection->bufferedByteValid = true;
-
         /* The network receive task is created ONLY when the receive callback is set. Thus, assert
          * check that the callback is valid. */
         configASSERT( pNetworkConnection->receiveCallback != NULL );
@@ -559,16 +547,6 @@ size_t IotNetworkAfr_Receive( void * pConnection,
     /* Caller should never request zero bytes. */
     configASSERT( bytesRequested > 0 );
 
-    /* Write the buffered byte. THIS IS A TEMPORARY WORKAROUND AND ASSUMES THIS
-     * FUNCTION IS ALWAYS CALLED FROM THE RECEIVE CALLBACK. */
-    if( pNetworkConnection->bufferedByteValid == true )
-    {
-        *pBuffer = pNetworkConnection->bufferedByte;
-        bytesReceived = 1;
-        bytesRemaining--;
-        pNetworkConnection->bufferedByteValid = false;
-    }
-
     /* Block and wait for incoming data. */
     while( bytesRemaining > 0 )
     {
@@ -627,31 +605,19 @@ size_t IotNetworkAfr_ReceiveUpto( void * pConnection,
     /* Caller should never pass a zero-length buffer. */
     configASSERT( bufferSize > 0 );
 
-    /* Write the buffered byte. THIS IS A TEMPORARY WORKAROUND AND ASSUMES THIS
-     * FUNCTION IS ALWAYS CALLED FROM THE RECEIVE CALLBACK. */
-    if( pNetworkConnection->bufferedByteValid == true )
+    /* Block and wait for incoming data. */
+    socketStatus = SOCKETS_Recv( pNetworkConnection->socket,
+                                 pBuffer,
+                                 bufferSize,
+                                 0 );
+
+    if( socketStatus <= 0 )
     {
-        *pBuffer = pNetworkConnection->bufferedByte;
-        bytesReceived = 1;
-        pNetworkConnection->bufferedByteValid = false;
+        IotLogError( "Error %ld while receiving data.", ( long int ) socketStatus );
     }
-
-    if( bufferSize - bytesReceived > 0 )
+    else
     {
-        /* Block and wait for incoming data. */
-        socketStatus = SOCKETS_Recv( pNetworkConnection->socket,
-                                     pBuffer + bytesReceived,
-                                     bufferSize - bytesReceived,
-                                     0 );
-
-        if( socketStatus <= 0 )
-        {
-            IotLogError( "Error %ld while receiving data.", ( long int ) socketStatus );
-        }
-        else
-        {
-            bytesReceived += ( size_t ) socketStatus;
-        }
+        bytesReceived = ( size_t ) socketStatus;
     }
 
     IotLogDebug( "Received %lu bytes.",
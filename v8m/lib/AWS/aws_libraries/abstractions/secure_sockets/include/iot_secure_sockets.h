@@ -332,6 +332,38 @@ int32_t SOCKETS_Connect( Socket_t xSocket,
                          Socklen_t xAddressLength );
 /* @[declare_secure_sockets_connect] */
 
+/**
+ * @brief Maximum number of addresses SOCKETS_ConnectAny() races.
+ */
+#define SOCKETS_CONNECT_ANY_MAX_ADDRESSES    ( 3U )
+
+/**
+ * @brief Connects the socket to whichever of several addresses answers first.
+ *
+ * A TCP connection is started to each address at the same time. The first one
+ * established is kept and the others are abandoned, then TLS is negotiated on it
+ * as in SOCKETS_Connect(). This is meant for the addresses of a single server,
+ * for instance a cached address and a freshly resolved one.
+ *
+ * The same rules as SOCKETS_Connect() apply otherwise.
+ *
+ * @param[in] xSocket The handle of the socket to be connected.
+ * @param[in] pxAddresses The addresses to connect the socket to.
+ * @param[in] xAddressCount The number of addresses in pxAddresses, at most
+ * SOCKETS_CONNECT_ANY_MAX_ADDRESSES.
+ * @param[out] pxConnected Index in pxAddresses of the address connected to. May be NULL.
+ *
+ * @return
+ * * @ref SOCKETS_ERROR_NONE if a connection is established.
+ * * If an error occurred, a negative value is returned. @ref SocketsErrors
+ */
+/* @[declare_secure_sockets_connectany] */
+int32_t SOCKETS_ConnectAny( Socket_t xSocket,
+                            const SocketsSockaddr_t * pxAddresses,
+                            size_t xAddressCount,
+                            size_t * pxConnected );
+/* @[declare_secure_sockets_connectany] */
+
 /**
  * @brief Receive data from a TCP socket.
  *
@@ -362,6 +394,30 @@ int32_t SOCKETS_Recv( Socket_t xSocket,
                       uint32_t ulFlags );
 /* @[declare_secure_sockets_recv] */
 
+/**
+ * @brief Wait until data can be received from a TCP socket.
+ *
+ * The socket must have already been created using a call to SOCKETS_Socket()
+ * and connected to a remote socket using SOCKETS_Connect().
+ *
+ * Unlike a receive, no data is consumed, so the caller can wait for incoming
+ * data without holding on to a partial read. Data already decrypted by TLS
+ * counts as available.
+ *
+ * @param[in] xSocket The handle of the socket to wait on.
+ * @param[in] ulTimeoutMs The maximum time to wait, in milliseconds.
+ *
+ * @return
+ * * 1 if data can be received without blocking.
+ * * 0 if no data arrived before the timeout.
+ * * If the connection was closed or an error occurred, a negative value is
+ *   returned. @ref SocketsErrors
+ */
+/* @[declare_secure_sockets_poll] */
+int32_t SOCKETS_Poll( Socket_t xSocket,
+                      uint32_t ulTimeoutMs );
+/* @[declare_secure_sockets_poll] */
+
 /**
  * @brief Transmit data to the remote socket.
  *
@@ -388,6 +444,42 @@ int32_t SOCKETS_Send( Socket_t xSocket,
                       uint32_t ulFlags );
 /* @[declare_secure_sockets_send] */
 
+/**
+ * @brief A buffer of a vectored send.
+ */
+typedef struct SocketsOutVector
+{
+    const void * pvData; /**< @brief Start of the buffer. */
+    size_t xLength;      /**< @brief Length of the buffer in bytes. */
+} SocketsOutVector_t;
+
+/**
+ * @brief Transmit the concatenation of several buffers to the remote socket.
+ *
+ * The socket must have already been created using a call to SOCKETS_Socket() and
+ * connected to a remote socket using SOCKETS_Connect().
+ *
+ * Small buffers are gathered before being handed to TLS so that they share a
+ * record, instead of each costing a record of its own as with consecutive calls
+ * to SOCKETS_Send().
+ *
+ * @param[in] xSocket The handle of the sending socket.
+ * @param[in] pxVectors The buffers to send, in order.
+ * @param[in] xVectorCount The number of buffers in pxVectors.
+ * @param[in] ulFlags Not currently used. Should be set to 0.
+ *
+ * @return
+ * * On success, the number of bytes actually sent is returned. Bytes are
+ *   counted across buffers, in order.
+ * * If an error occurred, a negative value is returned. @ref SocketsErrors
+ */
+/* @[declare_secure_sockets_sendvector] */
+int32_t SOCKETS_SendVector( Socket_t xSocket,
+                            const SocketsOutVector_t * pxVectors,
+                            size_t xVectorCount,
+                            uint32_t ulFlags );
+/* @[declare_secure_sockets_sendvector] */
+
 /**
  * @brief Closes all or part of a full-duplex connection on the socket.
  *
@@ -487,6 +579,9 @@ int32_t SOCKETS_Close( Socket_t xSocket );
  *      the socket for reading
  *      - This option provides an asynchronous way to handle received data
  *      - pvOptionValue is a pointer to the callback function
+ *      - The lwIP port invokes the callback from a receive dispatcher task
+ *      shared by all sockets. The callback is invoked once when data
+ *      becomes available and is re-armed by the next SOCKETS_Recv() call.
  *      - See PORT_SPECIFIC_LINK for device limitations.
  *  - Security Sockets Options
  *    - @ref SOCKETS_SO_REQUIRE_TLS
@@ -560,6 +655,37 @@ int32_t SOCKETS_SetSockOpt( Socket_t xSocket,
 uint32_t SOCKETS_GetHostByName( const char * pcHostName );
 /* @[declare_secure_sockets_gethostbyname] */
 
+/**
+ * @brief Resolve a host name to its IPv4 addresses, without blocking on the network
+ * unless asked to.
+ *
+ * IP address literals and "localhost" are converted without a query. Addresses
+ * are cached for the TTL of the DNS answer, and names the DNS server reports as
+ * not existing for socketsconfigDNS_NEGATIVE_TTL_MS. A name which is not cached, or
+ * whose addresses have expired, is resolved by a background task. Cached addresses
+ * close to expiry are returned while they are refreshed in the background.
+ *
+ * @param[in] pcHostName The host name to resolve.
+ * @param[out] pulAddresses Array receiving the addresses, in network byte order.
+ * @param[in] xMaxAddresses Number of entries in @p pulAddresses.
+ * @param[in] ulTimeoutMs Time in milliseconds to wait for the name to be resolved,
+ * 0 to return immediately.
+ *
+ * @return
+ * * The number of addresses written to @p pulAddresses.
+ * * SOCKETS_EWOULDBLOCK if the name is being resolved and the timeout expired.
+ * * SOCKETS_SOCKET_ERROR if the name does not resolve, or if no DNS server
+ *   answered.
+ * * SOCKETS_EINVAL if a parameter is invalid.
+ * * SOCKETS_ENOMEM if the cache is full of names being resolved.
+ */
+/* @[declare_secure_sockets_gethostaddresses] */
+int32_t SOCKETS_GetHostAddresses( const char * pcHostName,
+                                  uint32_t * pulAddresses,
+                                  size_t xMaxAddresses,
+                                  uint32_t ulTimeoutMs );
+/* @[declare_secure_sockets_gethostaddresses] */
+
 
 
 /**
@@ -69,4 +69,52 @@
     #define AWS_IOT_SECURE_SOCKETS_METRICS_ENABLED    ( 0 )
 #endif
 
+/**
+ * @brief Number of host names kept in the DNS cache.
+ */
+#ifndef socketsconfigDNS_CACHE_ENTRIES
+    #define socketsconfigDNS_CACHE_ENTRIES    ( 4 )
+#endif
+
+/**
+ * @brief Bounds, in milliseconds, of the time the addresses of a name are cached.
+ *
+ * Within these bounds the TTL of the DNS answer is used.
+ */
+#ifndef socketsconfigDNS_MIN_TTL_MS
+    #define socketsconfigDNS_MIN_TTL_MS    ( 5000 )
+#endif
+
+#ifndef socketsconfigDNS_MAX_TTL_MS
+    #define socketsconfigDNS_MAX_TTL_MS    ( 3600000 )
+#endif
+
+/**
+ * @brief Time, in milliseconds, a name the DNS server reports as not existing, or
+ * as having no address, is cached for.
+ */
+#ifndef socketsconfigDNS_NEGATIVE_TTL_MS
+    #define socketsconfigDNS_NEGATIVE_TTL_MS    ( 10000 )
+#endif
+
+/**
+ * @brief Percentage of the TTL of a cached name after which using it triggers a
+ * refresh in the background.
+ */
+#ifndef socketsconfigDNS_REFRESH_PERCENT
+    #define socketsconfigDNS_REFRESH_PERCENT    ( 75 )
+#endif
+
+/**
+ * @brief Time, in milliseconds, to wait for the answer to a DNS query, and number of
+ * times the query is sent before the name is considered unresolvable.
+ */
+#ifndef socketsconfigDNS_QUERY_TIMEOUT_MS
+    #define socketsconfigDNS_QUERY_TIMEOUT_MS    ( 2000 )
+#endif
+
+#ifndef socketsconfigDNS_QUERY_ATTEMPTS
+    #define socketsconfigDNS_QUERY_ATTEMPTS    ( 3 )
+#endif
+
 #endif /* AWS_INC_SECURE_SOCKETS_CONFIG_DEFAULTS_H_ */
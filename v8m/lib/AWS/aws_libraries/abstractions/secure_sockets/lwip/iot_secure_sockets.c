@@ -40,9 +40,14 @@
 
 #include <string.h>
 #include <stdbool.h>
+#include <errno.h>
 
 #include "bootstrap/mbed_atomic.h"
 
+/* lwIP select() is used to wait on all sockets with a receive callback at once, and on
+ * the connections raced by SOCKETS_ConnectAny(). */
+#include "lwip/sockets.h"
+
 /*-----------------------------------------------------------*/
 
 #define SS_STATUS_CONNECTED               ( 1 )
@@ -50,8 +55,20 @@
 
 #define SECURE_SOCKETS_SELECT_WAIT_SEC    ( 10 )
 
-#define SOCKETS_START_DELETION            ( 0x01 )
-#define SOCKETS_COMPLETE_DELETION         ( 0x02 )
+/*
+ * Buffers of a vectored send smaller than this are gathered on the stack so that
+ * they go out in a single TLS record.
+ */
+#ifndef SECURE_SOCKETS_SEND_COALESCE_SIZE
+    #define SECURE_SOCKETS_SEND_COALESCE_SIZE    ( 256 )
+#endif
+
+/* Event flag set when the dispatcher returns from a receive callback. */
+#define SOCKETS_RX_DISPATCH_DONE          ( 0x01 )
+
+#define SOCKETS_RX_DISPATCH_UNINITIALISED    ( 0 )
+#define SOCKETS_RX_DISPATCH_READY            ( 1 )
+#define SOCKETS_RX_DISPATCH_FAILED           ( 2 )
 
 /*
  * secure socket context.
@@ -73,12 +90,12 @@ typedef struct _ss_ctx_t
     int send_flag;
     int recv_flag;
 
-    osThreadId_t rx_handle;
     void ( * rx_callback )( Socket_t pxSocket );
-    osEventFlagsId_t rx_EventFlags;
+    volatile bool rx_armed; /* The callback is invoked once, then re-armed by SOCKETS_Recv. */
 
     bool enforce_tls;
     void * tls_ctx;
+    volatile uint32_t tls_pending; /* Decrypted bytes left in TLS by the last read, see prvTlsRecordPending(). */
     char * destination;
 
     char * server_cert;
@@ -98,6 +115,24 @@ typedef struct _ss_ctx_t
 /*static int8_t sockets_allocated = SUPPORTED_DESCRIPTORS; */
 static int8_t sockets_allocated = socketsconfigDEFAULT_MAX_NUM_SECURE_SOCKETS;
 
+/*
+ * Receive dispatcher: a single task waits on every socket that has a receive callback
+ * and invokes the callbacks, instead of one polling task per socket.
+ *
+ * The dispatcher blocks in select() until a socket is readable. A task changing the
+ * sockets to watch sends a datagram to the loopback control socket, which select()
+ * also watches, to have the set rebuilt.
+ */
+static ss_ctx_t * rx_dispatch_sockets[ socketsconfigDEFAULT_MAX_NUM_SECURE_SOCKETS ];
+static osMutexId_t rx_dispatch_mutex;
+static osEventFlagsId_t rx_dispatch_flags;
+static osThreadId_t rx_dispatch_handle;
+static volatile uint8_t rx_dispatch_state = SOCKETS_RX_DISPATCH_UNINITIALISED;
+static int rx_dispatch_control = -1;
+static struct sockaddr_in rx_dispatch_control_addr;
+static core_util_atomic_flag rx_dispatch_wake_pending = CORE_UTIL_ATOMIC_FLAG_INIT;
+static ss_ctx_t * volatile rx_dispatch_current; /* Socket whose callback is running. */
+
 
 /*-----------------------------------------------------------*/
 
@@ -231,100 +266,400 @@ static BaseType_t prvNetworkRecv( void * pvContext,
 
 /*-----------------------------------------------------------*/
 
-static void vTaskRxSelect( void * param )
+/*
+ * @brief Whether TLS holds decrypted data, which select() cannot see on the socket.
+ *
+ * Uses the count recorded by the socket owner, as the TLS context must not be
+ * read while the owner may be inside TLS_Recv().
+ */
+static bool prvTlsPending( ss_ctx_t * ctx )
+{
+    return ctx->enforce_tls && ( core_util_atomic_load_u32( &ctx->tls_pending ) > 0U );
+}
+
+/*-----------------------------------------------------------*/
+
+/*
+ * @brief Record the decrypted data left in TLS, from the thread that reads the socket.
+ *
+ * The count is atomic so that the receive path does not take the dispatcher's mutex.
+ */
+static void prvTlsRecordPending( ss_ctx_t * ctx )
+{
+    uint32_t pending = 0U;
+
+    if( ctx->enforce_tls && ( ctx->tls_ctx != NULL ) )
+    {
+        pending = ( uint32_t ) TLS_GetBytesAvailable( ctx->tls_ctx );
+    }
+
+    core_util_atomic_store_u32( &ctx->tls_pending, pending );
+}
+
+/*-----------------------------------------------------------*/
+
+/*
+ * @brief Have the dispatcher rebuild the set of sockets it waits on.
+ *
+ * A datagram already in flight is enough, the dispatcher reads the set after
+ * draining the control socket.
+ */
+static void prvRxDispatchWake( void )
+{
+    const uint8_t wake = 0;
+
+    if( core_util_atomic_flag_test_and_set( &rx_dispatch_wake_pending ) == false )
+    {
+        ( void ) lwip_sendto( rx_dispatch_control, &wake, sizeof( wake ), 0,
+                              ( const struct sockaddr * ) &rx_dispatch_control_addr,
+                              sizeof( rx_dispatch_control_addr ) );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static void vTaskRxDispatch( void * param )
 {
-    ss_ctx_t * ctx = ( ss_ctx_t * ) param;
-    int s = ctx->ip_socket;
-    ctx->state = SST_RX_READY;
+    fd_set read_set;
+    struct timeval timeout;
+    ss_ctx_t * ctx;
+    void ( * callback )( Socket_t pxSocket );
+    uint8_t wake;
+    bool tls_pending;
+    int max_fd;
+    int ret;
+    size_t i;
+
+    ( void ) param;
 
     while( 1 )
     {
-        if( ctx->state == SST_RX_CLOSING )
+        /* Wakes requested from here on are seen by the next select(). */
+        core_util_atomic_flag_clear( &rx_dispatch_wake_pending );
+
+        while( lwip_recv( rx_dispatch_control, &wake, sizeof( wake ), MSG_DONTWAIT ) > 0 )
         {
-            ctx->state = SST_RX_CLOSED;
-            break;
         }
 
-        uint32_t ret;
-        for ( ; ; )
+        FD_ZERO( &read_set );
+        FD_SET( rx_dispatch_control, &read_set );
+        max_fd = rx_dispatch_control;
+        tls_pending = false;
+
+        osMutexAcquire( rx_dispatch_mutex, osWaitForever );
+
+        for( i = 0; i < socketsconfigDEFAULT_MAX_NUM_SECURE_SOCKETS; i++ )
         {
-            ret = iotSocketRecv( s, NULL, 0 );
-            if ( ret != IOT_SOCKET_EAGAIN )
+            ctx = rx_dispatch_sockets[ i ];
+
+            if( ( ctx != NULL ) && ( ctx->rx_armed == true ) && ( ctx->state != SST_RX_CLOSING ) )
             {
-                break;
+                FD_SET( ctx->ip_socket, &read_set );
+
+                if( ctx->ip_socket > max_fd )
+                {
+                    max_fd = ctx->ip_socket;
+                }
+
+                tls_pending = tls_pending || prvTlsPending( ctx );
             }
         }
 
-        if (ret == 0)
+        osMutexRelease( rx_dispatch_mutex );
+
+        /* Data left in TLS is dispatched without waiting on the network. */
+        timeout.tv_sec = 0;
+        timeout.tv_usec = 0;
+
+        ret = lwip_select( max_fd + 1, &read_set, NULL, NULL, tls_pending ? &timeout : NULL );
+
+        if( ( ret < 0 ) || ( ( ret == 0 ) && ( tls_pending == false ) ) )
         {
-            ctx->rx_callback( ( Socket_t ) ctx );
+            /* A watched socket was closed meanwhile: rebuild the set. */
+            continue;
         }
-        else
+
+        if( ret == 0 )
         {
-            break;
+            FD_ZERO( &read_set );
         }
 
-        if( osEventFlagsWait( ctx->rx_EventFlags, SOCKETS_START_DELETION, osFlagsWaitAll, 0 ) == SOCKETS_START_DELETION )
+        /* Callbacks run without the mutex, holding a reference to the socket.
+         * prvRxSelectClear() waits for the callback of its socket to return. */
+        for( i = 0; i < socketsconfigDEFAULT_MAX_NUM_SECURE_SOCKETS; i++ )
         {
-            /* Inform the main task that the event has been received. */
-            ( void ) osEventFlagsSet( ctx->rx_EventFlags, SOCKETS_COMPLETE_DELETION );
-            break;
+            callback = NULL;
+
+            osMutexAcquire( rx_dispatch_mutex, osWaitForever );
+
+            ctx = rx_dispatch_sockets[ i ];
+
+            if( ( ctx != NULL ) && ( ctx->rx_armed == true ) &&
+                ( FD_ISSET( ctx->ip_socket, &read_set ) || prvTlsPending( ctx ) ) )
+            {
+                ctx->rx_armed = false;
+                callback = ctx->rx_callback;
+                rx_dispatch_current = ctx;
+                prvIncrementRefCount( ctx );
+            }
+
+            osMutexRelease( rx_dispatch_mutex );
+
+            if( callback != NULL )
+            {
+                callback( ( Socket_t ) ctx );
+
+                osMutexAcquire( rx_dispatch_mutex, osWaitForever );
+                rx_dispatch_current = NULL;
+                osMutexRelease( rx_dispatch_mutex );
+
+                ( void ) osEventFlagsSet( rx_dispatch_flags, SOCKETS_RX_DISPATCH_DONE );
+                prvDecrementRefCount( ctx );
+            }
         }
     }
+}
+
+/*-----------------------------------------------------------*/
+
+/*
+ * @brief Create the loopback socket used to wake the dispatcher.
+ */
+static bool prvRxDispatchControlInit( void )
+{
+    socklen_t len = sizeof( rx_dispatch_control_addr );
+
+    rx_dispatch_control = lwip_socket( AF_INET, SOCK_DGRAM, IPPROTO_UDP );
+
+    if( rx_dispatch_control < 0 )
+    {
+        return false;
+    }
 
-    prvDecrementRefCount( ctx );
+    memset( &rx_dispatch_control_addr, 0, sizeof( rx_dispatch_control_addr ) );
+    rx_dispatch_control_addr.sin_family = AF_INET;
+    rx_dispatch_control_addr.sin_addr.s_addr = PP_HTONL( INADDR_LOOPBACK );
+
+    if( ( lwip_bind( rx_dispatch_control, ( const struct sockaddr * ) &rx_dispatch_control_addr,
+                     sizeof( rx_dispatch_control_addr ) ) != 0 ) ||
+        ( lwip_getsockname( rx_dispatch_control, ( struct sockaddr * ) &rx_dispatch_control_addr, &len ) != 0 ) )
+    {
+        lwip_close( rx_dispatch_control );
+        rx_dispatch_control = -1;
+        return false;
+    }
+
+    return true;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool prvRxDispatchInit( void )
+{
+    const osMutexAttr_t mutex_attr = {
+        .attr_bits = osMutexRecursive | osMutexPrioInherit
+    };
+    int32_t lock;
+
+    /* Only the mutex is created with the scheduler locked, the first task to
+     * take it creates the dispatcher while the others wait for it. */
+    if( rx_dispatch_mutex == NULL )
+    {
+        lock = osKernelLock();
 
-    osThreadExit();
+        if( rx_dispatch_mutex == NULL )
+        {
+            rx_dispatch_mutex = osMutexNew( &mutex_attr );
+        }
+
+        ( void ) osKernelRestoreLock( lock );
+    }
+
+    if( rx_dispatch_mutex == NULL )
+    {
+        return false;
+    }
+
+    if( rx_dispatch_state == SOCKETS_RX_DISPATCH_UNINITIALISED )
+    {
+        osMutexAcquire( rx_dispatch_mutex, osWaitForever );
+
+        if( rx_dispatch_state == SOCKETS_RX_DISPATCH_UNINITIALISED )
+        {
+            osThreadAttr_t attr = {
+                .name       = "SocketsRx",
+                .stack_size = socketsconfigRECEIVE_CALLBACK_TASK_STACK_DEPTH,
+                .priority   = osPriorityNormal
+            };
+
+            rx_dispatch_flags = osEventFlagsNew( NULL );
+
+            if( ( rx_dispatch_flags != NULL ) && prvRxDispatchControlInit() )
+            {
+                rx_dispatch_handle = osThreadNew( vTaskRxDispatch, NULL, &attr );
+            }
+
+            rx_dispatch_state = ( rx_dispatch_handle != NULL ) ?
+                                SOCKETS_RX_DISPATCH_READY : SOCKETS_RX_DISPATCH_FAILED;
+        }
+
+        osMutexRelease( rx_dispatch_mutex );
+    }
+
+    return rx_dispatch_state == SOCKETS_RX_DISPATCH_READY;
 }
 
+/*-----------------------------------------------------------*/
+
+/*
+ * @brief Re-arm the receive callback once the application reads from the socket.
+ */
+static void prvRxDispatchArm( ss_ctx_t * ctx )
+{
+    if( ( ctx->rx_callback != NULL ) && ( ctx->rx_armed == false ) )
+    {
+        ctx->rx_armed = true;
+        prvRxDispatchWake();
+    }
+}
 
 /*-----------------------------------------------------------*/
 
 static void prvRxSelectSet( ss_ctx_t * ctx,
                             const void * pvOptionValue )
 {
-    BaseType_t xReturned;
+    size_t i;
 
-    ctx->rx_callback = ( void ( * )( Socket_t ) )pvOptionValue;
+    if( prvRxDispatchInit() == false )
+    {
+        configASSERT( false );
+        return;
+    }
 
-    prvIncrementRefCount( ctx );
+    osMutexAcquire( rx_dispatch_mutex, osWaitForever );
 
-    ctx->rx_EventFlags = osEventFlagsNew( NULL );
+    if( ctx->rx_callback == NULL )
+    {
+        for( i = 0; i < socketsconfigDEFAULT_MAX_NUM_SECURE_SOCKETS; i++ )
+        {
+            if( rx_dispatch_sockets[ i ] == NULL )
+            {
+                /* The dispatcher holds a reference while the socket is registered. */
+                prvIncrementRefCount( ctx );
+                rx_dispatch_sockets[ i ] = ctx;
+                break;
+            }
+        }
 
-    configASSERT( ctx->rx_EventFlags != NULL );
+        configASSERT( i < socketsconfigDEFAULT_MAX_NUM_SECURE_SOCKETS );
+    }
 
-    osThreadAttr_t attr = {
-      .stack_size = socketsconfigRECEIVE_CALLBACK_TASK_STACK_DEPTH,
-      .priority = osPriorityNormal
-    };
+    ctx->rx_callback = ( void ( * )( Socket_t ) )pvOptionValue;
+    ctx->rx_armed = true;
 
-    ctx->rx_handle = osThreadNew( vTaskRxSelect, ctx, &attr);
+    osMutexRelease( rx_dispatch_mutex );
 
-    configASSERT( ctx->rx_handle != NULL );
+    prvRxDispatchWake();
 }
 
 /*-----------------------------------------------------------*/
 
 static void prvRxSelectClear( ss_ctx_t * ctx )
 {
-    /* Inform the vTaskRxSelect to delete itself. */
-    osEventFlagsSet( ctx->rx_EventFlags, SOCKETS_START_DELETION );
+    bool registered = false;
+    size_t i;
 
-    /* Wait for the task to delete itself. */
-    while( osEventFlagsWait( ctx->rx_EventFlags, SOCKETS_COMPLETE_DELETION, osFlagsWaitAll, osWaitForever )
-           != SOCKETS_COMPLETE_DELETION )
+    if( rx_dispatch_state != SOCKETS_RX_DISPATCH_READY )
     {
-        /* Continue waiting for the task to delete itself. */
+        return;
     }
 
-    /* Reset the handle of the task to NULL. */
-    ctx->rx_handle = NULL;
+    osMutexAcquire( rx_dispatch_mutex, osWaitForever );
 
-    /* Delete the event group. */
-    osEventFlagsDelete( ctx->rx_EventFlags );
+    for( i = 0; i < socketsconfigDEFAULT_MAX_NUM_SECURE_SOCKETS; i++ )
+    {
+        if( rx_dispatch_sockets[ i ] == ctx )
+        {
+            rx_dispatch_sockets[ i ] = NULL;
+            registered = true;
+        }
+    }
 
     /* Remove the reference to the callback. */
     ctx->rx_callback = NULL;
+    ctx->rx_armed = false;
+
+    /* Wait for a callback in progress, unless called from that callback. The
+     * dispatcher clears rx_dispatch_current with the mutex held before it sets
+     * the flag, so the flag cleared here is set after the callback returns. */
+    while( ( rx_dispatch_current == ctx ) && ( osThreadGetId() != rx_dispatch_handle ) )
+    {
+        ( void ) osEventFlagsClear( rx_dispatch_flags, SOCKETS_RX_DISPATCH_DONE );
+        osMutexRelease( rx_dispatch_mutex );
+        ( void ) osEventFlagsWait( rx_dispatch_flags, SOCKETS_RX_DISPATCH_DONE,
+                                   osFlagsWaitAny | osFlagsNoClear, osWaitForever );
+        osMutexAcquire( rx_dispatch_mutex, osWaitForever );
+    }
+
+    osMutexRelease( rx_dispatch_mutex );
+
+    if( registered )
+    {
+        /* The descriptor is about to be released, stop selecting on it. */
+        prvRxDispatchWake();
+        prvDecrementRefCount( ctx );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+/*
+ * @brief Negotiate TLS on a connected socket, if required.
+ */
+static int32_t prvSocketsSecure( ss_ctx_t * ctx )
+{
+    TLSParams_t tls_params = { 0 };
+    BaseType_t status;
+
+    if( !ctx->enforce_tls )
+    {
+        return SOCKETS_ERROR_NONE;
+    }
+
+    tls_params.ulSize = sizeof( tls_params );
+    tls_params.pcDestination = ctx->destination;
+    tls_params.pcServerCertificate = ctx->server_cert;
+    tls_params.ulServerCertificateLength = ctx->server_cert_len;
+    tls_params.pvCallerContext = ctx;
+    tls_params.pxNetworkRecv = prvNetworkRecv;
+    tls_params.pxNetworkSend = prvNetworkSend;
+    tls_params.ppcAlpnProtocols = ( const char ** ) ctx->ppcAlpnProtocols;
+    tls_params.ulAlpnProtocolsCount = ctx->ulAlpnProtocolsCount;
+
+    status = TLS_Init( &ctx->tls_ctx, &tls_params );
+
+    if( osOK != status )
+    {
+        configPRINTF( ( "TLS_Init fail\n" ) );
+        return SOCKETS_SOCKET_ERROR;
+    }
+
+    status = TLS_Connect( ctx->tls_ctx );
+
+    if( osOK == status )
+    {
+        ctx->status |= SS_STATUS_SECURED;
+
+        /* Application data may have arrived with the end of the handshake. */
+        prvTlsRecordPending( ctx );
+        return SOCKETS_ERROR_NONE;
+    }
+
+    configPRINTF( ( "TLS_Connect fail (0x%x, %s)\n",
+                    ( unsigned int ) -status,
+                    ctx->destination ? ctx->destination : "NULL" ) );
+
+    return SOCKETS_SOCKET_ERROR;
 }
 
 /*-----------------------------------------------------------*/
@@ -453,54 +788,192 @@ int32_t SOCKETS_Connect( Socket_t xSocket,
 
     if( 0 == ret )
     {
-        TLSParams_t tls_params = { 0 };
-        BaseType_t status;
-
         ctx->status |= SS_STATUS_CONNECTED;
 
-        if( !ctx->enforce_tls )
+        return prvSocketsSecure( ctx );
+    }
+    else
+    {
+        configPRINTF( ( "iotSocketConnect fail %d\n", ret ) );
+    }
+
+    return SOCKETS_SOCKET_ERROR;
+}
+
+/*-----------------------------------------------------------*/
+
+int32_t SOCKETS_ConnectAny( Socket_t xSocket,
+                            const SocketsSockaddr_t * pxAddresses,
+                            size_t xAddressCount,
+                            size_t * pxConnected )
+{
+    ss_ctx_t * ctx;
+    int fds[ SOCKETS_CONNECT_ANY_MAX_ADDRESSES ];
+    size_t pending = 0;
+    int winner = -1;
+    uint32_t start;
+    uint32_t elapsed;
+    uint32_t remaining;
+    struct sockaddr_in addr;
+    fd_set write_set;
+    struct timeval timeout;
+    int error;
+    socklen_t error_len;
+    int max_fd;
+    int ret;
+    size_t i;
+
+    if( ( SOCKETS_INVALID_SOCKET == xSocket ) || ( pxAddresses == NULL ) ||
+        ( xAddressCount == 0 ) || ( xAddressCount > SOCKETS_CONNECT_ANY_MAX_ADDRESSES ) )
+    {
+        return SOCKETS_EINVAL;
+    }
+
+    ctx = ( ss_ctx_t * ) xSocket;
+    configASSERT( ctx->ip_socket >= 0 );
+
+    /* The socket of the context dials the first address, other addresses get a socket of their own. */
+    for( i = 0; i < xAddressCount; i++ )
+    {
+        fds[ i ] = ( i == 0 ) ? ctx->ip_socket : lwip_socket( AF_INET, SOCK_STREAM, IPPROTO_TCP );
+
+        if( fds[ i ] < 0 )
         {
-            return SOCKETS_ERROR_NONE;
+            continue;
         }
 
-        tls_params.ulSize = sizeof( tls_params );
-        tls_params.pcDestination = ctx->destination;
-        tls_params.pcServerCertificate = ctx->server_cert;
-        tls_params.ulServerCertificateLength = ctx->server_cert_len;
-        tls_params.pvCallerContext = ctx;
-        tls_params.pxNetworkRecv = prvNetworkRecv;
-        tls_params.pxNetworkSend = prvNetworkSend;
-        tls_params.ppcAlpnProtocols = ( const char ** ) ctx->ppcAlpnProtocols;
-        tls_params.ulAlpnProtocolsCount = ctx->ulAlpnProtocolsCount;
+        memset( &addr, 0, sizeof( addr ) );
+        addr.sin_family = AF_INET;
+        addr.sin_port = pxAddresses[ i ].usPort;
+        addr.sin_addr.s_addr = pxAddresses[ i ].ulAddress;
+
+        ( void ) lwip_fcntl( fds[ i ], F_SETFL, O_NONBLOCK );
 
-        status = TLS_Init( &ctx->tls_ctx, &tls_params );
+        ret = lwip_connect( fds[ i ], ( struct sockaddr * ) &addr, sizeof( addr ) );
 
-        if( osOK != status )
+        if( ret == 0 )
         {
-            configPRINTF( ( "TLS_Init fail\n" ) );
-            return SOCKETS_SOCKET_ERROR;
+            winner = ( int ) i;
+            i++;
+            break;
+        }
+        else if( errno == EINPROGRESS )
+        {
+            pending++;
+        }
+        else
+        {
+            configPRINTF( ( "lwip_connect fail %d\n", errno ) );
+
+            if( i != 0 )
+            {
+                lwip_close( fds[ i ] );
+            }
+
+            fds[ i ] = -1;
         }
+    }
+
+    /* Sockets not created because a connection was established straight away. */
+    for( ; i < xAddressCount; i++ )
+    {
+        fds[ i ] = -1;
+    }
+
+    start = osKernelGetTickCount();
 
-        status = TLS_Connect( ctx->tls_ctx );
+    while( ( winner < 0 ) && ( pending > 0 ) )
+    {
+        elapsed = osKernelGetTickCount() - start;
 
-        if( osOK == status )
+        if( elapsed >= pdMS_TO_TICKS( SECURE_SOCKETS_SELECT_WAIT_SEC * 1000 ) )
         {
-            ctx->status |= SS_STATUS_SECURED;
-            return SOCKETS_ERROR_NONE;
+            configPRINTF( ( "Connect timeout\n" ) );
+            break;
         }
-        else
+
+        FD_ZERO( &write_set );
+        max_fd = -1;
+
+        for( i = 0; i < xAddressCount; i++ )
+        {
+            if( fds[ i ] >= 0 )
+            {
+                FD_SET( fds[ i ], &write_set );
+                max_fd = ( fds[ i ] > max_fd ) ? fds[ i ] : max_fd;
+            }
+        }
+
+        remaining = pdMS_TO_TICKS( SECURE_SOCKETS_SELECT_WAIT_SEC * 1000 ) - elapsed;
+        timeout.tv_sec = TICK_TO_S( remaining );
+        timeout.tv_usec = TICK_TO_US( remaining % configTICK_RATE_HZ );
+
+        ret = lwip_select( max_fd + 1, NULL, &write_set, NULL, &timeout );
+
+        if( ret < 0 )
+        {
+            break;
+        }
+
+        /* A socket becomes writable once its connection is established or has failed. */
+        for( i = 0; ( i < xAddressCount ) && ( winner < 0 ); i++ )
+        {
+            if( ( fds[ i ] < 0 ) || !FD_ISSET( fds[ i ], &write_set ) )
+            {
+                continue;
+            }
+
+            error = 0;
+            error_len = sizeof( error );
+            ( void ) lwip_getsockopt( fds[ i ], SOL_SOCKET, SO_ERROR, &error, &error_len );
+
+            if( error == 0 )
+            {
+                winner = ( int ) i;
+            }
+            else
+            {
+                if( i != 0 )
+                {
+                    lwip_close( fds[ i ] );
+                }
+
+                fds[ i ] = -1;
+                pending--;
+            }
+        }
+    }
+
+    /* Abandon the other attempts. */
+    for( i = 0; i < xAddressCount; i++ )
+    {
+        if( ( ( int ) i != winner ) && ( i != 0 ) && ( fds[ i ] >= 0 ) )
         {
-            configPRINTF( ( "TLS_Connect fail (0x%x, %s)\n",
-                            ( unsigned int ) -status,
-                            ctx->destination ? ctx->destination : "NULL" ) );
+            lwip_close( fds[ i ] );
         }
     }
-    else
+
+    if( winner < 0 )
     {
-        configPRINTF( ( "iotSocketConnect fail %d\n", ret ) );
+        return SOCKETS_SOCKET_ERROR;
     }
 
-    return SOCKETS_SOCKET_ERROR;
+    if( winner != 0 )
+    {
+        iotSocketClose( ctx->ip_socket );
+        ctx->ip_socket = fds[ winner ];
+    }
+
+    ( void ) lwip_fcntl( ctx->ip_socket, F_SETFL, 0 );
+
+    ctx->status |= SS_STATUS_CONNECTED;
+
+    if( pxConnected != NULL )
+    {
+        *pxConnected = ( size_t ) winner;
+    }
+
+    return prvSocketsSecure( ctx );
 }
 
 /*-----------------------------------------------------------*/
@@ -511,6 +984,7 @@ int32_t SOCKETS_Recv( Socket_t xSocket,
                       uint32_t ulFlags )
 {
     ss_ctx_t * ctx = ( ss_ctx_t * ) xSocket;
+    int32_t ret;
 
     if( SOCKETS_INVALID_SOCKET == xSocket )
     {
@@ -534,12 +1008,84 @@ int32_t SOCKETS_Recv( Socket_t xSocket,
     if( ctx->enforce_tls )
     {
         /* Receive through TLS pipe, if negotiated. */
-        return TLS_Recv( ctx->tls_ctx, pvBuffer, xBufferLength );
+        ret = TLS_Recv( ctx->tls_ctx, pvBuffer, xBufferLength );
     }
     else
     {
-        return prvNetworkRecv( ( void * ) ctx, pvBuffer, xBufferLength );
+        ret = prvNetworkRecv( ( void * ) ctx, pvBuffer, xBufferLength );
+    }
+
+    /* The application is draining the socket, watch it again. This is done once the
+     * read is over and the data left in TLS is recorded for the dispatcher. */
+    prvTlsRecordPending( ctx );
+    prvRxDispatchArm( ctx );
+
+    return ret;
+}
+
+/*-----------------------------------------------------------*/
+
+int32_t SOCKETS_Poll( Socket_t xSocket,
+                      uint32_t ulTimeoutMs )
+{
+    ss_ctx_t * ctx = ( ss_ctx_t * ) xSocket;
+    fd_set read_set;
+    struct timeval timeout;
+    uint8_t peek;
+    int error = 0;
+    socklen_t error_len = sizeof( error );
+    int ret;
+
+    if( SOCKETS_INVALID_SOCKET == xSocket )
+    {
+        return SOCKETS_SOCKET_ERROR;
+    }
+
+    if( ( ctx->status & SS_STATUS_CONNECTED ) != SS_STATUS_CONNECTED )
+    {
+        return SOCKETS_ENOTCONN;
+    }
+
+    configASSERT( ctx->ip_socket >= 0 );
+
+    if( prvTlsPending( ctx ) )
+    {
+        return 1;
+    }
+
+    FD_ZERO( &read_set );
+    FD_SET( ctx->ip_socket, &read_set );
+
+    timeout.tv_sec = ulTimeoutMs / 1000;
+    timeout.tv_usec = ( ulTimeoutMs % 1000 ) * 1000;
+
+    ret = lwip_select( ctx->ip_socket + 1, &read_set, NULL, NULL, &timeout );
+
+    if( ret == 0 )
+    {
+        return 0;
+    }
+    else if( ret < 0 )
+    {
+        return SOCKETS_SOCKET_ERROR;
+    }
+
+    /* A socket is also readable once the peer closed it or on error, which must not be
+     * reported as data or the caller would keep waking up. */
+    ret = lwip_recv( ctx->ip_socket, &peek, 1, MSG_PEEK | MSG_DONTWAIT );
+
+    if( ret > 0 )
+    {
+        return 1;
+    }
+    else if( ret == 0 )
+    {
+        return SOCKETS_ECLOSED;
     }
+
+    ( void ) lwip_getsockopt( ctx->ip_socket, SOL_SOCKET, SO_ERROR, &error, &error_len );
+
+    return ( error == 0 ) ? 0 : SOCKETS_ECLOSED;
 }
 
 /*-----------------------------------------------------------*/
@@ -584,6 +1130,131 @@ int32_t SOCKETS_Send( Socket_t xSocket,
 
 /*-----------------------------------------------------------*/
 
+int32_t SOCKETS_SendVector( Socket_t xSocket,
+                            const SocketsOutVector_t * pxVectors,
+                            size_t xVectorCount,
+                            uint32_t ulFlags )
+{
+    ss_ctx_t * ctx;
+    BaseType_t ( * send )( void *, const unsigned char *, size_t );
+    void * send_ctx;
+    uint8_t staging[ SECURE_SOCKETS_SEND_COALESCE_SIZE ];
+    size_t staged = 0;
+    size_t sent = 0;
+    size_t offset = 0;
+    size_t remaining;
+    size_t fill;
+    const uint8_t * data;
+    BaseType_t ret;
+    size_t i = 0;
+
+    if( SOCKETS_INVALID_SOCKET == xSocket )
+    {
+        return SOCKETS_SOCKET_ERROR;
+    }
+
+    if( ( NULL == pxVectors ) || ( 0 == xVectorCount ) )
+    {
+        return SOCKETS_EINVAL;
+    }
+
+    ctx = ( ss_ctx_t * ) xSocket;
+
+    if( ( ctx->status & SS_STATUS_CONNECTED ) != SS_STATUS_CONNECTED )
+    {
+        return SOCKETS_ENOTCONN;
+    }
+
+    configASSERT( ctx->ip_socket >= 0 );
+    ctx->send_flag = ulFlags;
+
+    if( ctx->enforce_tls )
+    {
+        send = TLS_Send;
+        send_ctx = ctx->tls_ctx;
+    }
+    else
+    {
+        send = prvNetworkSend;
+        send_ctx = ( void * ) ctx;
+    }
+
+    while( i < xVectorCount )
+    {
+        data = ( const uint8_t * ) pxVectors[ i ].pvData + offset;
+        remaining = pxVectors[ i ].xLength - offset;
+
+        if( remaining == 0 )
+        {
+            i++;
+            offset = 0;
+        }
+        else if( staged + remaining <= sizeof( staging ) )
+        {
+            memcpy( &staging[ staged ], data, remaining );
+            staged += remaining;
+            i++;
+            offset = 0;
+        }
+        else if( staged > 0 )
+        {
+            /* Complete the staged record with the start of this buffer. */
+            fill = sizeof( staging ) - staged;
+            memcpy( &staging[ staged ], data, fill );
+            offset += fill;
+
+            ret = send( send_ctx, staging, sizeof( staging ) );
+
+            if( ret < 0 )
+            {
+                return ( sent > 0 ) ? ( int32_t ) sent : ( int32_t ) ret;
+            }
+
+            sent += ( size_t ) ret;
+            staged = 0;
+
+            if( ( size_t ) ret < sizeof( staging ) )
+            {
+                return ( int32_t ) sent;
+            }
+        }
+        else
+        {
+            /* Large buffers are sent in place. */
+            ret = send( send_ctx, data, remaining );
+
+            if( ret < 0 )
+            {
+                return ( sent > 0 ) ? ( int32_t ) sent : ( int32_t ) ret;
+            }
+
+            sent += ( size_t ) ret;
+            offset += ( size_t ) ret;
+
+            if( ( size_t ) ret < remaining )
+            {
+                return ( int32_t ) sent;
+            }
+        }
+    }
+
+    if( staged > 0 )
+    {
+        ret = send( send_ctx, staging, staged );
+
+        if( ret < 0 )
+        {
+            return ( sent > 0 ) ? ( int32_t ) sent : ( int32_t ) ret;
+        }
+
+        sent += ( size_t ) ret;
+    }
+
+    return ( int32_t ) sent;
+}
+
+/*-----------------------------------------------------------*/
+
 int32_t SOCKETS_Shutdown( Socket_t xSocket,
                           uint32_t ulHow )
 {
@@ -625,6 +1296,9 @@ int32_t SOCKETS_Close( Socket_t xSocket )
     ctx = ( ss_ctx_t * ) xSocket;
     ctx->state = SST_RX_CLOSING;
 
+    /* Stop watching the socket before its descriptor is released. */
+    prvRxSelectClear( ctx );
+
     iotSocketClose( ctx->ip_socket );
     prvDecrementRefCount( ctx );
 
@@ -851,31 +1525,7 @@ int32_t SOCKETS_SetSockOpt( Socket_t xSocket,
 
 /*-----------------------------------------------------------*/
 
-uint32_t SOCKETS_GetHostByName( const char * pcHostName )
-{
-    uint32_t ret;
-    uint32_t addr;
-    /* we only want IPV4 address */
-    uint32_t ip_len = sizeof( uint32_t );
-
-    if( strlen( pcHostName ) > ( size_t ) securesocketsMAX_DNS_NAME_LENGTH ) {
-         configPRINTF( ( "Host name (%s) too long!", pcHostName ) );
-    }
-
-    ret = iotSocketGetHostByName( pcHostName, IOT_SOCKET_AF_INET, ( uint8_t * ) &addr, &ip_len );
-
-    if ( ret != 0 ) {
-        configPRINTF( ( "Error (%lu) from iotSocketGetHostByName() while resolving (%s)!", ret, pcHostName ) );
-        return 0;
-    }
-
-    if( addr == 0 )
-    {
-        configPRINTF( ( "Unable to resolve (%s)", pcHostName ) );
-    }
-
-    return addr;
-}
+/* SOCKETS_GetHostByName() is implemented with the DNS cache in iot_secure_sockets_dns.c. */
 
 /*-----------------------------------------------------------*/
 
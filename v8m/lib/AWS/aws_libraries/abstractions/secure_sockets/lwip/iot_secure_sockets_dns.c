@@ -0,0 +1,969 @@
+/*
+ * Copyright (c) 2023 Arm Limited. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+/**
+ * @file iot_secure_sockets_dns.c
+ * @brief Host name resolution of the Secure Sockets lwIP port, with a cache.
+ *
+ * IP address literals and "localhost" are returned without a query. Other names
+ * are resolved by a resolver task sending A queries over UDP to the DNS servers
+ * configured in lwIP, so that the TTL of the answers is known. Answers are cached
+ * for their TTL, bounded by socketsconfigDNS_MIN_TTL_MS and
+ * socketsconfigDNS_MAX_TTL_MS, and names the servers report as not existing, or
+ * as having no address, are cached for socketsconfigDNS_NEGATIVE_TTL_MS. Queries
+ * left unanswered are not cached, the next lookup sends a new one. A name used
+ * once socketsconfigDNS_REFRESH_PERCENT of its TTL has elapsed is resolved again
+ * in the background while the cached addresses are still returned.
+ *
+ * Each lookup uses a socket bound to a random port and each query a random ID.
+ * An answer is accepted only from the server queried and only if it echoes the
+ * question sent, and only the A records of the name queried, or of the names
+ * its CNAME records lead to, are used.
+ */
+
+#include "cmsis_os2.h"
+#include "aws_secure_sockets_config.h"
+#include "iot_secure_sockets.h"
+#include "iot_config.h"
+
+#include <string.h>
+#include <ctype.h>
+#include <stdbool.h>
+
+#include "lwip/sockets.h"
+#include "lwip/dns.h"
+#include "lwip/tcpip.h"
+
+#include "psa/crypto.h"
+
+/*-----------------------------------------------------------*/
+
+#define DNS_PORT                    ( 53 )
+#define DNS_HEADER_SIZE             ( 12 )
+#define DNS_MESSAGE_SIZE            ( 512 )
+#define DNS_TYPE_A                  ( 1 )
+#define DNS_TYPE_CNAME              ( 5 )
+#define DNS_CLASS_IN                ( 1 )
+#define DNS_FLAGS_QR                ( 0x8000 )
+#define DNS_FLAGS_RD                ( 0x0100 )
+#define DNS_FLAGS_RCODE_MASK        ( 0x000F )
+#define DNS_RCODE_NXDOMAIN          ( 3 )
+#define DNS_MAX_POINTERS            ( 16 ) /* Compression pointers followed in a name. */
+#define DNS_MAX_CNAMES              ( 8 )  /* CNAME records followed in an answer. */
+#define DNS_PORT_EPHEMERAL_FIRST    ( 49152 )
+#define DNS_PORT_BIND_ATTEMPTS      ( 8 )
+
+#define DNS_ENTRY_FREE              ( 0 )
+#define DNS_ENTRY_RESOLVED          ( 1 )
+#define DNS_ENTRY_NEGATIVE          ( 2 )
+#define DNS_ENTRY_FAILED            ( 3 ) /* No server answered the last query. */
+
+#define DNS_RESULT_OK               ( 0 )
+#define DNS_RESULT_NOT_FOUND        ( 1 )
+#define DNS_RESULT_ERROR            ( 2 )
+#define DNS_RESULT_IGNORED          ( 3 ) /* Not an answer to the query sent. */
+
+#define DNS_RESOLVER_UNINITIALISED  ( 0 )
+#define DNS_RESOLVER_READY          ( 1 )
+#define DNS_RESOLVER_FAILED         ( 2 )
+
+#define DNS_RESOLVER_STACK_SIZE     ( 2048 )
+
+/* A query waited for by SOCKETS_GetHostByName() is given all its attempts. */
+#define DNS_LOOKUP_TIMEOUT_MS       ( socketsconfigDNS_QUERY_TIMEOUT_MS * socketsconfigDNS_QUERY_ATTEMPTS )
+
+typedef struct dns_entry
+{
+    char name[ securesocketsMAX_DNS_NAME_LENGTH + 1 ];
+    uint8_t state;
+    bool pending; /* A query is queued or in progress. */
+    uint8_t address_count;
+    uint32_t addresses[ SOCKETS_CONNECT_ANY_MAX_ADDRESSES ];
+    uint32_t resolved_at;
+    uint32_t ttl;
+    uint32_t last_used;
+} dns_entry_t;
+
+/*
+ * Entry i of the cache has bit i in dns_flags, which is set when a query for the
+ * entry completes and cleared when one starts.
+ */
+static dns_entry_t dns_cache[ socketsconfigDNS_CACHE_ENTRIES ];
+static osMutexId_t dns_mutex;
+static osEventFlagsId_t dns_flags;
+static osMessageQueueId_t dns_queue;
+static osThreadId_t dns_handle;
+static volatile uint8_t dns_state = DNS_RESOLVER_UNINITIALISED;
+
+/*-----------------------------------------------------------*/
+
+static size_t prvDnsWriteQuery( uint8_t * buf,
+                                const char * name,
+                                uint16_t id )
+{
+    size_t len = DNS_HEADER_SIZE;
+    const char * label = name;
+    const char * dot;
+    size_t label_len;
+
+    memset( buf, 0, DNS_HEADER_SIZE );
+    buf[ 0 ] = ( uint8_t ) ( id >> 8 );
+    buf[ 1 ] = ( uint8_t ) id;
+    buf[ 2 ] = ( uint8_t ) ( DNS_FLAGS_RD >> 8 );
+    buf[ 5 ] = 1; /* One question. */
+
+    while( *label != '\0' )
+    {
+        dot = strchr( label, '.' );
+        label_len = ( dot != NULL ) ? ( size_t ) ( dot - label ) : strlen( label );
+
+        if( ( label_len == 0 ) || ( label_len > 63 ) )
+        {
+            return 0;
+        }
+
+        buf[ len++ ] = ( uint8_t ) label_len;
+        memcpy( &buf[ len ], label, label_len );
+        len += label_len;
+        label += label_len + ( ( dot != NULL ) ? 1 : 0 );
+    }
+
+    buf[ len++ ] = 0;
+    buf[ len++ ] = 0;
+    buf[ len++ ] = DNS_TYPE_A;
+    buf[ len++ ] = 0;
+    buf[ len++ ] = DNS_CLASS_IN;
+
+    return len;
+}
+
+/*-----------------------------------------------------------*/
+
+/*
+ * @brief Follow the compression pointers at an offset, return the offset of the
+ * label found or 0 if the name is malformed.
+ */
+static size_t prvDnsLabel( const uint8_t * buf,
+                           size_t len,
+                           size_t offset,
+                           uint8_t * pointers )
+{
+    while( ( offset < len ) && ( ( buf[ offset ] & 0xC0 ) == 0xC0 ) )
+    {
+        if( ( offset + 2 > len ) || ( ++( *pointers ) > DNS_MAX_POINTERS ) )
+        {
+            return 0;
+        }
+
+        offset = ( ( size_t ) ( buf[ offset ] & 0x3F ) << 8 ) | buf[ offset + 1 ];
+    }
+
+    /* The header is never part of a name, so 0 is not a valid offset. */
+    if( ( offset < DNS_HEADER_SIZE ) || ( offset >= len ) || ( ( buf[ offset ] & 0xC0 ) != 0 ) ||
+        ( offset + 1 + buf[ offset ] > len ) )
+    {
+        return 0;
+    }
+
+    return offset;
+}
+
+/*-----------------------------------------------------------*/
+
+/*
+ * @brief Skip a possibly compressed name, return the offset after it or 0.
+ */
+static size_t prvDnsSkipName( const uint8_t * buf,
+                              size_t len,
+                              size_t offset )
+{
+    while( offset < len )
+    {
+        if( buf[ offset ] == 0 )
+        {
+            return offset + 1;
+        }
+        else if( ( buf[ offset ] & 0xC0 ) == 0xC0 )
+        {
+            return ( offset + 2 <= len ) ? offset + 2 : 0;
+        }
+        else
+        {
+            offset += buf[ offset ] + 1;
+        }
+    }
+
+    return 0;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool prvDnsLabelEqual( const uint8_t * a,
+                              const uint8_t * b,
+                              size_t len )
+{
+    size_t i;
+
+    for( i = 0; i < len; i++ )
+    {
+        if( tolower( a[ i ] ) != tolower( b[ i ] ) )
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/*-----------------------------------------------------------*/
+
+/*
+ * @brief Compare a name of a message with a host name, ignoring case.
+ */
+static bool prvDnsNameIs( const uint8_t * buf,
+                          size_t len,
+                          size_t offset,
+                          const char * name )
+{
+    uint8_t pointers = 0;
+    size_t label_len;
+
+    for( ; ; )
+    {
+        offset = prvDnsLabel( buf, len, offset, &pointers );
+
+        if( offset == 0 )
+        {
+            return false;
+        }
+
+        label_len = buf[ offset ];
+
+        if( label_len == 0 )
+        {
+            return *name == '\0';
+        }
+
+        if( ( memchr( name, '\0', label_len ) != NULL ) ||
+            !prvDnsLabelEqual( &buf[ offset + 1 ], ( const uint8_t * ) name, label_len ) ||
+            ( ( name[ label_len ] != '.' ) && ( name[ label_len ] != '\0' ) ) )
+        {
+            return false;
+        }
+
+        name += label_len + ( ( name[ label_len ] == '.' ) ? 1 : 0 );
+        offset += label_len + 1;
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+/*
+ * @brief Compare two names of a message, ignoring case.
+ */
+static bool prvDnsNamesEqual( const uint8_t * buf,
+                              size_t len,
+                              size_t a,
+                              size_t b )
+{
+    uint8_t pointers_a = 0;
+    uint8_t pointers_b = 0;
+
+    for( ; ; )
+    {
+        a = prvDnsLabel( buf, len, a, &pointers_a );
+        b = prvDnsLabel( buf, len, b, &pointers_b );
+
+        if( ( a == 0 ) || ( b == 0 ) || ( buf[ a ] != buf[ b ] ) ||
+            !prvDnsLabelEqual( &buf[ a + 1 ], &buf[ b + 1 ], buf[ a ] ) )
+        {
+            return false;
+        }
+
+        if( buf[ a ] == 0 )
+        {
+            return true;
+        }
+
+        a += buf[ a ] + 1;
+        b += buf[ b ] + 1;
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+/*
+ * @brief Read the header of the resource record at an offset.
+ *
+ * @return The offset of the record data, or 0 if the record is malformed.
+ */
+static size_t prvDnsRecord( const uint8_t * buf,
+                            size_t len,
+                            size_t offset,
+                            uint16_t * type,
+                            uint16_t * class,
+                            uint32_t * ttl,
+                            uint16_t * rdlength )
+{
+    offset = prvDnsSkipName( buf, len, offset );
+
+    if( ( offset == 0 ) || ( offset + 10 > len ) )
+    {
+        return 0;
+    }
+
+    *type = ( uint16_t ) ( ( buf[ offset ] << 8 ) | buf[ offset + 1 ] );
+    *class = ( uint16_t ) ( ( buf[ offset + 2 ] << 8 ) | buf[ offset + 3 ] );
+    *ttl = ( ( uint32_t ) buf[ offset + 4 ] << 24 ) | ( ( uint32_t ) buf[ offset + 5 ] << 16 ) |
+           ( ( uint32_t ) buf[ offset + 6 ] << 8 ) | buf[ offset + 7 ];
+    *rdlength = ( uint16_t ) ( ( buf[ offset + 8 ] << 8 ) | buf[ offset + 9 ] );
+    offset += 10;
+
+    if( offset + *rdlength > len )
+    {
+        return 0;
+    }
+
+    return offset;
+}
+
+/*-----------------------------------------------------------*/
+
+static int prvDnsParseResponse( const uint8_t * buf,
+                                size_t len,
+                                uint16_t id,
+                                const char * name,
+                                dns_entry_t * result )
+{
+    uint16_t flags;
+    uint16_t answers;
+    uint16_t type;
+    uint16_t class;
+    uint16_t rdlength;
+    uint16_t i;
+    uint32_t ttl;
+    uint32_t min_ttl = UINT32_MAX;
+    size_t offset = DNS_HEADER_SIZE;
+    size_t answers_offset;
+    size_t owner;
+    size_t target; /* The name whose A records are looked for. */
+    uint8_t cnames = 0;
+    bool followed;
+
+    /* One question is sent, the answer must repeat it. */
+    if( ( len < DNS_HEADER_SIZE ) || ( ( ( buf[ 0 ] << 8 ) | buf[ 1 ] ) != id ) ||
+        ( ( buf[ 2 ] & ( DNS_FLAGS_QR >> 8 ) ) == 0 ) || ( buf[ 4 ] != 0 ) || ( buf[ 5 ] != 1 ) ||
+        !prvDnsNameIs( buf, len, offset, name ) )
+    {
+        return DNS_RESULT_IGNORED;
+    }
+
+    offset = prvDnsSkipName( buf, len, offset );
+
+    if( ( offset == 0 ) || ( offset + 4 > len ) ||
+        ( ( ( buf[ offset ] << 8 ) | buf[ offset + 1 ] ) != DNS_TYPE_A ) ||
+        ( ( ( buf[ offset + 2 ] << 8 ) | buf[ offset + 3 ] ) != DNS_CLASS_IN ) )
+    {
+        return DNS_RESULT_IGNORED;
+    }
+
+    target = DNS_HEADER_SIZE;
+    answers_offset = offset + 4;
+    flags = ( uint16_t ) ( ( buf[ 2 ] << 8 ) | buf[ 3 ] );
+    answers = ( uint16_t ) ( ( buf[ 6 ] << 8 ) | buf[ 7 ] );
+
+    if( ( flags & DNS_FLAGS_RCODE_MASK ) == DNS_RCODE_NXDOMAIN )
+    {
+        return DNS_RESULT_NOT_FOUND;
+    }
+    else if( ( flags & DNS_FLAGS_RCODE_MASK ) != 0 )
+    {
+        return DNS_RESULT_ERROR;
+    }
+
+    /* Follow the CNAME records from the name queried, whatever their order. */
+    do
+    {
+        followed = false;
+        offset = answers_offset;
+
+        for( i = 0; i < answers; i++ )
+        {
+            owner = offset;
+            offset = prvDnsRecord( buf, len, offset, &type, &class, &ttl, &rdlength );
+
+            if( offset == 0 )
+            {
+                return DNS_RESULT_ERROR;
+            }
+
+            if( ( type == DNS_TYPE_CNAME ) && ( class == DNS_CLASS_IN ) &&
+                prvDnsNamesEqual( buf, len, owner, target ) )
+            {
+                if( ( ++cnames > DNS_MAX_CNAMES ) || ( prvDnsSkipName( buf, offset + rdlength, offset ) == 0 ) )
+                {
+                    return DNS_RESULT_ERROR;
+                }
+
+                target = offset;
+                min_ttl = ( ttl < min_ttl ) ? ttl : min_ttl;
+                followed = true;
+                break;
+            }
+
+            offset += rdlength;
+        }
+    } while( followed );
+
+    result->address_count = 0;
+    offset = answers_offset;
+
+    for( i = 0; i < answers; i++ )
+    {
+        owner = offset;
+        offset = prvDnsRecord( buf, len, offset, &type, &class, &ttl, &rdlength );
+
+        if( offset == 0 )
+        {
+            return DNS_RESULT_ERROR;
+        }
+
+        if( ( type == DNS_TYPE_A ) && ( class == DNS_CLASS_IN ) && ( rdlength == 4 ) &&
+            ( result->address_count < SOCKETS_CONNECT_ANY_MAX_ADDRESSES ) &&
+            prvDnsNamesEqual( buf, len, owner, target ) )
+        {
+            /* Kept in network byte order. */
+            memcpy( &result->addresses[ result->address_count++ ], &buf[ offset ], 4 );
+            min_ttl = ( ttl < min_ttl ) ? ttl : min_ttl;
+        }
+
+        offset += rdlength;
+    }
+
+    if( result->address_count == 0 )
+    {
+        return DNS_RESULT_NOT_FOUND;
+    }
+
+    /* Seconds to milliseconds, bounded by the configuration. */
+    min_ttl = ( min_ttl > ( socketsconfigDNS_MAX_TTL_MS / 1000 ) ) ? socketsconfigDNS_MAX_TTL_MS : min_ttl * 1000;
+    min_ttl = ( min_ttl < socketsconfigDNS_MIN_TTL_MS ) ? socketsconfigDNS_MIN_TTL_MS : min_ttl;
+    result->ttl = pdMS_TO_TICKS( min_ttl );
+
+    return DNS_RESULT_OK;
+}
+
+/*-----------------------------------------------------------*/
+
+/*
+ * @brief Send a query for a name to a DNS server and wait for the answer.
+ */
+static int prvDnsQueryServer( int sock,
+                              const struct sockaddr_in * server,
+                              const char * name,
+                              dns_entry_t * result )
+{
+    uint8_t buf[ DNS_MESSAGE_SIZE ];
+    struct sockaddr_in from;
+    socklen_t from_len;
+    fd_set read_set;
+    struct timeval timeout;
+    size_t query_len;
+    uint16_t id;
+    uint32_t sent;
+    uint32_t elapsed;
+    int ret = DNS_RESULT_ERROR;
+    int attempt;
+    int len;
+
+    for( attempt = 0; ( attempt < socketsconfigDNS_QUERY_ATTEMPTS ) && ( ret == DNS_RESULT_ERROR ); attempt++ )
+    {
+        if( psa_generate_random( ( uint8_t * ) &id, sizeof( id ) ) != PSA_SUCCESS )
+        {
+            break;
+        }
+
+        query_len = prvDnsWriteQuery( buf, name, id );
+
+        if( query_len == 0 )
+        {
+            ret = DNS_RESULT_NOT_FOUND;
+            break;
+        }
+
+        if( lwip_sendto( sock, buf, query_len, 0, ( const struct sockaddr * ) server, sizeof( *server ) ) < 0 )
+        {
+            continue;
+        }
+
+        /* Answers to earlier attempts or from elsewhere are dropped until the
+         * timeout, which they do not extend. */
+        sent = osKernelGetTickCount();
+
+        for( ; ; )
+        {
+            elapsed = ( ( osKernelGetTickCount() - sent ) * 1000 ) / osKernelGetTickFreq();
+
+            if( elapsed >= socketsconfigDNS_QUERY_TIMEOUT_MS )
+            {
+                break;
+            }
+
+            FD_ZERO( &read_set );
+            FD_SET( sock, &read_set );
+            timeout.tv_sec = ( socketsconfigDNS_QUERY_TIMEOUT_MS - elapsed ) / 1000;
+            timeout.tv_usec = ( ( socketsconfigDNS_QUERY_TIMEOUT_MS - elapsed ) % 1000 ) * 1000;
+
+            if( lwip_select( sock + 1, &read_set, NULL, NULL, &timeout ) <= 0 )
+            {
+                break;
+            }
+
+            from_len = sizeof( from );
+            len = lwip_recvfrom( sock, buf, sizeof( buf ), 0, ( struct sockaddr * ) &from, &from_len );
+
+            if( ( len > 0 ) && ( from.sin_addr.s_addr == server->sin_addr.s_addr ) &&
+                ( from.sin_port == server->sin_port ) )
+            {
+                ret = prvDnsParseResponse( buf, ( size_t ) len, id, name, result );
+
+                if( ret != DNS_RESULT_IGNORED )
+                {
+                    break;
+                }
+            }
+        }
+
+        ret = ( ret == DNS_RESULT_IGNORED ) ? DNS_RESULT_ERROR : ret;
+    }
+
+    return ret;
+}
+
+/*-----------------------------------------------------------*/
+
+/*
+ * @brief Bind a socket to a random ephemeral port.
+ */
+static bool prvDnsBind( int sock )
+{
+    struct sockaddr_in local;
+    uint16_t port;
+    int attempt;
+
+    memset( &local, 0, sizeof( local ) );
+    local.sin_family = AF_INET;
+    local.sin_addr.s_addr = PP_HTONL( INADDR_ANY );
+
+    /* A port in use is unlikely, another is tried. */
+    for( attempt = 0; attempt < DNS_PORT_BIND_ATTEMPTS; attempt++ )
+    {
+        if( psa_generate_random( ( uint8_t * ) &port, sizeof( port ) ) != PSA_SUCCESS )
+        {
+            return false;
+        }
+
+        port = ( uint16_t ) ( DNS_PORT_EPHEMERAL_FIRST + ( port % ( 65536 - DNS_PORT_EPHEMERAL_FIRST ) ) );
+        local.sin_port = lwip_htons( port );
+
+        if( lwip_bind( sock, ( const struct sockaddr * ) &local, sizeof( local ) ) == 0 )
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/*-----------------------------------------------------------*/
+
+/*
+ * @brief Query the DNS servers configured in lwIP in turn until one answers.
+ */
+static int prvDnsQuery( const char * name,
+                        dns_entry_t * result )
+{
+    struct sockaddr_in server;
+    ip_addr_t addr;
+    int ret = DNS_RESULT_ERROR;
+    bool has_server = false;
+    uint8_t i;
+    int sock;
+
+    sock = lwip_socket( AF_INET, SOCK_DGRAM, IPPROTO_UDP );
+
+    if( sock < 0 )
+    {
+        return DNS_RESULT_ERROR;
+    }
+
+    if( !prvDnsBind( sock ) )
+    {
+        lwip_close( sock );
+        return DNS_RESULT_ERROR;
+    }
+
+    /* A server which answers, even that the name does not exist, is trusted. */
+    for( i = 0; ( i < DNS_MAX_SERVERS ) && ( ret == DNS_RESULT_ERROR ); i++ )
+    {
+        /* The servers are changed by DHCP in the TCP/IP thread. */
+        LOCK_TCPIP_CORE();
+        ip_addr_copy( addr, *dns_getserver( i ) );
+        UNLOCK_TCPIP_CORE();
+
+        if( !IP_IS_V4( &addr ) || ( ip_addr_get_ip4_u32( &addr ) == 0 ) )
+        {
+            continue;
+        }
+
+        memset( &server, 0, sizeof( server ) );
+        server.sin_family = AF_INET;
+        server.sin_port = lwip_htons( DNS_PORT );
+        server.sin_addr.s_addr = ip_addr_get_ip4_u32( &addr );
+        has_server = true;
+
+        ret = prvDnsQueryServer( sock, &server, name, result );
+    }
+
+    lwip_close( sock );
+
+    if( !has_server )
+    {
+        configPRINTF( ( "No DNS server\n" ) );
+    }
+
+    return ret;
+}
+
+/*-----------------------------------------------------------*/
+
+static void vTaskDnsResolver( void * param )
+{
+    dns_entry_t result;
+    uint8_t index;
+    int ret;
+
+    ( void ) param;
+
+    for( ; ; )
+    {
+        if( osMessageQueueGet( dns_queue, &index, NULL, osWaitForever ) != osOK )
+        {
+            continue;
+        }
+
+        osMutexAcquire( dns_mutex, osWaitForever );
+        memcpy( result.name, dns_cache[ index ].name, sizeof( result.name ) );
+        osMutexRelease( dns_mutex );
+
+        ret = prvDnsQuery( result.name, &result );
+
+        osMutexAcquire( dns_mutex, osWaitForever );
+
+        if( ret == DNS_RESULT_OK )
+        {
+            dns_cache[ index ].state = DNS_ENTRY_RESOLVED;
+            dns_cache[ index ].address_count = result.address_count;
+            memcpy( dns_cache[ index ].addresses, result.addresses, sizeof( result.addresses ) );
+            dns_cache[ index ].ttl = result.ttl;
+            dns_cache[ index ].resolved_at = osKernelGetTickCount();
+        }
+        else if( ret == DNS_RESULT_NOT_FOUND )
+        {
+            dns_cache[ index ].state = DNS_ENTRY_NEGATIVE;
+            dns_cache[ index ].address_count = 0;
+            dns_cache[ index ].ttl = pdMS_TO_TICKS( socketsconfigDNS_NEGATIVE_TTL_MS );
+            dns_cache[ index ].resolved_at = osKernelGetTickCount();
+        }
+        else if( ( dns_cache[ index ].state != DNS_ENTRY_RESOLVED ) ||
+                 ( osKernelGetTickCount() - dns_cache[ index ].resolved_at >= dns_cache[ index ].ttl ) )
+        {
+            /* Not cached, only the lookups waiting for this query fail. A failed
+             * refresh keeps the addresses until they expire. */
+            dns_cache[ index ].state = DNS_ENTRY_FAILED;
+            dns_cache[ index ].address_count = 0;
+        }
+
+        dns_cache[ index ].pending = false;
+        ( void ) osEventFlagsSet( dns_flags, 1UL << index );
+
+        osMutexRelease( dns_mutex );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static bool prvDnsInit( void )
+{
+    int32_t lock;
+
+    /* Only the mutex is created with the scheduler locked, the first task to
+     * take it creates the resolver while the others wait for it. */
+    if( dns_mutex == NULL )
+    {
+        lock = osKernelLock();
+
+        if( dns_mutex == NULL )
+        {
+            dns_mutex = osMutexNew( NULL );
+        }
+
+        ( void ) osKernelRestoreLock( lock );
+    }
+
+    if( dns_mutex == NULL )
+    {
+        return false;
+    }
+
+    if( dns_state == DNS_RESOLVER_UNINITIALISED )
+    {
+        osMutexAcquire( dns_mutex, osWaitForever );
+
+        if( dns_state == DNS_RESOLVER_UNINITIALISED )
+        {
+            osThreadAttr_t attr = {
+                .name       = "SocketsDns",
+                .stack_size = DNS_RESOLVER_STACK_SIZE,
+                .priority   = osPriorityNormal
+            };
+
+            dns_flags = osEventFlagsNew( NULL );
+            dns_queue = osMessageQueueNew( socketsconfigDNS_CACHE_ENTRIES, sizeof( uint8_t ), NULL );
+
+            if( ( dns_flags != NULL ) && ( dns_queue != NULL ) )
+            {
+                dns_handle = osThreadNew( vTaskDnsResolver, NULL, &attr );
+            }
+
+            dns_state = ( dns_handle != NULL ) ? DNS_RESOLVER_READY : DNS_RESOLVER_FAILED;
+        }
+
+        osMutexRelease( dns_mutex );
+    }
+
+    return dns_state == DNS_RESOLVER_READY;
+}
+
+/*-----------------------------------------------------------*/
+
+/*
+ * @brief Queue a query for an entry, the DNS mutex must be held.
+ */
+static void prvDnsResolve( uint8_t index )
+{
+    if( dns_cache[ index ].pending == false )
+    {
+        ( void ) osEventFlagsClear( dns_flags, 1UL << index );
+        dns_cache[ index ].pending = true;
+
+        /* The queue has room for every entry and an entry is queued only once. */
+        ( void ) osMessageQueuePut( dns_queue, &index, 0, 0 );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+/*
+ * @brief Look a name up in the cache, the DNS mutex must be held.
+ *
+ * @param[in] waited Whether the caller already waited for a query of the name,
+ * in which case a failed query is reported instead of sent again.
+ */
+static int32_t prvDnsLookup( const char * pcHostName,
+                             uint32_t * pulAddresses,
+                             size_t xMaxAddresses,
+                             uint8_t * index,
+                             bool waited )
+{
+    dns_entry_t * entry = NULL;
+    uint32_t now = osKernelGetTickCount();
+    uint32_t age;
+    uint8_t i;
+    uint8_t victim = socketsconfigDNS_CACHE_ENTRIES;
+
+    for( i = 0; i < socketsconfigDNS_CACHE_ENTRIES; i++ )
+    {
+        if( ( dns_cache[ i ].state != DNS_ENTRY_FREE ) || ( dns_cache[ i ].pending == true ) )
+        {
+            if( strcmp( dns_cache[ i ].name, pcHostName ) == 0 )
+            {
+                entry = &dns_cache[ i ];
+                break;
+            }
+        }
+
+        /* Replace a free entry, or else the least recently used one. */
+        if( dns_cache[ i ].pending == false )
+        {
+            if( ( victim == socketsconfigDNS_CACHE_ENTRIES ) ||
+                ( ( dns_cache[ victim ].state != DNS_ENTRY_FREE ) &&
+                  ( ( dns_cache[ i ].state == DNS_ENTRY_FREE ) ||
+                    ( now - dns_cache[ i ].last_used > now - dns_cache[ victim ].last_used ) ) ) )
+            {
+                victim = i;
+            }
+        }
+    }
+
+    if( entry == NULL )
+    {
+        if( victim == socketsconfigDNS_CACHE_ENTRIES )
+        {
+            return SOCKETS_ENOMEM;
+        }
+
+        i = victim;
+        entry = &dns_cache[ i ];
+        memset( entry, 0, sizeof( *entry ) );
+        strcpy( entry->name, pcHostName );
+    }
+
+    *index = i;
+    entry->last_used = now;
+    age = now - entry->resolved_at;
+
+    if( ( entry->state == DNS_ENTRY_FAILED ) && ( entry->pending == false ) && waited )
+    {
+        return SOCKETS_SOCKET_ERROR;
+    }
+
+    if( ( entry->state == DNS_ENTRY_FREE ) || ( entry->state == DNS_ENTRY_FAILED ) || ( age >= entry->ttl ) )
+    {
+        prvDnsResolve( i );
+        return SOCKETS_EWOULDBLOCK;
+    }
+
+    if( entry->state == DNS_ENTRY_NEGATIVE )
+    {
+        return SOCKETS_SOCKET_ERROR;
+    }
+
+    if( age >= ( entry->ttl / 100 ) * socketsconfigDNS_REFRESH_PERCENT )
+    {
+        prvDnsResolve( i );
+    }
+
+    if( xMaxAddresses > entry->address_count )
+    {
+        xMaxAddresses = entry->address_count;
+    }
+
+    memcpy( pulAddresses, entry->addresses, xMaxAddresses * sizeof( uint32_t ) );
+
+    return ( int32_t ) xMaxAddresses;
+}
+
+/*-----------------------------------------------------------*/
+
+/*
+ * @brief Convert an IP address literal or "localhost", return false for other names.
+ */
+static bool prvDnsLiteral( const char * pcHostName,
+                           uint32_t * pulAddress )
+{
+    ip_addr_t addr;
+
+    if( strcmp( pcHostName, "localhost" ) == 0 )
+    {
+        *pulAddress = PP_HTONL( IPADDR_LOOPBACK );
+        return true;
+    }
+
+    if( ipaddr_aton( pcHostName, &addr ) && IP_IS_V4( &addr ) )
+    {
+        *pulAddress = ip_addr_get_ip4_u32( &addr );
+        return true;
+    }
+
+    return false;
+}
+
+/*-----------------------------------------------------------*/
+
+int32_t SOCKETS_GetHostAddresses( const char * pcHostName,
+                                  uint32_t * pulAddresses,
+                                  size_t xMaxAddresses,
+                                  uint32_t ulTimeoutMs )
+{
+    uint32_t start = osKernelGetTickCount();
+    uint32_t elapsed;
+    uint8_t index = 0;
+    bool waited = false;
+    int32_t ret;
+
+    if( ( pcHostName == NULL ) || ( pulAddresses == NULL ) || ( xMaxAddresses == 0 ) )
+    {
+        return SOCKETS_EINVAL;
+    }
+
+    if( strlen( pcHostName ) > ( size_t ) securesocketsMAX_DNS_NAME_LENGTH )
+    {
+        configPRINTF( ( "Host name (%s) too long!", pcHostName ) );
+        return SOCKETS_EINVAL;
+    }
+
+    if( prvDnsLiteral( pcHostName, pulAddresses ) )
+    {
+        return 1;
+    }
+
+    if( !prvDnsInit() )
+    {
+        return SOCKETS_ENOMEM;
+    }
+
+    for( ; ; )
+    {
+        osMutexAcquire( dns_mutex, osWaitForever );
+        ret = prvDnsLookup( pcHostName, pulAddresses, xMaxAddresses, &index, waited );
+        osMutexRelease( dns_mutex );
+
+        elapsed = osKernelGetTickCount() - start;
+
+        if( ( ret != SOCKETS_EWOULDBLOCK ) || ( elapsed >= pdMS_TO_TICKS( ulTimeoutMs ) ) )
+        {
+            break;
+        }
+
+        ( void ) osEventFlagsWait( dns_flags, 1UL << index, osFlagsWaitAny | osFlagsNoClear,
+                                   pdMS_TO_TICKS( ulTimeoutMs ) - elapsed );
+        waited = true;
+    }
+
+    return ret;
+}
+
+/*-----------------------------------------------------------*/
+
+uint32_t SOCKETS_GetHostByName( const char * pcHostName )
+{
+    uint32_t addr = 0;
+
+    if( SOCKETS_GetHostAddresses( pcHostName, &addr, 1, DNS_LOOKUP_TIMEOUT_MS ) <= 0 )
+    {
+        configPRINTF( ( "Unable to resolve (%s)", pcHostName ) );
+        return 0;
+    }
+
+    return addr;
+}
@@ -39,6 +39,16 @@
 
 /*-----------------------------------------------------------*/
 
+/**
+ * @brief Number of transport vectors converted to Secure Sockets vectors at a
+ * time by #SecureSocketsTransport_Writev.
+ */
+#ifndef SECURE_SOCKETS_TRANSPORT_WRITEV_BATCH
+    #define SECURE_SOCKETS_TRANSPORT_WRITEV_BATCH    ( 8U )
+#endif
+
+/*-----------------------------------------------------------*/
+
 /**
  * @brief Each compilation unit that consumes the NetworkContext must define it.
  * It should contain a single pointer to the type of your desired transport.
@@ -72,6 +82,9 @@ static int32_t transportTimeoutSetup( Socket_t tcpSocket,
  * @param[out] pNetworkContext The output parameter to return the created network context.
  * @param[in] pServerInfo Server connection info.
  * @param[in] pSocketsConfig Socket configurations for the connection.
+ * @param[in] pAddresses Addresses of the server, or NULL to resolve its host name.
+ * @param[in] addressCount Number of addresses in @p pAddresses.
+ * @param[out] pConnected Index in @p pAddresses of the address connected to. May be NULL.
  *
  * @return #TRANSPORT_SOCKET_STATUS_SUCCESS on success;
  *         #TRANSPORT_SOCKET_STATUS_INVALID_PARAMETER, #TRANSPORT_SOCKET_STATUS_INSUFFICIENT_MEMORY,
@@ -80,7 +93,10 @@ static int32_t transportTimeoutSetup( Socket_t tcpSocket,
  */
 static TransportSocketStatus_t establishConnect( NetworkContext_t * pNetworkContext,
                                                  const ServerInfo_t * pServerInfo,
-                                                 const SocketsConfig_t * pSocketsConfig );
+                                                 const SocketsConfig_t * pSocketsConfig,
+                                                 const uint32_t * pAddresses,
+                                                 size_t addressCount,
+                                                 size_t * pConnected );
 
 /**
  * @brief Set up TLS configurations for the socket.
@@ -110,6 +126,33 @@ static int32_t tlsSetup( const SocketsConfig_t * pSocketsConfig,
 static TransportSocketStatus_t connectToServer( Socket_t tcpSocket,
                                                 const ServerInfo_t * pServerInfo );
 
+/**
+ * Connect to the first of @p pAddresses to answer using @p tcpSocket.
+ *
+ * @param[in] tcpSocket The socket to establish connect.
+ * @param[in] pServerInfo Server connection info.
+ * @param[in] pAddresses Addresses of the server.
+ * @param[in] addressCount Number of addresses in @p pAddresses.
+ * @param[out] pConnected Index in @p pAddresses of the address connected to. May be NULL.
+ *
+ * @return #TRANSPORT_SOCKET_STATUS_SUCCESS on success;
+ *         #TRANSPORT_SOCKET_STATUS_CONNECT_FAILURE on failure.
+ */
+static TransportSocketStatus_t connectToAnyAddress( Socket_t tcpSocket,
+                                                    const ServerInfo_t * pServerInfo,
+                                                    const uint32_t * pAddresses,
+                                                    size_t addressCount,
+                                                    size_t * pConnected );
+
+/**
+ * @brief Check the parameters common to the connect functions.
+ *
+ * @return #TRANSPORT_SOCKET_STATUS_SUCCESS or #TRANSPORT_SOCKET_STATUS_INVALID_PARAMETER.
+ */
+static TransportSocketStatus_t checkConnectParameters( const NetworkContext_t * pNetworkContext,
+                                                       const ServerInfo_t * pServerInfo,
+                                                       const SocketsConfig_t * pSocketsConfig );
+
 /*-----------------------------------------------------------*/
 
 /* MISRA Rule 8.13 flags the following line for not using the const qualifier
@@ -167,6 +210,80 @@ int32_t SecureSocketsTransport_Send( NetworkContext_t * pNetworkContext,
 
 /*-----------------------------------------------------------*/
 
+int32_t SecureSocketsTransport_Writev( NetworkContext_t * pNetworkContext,
+                                       TransportOutVector_t * pIoVec,
+                                       size_t ioVecCount )
+{
+    int32_t bytesSent = 0;
+    int32_t batchSent = 0;
+    size_t batchBytes = 0;
+    size_t batchCount = 0;
+    size_t i = 0;
+    SocketsOutVector_t vectors[ SECURE_SOCKETS_TRANSPORT_WRITEV_BATCH ];
+
+    if( ( pIoVec == NULL ) ||
+        ( ioVecCount == 0UL ) ||
+        ( pNetworkContext == NULL ) ||
+        ( pNetworkContext->pParams == NULL ) )
+    {
+        LogError( ( "Invalid parameter: pIoVec=%p, ioVecCount=%lu, pNetworkContext=%p",
+                    ( void * ) pIoVec, ioVecCount, ( void * ) pNetworkContext ) );
+        bytesSent = SOCKETS_EINVAL;
+    }
+    else if( pNetworkContext->pParams->tcpSocket == SOCKETS_INVALID_SOCKET )
+    {
+        LogError( ( "Invalid parameter: pNetworkContext->pParams->tcpSocket cannot be SOCKETS_INVALID_SOCKET." ) );
+        bytesSent = SOCKETS_EINVAL;
+    }
+    else
+    {
+        while( i < ioVecCount )
+        {
+            batchBytes = 0;
+
+            for( batchCount = 0;
+                 ( batchCount < SECURE_SOCKETS_TRANSPORT_WRITEV_BATCH ) && ( i < ioVecCount );
+                 batchCount++, i++ )
+            {
+                vectors[ batchCount ].pvData = pIoVec[ i ].iov_base;
+                vectors[ batchCount ].xLength = pIoVec[ i ].iov_len;
+                batchBytes += pIoVec[ i ].iov_len;
+            }
+
+            batchSent = SOCKETS_SendVector( pNetworkContext->pParams->tcpSocket,
+                                            vectors,
+                                            batchCount,
+                                            0 );
+
+            if( batchSent < 0 )
+            {
+                LogError( ( "Failed to send data over network. bytesSent=%d.", batchSent ) );
+
+                /* Report an error only if nothing went out, as with a partial send. */
+                bytesSent = ( bytesSent > 0 ) ? bytesSent : batchSent;
+                break;
+            }
+
+            bytesSent += batchSent;
+
+            if( ( size_t ) batchSent < batchBytes )
+            {
+                LogWarn( ( "bytesSent %d < bytesToSend %lu.", batchSent, batchBytes ) );
+                break;
+            }
+        }
+
+        if( bytesSent > 0 )
+        {
+            LogInfo( ( "Successfully sent %d bytes over network.", bytesSent ) );
+        }
+    }
+
+    return bytesSent;
+}
+
+/*-----------------------------------------------------------*/
+
 /* MISRA Rule 8.13 flags the following line for not using the const qualifier
  * on `pNetworkContext`. Indeed, the object pointed by it is not modified
  * by Secure Sockets, but other implementations of `TransportRecv_t` may do so. */
@@ -348,6 +465,40 @@ static TransportSocketStatus_t connectToServer( Socket_t tcpSocket,
 
 /*-----------------------------------------------------------*/
 
+static TransportSocketStatus_t connectToAnyAddress( Socket_t tcpSocket,
+                                                    const ServerInfo_t * pServerInfo,
+                                                    const uint32_t * pAddresses,
+                                                    size_t addressCount,
+                                                    size_t * pConnected )
+{
+    TransportSocketStatus_t returnStatus = TRANSPORT_SOCKET_STATUS_SUCCESS;
+    int32_t secureSocketStatus = ( int32_t ) SOCKETS_ERROR_NONE;
+    SocketsSockaddr_t serverAddresses[ SOCKETS_CONNECT_ANY_MAX_ADDRESSES ] = { 0 };
+    size_t index;
+
+    for( index = 0; index < addressCount; index++ )
+    {
+        serverAddresses[ index ].ucSocketDomain = SOCKETS_AF_INET;
+        serverAddresses[ index ].usPort = SOCKETS_htons( pServerInfo->port );
+        serverAddresses[ index ].ulAddress = pAddresses[ index ];
+    }
+
+    secureSocketStatus = SOCKETS_ConnectAny( tcpSocket,
+                                             serverAddresses,
+                                             addressCount,
+                                             pConnected );
+
+    if( secureSocketStatus != ( int32_t ) SOCKETS_ERROR_NONE )
+    {
+        LogError( ( "Failed to establish new connection. secureSocketStatus=%d.", secureSocketStatus ) );
+        returnStatus = TRANSPORT_SOCKET_STATUS_CONNECT_FAILURE;
+    }
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
 static int32_t transportTimeoutSetup( Socket_t tcpSocket,
                                       uint32_t sendTimeoutMs,
                                       uint32_t recvTimeoutMs )
@@ -403,7 +554,10 @@ static int32_t transportTimeoutSetup( Socket_t tcpSocket,
 
 static TransportSocketStatus_t establishConnect( NetworkContext_t * pNetworkContext,
                                                  const ServerInfo_t * pServerInfo,
-                                                 const SocketsConfig_t * pSocketsConfig )
+                                                 const SocketsConfig_t * pSocketsConfig,
+                                                 const uint32_t * pAddresses,
+                                                 size_t addressCount,
+                                                 size_t * pConnected )
 {
     Socket_t tcpSocket = ( Socket_t ) SOCKETS_INVALID_SOCKET;
     TransportSocketStatus_t returnStatus = TRANSPORT_SOCKET_STATUS_SUCCESS;
@@ -458,8 +612,19 @@ static TransportSocketStatus_t establishConnect( NetworkContext_t * pNetworkCont
     if( returnStatus == TRANSPORT_SOCKET_STATUS_SUCCESS )
     {
         /* Establish the TCP connection. */
-        returnStatus = connectToServer( tcpSocket,
-                                        pServerInfo );
+        if( pAddresses == NULL )
+        {
+            returnStatus = connectToServer( tcpSocket,
+                                            pServerInfo );
+        }
+        else
+        {
+            returnStatus = connectToAnyAddress( tcpSocket,
+                                                pServerInfo,
+                                                pAddresses,
+                                                addressCount,
+                                                pConnected );
+        }
     }
 
     if( returnStatus == TRANSPORT_SOCKET_STATUS_SUCCESS )
@@ -493,9 +658,9 @@ static TransportSocketStatus_t establishConnect( NetworkContext_t * pNetworkCont
 
 /*-----------------------------------------------------------*/
 
-TransportSocketStatus_t SecureSocketsTransport_Connect( NetworkContext_t * pNetworkContext,
-                                                        const ServerInfo_t * pServerInfo,
-                                                        const SocketsConfig_t * pSocketsConfig )
+static TransportSocketStatus_t checkConnectParameters( const NetworkContext_t * pNetworkContext,
+                                                       const ServerInfo_t * pServerInfo,
+                                                       const SocketsConfig_t * pSocketsConfig )
 {
     TransportSocketStatus_t returnStatus = TRANSPORT_SOCKET_STATUS_SUCCESS;
 
@@ -531,11 +696,70 @@ TransportSocketStatus_t SecureSocketsTransport_Connect( NetworkContext_t * pNetw
         returnStatus = TRANSPORT_SOCKET_STATUS_INVALID_PARAMETER;
     }
     else
+    {
+        /* MISRA 15.7 */
+    }
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+TransportSocketStatus_t SecureSocketsTransport_Connect( NetworkContext_t * pNetworkContext,
+                                                        const ServerInfo_t * pServerInfo,
+                                                        const SocketsConfig_t * pSocketsConfig )
+{
+    TransportSocketStatus_t returnStatus;
+
+    returnStatus = checkConnectParameters( pNetworkContext, pServerInfo, pSocketsConfig );
+
+    if( returnStatus == TRANSPORT_SOCKET_STATUS_SUCCESS )
+    {
+        /* Establish the TCP connection. */
+        returnStatus = establishConnect( pNetworkContext,
+                                         pServerInfo,
+                                         pSocketsConfig,
+                                         NULL,
+                                         0U,
+                                         NULL );
+    }
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+TransportSocketStatus_t SecureSocketsTransport_ConnectAny( NetworkContext_t * pNetworkContext,
+                                                           const ServerInfo_t * pServerInfo,
+                                                           const SocketsConfig_t * pSocketsConfig,
+                                                           const uint32_t * pAddresses,
+                                                           size_t addressCount,
+                                                           size_t * pConnected )
+{
+    TransportSocketStatus_t returnStatus;
+
+    returnStatus = checkConnectParameters( pNetworkContext, pServerInfo, pSocketsConfig );
+
+    if( returnStatus == TRANSPORT_SOCKET_STATUS_SUCCESS )
+    {
+        if( ( pAddresses == NULL ) || ( addressCount == 0U ) ||
+            ( addressCount > SOCKETS_CONNECT_ANY_MAX_ADDRESSES ) )
+        {
+            LogError( ( "Parameter check failed: addressCount must be between 1 and %u.",
+                        SOCKETS_CONNECT_ANY_MAX_ADDRESSES ) );
+            returnStatus = TRANSPORT_SOCKET_STATUS_INVALID_PARAMETER;
+        }
+    }
+
+    if( returnStatus == TRANSPORT_SOCKET_STATUS_SUCCESS )
     {
         /* Establish the TCP connection. */
         returnStatus = establishConnect( pNetworkContext,
                                          pServerInfo,
-                                         pSocketsConfig );
+                                         pSocketsConfig,
+                                         pAddresses,
+                                         addressCount,
+                                         pConnected );
     }
 
     return returnStatus;
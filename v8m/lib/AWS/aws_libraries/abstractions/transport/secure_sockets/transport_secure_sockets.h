@@ -155,6 +155,32 @@ TransportSocketStatus_t SecureSocketsTransport_Connect( NetworkContext_t * pNetw
                                                         const ServerInfo_t * pServerInfo,
                                                         const SocketsConfig_t * pSocketsConfig );
 
+/**
+ * @brief Same as #SecureSocketsTransport_Connect, to already resolved addresses
+ * of the server.
+ *
+ * The TCP connections to the addresses are raced and the TLS session is set up on
+ * the first one established. The host name is still used for SNI.
+ *
+ * @param[out] pNetworkContext The output parameter to return the created network context.
+ * @param[in] pServerInfo Server connection info.
+ * @param[in] pSocketsConfig socket configs for the connection.
+ * @param[in] pAddresses IPv4 addresses of the server, in network byte order.
+ * @param[in] addressCount Number of addresses, at most #SOCKETS_CONNECT_ANY_MAX_ADDRESSES.
+ * @param[out] pConnected Index in @p pAddresses of the address connected to. May be NULL.
+ *
+ * @return #TRANSPORT_SOCKET_STATUS_SUCCESS on success;
+ *         #TRANSPORT_SOCKET_STATUS_INVALID_PARAMETER, #TRANSPORT_SOCKET_STATUS_INSUFFICIENT_MEMORY,
+ *         #TRANSPORT_SOCKET_STATUS_CREDENTIALS_INVALID, #TRANSPORT_SOCKET_STATUS_INTERNAL_ERROR,
+ *         #TRANSPORT_SOCKET_STATUS_CONNECT_FAILURE on failure.
+ */
+TransportSocketStatus_t SecureSocketsTransport_ConnectAny( NetworkContext_t * pNetworkContext,
+                                                           const ServerInfo_t * pServerInfo,
+                                                           const SocketsConfig_t * pSocketsConfig,
+                                                           const uint32_t * pAddresses,
+                                                           size_t addressCount,
+                                                           size_t * pConnected );
+
 /**
  * @brief Closes a TLS session on top of a TCP connection using the Secure Sockets API.
  *
@@ -201,4 +227,22 @@ int32_t SecureSocketsTransport_Send( NetworkContext_t * pNetworkContext,
                                      const void * pMessage,
                                      size_t bytesToSend );
 
+/**
+ * @brief Sends the concatenation of several buffers over an established TLS
+ * session using the Secure Sockets API.
+ *
+ * This can be used as the #TransportInterface.writev function so that small
+ * pieces of a packet, such as an MQTT header and topic, share a TLS record
+ * instead of being serialized into a network buffer first.
+ *
+ * @param[in] pNetworkContext The network context created using Secure Sockets API.
+ * @param[in] pIoVec Array of buffers to send over the network stack.
+ * @param[in] ioVecCount Number of buffers in `pIoVec`.
+ *
+ * @return Number of bytes sent if successful; negative value on error.
+ */
+int32_t SecureSocketsTransport_Writev( NetworkContext_t * pNetworkContext,
+                                       TransportOutVector_t * pIoVec,
+                                       size_t ioVecCount );
+
 #endif /* TRANSPORT_SECURE_SOCKETS_H */
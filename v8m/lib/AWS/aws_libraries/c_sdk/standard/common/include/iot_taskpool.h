@@ -73,6 +73,8 @@
  * @function_brief{taskpool_function_getstatus}
  * - @function_name{taskpool_function_trycancel}
  * @function_brief{taskpool_function_trycancel}
+ * - @function_name{taskpool_function_getjobslabstatistics}
+ * @function_brief{taskpool_function_getjobslabstatistics}
  * - @function_name{taskpool_function_getjobstoragefromhandle}
  * @function_brief{taskpool_function_getjobstoragefromhandle}
  * - @function_name{taskpool_function_strerror}
@@ -119,6 +121,9 @@
  * @function_page{IotTaskPool_TryCancel,taskpool,trycancel}
  * @function_snippet{taskpool,trycancel,this}
  * @copydoc IotTaskPool_TryCancel
+ * @function_page{IotTaskPool_GetJobSlabStatistics,taskpool,getjobslabstatistics}
+ * @function_snippet{taskpool,getjobslabstatistics,this}
+ * @copydoc IotTaskPool_GetJobSlabStatistics
  * @function_page{IotTaskPool_GetJobStorageFromHandle,taskpool,getjobstoragefromhandle}
  * @function_snippet{taskpool,getjobstoragefromhandle,this}
  * @copydoc IotTaskPool_GetJobStorageFromHandle
@@ -377,7 +382,8 @@ IotTaskPoolError_t IotTaskPool_RecycleJob( IotTaskPool_t taskPool,
  * @param[in] taskPool A handle to the task pool that must have been previously initialized with.
  * a call to @ref IotTaskPool_Create.
  * @param[in] job A job to schedule for execution. This must be first initialized with a call to @ref IotTaskPool_CreateJob.
- * @param[in] flags Flags to be passed by the user, e.g. to identify the job as high priority by specifying #IOT_TASKPOOL_JOB_HIGH_PRIORITY.
+ * @param[in] flags Flags to be passed by the user, e.g. to identify the job as high priority by specifying #IOT_TASKPOOL_JOB_HIGH_PRIORITY,
+ * or as background work by specifying #IOT_TASKPOOL_JOB_LOW_PRIORITY.
  *
  * @return One of the following:
  * - #IOT_TASKPOOL_SUCCESS
@@ -512,6 +518,26 @@ IotTaskPoolError_t IotTaskPool_GetStatus( IotTaskPool_t taskPool,
                                           IotTaskPoolJobStatus_t * const pStatus );
 /* @[declare_taskpool_getstatus] */
 
+/**
+ * @brief This function retrieves the statistics of the job slab of a task pool.
+ *
+ * @param[in] taskPool A handle to the task pool that must have been previously initialized with
+ * a call to @ref IotTaskPool_Create or @ref IotTaskPool_CreateSystemTaskPool.
+ * @param[out] pStatistics The statistics of the job slab.
+ *
+ * @return One of the following:
+ * - #IOT_TASKPOOL_SUCCESS
+ * - #IOT_TASKPOOL_BAD_PARAMETER
+ * - #IOT_TASKPOOL_SHUTDOWN_IN_PROGRESS
+ *
+ * @note A growing @ref IotTaskPoolJobSlabStatistics_t.heapAllocations count means the slab is too small
+ * for the workload, see #IotTaskPoolInfo_t.jobSlabSize.
+ */
+/* @[declare_taskpool_getjobslabstatistics] */
+IotTaskPoolError_t IotTaskPool_GetJobSlabStatistics( IotTaskPool_t taskPool,
+                                                     IotTaskPoolJobSlabStatistics_t * const pStatistics );
+/* @[declare_taskpool_getjobslabstatistics] */
+
 /**
  * @brief This function tries to cancel a job that was previously scheduled with @ref IotTaskPool_Schedule.
  *
@@ -592,6 +618,22 @@ const char * IotTaskPool_strerror( IotTaskPoolError_t status );
     #define IOT_TASKPOOL_JOBS_RECYCLE_LIMIT    ( 8UL )
 #endif
 
+/**
+ * @brief The default number of recyclable jobs preallocated in the slab of a task pool.
+ *
+ * This is also the largest slab a task pool can have when using a memory pool.
+ */
+#ifndef IOT_TASKPOOL_JOB_SLAB_SIZE
+    #define IOT_TASKPOOL_JOB_SLAB_SIZE    ( 16UL )
+#endif
+
+/**
+ * @brief The alignment in bytes of the job slab of a task pool, the data cache line size.
+ */
+#ifndef IOT_TASKPOOL_JOB_SLAB_ALIGNMENT
+    #define IOT_TASKPOOL_JOB_SLAB_ALIGNMENT    ( 32UL )
+#endif
+
 /**
  * @brief The maximum timeout in milliseconds to wait for a job to be scheduled before waking up a worker thread.
  * A worker thread that wakes up as a result of a timeout may exit to allow the task pool to fold back to its
@@ -601,4 +643,35 @@ const char * IotTaskPool_strerror( IotTaskPoolError_t status );
     #define IOT_TASKPOOL_JOB_WAIT_TIMEOUT_MS    ( 60 * 1000UL )
 #endif
 
+/**
+ * @brief The number of work queues of a task pool.
+ *
+ * Jobs are spread across the work queues and each worker thread serves one of them first, stealing
+ * jobs from the others when its own is empty. More queues reduce lock contention between workers,
+ * at the cost of one mutex per queue.
+ */
+#ifndef IOT_TASKPOOL_WORKER_QUEUES
+    #define IOT_TASKPOOL_WORKER_QUEUES    ( 4UL )
+#endif
+
+/**
+ * @brief The resolution in milliseconds of the timer wheel for deferred jobs.
+ *
+ * A deferred job is dispatched on the first tick at or after its deadline.
+ */
+#ifndef IOT_TASKPOOL_TIMER_WHEEL_TICK_MS
+    #define IOT_TASKPOOL_TIMER_WHEEL_TICK_MS    ( 10UL )
+#endif
+
+/**
+ * @brief The number of levels of the timer wheel for deferred jobs.
+ *
+ * Each level has 32 slots and covers 32 times the range of the level below, so 4 levels cover
+ * about 2.9 hours with 10 ms ticks. Longer delays are still supported, at the cost of being placed
+ * again in the wheel once per range.
+ */
+#ifndef IOT_TASKPOOL_TIMER_WHEEL_LEVELS
+    #define IOT_TASKPOOL_TIMER_WHEEL_LEVELS    ( 4UL )
+#endif
+
 #endif /* ifndef IOT_TASKPOOL_H_ */
@@ -179,6 +179,18 @@
  */
     void IotTaskPool_FreeTimerEvent( void * ptr );
 
+/**
+ * @brief Allocate the job slab of a task pool. This function should have the
+ * same signature as [malloc].
+ */
+    void * IotTaskPool_MallocJobSlab( size_t size );
+
+/**
+ * @brief Free the job slab of a task pool. This function should have the
+ * same signature as[ free ].
+ */
+    void IotTaskPool_FreeJobSlab( void * ptr );
+
 #else /* if IOT_STATIC_MEMORY_ONLY == 1 */
     #include <stdlib.h>
 
@@ -206,6 +218,14 @@
         #define IotTaskPool_FreeTimerEvent    free
     #endif
 
+    #ifndef IotTaskPool_MallocJobSlab
+        #define IotTaskPool_MallocJobSlab    malloc
+    #endif
+
+    #ifndef IotTaskPool_FreeJobSlab
+        #define IotTaskPool_FreeJobSlab    free
+    #endif
+
 #endif /* if IOT_STATIC_MEMORY_ONLY == 1 */
 
 /* ---------------------------------------------------------------------------------------------- */
@@ -219,6 +239,30 @@
 #define IOT_TASK_POOL_INTERNAL_STATIC    ( ( uint32_t ) 0x00000001 )      /* Flag to mark a job as user-allocated. */
 /** @endcond */
 
+/**
+ * @brief Priority classes of the work queues, in the order workers serve them.
+ */
+#define TASKPOOL_PRIORITY_HIGH       ( 0U ) /**< @brief Jobs scheduled with #IOT_TASKPOOL_JOB_HIGH_PRIORITY. */
+#define TASKPOOL_PRIORITY_NORMAL     ( 1U ) /**< @brief Jobs scheduled without priority flags. */
+#define TASKPOOL_PRIORITY_LOW        ( 2U ) /**< @brief Jobs scheduled with #IOT_TASKPOOL_JOB_LOW_PRIORITY. */
+#define TASKPOOL_PRIORITY_CLASSES    ( 3U ) /**< @brief Number of priority classes. */
+
+/**
+ * @brief Geometry of a level of the timer wheel for deferred jobs.
+ */
+#define TASKPOOL_TIMER_WHEEL_SLOT_BITS    ( 5U )                                      /**< @brief Bits of the expiration tick indexing a level. */
+#define TASKPOOL_TIMER_WHEEL_SLOTS        ( 1UL << TASKPOOL_TIMER_WHEEL_SLOT_BITS )   /**< @brief Slots in a level, one bit each in the occupancy bitmap. */
+#define TASKPOOL_TIMER_WHEEL_SLOT_MASK    ( TASKPOOL_TIMER_WHEEL_SLOTS - 1UL )        /**< @brief Mask of the slot index in a level. */
+
+/**
+ * @brief Number of bytes to allocate for a job slab of `jobs` jobs: the jobs, the bitmap
+ * of the jobs in use, and room to align the jobs on #IOT_TASKPOOL_JOB_SLAB_ALIGNMENT.
+ */
+#define TASKPOOL_JOB_SLAB_BYTES( jobs )                                  \
+    ( ( ( jobs ) * sizeof( struct _taskPoolJob ) ) +                     \
+      ( ( ( ( jobs ) + 31UL ) / 32UL ) * sizeof( uint32_t ) ) +          \
+      IOT_TASKPOOL_JOB_SLAB_ALIGNMENT - 1UL )
+
 /**
  * @brief Task pool jobs cache.
  *
@@ -228,11 +272,59 @@
  */
 typedef struct _taskPoolCache
 {
-    IotListDouble_t freeList; /**< @brief A list ot hold cached jobs. */
-
-    uint32_t freeCount;       /**< @brief A counter to track the number of jobs in the cache. */
+    IotListDouble_t freeList;     /**< @brief A list ot hold cached jobs. */
+
+    uint32_t freeCount;           /**< @brief A counter to track the number of jobs in the cache. */
+
+    struct _taskPoolJob * pSlab;  /**< @brief The jobs preallocated for the task pool, aligned on a cache line. */
+    void * pSlabMemory;           /**< @brief The allocation holding the slab. */
+    uint32_t * pSlabInUse;        /**< @brief Bitmap of the slab jobs in use, one bit per job. */
+    uint32_t slabSize;            /**< @brief The number of jobs in the slab. */
+    volatile uint32_t slabInUse;  /**< @brief The number of slab jobs in use. */
+    uint32_t slabHighWatermark;   /**< @brief The highest number of slab jobs in use at once. */
+    uint32_t slabAllocations;     /**< @brief The number of jobs served from the slab. */
+    uint32_t heapAllocations;     /**< @brief The number of jobs allocated on the heap because the slab was full. */
 } _taskPoolCache_t;
 
+/**
+ * @brief A work queue of the task pool.
+ *
+ * Each worker thread is attached to one work queue and serves it first, then steals jobs from the
+ * other work queues of the task pool. Jobs are spread across the work queues by the scheduler, so that
+ * workers do not all contend on the same lock to pick up jobs.
+ *
+ * @warning This is a system-level data type that should not be modified or used directly in any application.
+ * @warning This is a system-level data type that can and will change across different versions of the platform, with no regards for backward compatibility.
+ *
+ */
+typedef struct _taskPoolWorkQueue
+{
+    IotDeQueue_t jobs[ TASKPOOL_PRIORITY_CLASSES ];          /**< @brief The jobs waiting to be executed, one queue per priority class. */
+    volatile uint32_t pendingJobs[ TASKPOOL_PRIORITY_CLASSES ]; /**< @brief The number of jobs in each queue, read without the lock as a hint. */
+    IotMutex_t lock;                                         /**< @brief The lock to protect the queues. */
+} _taskPoolWorkQueue_t;
+
+/**
+ * @brief The hierarchical timer wheel holding the deferred jobs of a task pool.
+ *
+ * Level 0 has one slot per tick. Each slot of level N covers a whole rotation of level N - 1, and its
+ * timer events move down to the lower levels when the wheel reaches the start of that slot.
+ * Delays longer than the range of the top level are parked in the top level and placed again every
+ * time they come up.
+ *
+ * @warning This is a system-level data type that should not be modified or used directly in any application.
+ * @warning This is a system-level data type that can and will change across different versions of the platform, with no regards for backward compatibility.
+ *
+ */
+typedef struct _taskPoolTimerWheel
+{
+    IotListDouble_t slots[ IOT_TASKPOOL_TIMER_WHEEL_LEVELS * TASKPOOL_TIMER_WHEEL_SLOTS ]; /**< @brief The timer events, per level and slot. */
+    uint32_t occupied[ IOT_TASKPOOL_TIMER_WHEEL_LEVELS ];                                 /**< @brief Bitmap of the slots holding timer events, per level. */
+    uint64_t currentTick;                                                                 /**< @brief The last tick processed by the wheel. */
+    uint64_t armedTick;                                                                   /**< @brief The tick the timer is armed for, 0 if the timer is not armed. */
+    uint32_t events;                                                                      /**< @brief The number of timer events in the wheel. */
+} _taskPoolTimerWheel_t;
+
 /**
  * @brief The task pool data structure keeps track of the internal state and the signals for the dispatcher threads.
  * The task pool is a thread safe data structure.
@@ -243,19 +335,23 @@ typedef struct _taskPoolCache
  */
 typedef struct _taskPool
 {
-    IotDeQueue_t dispatchQueue;      /**< @brief The queue for the jobs waiting to be executed. */
-    IotListDouble_t timerEventsList; /**< @brief The timeouts queue for all deferred jobs waiting to be executed. */
-    _taskPoolCache_t jobsCache;      /**< @brief A cache to re-use jobs in order to limit memory allocations. */
-    uint32_t minThreads;             /**< @brief The minimum number of threads for the task pool. */
-    uint32_t maxThreads;             /**< @brief The maximum number of threads for the task pool. */
-    uint32_t activeThreads;          /**< @brief The number of threads in the task pool at any given time. */
-    uint32_t activeJobs;             /**< @brief The number of active jobs in the task pool at any given time. */
-    uint32_t stackSize;              /**< @brief The stack size for all task pool threads. */
-    int32_t priority;                /**< @brief The priority for all task pool threads. */
-    IotSemaphore_t dispatchSignal;   /**< @brief The synchronization object on which threads are waiting for incoming jobs. */
-    IotSemaphore_t startStopSignal;  /**< @brief The synchronization object for threads to signal start and stop condition. */
-    IotTimer_t timer;                /**< @brief The timer for deferred jobs. */
-    IotMutex_t lock;                 /**< @brief The lock to protect the task pool data structure access. */
+    _taskPoolWorkQueue_t workQueues[ IOT_TASKPOOL_WORKER_QUEUES ]; /**< @brief The queues for the jobs waiting to be executed. */
+    _taskPoolTimerWheel_t timerWheel;                             /**< @brief The timer wheel for all deferred jobs waiting to be executed. */
+    _taskPoolCache_t jobsCache;                                   /**< @brief A cache to re-use jobs in order to limit memory allocations. */
+    uint32_t minThreads;                                          /**< @brief The minimum number of threads for the task pool. */
+    uint32_t maxThreads;                                          /**< @brief The maximum number of threads for the task pool. */
+    uint32_t activeThreads;                                       /**< @brief The number of threads in the task pool at any given time. */
+    volatile uint32_t activeJobs;                                 /**< @brief The number of active jobs in the task pool at any given time. */
+    volatile uint32_t idleThreads;                                /**< @brief The number of threads waiting on the dispatch signal. */
+    volatile uint32_t pendingWakeups;                             /**< @brief The number of posts to the dispatch signal not consumed yet. */
+    volatile uint32_t nextJobQueue;                               /**< @brief Round-robin counter to pick the work queue of a new job. */
+    volatile uint32_t nextWorkerQueue;                            /**< @brief Round-robin counter to attach a new worker to a work queue. */
+    uint32_t stackSize;                                           /**< @brief The stack size for all task pool threads. */
+    int32_t priority;                                             /**< @brief The priority for all task pool threads. */
+    IotSemaphore_t dispatchSignal;                                /**< @brief The synchronization object on which threads are waiting for incoming jobs. */
+    IotSemaphore_t startStopSignal;                               /**< @brief The synchronization object for threads to signal start and stop condition. */
+    IotTimer_t timer;                                             /**< @brief The timer for deferred jobs. */
+    IotMutex_t lock;                                              /**< @brief The lock to protect the task pool data structure access. */
 } _taskPool_t;
 
 /**
@@ -267,24 +363,28 @@ typedef struct _taskPool
  */
 typedef struct _taskPoolJob
 {
-    IotLink_t link;                    /**< @brief The link to insert the job in the dispatch queue. */
-    IotTaskPoolRoutine_t userCallback; /**< @brief The user provided callback. */
-    void * pUserContext;               /**< @brief The user provided context. */
-    uint32_t flags;                    /**< @brief Internal flags. */
-    IotTaskPoolJobStatus_t status;     /**< @brief The status for the job. */
+    IotLink_t link;                           /**< @brief The link to insert the job in the dispatch queue. */
+    IotTaskPoolRoutine_t userCallback;        /**< @brief The user provided callback. */
+    void * pUserContext;                      /**< @brief The user provided context. */
+    uint32_t flags;                           /**< @brief Internal flags. */
+    IotTaskPoolJobStatus_t status;            /**< @brief The status for the job. */
+    _taskPoolWorkQueue_t * pQueue;            /**< @brief The work queue holding the job while it is scheduled. */
+    uint32_t priorityClass;                   /**< @brief The priority class the job was scheduled with. */
+    struct _taskPoolTimerEvent * pTimerEvent; /**< @brief The timer event of the job while it is deferred. */
 } _taskPoolJob_t;
 
 /**
  * @brief Represents an operation that is subject to a timer.
  *
- * These events are queued per MQTT connection. They are sorted by their
- * expiration time.
+ * These events are placed in the timer wheel of the task pool, in the slot
+ * of their expiration tick.
  */
 typedef struct _taskPoolTimerEvent
 {
     IotLink_t link;          /**< @brief List link member. */
-    uint64_t expirationTime; /**< @brief When this event should be processed. */
+    uint64_t expirationTick; /**< @brief The timer wheel tick when this event should be processed. */
     _taskPoolJob_t * pJob;   /**< @brief The task pool job associated with this event. */
+    uint32_t slot;           /**< @brief The timer wheel slot holding this event. */
 } _taskPoolTimerEvent_t;
 
 #endif /* ifndef IOT_TASKPOOL_INTERNAL_H_ */
@@ -231,6 +231,9 @@ typedef struct IotTaskPoolJobStorage
     void * dummy3;                 /**< @brief Placeholder. */
     uint32_t dummy4;               /**< @brief Placeholder. */
     IotTaskPoolJobStatus_t status; /**< @brief Placeholder. */
+    void * dummy5;                 /**< @brief Placeholder. */
+    uint32_t dummy6;               /**< @brief Placeholder. */
+    void * dummy7;                 /**< @brief Placeholder. */
 } IotTaskPoolJobStorage_t;
 
 /**
@@ -285,12 +288,28 @@ typedef struct IotTaskPoolInfo
      * number of worker threads at run time.
      */
 
-    uint32_t minThreads; /**< @brief Minimum number of threads in a task pool. These threads will be created when the task pool is first created with @ref taskpool_function_create. */
-    uint32_t maxThreads; /**< @brief Maximum number of threads in a task pool. A task pool may try and grow the number of active threads up to #IotTaskPoolInfo_t.maxThreads. */
-    uint32_t stackSize;  /**< @brief Stack size for every task pool thread. The stack size for each thread is fixed after the task pool is created and cannot be changed. */
-    int32_t priority;    /**< @brief priority for every task pool thread. The priority for each thread is fixed after the task pool is created and cannot be changed. */
+    uint32_t minThreads;  /**< @brief Minimum number of threads in a task pool. These threads will be created when the task pool is first created with @ref taskpool_function_create. */
+    uint32_t maxThreads;  /**< @brief Maximum number of threads in a task pool. A task pool may try and grow the number of active threads up to #IotTaskPoolInfo_t.maxThreads. */
+    uint32_t stackSize;   /**< @brief Stack size for every task pool thread. The stack size for each thread is fixed after the task pool is created and cannot be changed. */
+    int32_t priority;     /**< @brief priority for every task pool thread. The priority for each thread is fixed after the task pool is created and cannot be changed. */
+    uint32_t jobSlabSize; /**< @brief Number of recyclable jobs preallocated when the task pool is created, or 0 for #IOT_TASKPOOL_JOB_SLAB_SIZE. Recyclable jobs are allocated on the heap only when the slab is exhausted. */
 } IotTaskPoolInfo_t;
 
+/**
+ * @ingroup taskpool_datatypes_paramstructs
+ * @brief Statistics of the job slab of a task pool.
+ *
+ * Filled by @ref taskpool_function_getjobslabstatistics.
+ */
+typedef struct IotTaskPoolJobSlabStatistics
+{
+    uint32_t capacity;        /**< @brief Number of jobs in the slab. */
+    uint32_t inUse;           /**< @brief Number of slab jobs currently in use. */
+    uint32_t highWatermark;   /**< @brief Highest number of slab jobs in use at once. */
+    uint32_t allocations;     /**< @brief Number of recyclable jobs served from the slab. */
+    uint32_t heapAllocations; /**< @brief Number of recyclable jobs allocated on the heap because the slab was full. */
+} IotTaskPoolJobSlabStatistics_t;
+
 /*------------------------- TASKPOOL defined constants --------------------------*/
 
 /**
@@ -339,7 +358,7 @@ typedef struct IotTaskPoolInfo
 /** @brief Initializer for a #IotTaskPool_t. */
 #define IOT_TASKPOOL_INITIALIZER                NULL
 /** @brief Initializer for a #IotTaskPoolJobStorage_t. */
-#define IOT_TASKPOOL_JOB_STORAGE_INITIALIZER    { { NULL, NULL }, NULL, NULL, 0, IOT_TASKPOOL_STATUS_UNDEFINED }
+#define IOT_TASKPOOL_JOB_STORAGE_INITIALIZER    { { NULL, NULL }, NULL, NULL, 0, IOT_TASKPOOL_STATUS_UNDEFINED, NULL, 0, NULL }
 /** @brief Initializer for a #IotTaskPoolJob_t. */
 #define IOT_TASKPOOL_JOB_INITIALIZER            NULL
 /* @[define_taskpool_initializers] */
@@ -353,6 +372,13 @@ typedef struct IotTaskPoolInfo
  */
 #define IOT_TASKPOOL_JOB_HIGH_PRIORITY    ( ( uint32_t ) 0x00000001 )
 
+/**
+ * @brief Flag for scheduling a background job, executed only when no job without this flag is waiting.
+ *
+ * This flag cannot be combined with #IOT_TASKPOOL_JOB_HIGH_PRIORITY.
+ */
+#define IOT_TASKPOOL_JOB_LOW_PRIORITY     ( ( uint32_t ) 0x00000002 )
+
 /**
  * @brief Allows the use of the handle to the system task pool.
  *
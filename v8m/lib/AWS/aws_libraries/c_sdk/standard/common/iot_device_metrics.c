@@ -38,8 +38,7 @@
 #include "iot_config.h"
 
 #include "platform/iot_clock.h"
-#include "bootstrap/mbed_critical.h"
-#include "bootstrap/mbed_atomic.h"
+#include "lockfree.h"
 
 /*
  * @brief Total length of the hash in bytes.
@@ -127,14 +126,9 @@ static void _generateDeviceMetrics( const char * pDeviceIdentifier,
                                     size_t deviceMetricsLength );
 
 /*
- * @brief Spinlock lock implementation using atomic compare and swap.
+ * @brief Lets the holder of a lock run while waiting for it.
  */
-static void _atomicSpinlock_lock( uint32_t * lock );
-
-/*
- * @brief Spinlock unlock implementation using atomic compare and swap.
- */
-static void _atomicSpinlock_unlock( uint32_t * lock );
+static void _lockWait( void );
 
 /**
  * @brief Metrics for the device.
@@ -315,38 +309,10 @@ static void _generateDeviceMetrics( const char * pDeviceIdentifier,
     configASSERT( length > 0 );
 }
 
-static void _atomicSpinlock_lock( uint32_t * lock )
-{
-    uint32_t store = 1;
-
-    for( ; ; )
-    {
-        uint32_t current = 0;
-        if( core_util_atomic_cas_u32( lock, &current, store ) == 1 )
-        {
-            break;
-        }
-
-        /* Does context switch with negligible delay. */
-        IotClock_SleepMs( 1 );
-    }
-}
-
-static void _atomicSpinlock_unlock( uint32_t * lock )
+static void _lockWait( void )
 {
-    uint32_t store = 0;
-
-    for( ; ; )
-    {
-        uint32_t current = 1;
-        if( core_util_atomic_cas_u32( lock, &current, store ) == 1 )
-        {
-            break;
-        }
-
-        /* Does context switch with negligible delay. */
-        IotClock_SleepMs( 1 );
-    }
+    /* Does context switch with negligible delay. */
+    IotClock_SleepMs( 1 );
 }
 
 static void _generateUniqueIdentifier( const char * pInput,
@@ -375,11 +341,11 @@ static void _generateUniqueIdentifier( const char * pInput,
 const char * getDeviceIdentifier( void )
 {
     const char * pCertificate = IOT_DEVICE_CERTIFICATE;
-    static uint32_t lock = 0;
+    static lockfree_ticket_lock_t lock = LOCKFREE_TICKET_LOCK_INIT;
 
     if( deviceIdentifier[ 0 ] == '\0' )
     {
-        _atomicSpinlock_lock( &lock );
+        lockfree_ticket_lock_acquire( &lock, _lockWait );
 
         if( deviceIdentifier[ 0 ] == '\0' )
         {
@@ -394,7 +360,7 @@ const char * getDeviceIdentifier( void )
             }
         }
 
-        _atomicSpinlock_unlock( &lock );
+        lockfree_ticket_lock_release( &lock );
     }
 
     return deviceIdentifier;
@@ -406,11 +372,11 @@ const char * getDeviceIdentifier( void )
 const char * getDeviceMetrics( void )
 {
     const char * pDeviceIdentifier = NULL;
-    static uint32_t lock = 0;
+    static lockfree_ticket_lock_t lock = LOCKFREE_TICKET_LOCK_INIT;
 
     if( deviceMetrics[ 0 ] == '\0' )
     {
-        _atomicSpinlock_lock( &lock );
+        lockfree_ticket_lock_acquire( &lock, _lockWait );
 
         if( deviceMetrics[ 0 ] == '\0' )
         {
@@ -418,7 +384,7 @@ const char * getDeviceMetrics( void )
             _generateDeviceMetrics( pDeviceIdentifier, strlen( pDeviceIdentifier ), deviceMetrics, sizeof( deviceMetrics ) );
         }
 
-        _atomicSpinlock_unlock( &lock );
+        lockfree_ticket_lock_release( &lock );
     }
 
     return deviceMetrics;
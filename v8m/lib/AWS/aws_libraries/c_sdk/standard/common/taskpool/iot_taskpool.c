@@ -41,6 +41,9 @@
 #include "platform/iot_threads.h"
 #include "platform/iot_clock.h"
 
+/* Atomic operations include. */
+#include "iot_atomic.h"
+
 /* Task pool internal include. */
 #include "private/iot_taskpool_internal.h"
 
@@ -59,12 +62,7 @@
 /**
  * @brief Maximum semaphore value for wait operations.
  */
-#define TASKPOOL_MAX_SEM_VALUE              0xFFFF
-
-/**
- * @brief Reschedule delay in milliseconds for deferred jobs.
- */
-#define TASKPOOL_JOB_RESCHEDULE_DELAY_MS    ( 10ULL )
+#define TASKPOOL_MAX_SEM_VALUE    0xFFFF
 
 /* ---------------------------------------------------------------------------------- */
 
@@ -76,16 +74,27 @@
  * the system libraries as well. The system task pool needs to be initialized before any library is used or
  * before any code that posts jobs to the task pool runs.
  */
-_taskPool_t _IotSystemTaskPool = { .dispatchQueue = IOT_DEQUEUE_INITIALIZER };
+_taskPool_t _IotSystemTaskPool = { .minThreads = 0 };
 
 /* -------------- Convenience functions to create/recycle/destroy jobs -------------- */
 
 /**
- * @brief Initializes one instance of a Task pool cache.
+ * @brief Initializes one instance of a Task pool cache and allocates its job slab.
  *
  * @param[in] pCache The pre-allocated instance of the cache to initialize.
+ * @param[in] slabSize The number of jobs in the slab, or 0 for #IOT_TASKPOOL_JOB_SLAB_SIZE.
+ *
+ * @return #IOT_TASKPOOL_SUCCESS or #IOT_TASKPOOL_NO_MEMORY.
  */
-static void _initJobsCache( _taskPoolCache_t * const pCache );
+static IotTaskPoolError_t _initJobsCache( _taskPoolCache_t * const pCache,
+                                          uint32_t slabSize );
+
+/**
+ * @brief Frees the job slab of a Task pool cache.
+ *
+ * @param[in] pCache The instance of the cache to release the slab of.
+ */
+static void _destroyJobsCache( _taskPoolCache_t * const pCache );
 
 /**
  * @brief Initialize a job.
@@ -101,7 +110,27 @@ static void _initializeJob( _taskPoolJob_t * const pJob,
                             bool isStatic );
 
 /**
- * @brief Extracts and initializes one instance of a job from the cache or, if there is none available, it allocates and initializes a new one.
+ * @brief Takes one free job from the slab of a cache.
+ *
+ * @param[in] pCache The instance of the cache to take the job from.
+ *
+ * @return The job, or `NULL` if all slab jobs are in use.
+ */
+static _taskPoolJob_t * _allocateSlabJob( _taskPoolCache_t * const pCache );
+
+/**
+ * @brief Returns a job to the slab of a cache, if the job belongs to the slab.
+ *
+ * @param[in] pCache The instance of the cache the job was taken from.
+ * @param[in] pJob The job to return.
+ *
+ * @return `true` if the job belonged to the slab; `false` otherwise.
+ */
+static bool _releaseSlabJob( _taskPoolCache_t * const pCache,
+                             _taskPoolJob_t * const pJob );
+
+/**
+ * @brief Extracts and initializes one instance of a job from the slab or the cache or, if there is none available, it allocates and initializes a new one.
  *
  * @param[in] pCache The instance of the cache to extract the job from.
  */
@@ -120,10 +149,12 @@ static void _recycleJob( _taskPoolCache_t * const pCache,
 /**
  * Destroys one instance of a job.
  *
+ * @param[in] pCache The instance of the cache the job was fetched from.
  * @param[in] pJob The job to destroy.
  *
  */
-static void _destroyJob( _taskPoolJob_t * const pJob );
+static void _destroyJob( _taskPoolCache_t * const pCache,
+                         _taskPoolJob_t * const pJob );
 
 /* -------------- The worker thread procedure for a task pool thread -------------- */
 
@@ -135,25 +166,99 @@ static void _destroyJob( _taskPoolJob_t * const pJob );
  */
 static void _taskPoolWorker( void * pUserContext );
 
+/* -------------- Convenience functions to handle the work queues -------------- */
+
+/**
+ * Places a scheduled job in one of the work queues of a task pool.
+ *
+ * @param[in] pTaskPool The task pool to queue the job with.
+ * @param[in] pJob The job to queue.
+ * @param[in] priorityClass The priority class of the job.
+ *
+ */
+static void _enqueueJob( _taskPool_t * const pTaskPool,
+                         _taskPoolJob_t * const pJob,
+                         uint32_t priorityClass );
+
+/**
+ * Extracts the next job to execute, from the work queue of a worker first and then from the other work queues.
+ *
+ * @param[in] pTaskPool The task pool to extract the job from.
+ * @param[in] homeQueue The index of the work queue of the worker.
+ * @param[out] pUserCallback The callback of the extracted job.
+ *
+ * @return The extracted job, marked as 'completed', or NULL if all work queues are empty.
+ */
+static _taskPoolJob_t * _dequeueJob( _taskPool_t * const pTaskPool,
+                                     uint32_t homeQueue,
+                                     IotTaskPoolRoutine_t * const pUserCallback );
+
+/**
+ * Checks whether any work queue of a task pool holds a job, without locking the work queues.
+ *
+ * @param[in] pTaskPool The task pool to check.
+ *
+ */
+static bool _hasPendingJobs( const _taskPool_t * const pTaskPool );
+
+/**
+ * Wakes up one sleeping worker, unless all sleeping workers are being woken up already.
+ *
+ * @param[in] pTaskPool The task pool to wake up a worker for.
+ *
+ */
+static void _wakeWorker( _taskPool_t * const pTaskPool );
+
+/**
+ * Posts the dispatch signal and accounts for the post, so that it is not mistaken for an idle worker.
+ *
+ * @param[in] pTaskPool The task pool to post the dispatch signal of.
+ *
+ */
+static void _postDispatchSignal( _taskPool_t * const pTaskPool );
+
 /* -------------- Convenience functions to handle timer events  -------------- */
 
 /**
- * Comparer for the time list.
+ * Initializes an empty timer wheel.
+ *
+ * param[in] pWheel The timer wheel to initialize.
+ */
+static void _initTimerWheel( _taskPoolTimerWheel_t * const pWheel );
+
+/**
+ * Places a timer event in the slot of its expiration tick.
+ *
+ * param[in] pWheel The timer wheel to place the timer event in.
+ * param[in] pTimerEvent The timer event to place.
+ * param[in] baseTick The tick the placement is relative to, at or before the expiration tick.
+ */
+static void _insertTimerEvent( _taskPoolTimerWheel_t * const pWheel,
+                               _taskPoolTimerEvent_t * const pTimerEvent,
+                               uint64_t baseTick );
+
+/**
+ * Removes a timer event from the timer wheel.
+ *
+ * param[in] pWheel The timer wheel holding the timer event.
+ * param[in] pTimerEvent The timer event to remove.
+ */
+static void _removeTimerEvent( _taskPoolTimerWheel_t * const pWheel,
+                               _taskPoolTimerEvent_t * const pTimerEvent );
+
+/**
+ * Computes the next tick at which the timer wheel has timer events to expire or to move down a level.
  *
- * param[in] pTimerEventLink1 The link to the first timer event.
- * param[in] pTimerEventLink1 The link to the first timer event.
+ * param[in] pWheel The timer wheel to inspect. It must hold at least one timer event.
  */
-static int32_t _timerEventCompare( const IotLink_t * const pTimerEventLink1,
-                                   const IotLink_t * const pTimerEventLink2 );
+static uint64_t _nextTimerWheelTick( const _taskPoolTimerWheel_t * const pWheel );
 
 /**
- * Reschedules the timer for handling deferred jobs to the next timeout.
+ * Arms the timer of a task pool for the next tick of its timer wheel, if it is not armed for it already.
  *
- * param[in] pTimer The timer to reschedule.
- * param[in] pFirstTimerEvent The timer event that carries the timeout and job information.
+ * param[in] pTaskPool The task pool owning the timer wheel.
  */
-static void _rescheduleDeferredJobsTimer( IotTimer_t * const pTimer,
-                                          _taskPoolTimerEvent_t * const pFirstTimerEvent );
+static void _armTimerWheel( _taskPool_t * const pTaskPool );
 
 /**
  * The task pool timer procedure for scheduling deferred jobs.
@@ -230,16 +335,6 @@ static IotTaskPoolError_t _scheduleInternal( _taskPool_t * const pTaskPool,
                                              _taskPoolJob_t * const pJob,
                                              uint32_t flags );
 
-/**
- * Matches a deferred job in the timer queue with its timer event wrapper.
- *
- * @param[in] pLink A pointer to the timer event link in the timer queue.
- * @param[in] pMatch A pointer to the job to match.
- *
- */
-static bool _matchJobByPointer( const IotLink_t * const pLink,
-                                void * pMatch );
-
 /**
  * Tries to cancel a job.
  *
@@ -364,50 +459,57 @@ IotTaskPoolError_t IotTaskPool_Destroy( IotTaskPool_t taskPoolHandle )
          * all task pool data structures and release the associated memory.
          */
 
-        /* (1) Clear the job queue. */
-        do
+        /* (1) Clear the job queues. */
+        for( count = 0; count < IOT_TASKPOOL_WORKER_QUEUES * TASKPOOL_PRIORITY_CLASSES; ++count )
         {
-            pItemLink = NULL;
+            _taskPoolWorkQueue_t * pQueue = &pTaskPool->workQueues[ count / TASKPOOL_PRIORITY_CLASSES ];
+            uint32_t priorityClass = count % TASKPOOL_PRIORITY_CLASSES;
 
-            pItemLink = IotDeQueue_DequeueHead( &pTaskPool->dispatchQueue );
+            IotMutex_Lock( &pQueue->lock );
 
-            if( pItemLink != NULL )
+            do
             {
-                _taskPoolJob_t * pJob = IotLink_Container( _taskPoolJob_t, pItemLink, link );
+                pItemLink = NULL;
 
-                _destroyJob( pJob );
-            }
-        } while( pItemLink );
+                pItemLink = IotDeQueue_DequeueHead( &pQueue->jobs[ priorityClass ] );
+
+                if( pItemLink != NULL )
+                {
+                    _taskPoolJob_t * pJob = IotLink_Container( _taskPoolJob_t, pItemLink, link );
+
+                    pQueue->pendingJobs[ priorityClass ]--;
 
-        /* (2) Clear the timer queue. */
+                    _destroyJob( &pTaskPool->jobsCache, pJob );
+                }
+            } while( pItemLink );
+
+            IotMutex_Unlock( &pQueue->lock );
+        }
+
+        /* (2) Clear the timer wheel. */
         {
+            _taskPoolTimerWheel_t * pWheel = &pTaskPool->timerWheel;
             _taskPoolTimerEvent_t * pTimerEvent;
 
             /* A deferred job may have fired already. Since deferred jobs will go through the same mutex
              * the shutdown sequence is holding at this stage, there is no risk for race conditions. Yet, we
              * need to let the deferred job to destroy the task pool. */
-
-            pItemLink = IotListDouble_PeekHead( &pTaskPool->timerEventsList );
-
-            if( pItemLink != NULL )
+            if( ( pWheel->armedTick != 0ULL ) &&
+                ( ( pWheel->armedTick * IOT_TASKPOOL_TIMER_WHEEL_TICK_MS ) <= IotClock_GetTimeMs() ) )
             {
-                uint64_t now = IotClock_GetTimeMs();
+                IotLogDebug( "Shutdown will be deferred to the timer thread" );
 
-                pTimerEvent = IotLink_Container( _taskPoolTimerEvent_t, pItemLink, link );
-
-                if( pTimerEvent->expirationTime <= now )
-                {
-                    IotLogDebug( "Shutdown will be deferred to the timer thread" );
-
-                    /* Timer may have fired already! Let the timer thread destroy
-                     * complete the taskpool destruction sequence. */
-                    completeShutdown = false;
-                }
+                /* Timer may have fired already! Let the timer thread destroy
+                 * complete the taskpool destruction sequence. */
+                completeShutdown = false;
+            }
 
-                /* Remove all timers from the timeout list. */
+            /* Remove all timers from the timer wheel. */
+            for( count = 0; count < IOT_TASKPOOL_TIMER_WHEEL_LEVELS * TASKPOOL_TIMER_WHEEL_SLOTS; ++count )
+            {
                 for( ; ; )
                 {
-                    pItemLink = IotListDouble_RemoveHead( &pTaskPool->timerEventsList );
+                    pItemLink = IotListDouble_RemoveHead( &pWheel->slots[ count ] );
 
                     if( pItemLink == NULL )
                     {
@@ -416,11 +518,13 @@ IotTaskPoolError_t IotTaskPool_Destroy( IotTaskPool_t taskPoolHandle )
 
                     pTimerEvent = IotLink_Container( _taskPoolTimerEvent_t, pItemLink, link );
 
-                    _destroyJob( pTimerEvent->pJob );
+                    _destroyJob( &pTaskPool->jobsCache, pTimerEvent->pJob );
 
                     IotTaskPool_FreeTimerEvent( pTimerEvent );
                 }
             }
+
+            _initTimerWheel( pWheel );
         }
 
         /* (3) Clear the job cache. */
@@ -434,7 +538,7 @@ IotTaskPoolError_t IotTaskPool_Destroy( IotTaskPool_t taskPoolHandle )
             {
                 _taskPoolJob_t * pJob = IotLink_Container( _taskPoolJob_t, pItemLink, link );
 
-                _destroyJob( pJob );
+                _destroyJob( &pTaskPool->jobsCache, pJob );
             }
         } while( pItemLink );
 
@@ -511,7 +615,7 @@ IotTaskPoolError_t IotTaskPool_SetMaxThreads( IotTaskPool_t taskPoolHandle,
 
             while( i > 0UL )
             {
-                IotSemaphore_Post( &pTaskPool->dispatchSignal );
+                _postDispatchSignal( pTaskPool );
 
                 --i;
             }
@@ -636,7 +740,7 @@ IotTaskPoolError_t IotTaskPool_DestroyRecyclableJob( IotTaskPool_t taskPoolHandl
         /* At this point, the job must not be in any queue or list. */
         IotTaskPool_Assert( IotLink_IsLinked( &pJob1->link ) == false );
 
-        _destroyJob( pJob1 );
+        _destroyJob( &pTaskPool->jobsCache, pJob1 );
     }
 
     TASKPOOL_NO_FUNCTION_CLEANUP();
@@ -701,7 +805,9 @@ IotTaskPoolError_t IotTaskPool_Schedule( IotTaskPool_t taskPoolHandle,
     /* Parameter checking. */
     TASKPOOL_ON_NULL_ARG_GOTO_CLEANUP( taskPoolHandle );
     TASKPOOL_ON_NULL_ARG_GOTO_CLEANUP( pJob );
-    TASKPOOL_ON_ARG_ERROR_GOTO_CLEANUP( ( flags != 0UL ) && ( flags != IOT_TASKPOOL_JOB_HIGH_PRIORITY ) );
+    TASKPOOL_ON_ARG_ERROR_GOTO_CLEANUP( ( flags != 0UL ) &&
+                                        ( flags != IOT_TASKPOOL_JOB_HIGH_PRIORITY ) &&
+                                        ( flags != IOT_TASKPOOL_JOB_LOW_PRIORITY ) );
 
     pTaskPool = ( _taskPool_t * ) taskPoolHandle;
 
@@ -761,7 +867,7 @@ IotTaskPoolError_t IotTaskPool_ScheduleDeferred( IotTaskPool_t taskPoolHandle,
         /* If all safety checks completed, proceed. */
         if( TASKPOOL_SUCCEEDED( _trySafeExtraction( pTaskPool, pJob, false ) ) )
         {
-            IotLink_t * pTimerEventLink;
+            _taskPoolTimerWheel_t * pWheel = &pTaskPool->timerWheel;
             uint64_t now;
 
             _taskPoolTimerEvent_t * pTimerEvent = ( _taskPoolTimerEvent_t * ) IotTaskPool_MallocTimerEvent( sizeof( _taskPoolTimerEvent_t ) );
@@ -777,30 +883,26 @@ IotTaskPoolError_t IotTaskPool_ScheduleDeferred( IotTaskPool_t taskPoolHandle,
 
             now = IotClock_GetTimeMs();
 
+            /* An idle timer wheel restarts from the current time, so that it does not need to catch up. */
+            if( pWheel->events == 0UL )
+            {
+                pWheel->currentTick = now / IOT_TASKPOOL_TIMER_WHEEL_TICK_MS;
+            }
+
             pTimerEvent->link.pNext = NULL;
             pTimerEvent->link.pPrevious = NULL;
-            pTimerEvent->expirationTime = now + timeMs;
+            pTimerEvent->expirationTick = ( now + timeMs + IOT_TASKPOOL_TIMER_WHEEL_TICK_MS - 1ULL ) / IOT_TASKPOOL_TIMER_WHEEL_TICK_MS;
             pTimerEvent->pJob = ( _taskPoolJob_t * ) pJob;
 
-            /* Append the timer event to the timer list. */
-            IotListDouble_InsertSorted( &pTaskPool->timerEventsList, &pTimerEvent->link, _timerEventCompare );
+            /* Place the timer event in the timer wheel. */
+            _insertTimerEvent( pWheel, pTimerEvent, pWheel->currentTick );
 
             /* Update the job status to 'scheduled'. */
             pJob->status = IOT_TASKPOOL_STATUS_DEFERRED;
+            pJob->pTimerEvent = pTimerEvent;
 
-            /* Peek the first event in the timer event list. There must be at least one,
-             * since we just inserted it. */
-            pTimerEventLink = IotListDouble_PeekHead( &pTaskPool->timerEventsList );
-            IotTaskPool_Assert( pTimerEventLink != NULL );
-
-            /* If the event we inserted is at the front of the queue, then
-             * we need to reschedule the underlying timer. */
-            if( pTimerEventLink == &pTimerEvent->link )
-            {
-                pTimerEvent = IotLink_Container( _taskPoolTimerEvent_t, pTimerEventLink, link );
-
-                _rescheduleDeferredJobsTimer( &pTaskPool->timer, pTimerEvent );
-            }
+            /* Re-arm the underlying timer if the new event is due before the next tick it is armed for. */
+            _armTimerWheel( pTaskPool );
         }
         else
         {
@@ -851,6 +953,41 @@ IotTaskPoolError_t IotTaskPool_GetStatus( IotTaskPool_t taskPoolHandle,
 
 /*-----------------------------------------------------------*/
 
+IotTaskPoolError_t IotTaskPool_GetJobSlabStatistics( IotTaskPool_t taskPoolHandle,
+                                                     IotTaskPoolJobSlabStatistics_t * const pStatistics )
+{
+    TASKPOOL_FUNCTION_ENTRY( IOT_TASKPOOL_SUCCESS );
+    _taskPool_t * pTaskPool = NULL;
+
+    /* Parameter checking. */
+    TASKPOOL_ON_NULL_ARG_GOTO_CLEANUP( taskPoolHandle );
+    TASKPOOL_ON_NULL_ARG_GOTO_CLEANUP( pStatistics );
+
+    pTaskPool = ( _taskPool_t * ) taskPoolHandle;
+
+    TASKPOOL_ENTER_CRITICAL();
+    {
+        /* Bail out early if this task pool is shutting down. */
+        if( _IsShutdownStarted( pTaskPool ) )
+        {
+            TASKPOOL_EXIT_CRITICAL();
+
+            TASKPOOL_SET_AND_GOTO_CLEANUP( IOT_TASKPOOL_SHUTDOWN_IN_PROGRESS );
+        }
+
+        pStatistics->capacity = pTaskPool->jobsCache.slabSize;
+        pStatistics->inUse = pTaskPool->jobsCache.slabInUse;
+        pStatistics->highWatermark = pTaskPool->jobsCache.slabHighWatermark;
+        pStatistics->allocations = pTaskPool->jobsCache.slabAllocations;
+        pStatistics->heapAllocations = pTaskPool->jobsCache.heapAllocations;
+    }
+    TASKPOOL_EXIT_CRITICAL();
+
+    TASKPOOL_NO_FUNCTION_CLEANUP();
+}
+
+/*-----------------------------------------------------------*/
+
 IotTaskPoolError_t IotTaskPool_TryCancel( IotTaskPool_t taskPoolHandle,
                                           IotTaskPoolJob_t pJob,
                                           IotTaskPoolJobStatus_t * const pStatus )
@@ -951,10 +1088,13 @@ static IotTaskPoolError_t _initTaskPoolControlStructures( const IotTaskPoolInfo_
 {
     TASKPOOL_FUNCTION_ENTRY( IOT_TASKPOOL_SUCCESS );
 
+    uint32_t count;
+    uint32_t queueLocksInit = 0;
     bool semStartStopInit = false;
     bool lockInit = false;
     bool semDispatchInit = false;
     bool timerInit = false;
+    bool cacheInit = false;
 
     /* Zero out all data structures. */
     memset( ( void * ) pTaskPool, 0x00, sizeof( _taskPool_t ) );
@@ -962,15 +1102,31 @@ static IotTaskPoolError_t _initTaskPoolControlStructures( const IotTaskPoolInfo_
     /* Initialize a job data structures that require no de-initialization.
      * All other data structures carry a value of 'NULL' before initialization.
      */
-    IotDeQueue_Create( &pTaskPool->dispatchQueue );
-    IotListDouble_Create( &pTaskPool->timerEventsList );
+    for( count = 0; count < IOT_TASKPOOL_WORKER_QUEUES * TASKPOOL_PRIORITY_CLASSES; ++count )
+    {
+        IotDeQueue_Create( &pTaskPool->workQueues[ count / TASKPOOL_PRIORITY_CLASSES ].jobs[ count % TASKPOOL_PRIORITY_CLASSES ] );
+    }
+
+    _initTimerWheel( &pTaskPool->timerWheel );
 
     pTaskPool->minThreads = pInfo->minThreads;
     pTaskPool->maxThreads = pInfo->maxThreads;
     pTaskPool->stackSize = pInfo->stackSize;
     pTaskPool->priority = pInfo->priority;
 
-    _initJobsCache( &pTaskPool->jobsCache );
+    /* Preallocate the job slab. */
+    TASKPOOL_ON_ERROR_GOTO_CLEANUP( _initJobsCache( &pTaskPool->jobsCache, pInfo->jobSlabSize ) );
+
+    cacheInit = true;
+
+    /* Initialize the locks of the work queues. */
+    for( ; queueLocksInit < IOT_TASKPOOL_WORKER_QUEUES; ++queueLocksInit )
+    {
+        if( IotMutex_Create( &pTaskPool->workQueues[ queueLocksInit ].lock, false ) == false )
+        {
+            TASKPOOL_SET_AND_GOTO_CLEANUP( IOT_TASKPOOL_NO_MEMORY );
+        }
+    }
 
     /* Initialize the semaphore to ensure all threads have started. */
     if( IotSemaphore_Create( &pTaskPool->startStopSignal, 0, TASKPOOL_MAX_SEM_VALUE ) == true )
@@ -1034,6 +1190,16 @@ static IotTaskPoolError_t _initTaskPoolControlStructures( const IotTaskPoolInfo_
         {
             IotClock_TimerDestroy( &pTaskPool->timer );
         }
+
+        for( count = 0; count < queueLocksInit; ++count )
+        {
+            IotMutex_Destroy( &pTaskPool->workQueues[ count ].lock );
+        }
+
+        if( cacheInit == true )
+        {
+            _destroyJobsCache( &pTaskPool->jobsCache );
+        }
     }
 
     TASKPOOL_FUNCTION_CLEANUP_END();
@@ -1115,10 +1281,19 @@ static IotTaskPoolError_t _createTaskPool( const IotTaskPoolInfo_t * const pInfo
 
 static void _destroyTaskPool( _taskPool_t * const pTaskPool )
 {
+    uint32_t count;
+
     IotClock_TimerDestroy( &pTaskPool->timer );
     IotSemaphore_Destroy( &pTaskPool->dispatchSignal );
     IotSemaphore_Destroy( &pTaskPool->startStopSignal );
     IotMutex_Destroy( &pTaskPool->lock );
+
+    for( count = 0; count < IOT_TASKPOOL_WORKER_QUEUES; ++count )
+    {
+        IotMutex_Destroy( &pTaskPool->workQueues[ count ].lock );
+    }
+
+    _destroyJobsCache( &pTaskPool->jobsCache );
 }
 
 /* ---------------------------------------------------------------------------------------------- */
@@ -1133,6 +1308,9 @@ static void _taskPoolWorker( void * pUserContext )
     /* Extract pTaskPool pointer from context. */
     _taskPool_t * pTaskPool = ( _taskPool_t * ) pUserContext;
 
+    /* Attach this worker to a work queue. Workers are spread evenly across the work queues. */
+    uint32_t homeQueue = Atomic_Increment_u32( &pTaskPool->nextWorkerQueue ) % IOT_TASKPOOL_WORKER_QUEUES;
+
     /* Signal that this worker completed initialization and it is ready to receive notifications. */
     IotSemaphore_Post( &pTaskPool->startStopSignal );
 
@@ -1142,14 +1320,29 @@ static void _taskPoolWorker( void * pUserContext )
      */
     do
     {
-        bool jobAvailable;
-        IotLink_t * pFirst;
+        bool jobAvailable = true;
         _taskPoolJob_t * pJob = NULL;
 
+        /* Announce that this worker is going to sleep before checking the work queues one last time.
+         * A job queued before the announcement is found by the check, and a job queued after the
+         * announcement comes with a wake up, so no job is left behind until the next timeout. */
+        ( void ) Atomic_Increment_u32( &pTaskPool->idleThreads );
+
         /* Wait on incoming notifications. If waiting on the semaphore return with timeout, then
          * it means that this thread should consider shutting down for the task pool to fold back
          * to its minimum number of threads. */
-        jobAvailable = IotSemaphore_TimedWait( &pTaskPool->dispatchSignal, IOT_TASKPOOL_JOB_WAIT_TIMEOUT_MS );
+        if( _hasPendingJobs( pTaskPool ) == false )
+        {
+            jobAvailable = IotSemaphore_TimedWait( &pTaskPool->dispatchSignal, IOT_TASKPOOL_JOB_WAIT_TIMEOUT_MS );
+
+            if( jobAvailable == true )
+            {
+                /* This wake up was accounted for when the dispatch signal was posted. */
+                ( void ) Atomic_Decrement_u32( &pTaskPool->pendingWakeups );
+            }
+        }
+
+        ( void ) Atomic_Decrement_u32( &pTaskPool->idleThreads );
 
         /* Acquire the lock to check the exit condition, and release the lock if the exit condition is verified,
          * or before waiting for incoming notifications.
@@ -1205,92 +1398,234 @@ static void _taskPoolWorker( void * pUserContext )
                     running = false;
                 }
             }
+        }
+        TASKPOOL_EXIT_CRITICAL();
 
-            /* Only look for a job if waiting did not timed out. */
-            if( jobAvailable == true )
+        /* Pick up the first job without holding the task pool lock. Only the lock of the work queue
+         * holding the job is taken. */
+        pJob = _dequeueJob( pTaskPool, homeQueue, &userCallback );
+
+        /* INNER LOOP: it controls the execution of jobs: the exit condition is the lack of a job to execute. */
+        while( pJob != NULL )
+        {
+            /* Process the job by invoking the associated callback with the user context.
+             * This task pool thread will not be available until the user callback returns.
+             */
+            IotTaskPool_Assert( IotLink_IsLinked( &pJob->link ) == false );
+            IotTaskPool_Assert( userCallback != NULL );
+
+            userCallback( pTaskPool, pJob, pJob->pUserContext );
+
+            /* This job is finished, clear its pointer. */
+            pJob = NULL;
+            userCallback = NULL;
+
+            /* Update the number of busy threads, so new requests can be served by creating new threads, up to maxThreads. */
+            ( void ) Atomic_Decrement_u32( &pTaskPool->activeJobs );
+
+            /* If this thread exceeded the quota, then let it terminate. */
+            if( running == false )
+            {
+                /* Abandon the INNER LOOP. Execution will tranfer back to the OUTER LOOP condition. */
+                break;
+            }
+
+            /* Dequeue the next job, stealing from the other work queues once the home queue is empty. */
+            pJob = _dequeueJob( pTaskPool, homeQueue, &userCallback );
+        }
+    } while( running == true );
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+static void _enqueueJob( _taskPool_t * const pTaskPool,
+                         _taskPoolJob_t * const pJob,
+                         uint32_t priorityClass )
+{
+    /* Spread jobs across the work queues in round-robin order, to balance the work among workers. */
+    uint32_t index = Atomic_Increment_u32( &pTaskPool->nextJobQueue ) % IOT_TASKPOOL_WORKER_QUEUES;
+    _taskPoolWorkQueue_t * pQueue = &pTaskPool->workQueues[ index ];
+
+    IotMutex_Lock( &pQueue->lock );
+    {
+        /* The status changes under the lock of the work queue, as workers take jobs without the task pool lock. */
+        pJob->status = IOT_TASKPOOL_STATUS_SCHEDULED;
+        pJob->pQueue = pQueue;
+        pJob->priorityClass = priorityClass;
+
+        IotDeQueue_EnqueueTail( &pQueue->jobs[ priorityClass ], &pJob->link );
+
+        pQueue->pendingJobs[ priorityClass ]++;
+    }
+    IotMutex_Unlock( &pQueue->lock );
+}
+
+/*-----------------------------------------------------------*/
+
+static _taskPoolJob_t * _dequeueJob( _taskPool_t * const pTaskPool,
+                                     uint32_t homeQueue,
+                                     IotTaskPoolRoutine_t * const pUserCallback )
+{
+    uint32_t priorityClass, count;
+    _taskPoolJob_t * pJob = NULL;
+
+    /* Serve higher priority classes first across all work queues, so that a high priority job waiting in
+     * another work queue is not delayed by normal jobs in the home queue. Within a priority class, the
+     * home queue is checked first, then the other queues in order. */
+    for( priorityClass = 0; ( priorityClass < TASKPOOL_PRIORITY_CLASSES ) && ( pJob == NULL ); ++priorityClass )
+    {
+        for( count = 0; ( count < IOT_TASKPOOL_WORKER_QUEUES ) && ( pJob == NULL ); ++count )
+        {
+            _taskPoolWorkQueue_t * pQueue = &pTaskPool->workQueues[ ( homeQueue + count ) % IOT_TASKPOOL_WORKER_QUEUES ];
+
+            /* Skip empty queues without taking their lock. */
+            if( pQueue->pendingJobs[ priorityClass ] == 0UL )
+            {
+                continue;
+            }
+
+            IotMutex_Lock( &pQueue->lock );
             {
                 /* Dequeue the first job in FIFO order. */
-                pFirst = IotDeQueue_DequeueHead( &pTaskPool->dispatchQueue );
+                IotLink_t * pFirst = IotDeQueue_DequeueHead( &pQueue->jobs[ priorityClass ] );
 
-                /* If there is indeed a job, then update status under lock, and release the lock before processing the job. */
+                /* The queue may have been emptied by another worker since it was checked. */
                 if( pFirst != NULL )
                 {
+                    pQueue->pendingJobs[ priorityClass ]--;
+
                     /* Extract the job from its link. */
                     pJob = IotLink_Container( _taskPoolJob_t, pFirst, link );
 
                     /* Update status to 'executing'. */
                     pJob->status = IOT_TASKPOOL_STATUS_COMPLETED;
-                    userCallback = pJob->userCallback;
+                    pJob->pQueue = NULL;
+                    *pUserCallback = pJob->userCallback;
                 }
             }
+            IotMutex_Unlock( &pQueue->lock );
         }
-        TASKPOOL_EXIT_CRITICAL();
-
-        /* INNER LOOP: it controls the execution of jobs: the exit condition is the lack of a job to execute. */
-        while( pJob != NULL )
-        {
-            /* Process the job by invoking the associated callback with the user context.
-             * This task pool thread will not be available until the user callback returns.
-             */
-            {
-                IotTaskPool_Assert( IotLink_IsLinked( &pJob->link ) == false );
-                IotTaskPool_Assert( userCallback != NULL );
+    }
 
-                userCallback( pTaskPool, pJob, pJob->pUserContext );
+    return pJob;
+}
 
-                /* This job is finished, clear its pointer. */
-                pJob = NULL;
-                userCallback = NULL;
+/*-----------------------------------------------------------*/
 
-                /* If this thread exceeded the quota, then let it terminate. */
-                if( running == false )
-                {
-                    /* Abandon the INNER LOOP. Execution will tranfer back to the OUTER LOOP condition. */
-                    break;
-                }
-            }
+static bool _hasPendingJobs( const _taskPool_t * const pTaskPool )
+{
+    uint32_t count;
+    bool pending = false;
 
-            /* Acquire the lock before updating the job status. */
-            TASKPOOL_ENTER_CRITICAL();
-            {
-                /* Update the number of busy threads, so new requests can be served by creating new threads, up to maxThreads. */
-                pTaskPool->activeJobs--;
+    for( count = 0; ( count < IOT_TASKPOOL_WORKER_QUEUES * TASKPOOL_PRIORITY_CLASSES ) && ( pending == false ); ++count )
+    {
+        if( pTaskPool->workQueues[ count / TASKPOOL_PRIORITY_CLASSES ].pendingJobs[ count % TASKPOOL_PRIORITY_CLASSES ] != 0UL )
+        {
+            pending = true;
+        }
+    }
 
-                /* Try and dequeue the next job in the dispatch queue. */
-                IotLink_t * pItem = NULL;
+    return pending;
+}
 
-                /* Dequeue the next job from the dispatch queue. */
-                pItem = IotDeQueue_DequeueHead( &pTaskPool->dispatchQueue );
+/*-----------------------------------------------------------*/
 
-                /* If there is no job left in the dispatch queue, update the worker status and leave. */
-                if( pItem == NULL )
-                {
-                    TASKPOOL_EXIT_CRITICAL();
+static void _wakeWorker( _taskPool_t * const pTaskPool )
+{
+    for( ; ; )
+    {
+        uint32_t pendingWakeups = pTaskPool->pendingWakeups;
 
-                    /* Abandon the INNER LOOP. Execution will tranfer back to the OUTER LOOP condition. */
-                    break;
-                }
-                else
-                {
-                    pJob = IotLink_Container( _taskPoolJob_t, pItem, link );
+        /* Busy workers pick up the job once they are done with the current one, and workers
+         * already being woken up will find it too: only wake up a worker that would stay asleep. */
+        if( pTaskPool->idleThreads <= pendingWakeups )
+        {
+            break;
+        }
 
-                    userCallback = pJob->userCallback;
-                }
+        if( Atomic_CompareAndSwap_u32( &pTaskPool->pendingWakeups,
+                                       pendingWakeups + 1UL,
+                                       pendingWakeups ) == ATOMIC_COMPARE_AND_SWAP_SUCCESS )
+        {
+            IotSemaphore_Post( &pTaskPool->dispatchSignal );
 
-                pJob->status = IOT_TASKPOOL_STATUS_COMPLETED;
-            }
-            TASKPOOL_EXIT_CRITICAL();
+            break;
         }
-    } while( running == true );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static void _postDispatchSignal( _taskPool_t * const pTaskPool )
+{
+    ( void ) Atomic_Increment_u32( &pTaskPool->pendingWakeups );
+
+    IotSemaphore_Post( &pTaskPool->dispatchSignal );
 }
 
 /* ---------------------------------------------------------------------------------------------- */
 
-static void _initJobsCache( _taskPoolCache_t * const pCache )
+static IotTaskPoolError_t _initJobsCache( _taskPoolCache_t * const pCache,
+                                          uint32_t slabSize )
 {
+    TASKPOOL_FUNCTION_ENTRY( IOT_TASKPOOL_SUCCESS );
+
+    uint32_t bitmapWords;
+    uintptr_t slabAddress;
+
     IotDeQueue_Create( &pCache->freeList );
 
     pCache->freeCount = 0;
+
+    if( slabSize == 0UL )
+    {
+        slabSize = IOT_TASKPOOL_JOB_SLAB_SIZE;
+    }
+
+    bitmapWords = ( slabSize + 31UL ) / 32UL;
+
+    pCache->pSlabMemory = IotTaskPool_MallocJobSlab( TASKPOOL_JOB_SLAB_BYTES( slabSize ) );
+
+    if( pCache->pSlabMemory == NULL )
+    {
+        IotLogError( "Failed to allocate a slab of %lu jobs.", ( unsigned long ) slabSize );
+
+        TASKPOOL_SET_AND_GOTO_CLEANUP( IOT_TASKPOOL_NO_MEMORY );
+    }
+
+    /* Align the jobs on a cache line, the in-use bitmap follows the jobs. */
+    slabAddress = ( ( uintptr_t ) pCache->pSlabMemory + IOT_TASKPOOL_JOB_SLAB_ALIGNMENT - 1UL ) &
+                  ~( ( uintptr_t ) IOT_TASKPOOL_JOB_SLAB_ALIGNMENT - 1UL );
+
+    pCache->pSlab = ( _taskPoolJob_t * ) slabAddress;
+    pCache->pSlabInUse = ( uint32_t * ) &pCache->pSlab[ slabSize ];
+    pCache->slabSize = slabSize;
+
+    memset( pCache->pSlab, 0x00, slabSize * sizeof( _taskPoolJob_t ) );
+    memset( pCache->pSlabInUse, 0x00, bitmapWords * sizeof( uint32_t ) );
+
+    /* Mark the bits past the end of the slab as in use so they are never handed out. */
+    if( ( slabSize % 32UL ) != 0UL )
+    {
+        pCache->pSlabInUse[ bitmapWords - 1UL ] = ~( ( 1UL << ( slabSize % 32UL ) ) - 1UL );
+    }
+
+    TASKPOOL_NO_FUNCTION_CLEANUP();
+}
+
+/*-----------------------------------------------------------*/
+
+static void _destroyJobsCache( _taskPoolCache_t * const pCache )
+{
+    if( pCache->pSlabMemory != NULL )
+    {
+        IotTaskPool_FreeJobSlab( pCache->pSlabMemory );
+
+        pCache->pSlabMemory = NULL;
+        pCache->pSlab = NULL;
+        pCache->pSlabInUse = NULL;
+        pCache->slabSize = 0;
+    }
 }
 
 /*-----------------------------------------------------------*/
@@ -1316,14 +1651,86 @@ static void _initializeJob( _taskPoolJob_t * const pJob,
     }
 }
 
-static _taskPoolJob_t * _fetchOrAllocateJob( _taskPoolCache_t * const pCache )
+static _taskPoolJob_t * _allocateSlabJob( _taskPoolCache_t * const pCache )
 {
     _taskPoolJob_t * pJob = NULL;
-    IotLink_t * pLink = IotListDouble_RemoveHead( &( pCache->freeList ) );
+    uint32_t word;
+    uint32_t freeBits;
+    uint32_t index;
+    uint32_t inUse;
+
+    /* Jobs are only taken from the slab with the task pool lock held, so a free bit found here
+     * cannot be taken by anyone else. Jobs may be returned without the lock, hence the atomic
+     * updates of the bitmap. */
+    for( word = 0; word < ( pCache->slabSize + 31UL ) / 32UL; ++word )
+    {
+        freeBits = ~pCache->pSlabInUse[ word ];
+
+        if( freeBits != 0UL )
+        {
+            index = ( uint32_t ) __builtin_ctz( freeBits );
+
+            ( void ) Atomic_OR_u32( &pCache->pSlabInUse[ word ], 1UL << index );
+
+            pJob = &pCache->pSlab[ ( word * 32UL ) + index ];
+
+            memset( pJob, 0x00, sizeof( _taskPoolJob_t ) );
+
+            pCache->slabAllocations++;
+
+            inUse = Atomic_Increment_u32( &pCache->slabInUse ) + 1UL;
 
-    if( pLink != NULL )
+            if( inUse > pCache->slabHighWatermark )
+            {
+                pCache->slabHighWatermark = inUse;
+            }
+
+            break;
+        }
+    }
+
+    return pJob;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool _releaseSlabJob( _taskPoolCache_t * const pCache,
+                             _taskPoolJob_t * const pJob )
+{
+    bool slabJob = false;
+    uint32_t index;
+
+    if( ( pJob >= pCache->pSlab ) && ( pJob < &pCache->pSlab[ pCache->slabSize ] ) )
     {
-        pJob = IotLink_Container( _taskPoolJob_t, pLink, link );
+        index = ( uint32_t ) ( pJob - pCache->pSlab );
+
+        IotTaskPool_Assert( ( pCache->pSlabInUse[ index / 32UL ] & ( 1UL << ( index % 32UL ) ) ) != 0UL );
+
+        ( void ) Atomic_Decrement_u32( &pCache->slabInUse );
+        ( void ) Atomic_AND_u32( &pCache->pSlabInUse[ index / 32UL ], ~( 1UL << ( index % 32UL ) ) );
+
+        slabJob = true;
+    }
+
+    return slabJob;
+}
+
+/*-----------------------------------------------------------*/
+
+static _taskPoolJob_t * _fetchOrAllocateJob( _taskPoolCache_t * const pCache )
+{
+    _taskPoolJob_t * pJob = _allocateSlabJob( pCache );
+    IotLink_t * pLink = NULL;
+
+    /* If the slab is exhausted, then take a job from the cache. */
+    if( pJob == NULL )
+    {
+        pLink = IotListDouble_RemoveHead( &( pCache->freeList ) );
+
+        if( pLink != NULL )
+        {
+            pJob = IotLink_Container( _taskPoolJob_t, pLink, link );
+        }
     }
 
     /* If there is no available job in the cache, then allocate one. */
@@ -1334,6 +1741,8 @@ static _taskPoolJob_t * _fetchOrAllocateJob( _taskPoolCache_t * const pCache )
         if( pJob != NULL )
         {
             memset( pJob, 0x00, sizeof( _taskPoolJob_t ) );
+
+            pCache->heapAllocations++;
         }
         else
         {
@@ -1342,7 +1751,7 @@ static _taskPoolJob_t * _fetchOrAllocateJob( _taskPoolCache_t * const pCache )
         }
     }
     /* If there was a job in the cache, then make sure we keep the counters up-to-date. */
-    else
+    else if( pLink != NULL )
     {
         IotTaskPool_Assert( pCache->freeCount > 0 );
 
@@ -1360,8 +1769,12 @@ static void _recycleJob( _taskPoolCache_t * const pCache,
     /* We should never try and recycling a job that is linked into some queue. */
     IotTaskPool_Assert( IotLink_IsLinked( &pJob->link ) == false );
 
-    /* We will recycle the job if there is space in the cache. */
-    if( pCache->freeCount < IOT_TASKPOOL_JOBS_RECYCLE_LIMIT )
+    /* Slab jobs go back to the slab, other jobs are recycled if there is space in the cache. */
+    if( _releaseSlabJob( pCache, pJob ) == true )
+    {
+        /* Nothing else to do. */
+    }
+    else if( pCache->freeCount < IOT_TASKPOOL_JOBS_RECYCLE_LIMIT )
     {
         /* Destroy user data, for added safety & security. */
         pJob->userCallback = NULL;
@@ -1378,13 +1791,14 @@ static void _recycleJob( _taskPoolCache_t * const pCache,
     }
     else
     {
-        _destroyJob( pJob );
+        _destroyJob( pCache, pJob );
     }
 }
 
 /*-----------------------------------------------------------*/
 
-static void _destroyJob( _taskPoolJob_t * const pJob )
+static void _destroyJob( _taskPoolCache_t * const pCache,
+                         _taskPoolJob_t * const pJob )
 {
     /* Destroy user data, for added safety & security. */
     pJob->userCallback = NULL;
@@ -1393,10 +1807,13 @@ static void _destroyJob( _taskPoolJob_t * const pJob )
     /* Reset the status for added debugability. */
     pJob->status = IOT_TASKPOOL_STATUS_UNDEFINED;
 
-    /* Only dispose of dynamically allocated jobs. */
+    /* Only dispose of dynamically allocated jobs, slab jobs go back to the slab. */
     if( ( pJob->flags & IOT_TASK_POOL_INTERNAL_STATIC ) == 0UL )
     {
-        IotTaskPool_FreeJob( pJob );
+        if( _releaseSlabJob( pCache, pJob ) == false )
+        {
+            IotTaskPool_FreeJob( pJob );
+        }
     }
 }
 
@@ -1420,7 +1837,7 @@ static void _signalShutdown( _taskPool_t * const pTaskPool,
     /* Broadcast to all active threads to wake-up. Active threads do check the exit condition right after waking up. */
     for( count = 0; count < threads; ++count )
     {
-        IotSemaphore_Post( &pTaskPool->dispatchSignal );
+        _postDispatchSignal( pTaskPool );
     }
 }
 
@@ -1435,18 +1852,15 @@ static IotTaskPoolError_t _scheduleInternal( _taskPool_t * const pTaskPool,
     bool mustGrow = false;
     bool shouldGrow = false;
 
-    /* Update the job status to 'scheduled'. */
-    pJob->status = IOT_TASKPOOL_STATUS_SCHEDULED;
-
     /* Update the number of active jobs optimistically, so new requests can be served by creating new threads. */
-    pTaskPool->activeJobs++;
+    uint32_t activeJobs = Atomic_Increment_u32( &pTaskPool->activeJobs ) + 1UL;
 
     /* If all threads are busy, try and create a new one. Failing to create a new thread
      * only has performance implications on correctly executing the scheduled job.
      */
     uint32_t activeThreads = pTaskPool->activeThreads;
 
-    if( activeThreads <= pTaskPool->activeJobs )
+    if( activeThreads <= activeJobs )
     {
         /* If the job scheduling is tagged as high priority, then we must grow the task pool,
          * no matter how many threads are active already. */
@@ -1498,21 +1912,23 @@ static IotTaskPoolError_t _scheduleInternal( _taskPool_t * const pTaskPool,
 
     if( TASKPOOL_SUCCEEDED( status ) )
     {
-        /* Append the job to the dispatch queue.
-         * Put the job at the front, if it is a high priority job. */
-        if( mustGrow == true )
+        /* Append the job to the queue of its priority class in one of the work queues.
+         * Workers serve high priority jobs before any other job. */
+        if( ( flags & IOT_TASKPOOL_JOB_HIGH_PRIORITY ) == IOT_TASKPOOL_JOB_HIGH_PRIORITY )
         {
-            IotLogDebug( "High priority job: placing job at the head of the queue." );
-
-            IotDeQueue_EnqueueHead( &pTaskPool->dispatchQueue, &pJob->link );
+            _enqueueJob( pTaskPool, pJob, TASKPOOL_PRIORITY_HIGH );
+        }
+        else if( ( flags & IOT_TASKPOOL_JOB_LOW_PRIORITY ) == IOT_TASKPOOL_JOB_LOW_PRIORITY )
+        {
+            _enqueueJob( pTaskPool, pJob, TASKPOOL_PRIORITY_LOW );
         }
         else
         {
-            IotDeQueue_EnqueueTail( &pTaskPool->dispatchQueue, &pJob->link );
+            _enqueueJob( pTaskPool, pJob, TASKPOOL_PRIORITY_NORMAL );
         }
 
-        /* Signal a worker to pick up the job. */
-        IotSemaphore_Post( &pTaskPool->dispatchSignal );
+        /* Signal a worker to pick up the job, if none is available already. */
+        _wakeWorker( pTaskPool );
     }
     else
     {
@@ -1521,7 +1937,7 @@ static IotTaskPoolError_t _scheduleInternal( _taskPool_t * const pTaskPool,
         IotTaskPool_Assert( mustGrow == true );
 
         /* Revert updating the number of active jobs. */
-        pTaskPool->activeJobs--;
+        ( void ) Atomic_Decrement_u32( &pTaskPool->activeJobs );
     }
 
     TASKPOOL_FUNCTION_CLEANUP_END();
@@ -1529,23 +1945,6 @@ static IotTaskPoolError_t _scheduleInternal( _taskPool_t * const pTaskPool,
 
 /*-----------------------------------------------------------*/
 
-static bool _matchJobByPointer( const IotLink_t * const pLink,
-                                void * pMatch )
-{
-    const _taskPoolJob_t * const pJob = ( _taskPoolJob_t * ) pMatch;
-
-    const _taskPoolTimerEvent_t * const pTimerEvent = IotLink_Container( _taskPoolTimerEvent_t, pLink, link );
-
-    if( pJob == pTimerEvent->pJob )
-    {
-        return true;
-    }
-
-    return false;
-}
-
-/*-----------------------------------------------------------*/
-
 static IotTaskPoolError_t _tryCancelInternal( _taskPool_t * const pTaskPool,
                                               _taskPoolJob_t * const pJob,
                                               IotTaskPoolJobStatus_t * const pStatus )
@@ -1553,10 +1952,37 @@ static IotTaskPoolError_t _tryCancelInternal( _taskPool_t * const pTaskPool,
     TASKPOOL_FUNCTION_ENTRY( IOT_TASKPOOL_SUCCESS );
 
     bool cancelable = false;
+    _taskPoolWorkQueue_t * pQueue = NULL;
 
     /* We can only cancel jobs that are either 'ready' (waiting to be scheduled). 'deferred', or 'scheduled'. */
 
-    IotTaskPoolJobStatus_t currentStatus = pJob->status;
+    IotTaskPoolJobStatus_t currentStatus;
+
+    /* Workers take scheduled jobs under the lock of their work queue only. Pin the work queue of the
+     * job by holding its lock, so that the job cannot start executing while it is being canceled. A
+     * worker may take the job between reading the queue and locking it, check it is still there. */
+    for( ; ; )
+    {
+        pQueue = *( ( _taskPoolWorkQueue_t * volatile * ) &pJob->pQueue );
+
+        if( pQueue == NULL )
+        {
+            /* Not in a work queue, the status only changes under the task pool lock held by the caller. */
+            break;
+        }
+
+        IotMutex_Lock( &pQueue->lock );
+
+        if( pJob->pQueue == pQueue )
+        {
+            break;
+        }
+
+        IotMutex_Unlock( &pQueue->lock );
+    }
+
+    /* Only trust the status once the queue is pinned. */
+    currentStatus = pJob->status;
 
     switch( currentStatus )
     {
@@ -1597,47 +2023,31 @@ static IotTaskPoolError_t _tryCancelInternal( _taskPool_t * const pTaskPool,
          * queue and signal any waiting threads. */
         if( currentStatus == IOT_TASKPOOL_STATUS_SCHEDULED )
         {
-            /* A scheduled work items must be in the dispatch queue. */
+            /* A scheduled work items must be in a work queue. */
             IotTaskPool_Assert( IotLink_IsLinked( &pJob->link ) );
 
             IotDeQueue_Remove( &pJob->link );
+
+            pQueue->pendingJobs[ pJob->priorityClass ]--;
+            pJob->pQueue = NULL;
+
+            /* The job will not execute, release the slot it was accounted for. */
+            ( void ) Atomic_Decrement_u32( &pTaskPool->activeJobs );
         }
 
         /* If the job current status is 'deferred' then the job has to be pending
-         * in the timeouts queue. */
+         * in the timer wheel. */
         else if( currentStatus == IOT_TASKPOOL_STATUS_DEFERRED )
         {
-            /* Find the timer event associated with the current job. There MUST be one, hence assert if not. */
-            IotLink_t * pTimerEventLink = IotListDouble_FindFirstMatch( &pTaskPool->timerEventsList, NULL, _matchJobByPointer, pJob );
-            IotTaskPool_Assert( pTimerEventLink != NULL );
-
-            if( pTimerEventLink != NULL )
-            {
-                bool shouldReschedule = false;
+            /* A deferred job MUST have a timer event, hence assert if not. */
+            IotTaskPool_Assert( pJob->pTimerEvent != NULL );
 
-                /* If the job being cancelled was at the head of the timeouts queue, then we need to reschedule the timer
-                 * with the next job timeout */
-                IotLink_t * pHeadLink = IotListDouble_PeekHead( &pTaskPool->timerEventsList );
+            /* Remove the timer event associated with the canceled job and free the associated memory.
+             * The timer is left armed: firing without a due event only re-arms it for the next tick. */
+            _removeTimerEvent( &pTaskPool->timerWheel, pJob->pTimerEvent );
+            IotTaskPool_FreeTimerEvent( pJob->pTimerEvent );
 
-                if( pHeadLink == pTimerEventLink )
-                {
-                    shouldReschedule = true;
-                }
-
-                /* Remove the timer event associated with the canceled job and free the associated memory. */
-                IotListDouble_Remove( pTimerEventLink );
-                IotTaskPool_FreeTimerEvent( IotLink_Container( _taskPoolTimerEvent_t, pTimerEventLink, link ) );
-
-                if( shouldReschedule )
-                {
-                    IotLink_t * pNextTimerEventLink = IotListDouble_PeekHead( &pTaskPool->timerEventsList );
-
-                    if( pNextTimerEventLink != NULL )
-                    {
-                        _rescheduleDeferredJobsTimer( &pTaskPool->timer, IotLink_Container( _taskPoolTimerEvent_t, pNextTimerEventLink, link ) );
-                    }
-                }
-            }
+            pJob->pTimerEvent = NULL;
         }
         else
         {
@@ -1646,7 +2056,14 @@ static IotTaskPoolError_t _tryCancelInternal( _taskPool_t * const pTaskPool,
         }
     }
 
-    TASKPOOL_NO_FUNCTION_CLEANUP();
+    TASKPOOL_FUNCTION_CLEANUP();
+
+    if( pQueue != NULL )
+    {
+        IotMutex_Unlock( &pQueue->lock );
+    }
+
+    TASKPOOL_FUNCTION_CLEANUP_END();
 }
 
 /*-----------------------------------------------------------*/
@@ -1706,52 +2123,140 @@ static IotTaskPoolError_t _trySafeExtraction( _taskPool_t * const pTaskPool,
 
 /*-----------------------------------------------------------*/
 
-static int32_t _timerEventCompare( const IotLink_t * const pTimerEventLink1,
-                                   const IotLink_t * const pTimerEventLink2 )
+static void _initTimerWheel( _taskPoolTimerWheel_t * const pWheel )
+{
+    uint32_t count;
+
+    for( count = 0; count < IOT_TASKPOOL_TIMER_WHEEL_LEVELS * TASKPOOL_TIMER_WHEEL_SLOTS; ++count )
+    {
+        IotListDouble_Create( &pWheel->slots[ count ] );
+    }
+
+    for( count = 0; count < IOT_TASKPOOL_TIMER_WHEEL_LEVELS; ++count )
+    {
+        pWheel->occupied[ count ] = 0;
+    }
+
+    pWheel->currentTick = 0;
+    pWheel->armedTick = 0;
+    pWheel->events = 0;
+}
+
+/*-----------------------------------------------------------*/
+
+static void _insertTimerEvent( _taskPoolTimerWheel_t * const pWheel,
+                               _taskPoolTimerEvent_t * const pTimerEvent,
+                               uint64_t baseTick )
 {
-    const _taskPoolTimerEvent_t * const pTimerEvent1 = IotLink_Container( _taskPoolTimerEvent_t,
-                                                                          pTimerEventLink1,
-                                                                          link );
-    const _taskPoolTimerEvent_t * const pTimerEvent2 = IotLink_Container( _taskPoolTimerEvent_t,
-                                                                          pTimerEventLink2,
-                                                                          link );
+    uint32_t level = 0;
+    uint64_t placementTick = pTimerEvent->expirationTick;
+    uint64_t delta;
+
+    IotTaskPool_Assert( pTimerEvent->expirationTick >= baseTick );
+
+    delta = placementTick - baseTick;
 
-    if( pTimerEvent1->expirationTime < pTimerEvent2->expirationTime )
+    /* Pick the lowest level whose range covers the delay. */
+    while( ( level < ( IOT_TASKPOOL_TIMER_WHEEL_LEVELS - 1UL ) ) &&
+           ( delta >= ( 1ULL << ( TASKPOOL_TIMER_WHEEL_SLOT_BITS * ( level + 1UL ) ) ) ) )
     {
-        return -1;
+        level++;
     }
 
-    if( pTimerEvent1->expirationTime > pTimerEvent2->expirationTime )
+    /* Park delays beyond the range of the top level in its farthest slot. The event is placed again
+     * when the wheel reaches that slot. */
+    if( delta >= ( 1ULL << ( TASKPOOL_TIMER_WHEEL_SLOT_BITS * IOT_TASKPOOL_TIMER_WHEEL_LEVELS ) ) )
     {
-        return 1;
+        placementTick = baseTick + ( 1ULL << ( TASKPOOL_TIMER_WHEEL_SLOT_BITS * IOT_TASKPOOL_TIMER_WHEEL_LEVELS ) ) - 1ULL;
     }
 
-    return 0;
+    pTimerEvent->slot = ( level * TASKPOOL_TIMER_WHEEL_SLOTS ) +
+                        ( uint32_t ) ( ( placementTick >> ( TASKPOOL_TIMER_WHEEL_SLOT_BITS * level ) ) & TASKPOOL_TIMER_WHEEL_SLOT_MASK );
+
+    IotListDouble_InsertTail( &pWheel->slots[ pTimerEvent->slot ], &pTimerEvent->link );
+
+    pWheel->occupied[ level ] |= 1UL << ( pTimerEvent->slot & TASKPOOL_TIMER_WHEEL_SLOT_MASK );
+    pWheel->events++;
 }
 
 /*-----------------------------------------------------------*/
 
-static void _rescheduleDeferredJobsTimer( IotTimer_t * const pTimer,
-                                          _taskPoolTimerEvent_t * const pFirstTimerEvent )
+static void _removeTimerEvent( _taskPoolTimerWheel_t * const pWheel,
+                               _taskPoolTimerEvent_t * const pTimerEvent )
 {
-    uint64_t delta = 0;
-    uint64_t now = IotClock_GetTimeMs();
+    IotListDouble_Remove( &pTimerEvent->link );
 
-    if( pFirstTimerEvent->expirationTime > now )
+    if( IotListDouble_IsEmpty( &pWheel->slots[ pTimerEvent->slot ] ) )
     {
-        delta = pFirstTimerEvent->expirationTime - now;
+        pWheel->occupied[ pTimerEvent->slot / TASKPOOL_TIMER_WHEEL_SLOTS ] &= ~( 1UL << ( pTimerEvent->slot & TASKPOOL_TIMER_WHEEL_SLOT_MASK ) );
     }
 
-    if( delta < TASKPOOL_JOB_RESCHEDULE_DELAY_MS )
+    pWheel->events--;
+}
+
+/*-----------------------------------------------------------*/
+
+static uint64_t _nextTimerWheelTick( const _taskPoolTimerWheel_t * const pWheel )
+{
+    uint32_t level;
+    uint64_t nextTick = UINT64_MAX;
+
+    IotTaskPool_Assert( pWheel->events > 0UL );
+
+    for( level = 0; level < IOT_TASKPOOL_TIMER_WHEEL_LEVELS; ++level )
     {
-        delta = TASKPOOL_JOB_RESCHEDULE_DELAY_MS; /* The job will be late... */
+        uint32_t shift = TASKPOOL_TIMER_WHEEL_SLOT_BITS * level;
+        uint64_t position = ( pWheel->currentTick >> shift ) + 1ULL;
+        uint32_t first = ( uint32_t ) ( position & TASKPOOL_TIMER_WHEEL_SLOT_MASK );
+        uint32_t occupied = pWheel->occupied[ level ];
+
+        if( occupied != 0UL )
+        {
+            /* Rotate the bitmap so that bit 0 is the first slot after the current one: the distance
+             * to the next occupied slot, wrapping around the level, is then its lowest set bit. */
+            uint32_t rotated = ( occupied >> first ) | ( occupied << ( ( TASKPOOL_TIMER_WHEEL_SLOTS - first ) & TASKPOOL_TIMER_WHEEL_SLOT_MASK ) );
+            uint64_t tick = ( position + ( uint64_t ) __builtin_ctz( rotated ) ) << shift;
+
+            if( tick < nextTick )
+            {
+                nextTick = tick;
+            }
+        }
     }
 
-    IotTaskPool_Assert( delta > 0 );
+    return nextTick;
+}
+
+/*-----------------------------------------------------------*/
 
-    if( IotClock_TimerArm( pTimer, ( uint32_t ) delta, 0 ) == false )
+static void _armTimerWheel( _taskPool_t * const pTaskPool )
+{
+    _taskPoolTimerWheel_t * pWheel = &pTaskPool->timerWheel;
+
+    if( pWheel->events > 0UL )
     {
-        IotLogWarn( "Failed to re-arm timer for task pool" );
+        uint64_t nextTick = _nextTimerWheelTick( pWheel );
+
+        /* A timer armed for an earlier tick re-arms itself when it fires. */
+        if( ( pWheel->armedTick == 0ULL ) || ( nextTick < pWheel->armedTick ) )
+        {
+            uint64_t delta = 1;
+            uint64_t now = IotClock_GetTimeMs();
+
+            if( ( nextTick * IOT_TASKPOOL_TIMER_WHEEL_TICK_MS ) > now )
+            {
+                delta = ( nextTick * IOT_TASKPOOL_TIMER_WHEEL_TICK_MS ) - now;
+            }
+
+            if( IotClock_TimerArm( &pTaskPool->timer, ( uint32_t ) delta, 0 ) == false )
+            {
+                IotLogWarn( "Failed to re-arm timer for task pool" );
+            }
+            else
+            {
+                pWheel->armedTick = nextTick;
+            }
+        }
     }
 }
 
@@ -1760,6 +2265,7 @@ static void _rescheduleDeferredJobsTimer( IotTimer_t * const pTimer,
 static void _timerThread( void * pArgument )
 {
     _taskPool_t * pTaskPool = ( _taskPool_t * ) pArgument;
+    _taskPoolTimerWheel_t * pWheel = &pTaskPool->timerWheel;
     _taskPoolTimerEvent_t * pTimerEvent = NULL;
 
     IotLogDebug( "Timer thread started for task pool %p.", pTaskPool );
@@ -1783,52 +2289,87 @@ static void _timerThread( void * pArgument )
             return;
         }
 
-        /* Dispatch all deferred job whose timer expired, then reset the timer for the next
-         * job down the line. */
-        for( ; ; )
+        /* The timer fired, it is not armed anymore. */
+        pWheel->armedTick = 0;
+
+        /* Turn the wheel up to the current tick. Only the ticks with timer events to expire or to move
+         * down a level are visited, the wheel jumps over the others. */
+        uint64_t nowTick = IotClock_GetTimeMs() / IOT_TASKPOOL_TIMER_WHEEL_TICK_MS;
+
+        while( pWheel->events > 0UL )
         {
-            /* Peek the first event in the timer event list. */
-            IotLink_t * pLink = IotListDouble_PeekHead( &pTaskPool->timerEventsList );
+            uint64_t tick = _nextTimerWheelTick( pWheel );
+            uint32_t level;
 
-            /* Check if the timer misfired for any reason.  */
-            if( pLink != NULL )
+            if( tick > nowTick )
             {
-                /* Record the current time. */
-                uint64_t now = IotClock_GetTimeMs();
+                break;
+            }
 
-                /* Extract the job from its envelope. */
-                pTimerEvent = IotLink_Container( _taskPoolTimerEvent_t, pLink, link );
+            pWheel->currentTick = tick;
 
-                /* Check if the first event should be processed now. */
-                if( pTimerEvent->expirationTime <= now )
-                {
-                    /*  Remove the timer event for immediate processing. */
-                    IotListDouble_Remove( &( pTimerEvent->link ) );
-                }
-                else
+            /* Move the timer events of the slots starting at this tick down to the lower levels,
+             * from the top level down. */
+            for( level = IOT_TASKPOOL_TIMER_WHEEL_LEVELS - 1UL; level > 0UL; --level )
+            {
+                uint32_t shift = TASKPOOL_TIMER_WHEEL_SLOT_BITS * level;
+
+                if( ( tick & ( ( 1ULL << shift ) - 1ULL ) ) == 0ULL )
                 {
-                    /* The first element in the timer queue shouldn't be processed yet.
-                     * Arm the timer for when it should be processed and leave altogether. */
-                    _rescheduleDeferredJobsTimer( &pTaskPool->timer, pTimerEvent );
+                    uint32_t slot = ( level * TASKPOOL_TIMER_WHEEL_SLOTS ) + ( uint32_t ) ( ( tick >> shift ) & TASKPOOL_TIMER_WHEEL_SLOT_MASK );
+                    IotLink_t * pLink;
 
-                    break;
+                    while( ( pLink = IotListDouble_PeekHead( &pWheel->slots[ slot ] ) ) != NULL )
+                    {
+                        pTimerEvent = IotLink_Container( _taskPoolTimerEvent_t, pLink, link );
+
+                        _removeTimerEvent( pWheel, pTimerEvent );
+                        _insertTimerEvent( pWheel, pTimerEvent, tick );
+                    }
                 }
             }
-            /* If there are no timer events to process, terminate this thread. */
-            else
+
+            /* Dispatch all deferred jobs expiring in this tick in one batch. */
+            for( ; ; )
             {
-                IotLogDebug( "No further timer events to process. Exiting timer thread." );
+                IotLink_t * pLink = IotListDouble_PeekHead( &pWheel->slots[ tick & TASKPOOL_TIMER_WHEEL_SLOT_MASK ] );
 
-                break;
-            }
+                if( pLink == NULL )
+                {
+                    break;
+                }
 
-            IotLogDebug( "Scheduling job from timer event." );
+                pTimerEvent = IotLink_Container( _taskPoolTimerEvent_t, pLink, link );
+
+                _removeTimerEvent( pWheel, pTimerEvent );
+
+                /* With a single level, delays beyond its range are parked in level 0 itself. */
+                if( pTimerEvent->expirationTick > tick )
+                {
+                    _insertTimerEvent( pWheel, pTimerEvent, tick );
+
+                    continue;
+                }
+
+                IotLogDebug( "Scheduling job from timer event." );
 
-            /* Queue the job associated with the received timer event. */
-            ( void ) _scheduleInternal( pTaskPool, pTimerEvent->pJob, 0 );
+                /* Queue the job associated with the received timer event. */
+                pTimerEvent->pJob->pTimerEvent = NULL;
+                ( void ) _scheduleInternal( pTaskPool, pTimerEvent->pJob, 0 );
 
-            /* Free the timer event. */
-            IotTaskPool_FreeTimerEvent( pTimerEvent );
+                /* Free the timer event. */
+                IotTaskPool_FreeTimerEvent( pTimerEvent );
+            }
+        }
+
+        /* Arm the timer for the next tick with work to do, if any. */
+        if( pWheel->events == 0UL )
+        {
+            IotLogDebug( "No further timer events to process. Exiting timer thread." );
+        }
+        else
+        {
+            _armTimerWheel( pTaskPool );
         }
     }
     TASKPOOL_EXIT_CRITICAL();
@@ -58,7 +58,7 @@
  * Static memory buffers and flags, allocated and zeroed at compile-time.
  */
     static bool _pInUseTaskPools[ IOT_TASKPOOLS ] = { 0 };                                                          /**< @brief Task pools in-use flags. */
-    static _taskPool_t _pTaskPools[ IOT_TASKPOOLS ] = { { .dispatchQueue = IOT_DEQUEUE_INITIALIZER } };             /**< @brief Task pools. */
+    static _taskPool_t _pTaskPools[ IOT_TASKPOOLS ] = { { .minThreads = 0 } };                                      /**< @brief Task pools. */
 
     static bool _pInUseTaskPoolJobs[ IOT_TASKPOOL_JOBS_RECYCLE_LIMIT ] = { 0 };                                     /**< @brief Task pool jobs in-use flags. */
     static _taskPoolJob_t _pTaskPoolJobs[ IOT_TASKPOOL_JOBS_RECYCLE_LIMIT ] = { { .link = IOT_LINK_INITIALIZER } }; /**< @brief Task pool jobs. */
@@ -66,6 +66,9 @@
     static bool _pInUseTaskPoolTimerEvents[ IOT_TASKPOOL_JOBS_RECYCLE_LIMIT ] = { 0 };                              /**< @brief Task pool timer event in-use flags. */
     static _taskPoolTimerEvent_t _pTaskPoolTimerEvents[ IOT_TASKPOOL_JOBS_RECYCLE_LIMIT ] = { { .link = { 0 } } };  /**< @brief Task pool timer events. */
 
+    static bool _pInUseTaskPoolJobSlabs[ IOT_TASKPOOLS ] = { 0 };                                                   /**< @brief Task pool job slabs in-use flags. */
+    static uint8_t _pTaskPoolJobSlabs[ IOT_TASKPOOLS ][ TASKPOOL_JOB_SLAB_BYTES( IOT_TASKPOOL_JOB_SLAB_SIZE ) ];    /**< @brief Task pool job slabs. */
+
 /*-----------------------------------------------------------*/
 
     void * IotTaskPool_MallocTaskPool( size_t size )
@@ -170,6 +173,41 @@
                                      sizeof( _taskPoolTimerEvent_t ) );
     }
 
+/*-----------------------------------------------------------*/
+
+    void * IotTaskPool_MallocJobSlab( size_t size )
+    {
+        int32_t freeIndex = -1;
+        void * pNewJobSlab = NULL;
+
+        /* Check size argument. Slabs up to IOT_TASKPOOL_JOB_SLAB_SIZE jobs are supported. */
+        if( size <= sizeof( _pTaskPoolJobSlabs[ 0 ] ) )
+        {
+            /* Find a free task pool job slab. */
+            freeIndex = IotStaticMemory_FindFree( _pInUseTaskPoolJobSlabs,
+                                                  IOT_TASKPOOLS );
+
+            if( freeIndex != -1 )
+            {
+                pNewJobSlab = &( _pTaskPoolJobSlabs[ freeIndex ] );
+            }
+        }
+
+        return pNewJobSlab;
+    }
+
+/*-----------------------------------------------------------*/
+
+    void IotTaskPool_FreeJobSlab( void * ptr )
+    {
+        /* Return the in-use task pool job slab. */
+        IotStaticMemory_ReturnInUse( ptr,
+                                     _pTaskPoolJobSlabs,
+                                     _pInUseTaskPoolJobSlabs,
+                                     IOT_TASKPOOLS,
+                                     sizeof( _pTaskPoolJobSlabs[ 0 ] ) );
+    }
+
 /*-----------------------------------------------------------*/
 
 #endif /* if IOT_STATIC_MEMORY_ONLY == 1 */
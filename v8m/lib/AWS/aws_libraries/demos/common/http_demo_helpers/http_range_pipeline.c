@@ -0,0 +1,865 @@
+/*
+ * Copyright (c) 2023 Arm Limited. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include <string.h>
+
+#include "http_range_pipeline.h"
+
+/*-----------------------------------------------------------*/
+
+#define HTTP_STATUS_PARTIAL_CONTENT    ( 206U )
+
+#define HEADER_CONTENT_LENGTH          "content-length"
+#define HEADER_CONTENT_RANGE           "content-range"
+#define HEADER_TRANSFER_ENCODING       "transfer-encoding"
+
+/*-----------------------------------------------------------*/
+
+/*
+ * @brief Compare a header name, case-insensitively, to a lower-case string.
+ */
+static bool prvHeaderIs( const char * pcName,
+                         size_t xNameLen,
+                         const char * pcExpected )
+{
+    size_t i;
+    char c;
+
+    if( xNameLen != strlen( pcExpected ) )
+    {
+        return false;
+    }
+
+    for( i = 0; i < xNameLen; i++ )
+    {
+        c = pcName[ i ];
+
+        if( ( c >= 'A' ) && ( c <= 'Z' ) )
+        {
+            c = ( char ) ( c - 'A' + 'a' );
+        }
+
+        if( c != pcExpected[ i ] )
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/*-----------------------------------------------------------*/
+
+/*
+ * @brief Parse a decimal number, skipping leading spaces.
+ *
+ * @return Pointer past the number, or NULL if there is no number or it overflows.
+ */
+static const char * prvParseNumber( const char * pcText,
+                                    const char * pcEnd,
+                                    uint32_t * pulValue )
+{
+    uint32_t ulValue = 0;
+    const char * pcStart;
+
+    while( ( pcText < pcEnd ) && ( *pcText == ' ' ) )
+    {
+        pcText++;
+    }
+
+    pcStart = pcText;
+
+    while( ( pcText < pcEnd ) && ( *pcText >= '0' ) && ( *pcText <= '9' ) )
+    {
+        if( ulValue > ( ( UINT32_MAX - 9U ) / 10U ) )
+        {
+            return NULL;
+        }
+
+        ulValue = ( ulValue * 10U ) + ( uint32_t ) ( *pcText - '0' );
+        pcText++;
+    }
+
+    *pulValue = ulValue;
+
+    return ( pcText != pcStart ) ? pcText : NULL;
+}
+
+/*-----------------------------------------------------------*/
+
+/*
+ * @brief Parse the status line and the headers needed to read a range response.
+ */
+static HTTPStatus_t prvParseHeaders( HTTPRangePipeline_t * pxPipeline,
+                                     const char * pcHeaders,
+                                     size_t xHeadersLen,
+                                     uint32_t * pulContentLength,
+                                     bool * pxChunked,
+                                     uint32_t * pulRangeStart )
+{
+    const char * pcEnd = pcHeaders + xHeadersLen;
+    const char * pcLine = pcHeaders;
+    const char * pcLineEnd;
+    const char * pcColon;
+    const char * pcValue;
+    uint32_t ulStatus = 0;
+    uint32_t ulRangeEnd = 0;
+    uint32_t ulTotal = 0;
+    bool xHasLength = false;
+    bool xHasEncoding = false;
+    bool xHasRange = false;
+
+    *pxChunked = false;
+
+    /* "HTTP/1.1 206 Partial Content" */
+    if( ( xHeadersLen < 12U ) || ( memcmp( pcHeaders, "HTTP/1.", 7 ) != 0 ) )
+    {
+        return HTTPSecurityAlertInvalidProtocolVersion;
+    }
+
+    if( prvParseNumber( pcHeaders + 8, pcEnd, &ulStatus ) == NULL )
+    {
+        return HTTPSecurityAlertInvalidStatusCode;
+    }
+
+    if( ulStatus != HTTP_STATUS_PARTIAL_CONTENT )
+    {
+        return HTTPInvalidResponse;
+    }
+
+    while( pcLine < pcEnd )
+    {
+        pcLineEnd = memchr( pcLine, '\n', ( size_t ) ( pcEnd - pcLine ) );
+
+        if( pcLineEnd == NULL )
+        {
+            pcLineEnd = pcEnd;
+        }
+
+        pcColon = memchr( pcLine, ':', ( size_t ) ( pcLineEnd - pcLine ) );
+
+        if( pcColon != NULL )
+        {
+            pcValue = pcColon + 1;
+
+            if( prvHeaderIs( pcLine, ( size_t ) ( pcColon - pcLine ), HEADER_CONTENT_LENGTH ) )
+            {
+                xHasLength = prvParseNumber( pcValue, pcLineEnd, pulContentLength ) != NULL;
+            }
+            else if( prvHeaderIs( pcLine, ( size_t ) ( pcColon - pcLine ), HEADER_TRANSFER_ENCODING ) )
+            {
+                /* Only "chunked" alone is supported, other codings are not undone. */
+                while( ( pcValue < pcLineEnd ) && ( *pcValue == ' ' ) )
+                {
+                    pcValue++;
+                }
+
+                *pxChunked = ( ( size_t ) ( pcLineEnd - pcValue ) >= 7U ) &&
+                             prvHeaderIs( pcValue, 7U, "chunked" ) &&
+                             ( ( pcValue + 7 == pcLineEnd ) || ( pcValue[ 7 ] == '\r' ) || ( pcValue[ 7 ] == ' ' ) );
+                xHasEncoding = true;
+            }
+            else if( prvHeaderIs( pcLine, ( size_t ) ( pcColon - pcLine ), HEADER_CONTENT_RANGE ) )
+            {
+                /* "bytes <start>-<end>/<total>", the total may be "*". */
+                while( ( pcValue < pcLineEnd ) && ( *pcValue == ' ' ) )
+                {
+                    pcValue++;
+                }
+
+                if( ( ( size_t ) ( pcLineEnd - pcValue ) > 6U ) && ( memcmp( pcValue, "bytes ", 6 ) == 0 ) )
+                {
+                    pcValue = prvParseNumber( pcValue + 6, pcLineEnd, pulRangeStart );
+
+                    if( ( pcValue != NULL ) && ( *pcValue == '-' ) )
+                    {
+                        pcValue = prvParseNumber( pcValue + 1, pcLineEnd, &ulRangeEnd );
+                    }
+                    else
+                    {
+                        pcValue = NULL;
+                    }
+
+                    xHasRange = ( pcValue != NULL );
+
+                    if( xHasRange && ( *pcValue == '/' ) &&
+                        ( prvParseNumber( pcValue + 1, pcLineEnd, &ulTotal ) != NULL ) )
+                    {
+                        pxPipeline->ulTotalSize = ulTotal;
+                    }
+                }
+            }
+        }
+
+        pcLine = pcLineEnd + 1;
+    }
+
+    /* The transfer coding takes precedence over Content-Length, RFC 7230 section 3.3.3. */
+    if( ( xHasEncoding == true ) && ( *pxChunked == false ) )
+    {
+        return HTTPInvalidResponse;
+    }
+
+    if( ( xHasLength == false ) && ( *pxChunked == false ) )
+    {
+        return HTTPSecurityAlertInvalidContentLength;
+    }
+
+    if( xHasRange == false )
+    {
+        return HTTPInvalidResponse;
+    }
+
+    return HTTPSuccess;
+}
+
+/*-----------------------------------------------------------*/
+
+/*
+ * @brief Receive into @p pucBuffer, retrying transport calls that return no data.
+ *
+ * @return Number of bytes received, or a negative value on error.
+ */
+static int32_t prvRecv( const TransportInterface_t * pxTransport,
+                        uint8_t * pucBuffer,
+                        size_t xLength )
+{
+    int32_t lReceived = 0;
+    uint32_t ulIdle = 0;
+
+    while( ( lReceived == 0 ) && ( ulIdle < httpPIPELINE_MAX_IDLE_CALLS ) )
+    {
+        lReceived = pxTransport->recv( pxTransport->pNetworkContext, pucBuffer, xLength );
+        ulIdle++;
+    }
+
+    return ( lReceived == 0 ) ? -1 : lReceived;
+}
+
+/*-----------------------------------------------------------*/
+
+HTTPStatus_t httpRangePipelineInit( HTTPRangePipeline_t * pxPipeline,
+                                    const TransportInterface_t * pxTransport,
+                                    const char * pcUrl,
+                                    size_t xUrlLen,
+                                    uint8_t * pucRequestBuffer,
+                                    size_t xRequestBufferSize,
+                                    uint8_t * pucResponseBuffer,
+                                    size_t xResponseBufferSize )
+{
+    const char * pcEnd = pcUrl + xUrlLen;
+    const char * pcHost;
+    const char * pcPath;
+    const char * pcPort;
+    const char * pcDigit;
+    uint32_t ulPort;
+    bool xSecure = false;
+
+    if( ( pxPipeline == NULL ) || ( pxTransport == NULL ) || ( pcUrl == NULL ) ||
+        ( pucRequestBuffer == NULL ) || ( pucResponseBuffer == NULL ) || ( xResponseBufferSize < 4U ) )
+    {
+        return HTTPInvalidParameter;
+    }
+
+    pcHost = NULL;
+
+    if( ( xUrlLen > 7U ) && ( memcmp( pcUrl, "http://", 7 ) == 0 ) )
+    {
+        pcHost = pcUrl + 7;
+    }
+    else if( ( xUrlLen > 8U ) && ( memcmp( pcUrl, "https://", 8 ) == 0 ) )
+    {
+        pcHost = pcUrl + 8;
+        xSecure = true;
+    }
+
+    if( pcHost == NULL )
+    {
+        return HTTPInvalidParameter;
+    }
+
+    pcPath = memchr( pcHost, '/', ( size_t ) ( pcEnd - pcHost ) );
+
+    if( ( pcPath == NULL ) || ( pcPath == pcHost ) )
+    {
+        return HTTPInvalidParameter;
+    }
+
+    /* An explicit port follows the host name. */
+    pcPort = memchr( pcHost, ':', ( size_t ) ( pcPath - pcHost ) );
+    ulPort = xSecure ? 443U : 80U;
+
+    if( pcPort != NULL )
+    {
+        if( ( pcPort == pcHost ) || ( pcPort + 1 == pcPath ) )
+        {
+            return HTTPInvalidParameter;
+        }
+
+        ulPort = 0;
+
+        for( pcDigit = pcPort + 1; pcDigit < pcPath; pcDigit++ )
+        {
+            if( ( *pcDigit < '0' ) || ( *pcDigit > '9' ) || ( ulPort > ( UINT16_MAX / 10U ) ) )
+            {
+                return HTTPInvalidParameter;
+            }
+
+            ulPort = ( ulPort * 10U ) + ( uint32_t ) ( *pcDigit - '0' );
+        }
+
+        if( ( ulPort == 0U ) || ( ulPort > UINT16_MAX ) )
+        {
+            return HTTPInvalidParameter;
+        }
+    }
+
+    memset( pxPipeline, 0, sizeof( *pxPipeline ) );
+    pxPipeline->pxTransport = pxTransport;
+    pxPipeline->pcHost = pcHost;
+    pxPipeline->xHostLen = ( size_t ) ( pcPath - pcHost );
+    pxPipeline->xHostNameLen = ( size_t ) ( ( ( pcPort != NULL ) ? pcPort : pcPath ) - pcHost );
+    pxPipeline->usPort = ( uint16_t ) ulPort;
+    pxPipeline->xSecure = xSecure;
+    pxPipeline->pcPath = pcPath;
+    pxPipeline->xPathLen = ( size_t ) ( pcEnd - pcPath );
+    pxPipeline->pucRequestBuffer = pucRequestBuffer;
+    pxPipeline->xRequestBufferSize = xRequestBufferSize;
+    pxPipeline->pucResponseBuffer = pucResponseBuffer;
+    pxPipeline->xResponseBufferSize = xResponseBufferSize;
+
+    return HTTPSuccess;
+}
+
+/*-----------------------------------------------------------*/
+
+void httpRangePipelineReset( HTTPRangePipeline_t * pxPipeline )
+{
+    pxPipeline->xHead = 0;
+    pxPipeline->xInFlight = 0;
+    pxPipeline->xResponseBuffered = 0;
+}
+
+/*-----------------------------------------------------------*/
+
+HTTPStatus_t httpRangePipelineSend( HTTPRangePipeline_t * pxPipeline,
+                                    uint32_t ulRangeStart,
+                                    uint32_t ulRangeEnd )
+{
+    HTTPRequestHeaders_t xHeaders = { 0 };
+    HTTPRequestInfo_t xRequestInfo = { 0 };
+    HTTPStatus_t xStatus;
+    const TransportInterface_t * pxTransport = pxPipeline->pxTransport;
+    size_t xSent = 0;
+    uint32_t ulIdle = 0;
+    int32_t lSent;
+
+    if( ( pxPipeline->xInFlight >= httpPIPELINE_MAX_DEPTH ) ||
+        ( ulRangeEnd < ulRangeStart ) || ( ulRangeEnd > ( uint32_t ) INT32_MAX ) )
+    {
+        return ( pxPipeline->xInFlight >= httpPIPELINE_MAX_DEPTH ) ? HTTPInsufficientMemory : HTTPInvalidParameter;
+    }
+
+    xHeaders.pBuffer = pxPipeline->pucRequestBuffer;
+    xHeaders.bufferLen = pxPipeline->xRequestBufferSize;
+
+    xRequestInfo.pMethod = HTTP_METHOD_GET;
+    xRequestInfo.methodLen = sizeof( HTTP_METHOD_GET ) - 1U;
+    xRequestInfo.pPath = pxPipeline->pcPath;
+    xRequestInfo.pathLen = pxPipeline->xPathLen;
+    xRequestInfo.pHost = pxPipeline->pcHost;
+    xRequestInfo.hostLen = pxPipeline->xHostLen;
+    xRequestInfo.reqFlags = HTTP_REQUEST_KEEP_ALIVE_FLAG;
+
+    xStatus = HTTPClient_InitializeRequestHeaders( &xHeaders, &xRequestInfo );
+
+    if( xStatus == HTTPSuccess )
+    {
+        xStatus = HTTPClient_AddRangeHeader( &xHeaders, ( int32_t ) ulRangeStart, ( int32_t ) ulRangeEnd );
+    }
+
+    if( xStatus != HTTPSuccess )
+    {
+        return xStatus;
+    }
+
+    while( ( xSent < xHeaders.headersLen ) && ( ulIdle < httpPIPELINE_MAX_IDLE_CALLS ) )
+    {
+        lSent = pxTransport->send( pxTransport->pNetworkContext,
+                                   xHeaders.pBuffer + xSent,
+                                   xHeaders.headersLen - xSent );
+
+        if( lSent < 0 )
+        {
+            return HTTPNetworkError;
+        }
+
+        ulIdle = ( lSent == 0 ) ? ( ulIdle + 1U ) : 0U;
+        xSent += ( size_t ) lSent;
+    }
+
+    if( xSent < xHeaders.headersLen )
+    {
+        return HTTPNetworkError;
+    }
+
+    pxPipeline->pulRangeStart[ ( pxPipeline->xHead + pxPipeline->xInFlight ) % httpPIPELINE_MAX_DEPTH ] = ulRangeStart;
+    pxPipeline->xInFlight++;
+
+    return HTTPSuccess;
+}
+
+/*-----------------------------------------------------------*/
+
+/*
+ * @brief Receive the headers of the response to the oldest request in flight and
+ * check it is the requested range.
+ *
+ * On success the headers are the first @p pxHeadersLen bytes of the response
+ * buffer, followed by the part of the body read along with them.
+ */
+static HTTPStatus_t prvReceiveHeaders( HTTPRangePipeline_t * pxPipeline,
+                                       size_t * pxHeadersLen,
+                                       uint32_t * pulContentLength,
+                                       bool * pxChunked )
+{
+    uint8_t * pucBuffer = pxPipeline->pucResponseBuffer;
+    size_t xHeadersLen = 0;
+    size_t i;
+    uint32_t ulRangeStart = 0;
+    int32_t lReceived;
+    HTTPStatus_t xStatus;
+
+    if( pxPipeline->xInFlight == 0U )
+    {
+        return HTTPInvalidParameter;
+    }
+
+    /* Read until the end of the headers. Bytes past it belong to the body, and
+     * possibly to the next responses. */
+    while( xHeadersLen == 0U )
+    {
+        for( i = 3; i < pxPipeline->xResponseBuffered; i++ )
+        {
+            if( memcmp( &pucBuffer[ i - 3U ], "\r\n\r\n", 4 ) == 0 )
+            {
+                xHeadersLen = i + 1U;
+                break;
+            }
+        }
+
+        if( xHeadersLen != 0U )
+        {
+            break;
+        }
+
+        if( pxPipeline->xResponseBuffered == pxPipeline->xResponseBufferSize )
+        {
+            return HTTPSecurityAlertResponseHeadersSizeLimitExceeded;
+        }
+
+        lReceived = prvRecv( pxPipeline->pxTransport,
+                             &pucBuffer[ pxPipeline->xResponseBuffered ],
+                             pxPipeline->xResponseBufferSize - pxPipeline->xResponseBuffered );
+
+        if( lReceived < 0 )
+        {
+            return ( pxPipeline->xResponseBuffered == 0U ) ? HTTPNoResponse : HTTPNetworkError;
+        }
+
+        pxPipeline->xResponseBuffered += ( size_t ) lReceived;
+    }
+
+    xStatus = prvParseHeaders( pxPipeline, ( const char * ) pucBuffer, xHeadersLen,
+                               pulContentLength, pxChunked, &ulRangeStart );
+
+    if( ( xStatus == HTTPSuccess ) && ( ulRangeStart != pxPipeline->pulRangeStart[ pxPipeline->xHead ] ) )
+    {
+        xStatus = HTTPInvalidResponse;
+    }
+
+    *pxHeadersLen = xHeadersLen;
+
+    return xStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+/*
+ * @brief Make room after the unconsumed bytes of the response buffer, from
+ * @p pxPos on, and receive more.
+ *
+ * Only bytes which must be contiguous, chunk size lines and the responses that
+ * follow, are moved: the caller consumes everything else before calling this.
+ */
+static HTTPStatus_t prvStreamFill( HTTPRangePipeline_t * pxPipeline,
+                                   size_t * pxPos )
+{
+    uint8_t * pucBuffer = pxPipeline->pucResponseBuffer;
+    int32_t lReceived;
+
+    pxPipeline->xResponseBuffered -= *pxPos;
+    memmove( pucBuffer, &pucBuffer[ *pxPos ], pxPipeline->xResponseBuffered );
+    *pxPos = 0;
+
+    if( pxPipeline->xResponseBuffered == pxPipeline->xResponseBufferSize )
+    {
+        /* A line of the chunked encoding longer than the buffer. */
+        return HTTPInvalidResponse;
+    }
+
+    lReceived = prvRecv( pxPipeline->pxTransport,
+                         &pucBuffer[ pxPipeline->xResponseBuffered ],
+                         pxPipeline->xResponseBufferSize - pxPipeline->xResponseBuffered );
+
+    if( lReceived < 0 )
+    {
+        return HTTPNetworkError;
+    }
+
+    pxPipeline->xResponseBuffered += ( size_t ) lReceived;
+
+    return HTTPSuccess;
+}
+
+/*-----------------------------------------------------------*/
+
+/*
+ * @brief Hand @p ulLength bytes of body to the callback, as slices of the
+ * response buffer.
+ */
+static HTTPStatus_t prvStreamData( HTTPRangePipeline_t * pxPipeline,
+                                   size_t * pxPos,
+                                   uint32_t ulLength,
+                                   HTTPRangeBodyCallback_t xCallback,
+                                   void * pvContext )
+{
+    size_t xSlice;
+    HTTPStatus_t xStatus = HTTPSuccess;
+
+    while( ( xStatus == HTTPSuccess ) && ( ulLength > 0U ) )
+    {
+        if( *pxPos == pxPipeline->xResponseBuffered )
+        {
+            xStatus = prvStreamFill( pxPipeline, pxPos );
+            continue;
+        }
+
+        xSlice = pxPipeline->xResponseBuffered - *pxPos;
+        xSlice = ( xSlice < ulLength ) ? xSlice : ulLength;
+
+        xCallback( pvContext, &pxPipeline->pucResponseBuffer[ *pxPos ], xSlice );
+
+        *pxPos += xSlice;
+        ulLength -= ( uint32_t ) xSlice;
+    }
+
+    return xStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+/*
+ * @brief Take the next line of the chunked encoding, without its line ending.
+ */
+static HTTPStatus_t prvStreamLine( HTTPRangePipeline_t * pxPipeline,
+                                   size_t * pxPos,
+                                   const char ** ppcLine,
+                                   size_t * pxLineLen )
+{
+    const uint8_t * pucEnd = NULL;
+    HTTPStatus_t xStatus = HTTPSuccess;
+
+    while( xStatus == HTTPSuccess )
+    {
+        pucEnd = memchr( &pxPipeline->pucResponseBuffer[ *pxPos ], '\n', pxPipeline->xResponseBuffered - *pxPos );
+
+        if( pucEnd != NULL )
+        {
+            break;
+        }
+
+        xStatus = prvStreamFill( pxPipeline, pxPos );
+    }
+
+    if( xStatus == HTTPSuccess )
+    {
+        *ppcLine = ( const char * ) &pxPipeline->pucResponseBuffer[ *pxPos ];
+        *pxLineLen = ( size_t ) ( ( const char * ) pucEnd - *ppcLine );
+        *pxPos += *pxLineLen + 1U;
+
+        if( ( *pxLineLen > 0U ) && ( ( *ppcLine )[ *pxLineLen - 1U ] == '\r' ) )
+        {
+            ( *pxLineLen )--;
+        }
+    }
+
+    return xStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+/*
+ * @brief Stream the chunks of a chunked body, then skip its trailer.
+ */
+static HTTPStatus_t prvStreamChunks( HTTPRangePipeline_t * pxPipeline,
+                                     size_t * pxPos,
+                                     HTTPRangeBodyCallback_t xCallback,
+                                     void * pvContext,
+                                     size_t * pxBodyLen )
+{
+    const char * pcLine;
+    size_t xLineLen;
+    size_t i;
+    uint32_t ulChunkSize;
+    uint32_t ulDigit;
+    HTTPStatus_t xStatus;
+
+    *pxBodyLen = 0;
+
+    for( ; ; )
+    {
+        /* chunk-size [ ";" chunk-ext ] CRLF */
+        xStatus = prvStreamLine( pxPipeline, pxPos, &pcLine, &xLineLen );
+
+        if( xStatus != HTTPSuccess )
+        {
+            return xStatus;
+        }
+
+        ulChunkSize = 0;
+
+        for( i = 0; i < xLineLen; i++ )
+        {
+            if( ( pcLine[ i ] >= '0' ) && ( pcLine[ i ] <= '9' ) )
+            {
+                ulDigit = ( uint32_t ) ( pcLine[ i ] - '0' );
+            }
+            else if( ( pcLine[ i ] >= 'a' ) && ( pcLine[ i ] <= 'f' ) )
+            {
+                ulDigit = ( uint32_t ) ( pcLine[ i ] - 'a' + 10 );
+            }
+            else if( ( pcLine[ i ] >= 'A' ) && ( pcLine[ i ] <= 'F' ) )
+            {
+                ulDigit = ( uint32_t ) ( pcLine[ i ] - 'A' + 10 );
+            }
+            else
+            {
+                break;
+            }
+
+            if( ulChunkSize > ( UINT32_MAX >> 4 ) )
+            {
+                return HTTPInvalidResponse;
+            }
+
+            ulChunkSize = ( ulChunkSize << 4 ) | ulDigit;
+        }
+
+        if( ( i == 0U ) ||
+            ( ( i < xLineLen ) && ( pcLine[ i ] != ';' ) && ( pcLine[ i ] != ' ' ) && ( pcLine[ i ] != '\t' ) ) )
+        {
+            return HTTPInvalidResponse;
+        }
+
+        if( ulChunkSize == 0U )
+        {
+            break;
+        }
+
+        if( ( size_t ) ulChunkSize > ( SIZE_MAX - *pxBodyLen ) )
+        {
+            return HTTPInvalidResponse;
+        }
+
+        xStatus = prvStreamData( pxPipeline, pxPos, ulChunkSize, xCallback, pvContext );
+
+        if( xStatus == HTTPSuccess )
+        {
+            *pxBodyLen += ulChunkSize;
+
+            /* The CRLF closing the chunk data. */
+            xStatus = prvStreamLine( pxPipeline, pxPos, &pcLine, &xLineLen );
+        }
+
+        if( xStatus != HTTPSuccess )
+        {
+            return xStatus;
+        }
+
+        if( xLineLen != 0U )
+        {
+            return HTTPInvalidResponse;
+        }
+    }
+
+    /* Trailer fields, up to an empty line. */
+    do
+    {
+        xStatus = prvStreamLine( pxPipeline, pxPos, &pcLine, &xLineLen );
+    } while( ( xStatus == HTTPSuccess ) && ( xLineLen != 0U ) );
+
+    return xStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+HTTPStatus_t httpRangePipelineReceive( HTTPRangePipeline_t * pxPipeline,
+                                       uint8_t * pucBody,
+                                       size_t xBodySize,
+                                       size_t * pxBodyLen )
+{
+    uint8_t * pucBuffer = pxPipeline->pucResponseBuffer;
+    size_t xHeadersLen = 0;
+    size_t xBuffered;
+    size_t xCopied;
+    uint32_t ulContentLength = 0;
+    bool xChunked = false;
+    int32_t lReceived;
+    HTTPStatus_t xStatus;
+
+    xStatus = prvReceiveHeaders( pxPipeline, &xHeadersLen, &ulContentLength, &xChunked );
+
+    if( ( xStatus == HTTPSuccess ) && ( xChunked == true ) )
+    {
+        /* The size of a chunked body is only known once read. */
+        xStatus = HTTPSecurityAlertInvalidContentLength;
+    }
+
+    if( ( xStatus == HTTPSuccess ) && ( ulContentLength > xBodySize ) )
+    {
+        xStatus = HTTPInsufficientMemory;
+    }
+
+    if( xStatus != HTTPSuccess )
+    {
+        return xStatus;
+    }
+
+    /* Take the start of the body from the header buffer and keep what follows it. */
+    xBuffered = pxPipeline->xResponseBuffered - xHeadersLen;
+    xCopied = ( xBuffered < ulContentLength ) ? xBuffered : ulContentLength;
+    memcpy( pucBody, &pucBuffer[ xHeadersLen ], xCopied );
+    pxPipeline->xResponseBuffered = xBuffered - xCopied;
+    memmove( pucBuffer, &pucBuffer[ xHeadersLen + xCopied ], pxPipeline->xResponseBuffered );
+
+    /* The rest of the body goes straight to the caller's buffer. */
+    while( xCopied < ulContentLength )
+    {
+        lReceived = prvRecv( pxPipeline->pxTransport, &pucBody[ xCopied ], ulContentLength - xCopied );
+
+        if( lReceived < 0 )
+        {
+            return HTTPNetworkError;
+        }
+
+        xCopied += ( size_t ) lReceived;
+    }
+
+    pxPipeline->xHead = ( pxPipeline->xHead + 1U ) % httpPIPELINE_MAX_DEPTH;
+    pxPipeline->xInFlight--;
+    *pxBodyLen = xCopied;
+
+    return HTTPSuccess;
+}
+
+/*-----------------------------------------------------------*/
+
+HTTPStatus_t httpRangePipelineReceiveStream( HTTPRangePipeline_t * pxPipeline,
+                                             HTTPRangeBodyCallback_t xCallback,
+                                             void * pvContext,
+                                             size_t * pxBodyLen )
+{
+    size_t xPos = 0;
+    uint32_t ulContentLength = 0;
+    bool xChunked = false;
+    HTTPStatus_t xStatus;
+
+    if( xCallback == NULL )
+    {
+        return HTTPInvalidParameter;
+    }
+
+    xStatus = prvReceiveHeaders( pxPipeline, &xPos, &ulContentLength, &xChunked );
+
+    if( xStatus == HTTPSuccess )
+    {
+        if( xChunked == true )
+        {
+            xStatus = prvStreamChunks( pxPipeline, &xPos, xCallback, pvContext, pxBodyLen );
+        }
+        else
+        {
+            xStatus = prvStreamData( pxPipeline, &xPos, ulContentLength, xCallback, pvContext );
+            *pxBodyLen = ulContentLength;
+        }
+    }
+
+    if( xStatus != HTTPSuccess )
+    {
+        return xStatus;
+    }
+
+    /* Keep the start of the next responses. */
+    pxPipeline->xResponseBuffered -= xPos;
+    memmove( pxPipeline->pucResponseBuffer, &pxPipeline->pucResponseBuffer[ xPos ], pxPipeline->xResponseBuffered );
+
+    pxPipeline->xHead = ( pxPipeline->xHead + 1U ) % httpPIPELINE_MAX_DEPTH;
+    pxPipeline->xInFlight--;
+
+    return HTTPSuccess;
+}
+
+/*-----------------------------------------------------------*/
+
+size_t httpRangePipelineInFlight( const HTTPRangePipeline_t * pxPipeline )
+{
+    return pxPipeline->xInFlight;
+}
+
+/*-----------------------------------------------------------*/
+
+uint32_t httpRangePipelineNextStart( const HTTPRangePipeline_t * pxPipeline )
+{
+    return pxPipeline->pulRangeStart[ pxPipeline->xHead ];
+}
+
+/*-----------------------------------------------------------*/
+
+uint32_t httpRangePipelineTotalSize( const HTTPRangePipeline_t * pxPipeline )
+{
+    return pxPipeline->ulTotalSize;
+}
+
+/*-----------------------------------------------------------*/
+
+void httpRangePipelineServer( const HTTPRangePipeline_t * pxPipeline,
+                              const char ** ppcHostName,
+                              size_t * pxHostNameLen,
+                              uint16_t * pusPort,
+                              bool * pxSecure )
+{
+    *ppcHostName = pxPipeline->pcHost;
+    *pxHostNameLen = pxPipeline->xHostNameLen;
+    *pusPort = pxPipeline->usPort;
+    *pxSecure = pxPipeline->xSecure;
+}
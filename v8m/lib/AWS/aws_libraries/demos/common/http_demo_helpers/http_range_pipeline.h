@@ -0,0 +1,240 @@
+/*
+ * Copyright (c) 2023 Arm Limited. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+/**
+ * @file http_range_pipeline.h
+ * @brief Pipelined HTTP/1.1 range requests over a persistent connection.
+ *
+ * Several GET requests with a Range header are written back to back on the same
+ * connection, then the responses are read in order. The body of each response is
+ * either received directly into a buffer provided by the caller, so only the part
+ * read along with the response headers is copied, or handed to a callback as
+ * slices of the response buffer, with no body buffer and no copy at all.
+ *
+ * Requests are serialized with coreHTTP. Responses are expected to be
+ * "206 Partial Content" with a Content-Length, as returned by S3 for ranges, or
+ * with chunked transfer coding when streamed to a callback; other responses are
+ * reported as errors and the connection should be re-established.
+ */
+
+#ifndef HTTP_RANGE_PIPELINE_H
+#define HTTP_RANGE_PIPELINE_H
+
+/* Standard includes. */
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* HTTP API header. */
+#include "core_http_client.h"
+
+/* Transport interface header. */
+#include "transport_interface.h"
+
+/**
+ * @brief Maximum number of requests in flight on a pipeline.
+ */
+#ifndef httpPIPELINE_MAX_DEPTH
+    #define httpPIPELINE_MAX_DEPTH    ( 8U )
+#endif
+
+/**
+ * @brief Number of consecutive transport calls transferring no data before a send
+ * or a receive gives up. Each such call blocks for the transport timeout.
+ */
+#ifndef httpPIPELINE_MAX_IDLE_CALLS
+    #define httpPIPELINE_MAX_IDLE_CALLS    ( 20U )
+#endif
+
+/**
+ * @brief Receives the body of a response streamed by
+ * httpRangePipelineReceiveStream().
+ *
+ * @param[in] pvContext Context given to httpRangePipelineReceiveStream().
+ * @param[in] pucData Next bytes of the body. They are in the response buffer of
+ * the pipeline, and only valid until the callback returns.
+ * @param[in] xLength Number of bytes at @p pucData, never 0.
+ */
+typedef void ( * HTTPRangeBodyCallback_t )( void * pvContext,
+                                           const uint8_t * pucData,
+                                           size_t xLength );
+
+/**
+ * @brief State of a range request pipeline.
+ *
+ * All fields are private to http_range_pipeline.c.
+ */
+typedef struct HTTPRangePipeline
+{
+    const TransportInterface_t * pxTransport;
+    const char * pcHost; /* Authority of the URL, for the Host header. */
+    size_t xHostLen;
+    size_t xHostNameLen; /* Length of the host name at the start of pcHost, without the port. */
+    uint16_t usPort;
+    bool xSecure;
+    const char * pcPath;
+    size_t xPathLen;
+
+    uint8_t * pucRequestBuffer;
+    size_t xRequestBufferSize;
+    uint8_t * pucResponseBuffer;
+    size_t xResponseBufferSize;
+    size_t xResponseBuffered; /* Bytes received but not consumed yet, at the start of pucResponseBuffer. */
+
+    uint32_t pulRangeStart[ httpPIPELINE_MAX_DEPTH ];
+    size_t xHead;
+    size_t xInFlight;
+
+    uint32_t ulTotalSize; /* Size of the whole file from Content-Range, 0 until known. */
+} HTTPRangePipeline_t;
+
+/**
+ * @brief Set up a pipeline for the file at the given URL.
+ *
+ * The URL must start with "http://" or "https://" and must outlive the pipeline.
+ * The connection described by @p pxTransport must already be established.
+ *
+ * @param[out] pxPipeline The pipeline to initialize.
+ * @param[in] pxTransport Transport of the connection to the server of the URL.
+ * @param[in] pcUrl URL of the file.
+ * @param[in] xUrlLen Length of the URL.
+ * @param[in] pucRequestBuffer Buffer to serialize requests in. It must hold the
+ * request line, including the path and query of the URL, and the headers.
+ * @param[in] xRequestBufferSize Size of @p pucRequestBuffer.
+ * @param[in] pucResponseBuffer Buffer to receive response headers in.
+ * @param[in] xResponseBufferSize Size of @p pucResponseBuffer.
+ *
+ * @return HTTPSuccess, or HTTPInvalidParameter if the URL cannot be parsed.
+ */
+HTTPStatus_t httpRangePipelineInit( HTTPRangePipeline_t * pxPipeline,
+                                    const TransportInterface_t * pxTransport,
+                                    const char * pcUrl,
+                                    size_t xUrlLen,
+                                    uint8_t * pucRequestBuffer,
+                                    size_t xRequestBufferSize,
+                                    uint8_t * pucResponseBuffer,
+                                    size_t xResponseBufferSize );
+
+/**
+ * @brief Forget the requests in flight, after the connection was re-established.
+ *
+ * @param[in] pxPipeline The pipeline to reset.
+ */
+void httpRangePipelineReset( HTTPRangePipeline_t * pxPipeline );
+
+/**
+ * @brief Send a request for the bytes from @p ulRangeStart to @p ulRangeEnd,
+ * inclusive, without waiting for the response.
+ *
+ * @param[in] pxPipeline The pipeline.
+ * @param[in] ulRangeStart First byte of the range.
+ * @param[in] ulRangeEnd Last byte of the range.
+ *
+ * @return HTTPSuccess, HTTPInsufficientMemory if httpPIPELINE_MAX_DEPTH requests
+ * are in flight or the request does not fit the request buffer, or
+ * HTTPNetworkError.
+ */
+HTTPStatus_t httpRangePipelineSend( HTTPRangePipeline_t * pxPipeline,
+                                    uint32_t ulRangeStart,
+                                    uint32_t ulRangeEnd );
+
+/**
+ * @brief Receive the response to the oldest request in flight.
+ *
+ * @param[in] pxPipeline The pipeline.
+ * @param[out] pucBody Buffer to receive the body in.
+ * @param[in] xBodySize Size of @p pucBody.
+ * @param[out] pxBodyLen Length of the body received.
+ *
+ * @return HTTPSuccess, HTTPInvalidParameter if no request is in flight,
+ * HTTPInsufficientMemory if the body does not fit @p pucBody,
+ * HTTPSecurityAlertResponseHeadersSizeLimitExceeded if the headers do not fit the
+ * response buffer, HTTPSecurityAlertInvalidContentLength if the response has no
+ * Content-Length, HTTPInvalidResponse for a response other than the requested
+ * range, HTTPNoResponse or HTTPNetworkError.
+ */
+HTTPStatus_t httpRangePipelineReceive( HTTPRangePipeline_t * pxPipeline,
+                                       uint8_t * pucBody,
+                                       size_t xBodySize,
+                                       size_t * pxBodyLen );
+
+/**
+ * @brief Receive the response to the oldest request in flight, handing its body
+ * to @p xCallback as it is received.
+ *
+ * The body is received into the response buffer of the pipeline and each slice
+ * is passed to @p xCallback in place, including the part read along with the
+ * headers and the data of each chunk of a chunked response. The response buffer
+ * must hold the headers and the longest line of the chunked coding.
+ *
+ * @param[in] pxPipeline The pipeline.
+ * @param[in] xCallback Called with each slice of the body, in order.
+ * @param[in] pvContext Passed to @p xCallback.
+ * @param[out] pxBodyLen Length of the whole body.
+ *
+ * @return HTTPSuccess, HTTPInvalidParameter if no request is in flight or
+ * @p xCallback is NULL, HTTPSecurityAlertResponseHeadersSizeLimitExceeded if the
+ * headers do not fit the response buffer, HTTPSecurityAlertInvalidContentLength if
+ * the response has neither a Content-Length nor chunked coding, HTTPInvalidResponse
+ * for a response other than the requested range or malformed chunked coding,
+ * HTTPNoResponse or HTTPNetworkError. @p xCallback may have been called before an
+ * error, with the part of the body received until then.
+ */
+HTTPStatus_t httpRangePipelineReceiveStream( HTTPRangePipeline_t * pxPipeline,
+                                             HTTPRangeBodyCallback_t xCallback,
+                                             void * pvContext,
+                                             size_t * pxBodyLen );
+
+/**
+ * @brief Number of requests sent and not received yet.
+ */
+size_t httpRangePipelineInFlight( const HTTPRangePipeline_t * pxPipeline );
+
+/**
+ * @brief First byte of the range of the oldest request in flight.
+ *
+ * Only meaningful when httpRangePipelineInFlight() is not 0.
+ */
+uint32_t httpRangePipelineNextStart( const HTTPRangePipeline_t * pxPipeline );
+
+/**
+ * @brief Size of the whole file as reported by the server, or 0 until a response
+ * was received.
+ */
+uint32_t httpRangePipelineTotalSize( const HTTPRangePipeline_t * pxPipeline );
+
+/**
+ * @brief Server of the URL the pipeline was set up with, to connect to it.
+ *
+ * @param[in] pxPipeline The pipeline.
+ * @param[out] ppcHostName Host name, in the URL so not NULL-terminated.
+ * @param[out] pxHostNameLen Length of the host name.
+ * @param[out] pusPort Port given in the URL, or else the default of its scheme.
+ * @param[out] pxSecure Whether the scheme is "https".
+ */
+void httpRangePipelineServer( const HTTPRangePipeline_t * pxPipeline,
+                              const char ** ppcHostName,
+                              size_t * pxHostNameLen,
+                              uint16_t * pusPort,
+                              bool * pxSecure );
+
+#endif /* ifndef HTTP_RANGE_PIPELINE_H */
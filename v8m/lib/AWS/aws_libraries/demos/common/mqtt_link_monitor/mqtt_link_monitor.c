@@ -0,0 +1,375 @@
+/*
+ * Copyright (c) 2023 Arm Limited. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+/**
+ * @file mqtt_link_monitor.c
+ * @brief Keep-alive interval and reconnect backoff chosen from observations of
+ * the link to the MQTT broker.
+ */
+
+/* Standard includes. */
+#include <string.h>
+
+#include "mqtt_link_monitor.h"
+
+/**
+ * @brief Weight of a new observation in the smoothed loss, as a shift.
+ */
+#define LINK_LOSS_SHIFT                ( 3U )
+
+/**
+ * @brief Keep-alive intervals closer than this to the idle timeout found are not
+ * probed, in seconds.
+ */
+#define LINK_PROBE_RESOLUTION_SECONDS    ( 10U )
+
+/**
+ * @brief Allowance for timer jitter when an idle gap is compared to the
+ * keep-alive interval, in milliseconds. The round trip time is allowed for too,
+ * as the interval runs from the last packet sent and the gap from the last
+ * packet received.
+ */
+#define LINK_IDLE_SLACK_MS               ( 500U )
+
+/*-----------------------------------------------------------*/
+
+static uint16_t prvClampKeepAlive( uint32_t ulSeconds )
+{
+    if( ulSeconds < mqttlinkMIN_KEEP_ALIVE_SECONDS )
+    {
+        ulSeconds = mqttlinkMIN_KEEP_ALIVE_SECONDS;
+    }
+    else if( ulSeconds > mqttlinkMAX_KEEP_ALIVE_SECONDS )
+    {
+        ulSeconds = mqttlinkMAX_KEEP_ALIVE_SECONDS;
+    }
+
+    return ( uint16_t ) ulSeconds;
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvUpdateLoss( MQTTLinkMetrics_t * pxMetrics,
+                           bool xLost )
+{
+    uint32_t ulLoss = pxMetrics->usLossPermille;
+
+    ulLoss = ulLoss - ( ulLoss >> LINK_LOSS_SHIFT ) + ( xLost ? ( 1000U >> LINK_LOSS_SHIFT ) : 0U );
+    pxMetrics->usLossPermille = ( uint16_t ) ulLoss;
+}
+
+/*-----------------------------------------------------------*/
+
+/* The path kept a connection idle for ulKeepAlive seconds. */
+static void prvRecordSurvived( MQTTLinkMonitor_t * pxMonitor,
+                               uint32_t ulKeepAlive )
+{
+    MQTTLinkMetrics_t * pxMetrics = &pxMonitor->xMetrics;
+
+    pxMonitor->ucUnexpectedTimeouts = 0;
+
+    if( ulKeepAlive > pxMetrics->usIdleSurvivedSeconds )
+    {
+        pxMetrics->usIdleSurvivedSeconds = ( uint16_t ) ulKeepAlive;
+    }
+
+    if( pxMetrics->usIdleTimeoutSeconds <= pxMetrics->usIdleSurvivedSeconds )
+    {
+        pxMetrics->usIdleTimeoutSeconds = 0;
+        pxMonitor->ucIdleTimeoutHits = 0;
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+void MQTTLinkMonitor_Init( MQTTLinkMonitor_t * pxMonitor,
+                           uint16_t usKeepAliveSeconds )
+{
+    memset( pxMonitor, 0, sizeof( *pxMonitor ) );
+    pxMonitor->xMetrics.usKeepAliveSeconds = prvClampKeepAlive( usKeepAliveSeconds );
+}
+
+/*-----------------------------------------------------------*/
+
+void MQTTLinkMonitor_ConnectAttempt( MQTTLinkMonitor_t * pxMonitor,
+                                     bool xConnected,
+                                     uint32_t ulRttMs,
+                                     uint32_t ulNowMs )
+{
+    MQTTLinkMetrics_t * pxMetrics = &pxMonitor->xMetrics;
+    uint32_t ulDelta;
+
+    prvUpdateLoss( pxMetrics, !xConnected );
+
+    if( xConnected == false )
+    {
+        pxMetrics->ulConnectFailures++;
+        return;
+    }
+
+    pxMetrics->ulConnections++;
+    pxMonitor->ulBackoffMs = 0;
+    pxMonitor->ulLastTrafficMs = ulNowMs;
+    pxMonitor->ulSampleMs = ulNowMs;
+    pxMonitor->ulIdleMs = 0;
+    pxMonitor->ucIdleIntervals = 0;
+    pxMonitor->xConnected = true;
+
+    /* Smoothed round trip time and variation as in RFC 6298. */
+    if( pxMetrics->ulRttMs == 0U )
+    {
+        pxMetrics->ulRttMs = ulRttMs;
+        pxMetrics->ulRttVarMs = ulRttMs / 2U;
+    }
+    else
+    {
+        ulDelta = ( ulRttMs > pxMetrics->ulRttMs ) ? ( ulRttMs - pxMetrics->ulRttMs ) : ( pxMetrics->ulRttMs - ulRttMs );
+        pxMetrics->ulRttVarMs = ( ( 3U * pxMetrics->ulRttVarMs ) + ulDelta ) / 4U;
+        pxMetrics->ulRttMs = ( ( 7U * pxMetrics->ulRttMs ) + ulRttMs ) / 8U;
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+void MQTTLinkMonitor_Activity( MQTTLinkMonitor_t * pxMonitor,
+                               uint32_t ulLastTxMs,
+                               uint32_t ulLastRxMs,
+                               uint32_t ulNowMs )
+{
+    const MQTTLinkMetrics_t * pxMetrics = &pxMonitor->xMetrics;
+    uint32_t ulIntervalMs = pxMetrics->usKeepAliveSeconds * 1000U;
+    uint32_t ulSlackMs = LINK_IDLE_SLACK_MS + pxMetrics->ulRttMs + ( 4U * pxMetrics->ulRttVarMs );
+    bool xSent = ( ulLastTxMs != pxMonitor->ulLastTxMs );
+    bool xReceived = ( ulLastRxMs != pxMonitor->ulLastRxMs );
+    uint32_t ulLatestMs;
+    uint32_t ulGapMs;
+
+    pxMonitor->ulLastTxMs = ulLastTxMs;
+    pxMonitor->ulLastRxMs = ulLastRxMs;
+
+    if( pxMonitor->xConnected == false )
+    {
+        return;
+    }
+
+    if( ( xSent == false ) && ( xReceived == false ) )
+    {
+        pxMonitor->ulSampleMs = ulNowMs;
+        return;
+    }
+
+    /* Only the last packet sent and the last packet received are known. The
+     * gap ended with the first packet since the previous sample, taking the
+     * previous sample as its end never makes it look longer than it was. */
+    ulGapMs = pxMonitor->ulSampleMs - pxMonitor->ulLastTrafficMs;
+    pxMonitor->ulSampleMs = ulNowMs;
+
+    if( ulGapMs > pxMonitor->ulIdleMs )
+    {
+        pxMonitor->ulIdleMs = ulGapMs;
+    }
+
+    /* The path may have dropped the connection during a gap ended by a packet
+     * sent, this is only known once the broker answers. */
+    if( xReceived == true )
+    {
+        if( ( ( pxMonitor->ulIdleMs + ulSlackMs ) >= ulIntervalMs ) &&
+            ( pxMonitor->ucIdleIntervals < UINT8_MAX ) )
+        {
+            pxMonitor->ucIdleIntervals++;
+        }
+
+        pxMonitor->ulIdleMs = 0;
+    }
+
+    ulLatestMs = ( xSent == true ) ? ulLastTxMs : ulLastRxMs;
+
+    if( ( xReceived == true ) && ( ( int32_t ) ( ulLastRxMs - ulLatestMs ) > 0 ) )
+    {
+        ulLatestMs = ulLastRxMs;
+    }
+
+    /* CONNECT and CONNACK predate the time the connection was reported. */
+    if( ( int32_t ) ( ulLatestMs - pxMonitor->ulLastTrafficMs ) > 0 )
+    {
+        pxMonitor->ulLastTrafficMs = ulLatestMs;
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+void MQTTLinkMonitor_ConnectionLost( MQTTLinkMonitor_t * pxMonitor,
+                                     bool xKeepAliveTimeout,
+                                     uint32_t ulNowMs )
+{
+    MQTTLinkMetrics_t * pxMetrics = &pxMonitor->xMetrics;
+    uint32_t ulKeepAlive = pxMetrics->usKeepAliveSeconds;
+    bool xSurvived;
+
+    ( void ) ulNowMs;
+
+    if( pxMonitor->xConnected == false )
+    {
+        return;
+    }
+
+    pxMonitor->xConnected = false;
+
+    /* Only idle gaps tell whether the path keeps an idle connection for a whole
+     * interval, a busy connection can last long without a single one. */
+    xSurvived = ( pxMonitor->ucIdleIntervals >= mqttlinkPROBE_INTERVALS );
+
+    if( xKeepAliveTimeout == true )
+    {
+        pxMetrics->ulKeepAliveTimeouts++;
+    }
+
+    if( xSurvived == true )
+    {
+        /* The link was idle for the whole interval several times, a keep-alive
+         * timeout now is a lost packet and does not stop the probing. */
+        prvRecordSurvived( pxMonitor, ulKeepAlive );
+
+        /* Probe a longer interval, bisecting towards the idle timeout found, then
+         * try that timeout again unless it was already seen twice. */
+        if( pxMetrics->usIdleTimeoutSeconds == 0U )
+        {
+            ulKeepAlive = ( ulKeepAlive * 3U ) / 2U;
+        }
+        else if( ( pxMetrics->usIdleTimeoutSeconds - ulKeepAlive ) > LINK_PROBE_RESOLUTION_SECONDS )
+        {
+            ulKeepAlive = ( ulKeepAlive + pxMetrics->usIdleTimeoutSeconds ) / 2U;
+        }
+        else if( pxMonitor->ucIdleTimeoutHits < 2U )
+        {
+            ulKeepAlive = pxMetrics->usIdleTimeoutSeconds;
+        }
+        else
+        {
+            /* Settled just below the idle timeout of the path. */
+        }
+    }
+    else if( xKeepAliveTimeout == false )
+    {
+        /* Lost too early to tell anything about the interval. */
+    }
+    else if( pxMonitor->ucIdleIntervals > 0U )
+    {
+        /* The path kept the connection through a whole idle interval before,
+         * so the timeout is a lost packet. Keep the interval. */
+
+        prvRecordSurvived( pxMonitor, ulKeepAlive );
+    }
+    else if( ulKeepAlive <= pxMetrics->usIdleSurvivedSeconds )
+    {
+        /* Once is a lost packet, twice in a row means that the path changed. */
+        pxMonitor->ucUnexpectedTimeouts++;
+
+        if( pxMonitor->ucUnexpectedTimeouts >= 2U )
+        {
+            pxMonitor->ucUnexpectedTimeouts = 0;
+            pxMetrics->usIdleSurvivedSeconds = 0;
+            pxMetrics->usIdleTimeoutSeconds = ( uint16_t ) ulKeepAlive;
+            pxMonitor->ucIdleTimeoutHits = 1;
+            ulKeepAlive /= 2U;
+        }
+    }
+    else
+    {
+        /* The connection was dropped while idle for at most one interval. */
+        if( ( pxMetrics->usIdleTimeoutSeconds == 0U ) || ( ulKeepAlive < pxMetrics->usIdleTimeoutSeconds ) )
+        {
+            pxMetrics->usIdleTimeoutSeconds = ( uint16_t ) ulKeepAlive;
+            pxMonitor->ucIdleTimeoutHits = 1;
+        }
+        else
+        {
+            pxMonitor->ucIdleTimeoutHits++;
+        }
+
+        /* Fall back to the longest interval known to work, or halve it. */
+        ulKeepAlive = ( pxMetrics->usIdleSurvivedSeconds != 0U ) ?
+                      pxMetrics->usIdleSurvivedSeconds : ( pxMetrics->usIdleTimeoutSeconds / 2U );
+    }
+
+    pxMetrics->usKeepAliveSeconds = prvClampKeepAlive( ulKeepAlive );
+}
+
+/*-----------------------------------------------------------*/
+
+uint16_t MQTTLinkMonitor_KeepAliveSeconds( const MQTTLinkMonitor_t * pxMonitor )
+{
+    return pxMonitor->xMetrics.usKeepAliveSeconds;
+}
+
+/*-----------------------------------------------------------*/
+
+uint32_t MQTTLinkMonitor_NextBackoffMs( MQTTLinkMonitor_t * pxMonitor,
+                                        uint32_t ulRandom )
+{
+    MQTTLinkMetrics_t * pxMetrics = &pxMonitor->xMetrics;
+    uint32_t ulFloor = mqttlinkBACKOFF_BASE_MS;
+    uint32_t ulCeiling;
+    uint32_t ulUpper;
+    uint32_t ulDelay;
+
+    ulCeiling = mqttlinkBACKOFF_MAX_MS +
+                ( ( ( mqttlinkBACKOFF_LOSSY_MAX_MS - mqttlinkBACKOFF_MAX_MS ) / 1000U ) * pxMetrics->usLossPermille );
+
+    /* Retrying sooner than a couple of round trips only adds to the congestion. */
+    if( ( 2U * ( pxMetrics->ulRttMs + ( 4U * pxMetrics->ulRttVarMs ) ) ) > ulFloor )
+    {
+        ulFloor = 2U * ( pxMetrics->ulRttMs + ( 4U * pxMetrics->ulRttVarMs ) );
+    }
+
+    if( ulFloor > ulCeiling )
+    {
+        ulFloor = ulCeiling;
+    }
+
+    /* Decorrelated jitter: between the floor and three times the previous delay. */
+    ulUpper = 3U * pxMonitor->ulBackoffMs;
+
+    if( ulUpper < ulFloor )
+    {
+        ulUpper = ulFloor;
+    }
+
+    ulDelay = ulFloor + ( ulRandom % ( ulUpper - ulFloor + 1U ) );
+
+    if( ulDelay > ulCeiling )
+    {
+        ulDelay = ulCeiling;
+    }
+
+    pxMonitor->ulBackoffMs = ulDelay;
+    pxMetrics->ulLastBackoffMs = ulDelay;
+
+    return ulDelay;
+}
+
+/*-----------------------------------------------------------*/
+
+const MQTTLinkMetrics_t * MQTTLinkMonitor_GetMetrics( const MQTTLinkMonitor_t * pxMonitor )
+{
+    return &pxMonitor->xMetrics;
+}
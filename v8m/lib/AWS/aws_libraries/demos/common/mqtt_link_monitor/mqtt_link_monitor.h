@@ -0,0 +1,202 @@
+/*
+ * Copyright (c) 2023 Arm Limited. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+/**
+ * @file mqtt_link_monitor.h
+ * @brief Keep-alive interval and reconnect backoff chosen from observations of
+ * the link to the MQTT broker.
+ *
+ * Every keep-alive exchange wakes the radio, so the interval should be as long
+ * as possible, but no longer than the time after which a NAT or firewall on the
+ * path forgets an idle connection. The interval is raised after the broker
+ * answered several times after the link was idle for a whole interval, and
+ * lowered below the interval at which the broker stopped answering PINGREQ,
+ * converging on the idle timeout of the path. A connection that stays busy
+ * says nothing about the idle timeout, however long it lasts. A
+ * timeout is taken for the idle timeout of the path only once it repeats, so that
+ * a lost PINGRESP does not shorten the interval for good.
+ *
+ * Reconnect attempts are spaced with decorrelated jitter. The shortest delay is
+ * kept above the time of a few round trips to the broker, and the longest
+ * grows with the proportion of failed attempts so that a lossy link is not kept
+ * busy with handshakes.
+ *
+ * The monitor does not lock: calls for the same connection must be serialized.
+ */
+
+#ifndef MQTT_LINK_MONITOR_H
+#define MQTT_LINK_MONITOR_H
+
+/* Standard includes. */
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * @brief Bounds of the keep-alive interval, in seconds. AWS IoT accepts 30 to
+ * 1200 seconds.
+ */
+#ifndef mqttlinkMIN_KEEP_ALIVE_SECONDS
+    #define mqttlinkMIN_KEEP_ALIVE_SECONDS    ( 30U )
+#endif
+
+#ifndef mqttlinkMAX_KEEP_ALIVE_SECONDS
+    #define mqttlinkMAX_KEEP_ALIVE_SECONDS    ( 1200U )
+#endif
+
+/**
+ * @brief Number of times the broker must answer after a whole keep-alive
+ * interval without traffic before the next connection tries a longer interval.
+ */
+#ifndef mqttlinkPROBE_INTERVALS
+    #define mqttlinkPROBE_INTERVALS    ( 3U )
+#endif
+
+/**
+ * @brief Shortest and longest reconnect delays, in milliseconds. The longest
+ * delay goes from mqttlinkBACKOFF_MAX_MS on a clean link to
+ * mqttlinkBACKOFF_LOSSY_MAX_MS when every attempt fails.
+ */
+#ifndef mqttlinkBACKOFF_BASE_MS
+    #define mqttlinkBACKOFF_BASE_MS    ( 500U )
+#endif
+
+#ifndef mqttlinkBACKOFF_MAX_MS
+    #define mqttlinkBACKOFF_MAX_MS    ( 5000U )
+#endif
+
+#ifndef mqttlinkBACKOFF_LOSSY_MAX_MS
+    #define mqttlinkBACKOFF_LOSSY_MAX_MS    ( 60000U )
+#endif
+
+/**
+ * @brief Decisions of a link monitor and the observations they are based on.
+ */
+typedef struct MQTTLinkMetrics
+{
+    uint16_t usKeepAliveSeconds;     /* Interval for the next connection. */
+    uint16_t usIdleSurvivedSeconds;  /* Longest interval a connection outlived, 0 if none. */
+    uint16_t usIdleTimeoutSeconds;   /* Shortest interval the broker stopped answering at, 0 if none. */
+    uint32_t ulRttMs;                /* Smoothed round trip time, 0 until measured. */
+    uint32_t ulRttVarMs;             /* Round trip time variation. */
+    uint16_t usLossPermille;         /* Smoothed proportion of failed connection attempts. */
+    uint32_t ulLastBackoffMs;        /* Delay before the last reconnect attempt. */
+    uint32_t ulConnections;          /* Connections established. */
+    uint32_t ulConnectFailures;      /* Attempts which did not establish a connection. */
+    uint32_t ulKeepAliveTimeouts;    /* Connections lost because PINGREQ was not answered. */
+} MQTTLinkMetrics_t;
+
+/**
+ * @brief State of a link monitor.
+ *
+ * All fields are private to mqtt_link_monitor.c.
+ */
+typedef struct MQTTLinkMonitor
+{
+    MQTTLinkMetrics_t xMetrics;
+    uint32_t ulBackoffMs;         /* Delay of the previous attempt of the current series, 0 after a connection. */
+    uint32_t ulLastTrafficMs;     /* Time of the last packet sent or received. */
+    uint32_t ulLastTxMs;          /* lastPacketTxTime of the MQTT context at the previous sample. */
+    uint32_t ulLastRxMs;          /* lastPacketRxTime of the MQTT context at the previous sample. */
+    uint32_t ulSampleMs;          /* Time of the previous sample. */
+    uint32_t ulIdleMs;            /* Idle gap ended by the last packet sent, until the broker answers. */
+    uint8_t ucIdleIntervals;      /* Answered idle gaps of at least the keep-alive interval. */
+    bool xConnected;
+    uint8_t ucIdleTimeoutHits;    /* Keep-alive timeouts at usIdleTimeoutSeconds. */
+    uint8_t ucUnexpectedTimeouts; /* Consecutive keep-alive timeouts at intervals known to work. */
+} MQTTLinkMonitor_t;
+
+/**
+ * @brief Initialize a link monitor, with the keep-alive interval to start from.
+ *
+ * @param[out] pxMonitor The monitor to initialize.
+ * @param[in] usKeepAliveSeconds Keep-alive interval of the first connection.
+ */
+void MQTTLinkMonitor_Init( MQTTLinkMonitor_t * pxMonitor,
+                           uint16_t usKeepAliveSeconds );
+
+/**
+ * @brief Report the outcome of an attempt to connect to the broker.
+ *
+ * @param[in] pxMonitor The monitor.
+ * @param[in] xConnected `true` if CONNACK accepted the connection.
+ * @param[in] ulRttMs Time between sending CONNECT and receiving CONNACK, only
+ * used when @p xConnected is `true`.
+ * @param[in] ulNowMs Current time in milliseconds.
+ */
+void MQTTLinkMonitor_ConnectAttempt( MQTTLinkMonitor_t * pxMonitor,
+                                     bool xConnected,
+                                     uint32_t ulRttMs,
+                                     uint32_t ulNowMs );
+
+/**
+ * @brief Report the traffic on the connection to the broker, as recorded by
+ * the MQTT context.
+ *
+ * Called regularly from the task running the MQTT connection, with the
+ * lastPacketTxTime and lastPacketRxTime of its context, so that the monitor
+ * sees the idle gaps of the link.
+ *
+ * @param[in] pxMonitor The monitor.
+ * @param[in] ulLastTxMs Time the last packet was sent.
+ * @param[in] ulLastRxMs Time the last packet was received.
+ * @param[in] ulNowMs Current time in milliseconds, from the clock of the MQTT
+ * context.
+ */
+void MQTTLinkMonitor_Activity( MQTTLinkMonitor_t * pxMonitor,
+                               uint32_t ulLastTxMs,
+                               uint32_t ulLastRxMs,
+                               uint32_t ulNowMs );
+
+/**
+ * @brief Report the loss of the connection to the broker.
+ *
+ * @param[in] pxMonitor The monitor.
+ * @param[in] xKeepAliveTimeout `true` if the broker did not answer a PINGREQ,
+ * which is how an idle timeout on the path shows.
+ * @param[in] ulNowMs Current time in milliseconds.
+ */
+void MQTTLinkMonitor_ConnectionLost( MQTTLinkMonitor_t * pxMonitor,
+                                     bool xKeepAliveTimeout,
+                                     uint32_t ulNowMs );
+
+/**
+ * @brief Keep-alive interval to request in the next CONNECT.
+ */
+uint16_t MQTTLinkMonitor_KeepAliveSeconds( const MQTTLinkMonitor_t * pxMonitor );
+
+/**
+ * @brief Compute the delay before the next reconnect attempt.
+ *
+ * @param[in] pxMonitor The monitor.
+ * @param[in] ulRandom A random number, to spread the attempts of many devices.
+ *
+ * @return The delay in milliseconds.
+ */
+uint32_t MQTTLinkMonitor_NextBackoffMs( MQTTLinkMonitor_t * pxMonitor,
+                                        uint32_t ulRandom );
+
+/**
+ * @brief Decisions of the monitor and the observations they are based on.
+ */
+const MQTTLinkMetrics_t * MQTTLinkMonitor_GetMetrics( const MQTTLinkMonitor_t * pxMonitor );
+
+#endif /* ifndef MQTT_LINK_MONITOR_H */
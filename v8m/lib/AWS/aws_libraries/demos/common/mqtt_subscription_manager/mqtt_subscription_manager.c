@@ -35,15 +35,310 @@
 /* Subscription manager header include. */
 #include "mqtt_subscription_manager.h"
 
+/**
+ * @brief Kinds of topic filter level stored in the trie.
+ */
+#define TRIE_LEVEL_LITERAL        ( 0U )
+#define TRIE_LEVEL_SINGLE_WILD    ( 1U ) /* '+' */
+#define TRIE_LEVEL_MULTI_WILD     ( 2U ) /* '#' */
+
+/**
+ * @brief Index of the root node, which is never allocated to a level.
+ */
+#define TRIE_ROOT                 ( 0U )
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Length of the topic level starting at usOffset.
+ */
+static uint16_t prvLevelLength( const char * pcTopic,
+                                uint16_t usTopicLength,
+                                uint16_t usOffset )
+{
+    uint16_t usEnd = usOffset;
+
+    while( ( usEnd < usTopicLength ) && ( pcTopic[ usEnd ] != '/' ) )
+    {
+        usEnd++;
+    }
+
+    return ( uint16_t ) ( usEnd - usOffset );
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief FNV-1a hash of a topic level.
+ */
+static uint32_t prvLevelHash( const char * pcLevel,
+                              uint16_t usLevelLength )
+{
+    uint32_t ulHash = 2166136261UL;
+    uint16_t i;
+
+    for( i = 0; i < usLevelLength; i++ )
+    {
+        ulHash ^= ( uint8_t ) pcLevel[ i ];
+        ulHash *= 16777619UL;
+    }
+
+    return ulHash;
+}
+
+/*-----------------------------------------------------------*/
+
+static uint8_t prvLevelKind( const char * pcLevel,
+                             uint16_t usLevelLength )
+{
+    uint8_t ucKind = TRIE_LEVEL_LITERAL;
+
+    if( usLevelLength == 1U )
+    {
+        if( pcLevel[ 0 ] == '+' )
+        {
+            ucKind = TRIE_LEVEL_SINGLE_WILD;
+        }
+        else if( pcLevel[ 0 ] == '#' )
+        {
+            ucKind = TRIE_LEVEL_MULTI_WILD;
+        }
+    }
+
+    return ucKind;
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Find the child of usParent holding the given filter level.
+ *
+ * @return The node index, TRIE_ROOT if there is none.
+ */
+static uint16_t prvFindChild( const SubscriptionList_t * pxSubscriptionList,
+                              uint16_t usParent,
+                              uint8_t ucKind,
+                              uint32_t ulHash,
+                              uint16_t usLevelLength )
+{
+    uint16_t usChild = pxSubscriptionList->xNodes[ usParent ].usFirstChild;
+    const SubscriptionTrieNode_t * pxNode;
+
+    while( usChild != TRIE_ROOT )
+    {
+        pxNode = &pxSubscriptionList->xNodes[ usChild ];
+
+        if( ( pxNode->ucKind == ucKind ) &&
+            ( pxNode->usLevelLength == usLevelLength ) &&
+            ( pxNode->ulLevelHash == ulHash ) )
+        {
+            break;
+        }
+
+        usChild = pxNode->usNextSibling;
+    }
+
+    return usChild;
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Drop a filter's reference on each node of its path, freeing the nodes
+ * no other filter goes through.
+ */
+static void prvReleasePath( SubscriptionList_t * pxSubscriptionList,
+                            const uint16_t * pusPath,
+                            size_t xDepth )
+{
+    SubscriptionTrieNode_t * pxNodes = pxSubscriptionList->xNodes;
+    uint16_t usParent;
+    uint16_t * pusLink;
+
+    while( xDepth > 0U )
+    {
+        xDepth--;
+        pxNodes[ pusPath[ xDepth ] ].usUsers--;
+
+        if( pxNodes[ pusPath[ xDepth ] ].usUsers == 0U )
+        {
+            /* Unlink the node from its parent's children. */
+            usParent = ( xDepth == 0U ) ? TRIE_ROOT : pusPath[ xDepth - 1U ];
+            pusLink = &pxNodes[ usParent ].usFirstChild;
+
+            while( *pusLink != pusPath[ xDepth ] )
+            {
+                pusLink = &pxNodes[ *pusLink ].usNextSibling;
+            }
+
+            *pusLink = pxNodes[ pusPath[ xDepth ] ].usNextSibling;
+            memset( &pxNodes[ pusPath[ xDepth ] ], 0x00, sizeof( SubscriptionTrieNode_t ) );
+        }
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Walk the path of a topic filter, optionally creating the missing nodes
+ * and taking a reference on each node of the path.
+ *
+ * @return The node of the last filter level, TRIE_ROOT if the filter is not in
+ * the trie or could not be added.
+ */
+static uint16_t prvWalkFilter( SubscriptionList_t * pxSubscriptionList,
+                               const char * pcTopicFilterString,
+                               uint16_t usTopicFilterLength,
+                               bool xAdd,
+                               uint16_t * pusPath,
+                               size_t * pxDepth )
+{
+    SubscriptionTrieNode_t * pxNodes = pxSubscriptionList->xNodes;
+    uint16_t usNode = TRIE_ROOT, usChild, usLevelLength, usOffset = 0;
+    uint32_t ulHash;
+    uint8_t ucKind;
+    bool xDone = false;
 
-bool SubscriptionManager_AddSubscription( SubscriptionElement_t * pxSubscriptionList,
+    *pxDepth = 0U;
+
+    while( xDone == false )
+    {
+        usLevelLength = prvLevelLength( pcTopicFilterString, usTopicFilterLength, usOffset );
+        ulHash = prvLevelHash( &pcTopicFilterString[ usOffset ], usLevelLength );
+        ucKind = prvLevelKind( &pcTopicFilterString[ usOffset ], usLevelLength );
+
+        if( *pxDepth == SUBSCRIPTION_MANAGER_MAX_FILTER_LEVELS )
+        {
+            LogError( ( "Topic filter has more than %u levels.",
+                        ( unsigned int ) SUBSCRIPTION_MANAGER_MAX_FILTER_LEVELS ) );
+            usChild = TRIE_ROOT;
+        }
+        else
+        {
+            usChild = prvFindChild( pxSubscriptionList, usNode, ucKind, ulHash, usLevelLength );
+        }
+
+        if( ( usChild == TRIE_ROOT ) && ( xAdd == true ) && ( *pxDepth < SUBSCRIPTION_MANAGER_MAX_FILTER_LEVELS ) )
+        {
+            for( usChild = TRIE_ROOT + 1U; usChild < SUBSCRIPTION_MANAGER_MAX_TRIE_NODES; usChild++ )
+            {
+                if( pxNodes[ usChild ].usUsers == 0U )
+                {
+                    pxNodes[ usChild ].ulLevelHash = ulHash;
+                    pxNodes[ usChild ].usLevelLength = usLevelLength;
+                    pxNodes[ usChild ].ucKind = ucKind;
+                    pxNodes[ usChild ].usNextSibling = pxNodes[ usNode ].usFirstChild;
+                    pxNodes[ usNode ].usFirstChild = usChild;
+                    break;
+                }
+            }
+
+            if( usChild == SUBSCRIPTION_MANAGER_MAX_TRIE_NODES )
+            {
+                LogError( ( "No free topic trie node, see SUBSCRIPTION_MANAGER_MAX_TRIE_NODES." ) );
+                usChild = TRIE_ROOT;
+            }
+        }
+
+        if( usChild == TRIE_ROOT )
+        {
+            if( xAdd == true )
+            {
+                prvReleasePath( pxSubscriptionList, pusPath, *pxDepth );
+            }
+
+            usNode = TRIE_ROOT;
+            xDone = true;
+        }
+        else
+        {
+            if( xAdd == true )
+            {
+                pxNodes[ usChild ].usUsers++;
+            }
+
+            pusPath[ *pxDepth ] = usChild;
+            ( *pxDepth )++;
+            usNode = usChild;
+            usOffset += usLevelLength + 1U;
+            xDone = ( usOffset > usTopicFilterLength );
+        }
+    }
+
+    return usNode;
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Collect the subscriptions whose filter can match the topic from the
+ * level at usOffset on, below usParent.
+ */
+static void prvMatchTopic( const SubscriptionList_t * pxSubscriptionList,
+                           uint16_t usParent,
+                           const char * pcTopic,
+                           uint16_t usTopicLength,
+                           uint16_t usOffset,
+                           uint32_t * pulMatches )
+{
+    const SubscriptionTrieNode_t * pxNodes = pxSubscriptionList->xNodes;
+    uint16_t usLevelLength = prvLevelLength( pcTopic, usTopicLength, usOffset );
+    uint32_t ulHash = prvLevelHash( &pcTopic[ usOffset ], usLevelLength );
+    bool xLastLevel = ( ( usOffset + usLevelLength ) >= usTopicLength );
+    uint16_t usChild, usGrandChild;
+
+    for( usChild = pxNodes[ usParent ].usFirstChild; usChild != TRIE_ROOT; usChild = pxNodes[ usChild ].usNextSibling )
+    {
+        if( pxNodes[ usChild ].ucKind == TRIE_LEVEL_MULTI_WILD )
+        {
+            /* '#' matches this level and everything below it. */
+            *pulMatches |= pxNodes[ usChild ].ulSubscriptions;
+        }
+        else if( ( pxNodes[ usChild ].ucKind == TRIE_LEVEL_SINGLE_WILD ) ||
+                 ( ( pxNodes[ usChild ].usLevelLength == usLevelLength ) &&
+                   ( pxNodes[ usChild ].ulLevelHash == ulHash ) ) )
+        {
+            if( xLastLevel == true )
+            {
+                *pulMatches |= pxNodes[ usChild ].ulSubscriptions;
+
+                /* "a/#" also matches "a". */
+                for( usGrandChild = pxNodes[ usChild ].usFirstChild; usGrandChild != TRIE_ROOT; usGrandChild = pxNodes[ usGrandChild ].usNextSibling )
+                {
+                    if( pxNodes[ usGrandChild ].ucKind == TRIE_LEVEL_MULTI_WILD )
+                    {
+                        *pulMatches |= pxNodes[ usGrandChild ].ulSubscriptions;
+                    }
+                }
+            }
+            else
+            {
+                prvMatchTopic( pxSubscriptionList,
+                               usChild,
+                               pcTopic,
+                               usTopicLength,
+                               ( uint16_t ) ( usOffset + usLevelLength + 1U ),
+                               pulMatches );
+            }
+        }
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+bool SubscriptionManager_AddSubscription( SubscriptionList_t * pxSubscriptionList,
                                           const char * pcTopicFilterString,
                                           uint16_t usTopicFilterLength,
                                           IncomingPubCallback_t pxIncomingPublishCallback,
                                           void * pvIncomingPublishCallbackContext )
 {
-    int32_t lIndex = 0;
+    uint16_t usPath[ SUBSCRIPTION_MANAGER_MAX_FILTER_LEVELS ];
+    size_t xDepth = 0U;
+    uint16_t usNode = TRIE_ROOT;
+    uint32_t ulCandidates = 0U;
+    size_t xIndex = 0U;
     size_t xAvailableIndex = SUBSCRIPTION_MANAGER_MAX_SUBSCRIPTIONS;
+    SubscriptionElement_t * pxElement;
     bool xReturnStatus = false;
 
     if( ( pxSubscriptionList == NULL ) ||
@@ -60,35 +355,53 @@ bool SubscriptionManager_AddSubscription( SubscriptionElement_t * pxSubscription
     }
     else
     {
-        /* Start at end of array, so that we will insert at the first available index.
-         * Scans backwards to find duplicates. */
-        for( lIndex = ( int32_t ) SUBSCRIPTION_MANAGER_MAX_SUBSCRIPTIONS - 1; lIndex >= 0; lIndex-- )
+        /* Duplicates can only be among the subscriptions ending at the same level. */
+        usNode = prvWalkFilter( pxSubscriptionList, pcTopicFilterString, usTopicFilterLength, false, usPath, &xDepth );
+
+        if( usNode != TRIE_ROOT )
         {
-            if( pxSubscriptionList[ lIndex ].usFilterStringLength == 0 )
-            {
-                xAvailableIndex = lIndex;
-            }
-            else if( ( pxSubscriptionList[ lIndex ].usFilterStringLength == usTopicFilterLength ) &&
-                     ( strncmp( pcTopicFilterString, pxSubscriptionList[ lIndex ].pcSubscriptionFilterString, ( size_t ) usTopicFilterLength ) == 0 ) )
+            ulCandidates = pxSubscriptionList->xNodes[ usNode ].ulSubscriptions;
+        }
+
+        for( xIndex = 0U; xIndex < SUBSCRIPTION_MANAGER_MAX_SUBSCRIPTIONS; xIndex++ )
+        {
+            pxElement = &pxSubscriptionList->xSubscriptions[ xIndex ];
+
+            if( ( ulCandidates & ( 1UL << xIndex ) ) != 0U )
             {
-                /* If a subscription already exists, don't do anything. */
-                if( ( pxSubscriptionList[ lIndex ].pxIncomingPublishCallback == pxIncomingPublishCallback ) &&
-                    ( pxSubscriptionList[ lIndex ].pvIncomingPublishCallbackContext == pvIncomingPublishCallbackContext ) )
+                if( ( pxElement->usFilterStringLength == usTopicFilterLength ) &&
+                    ( strncmp( pcTopicFilterString, pxElement->pcSubscriptionFilterString, ( size_t ) usTopicFilterLength ) == 0 ) &&
+                    ( pxElement->pxIncomingPublishCallback == pxIncomingPublishCallback ) &&
+                    ( pxElement->pvIncomingPublishCallbackContext == pvIncomingPublishCallbackContext ) )
                 {
+                    /* If a subscription already exists, don't do anything. */
                     LogWarn( ( "Subscription already exists.\n" ) );
                     xAvailableIndex = SUBSCRIPTION_MANAGER_MAX_SUBSCRIPTIONS;
                     xReturnStatus = true;
                     break;
                 }
             }
+            else if( ( pxElement->usFilterStringLength == 0U ) &&
+                     ( xAvailableIndex == SUBSCRIPTION_MANAGER_MAX_SUBSCRIPTIONS ) )
+            {
+                /* Insert at the first available index. */
+                xAvailableIndex = xIndex;
+            }
         }
 
         if( xAvailableIndex < SUBSCRIPTION_MANAGER_MAX_SUBSCRIPTIONS )
         {
-            pxSubscriptionList[ xAvailableIndex ].pcSubscriptionFilterString = pcTopicFilterString;
-            pxSubscriptionList[ xAvailableIndex ].usFilterStringLength = usTopicFilterLength;
-            pxSubscriptionList[ xAvailableIndex ].pxIncomingPublishCallback = pxIncomingPublishCallback;
-            pxSubscriptionList[ xAvailableIndex ].pvIncomingPublishCallbackContext = pvIncomingPublishCallbackContext;
+            usNode = prvWalkFilter( pxSubscriptionList, pcTopicFilterString, usTopicFilterLength, true, usPath, &xDepth );
+        }
+
+        if( ( xAvailableIndex < SUBSCRIPTION_MANAGER_MAX_SUBSCRIPTIONS ) && ( usNode != TRIE_ROOT ) )
+        {
+            pxElement = &pxSubscriptionList->xSubscriptions[ xAvailableIndex ];
+            pxElement->pcSubscriptionFilterString = pcTopicFilterString;
+            pxElement->usFilterStringLength = usTopicFilterLength;
+            pxElement->pxIncomingPublishCallback = pxIncomingPublishCallback;
+            pxElement->pvIncomingPublishCallbackContext = pvIncomingPublishCallbackContext;
+            pxSubscriptionList->xNodes[ usNode ].ulSubscriptions |= ( 1UL << xAvailableIndex );
             xReturnStatus = true;
         }
     }
@@ -98,11 +411,15 @@ bool SubscriptionManager_AddSubscription( SubscriptionElement_t * pxSubscription
 
 /*-----------------------------------------------------------*/
 
-void SubscriptionManager_RemoveSubscription( SubscriptionElement_t * pxSubscriptionList,
+void SubscriptionManager_RemoveSubscription( SubscriptionList_t * pxSubscriptionList,
                                              const char * pcTopicFilterString,
                                              uint16_t usTopicFilterLength )
 {
-    int32_t lIndex = 0;
+    uint16_t usPath[ SUBSCRIPTION_MANAGER_MAX_FILTER_LEVELS ];
+    size_t xDepth = 0U;
+    uint16_t usNode = TRIE_ROOT;
+    size_t xIndex = 0U;
+    SubscriptionElement_t * pxElement;
 
     if( ( pxSubscriptionList == NULL ) ||
         ( pcTopicFilterString == NULL ) ||
@@ -116,14 +433,21 @@ void SubscriptionManager_RemoveSubscription( SubscriptionElement_t * pxSubscript
     }
     else
     {
-        for( lIndex = 0; lIndex < SUBSCRIPTION_MANAGER_MAX_SUBSCRIPTIONS; lIndex++ )
+        usNode = prvWalkFilter( pxSubscriptionList, pcTopicFilterString, usTopicFilterLength, false, usPath, &xDepth );
+
+        for( xIndex = 0U; ( usNode != TRIE_ROOT ) && ( xIndex < SUBSCRIPTION_MANAGER_MAX_SUBSCRIPTIONS ); xIndex++ )
         {
-            if( pxSubscriptionList[ lIndex ].usFilterStringLength == usTopicFilterLength )
+            pxElement = &pxSubscriptionList->xSubscriptions[ xIndex ];
+
+            if( ( ( pxSubscriptionList->xNodes[ usNode ].ulSubscriptions & ( 1UL << xIndex ) ) != 0U ) &&
+                ( pxElement->usFilterStringLength == usTopicFilterLength ) &&
+                ( strncmp( pxElement->pcSubscriptionFilterString, pcTopicFilterString, usTopicFilterLength ) == 0 ) )
             {
-                if( strncmp( pxSubscriptionList[ lIndex ].pcSubscriptionFilterString, pcTopicFilterString, usTopicFilterLength ) == 0 )
-                {
-                    memset( &( pxSubscriptionList[ lIndex ] ), 0x00, sizeof( SubscriptionElement_t ) );
-                }
+                memset( pxElement, 0x00, sizeof( SubscriptionElement_t ) );
+                pxSubscriptionList->xNodes[ usNode ].ulSubscriptions &= ~( 1UL << xIndex );
+
+                /* The last release may free usNode itself. */
+                prvReleasePath( pxSubscriptionList, usPath, xDepth );
             }
         }
     }
@@ -131,10 +455,12 @@ void SubscriptionManager_RemoveSubscription( SubscriptionElement_t * pxSubscript
 
 /*-----------------------------------------------------------*/
 
-bool SubscriptionManager_HandleIncomingPublishes( SubscriptionElement_t * pxSubscriptionList,
+bool SubscriptionManager_HandleIncomingPublishes( SubscriptionList_t * pxSubscriptionList,
                                                   MQTTPublishInfo_t * pxPublishInfo )
 {
-    int32_t lIndex = 0;
+    size_t xIndex = 0U;
+    uint32_t ulCandidates = 0U;
+    SubscriptionElement_t * pxElement;
     bool isMatched = false, publishHandled = false;
 
     if( ( pxSubscriptionList == NULL ) ||
@@ -146,20 +472,39 @@ bool SubscriptionManager_HandleIncomingPublishes( SubscriptionElement_t * pxSubs
     }
     else
     {
-        for( lIndex = 0; lIndex < SUBSCRIPTION_MANAGER_MAX_SUBSCRIPTIONS; lIndex++ )
+        prvMatchTopic( pxSubscriptionList,
+                       TRIE_ROOT,
+                       pxPublishInfo->pTopicName,
+                       pxPublishInfo->topicNameLength,
+                       0U,
+                       &ulCandidates );
+
+        for( xIndex = 0U; ( ulCandidates != 0U ) && ( xIndex < SUBSCRIPTION_MANAGER_MAX_SUBSCRIPTIONS ); xIndex++ )
         {
-            if( pxSubscriptionList[ lIndex ].usFilterStringLength > 0 )
+            pxElement = &pxSubscriptionList->xSubscriptions[ xIndex ];
+
+            if( ( ulCandidates & ( 1UL << xIndex ) ) == 0U )
+            {
+                continue;
+            }
+
+            ulCandidates &= ~( 1UL << xIndex );
+
+            /* A callback may have unsubscribed this element. */
+            if( pxElement->usFilterStringLength > 0U )
             {
+                /* Confirm the match, the trie compares level hashes and does not
+                 * apply the rules for topics starting with '$'. */
                 MQTT_MatchTopic( pxPublishInfo->pTopicName,
                                  pxPublishInfo->topicNameLength,
-                                 pxSubscriptionList[ lIndex ].pcSubscriptionFilterString,
-                                 pxSubscriptionList[ lIndex ].usFilterStringLength,
+                                 pxElement->pcSubscriptionFilterString,
+                                 pxElement->usFilterStringLength,
                                  &isMatched );
 
                 if( isMatched == true )
                 {
-                    pxSubscriptionList[ lIndex ].pxIncomingPublishCallback( pxSubscriptionList[ lIndex ].pvIncomingPublishCallbackContext,
-                                                                            pxPublishInfo );
+                    pxElement->pxIncomingPublishCallback( pxElement->pvIncomingPublishCallbackContext,
+                                                          pxPublishInfo );
 
                     publishHandled = true;
                 }
@@ -65,6 +65,27 @@
     #define SUBSCRIPTION_MANAGER_MAX_SUBSCRIPTIONS    10U
 #endif
 
+#if ( SUBSCRIPTION_MANAGER_MAX_SUBSCRIPTIONS > 32U )
+    #error "SUBSCRIPTION_MANAGER_MAX_SUBSCRIPTIONS must not exceed 32."
+#endif
+
+/**
+ * @brief Maximum number of topic filter levels stored in the topic trie.
+ *
+ * Subscriptions are indexed by level, filters sharing a prefix share the
+ * corresponding nodes. The root node is included in this count.
+ */
+#ifndef SUBSCRIPTION_MANAGER_MAX_TRIE_NODES
+    #define SUBSCRIPTION_MANAGER_MAX_TRIE_NODES    ( ( SUBSCRIPTION_MANAGER_MAX_SUBSCRIPTIONS * 6U ) + 1U )
+#endif
+
+/**
+ * @brief Maximum number of levels in a subscribed topic filter.
+ */
+#ifndef SUBSCRIPTION_MANAGER_MAX_FILTER_LEVELS
+    #define SUBSCRIPTION_MANAGER_MAX_FILTER_LEVELS    16U
+#endif
+
 /**
  * @brief Callback function called when receiving a publish.
  *
@@ -77,9 +98,6 @@ typedef void (* IncomingPubCallback_t )( void * pvIncomingPublishCallbackContext
 /**
  * @brief An element in the list of subscriptions.
  *
- * This subscription manager implementation expects that the array of the
- * subscription elements used for storing subscriptions to be initialized to 0.
- *
  * @note This implementation allows multiple tasks to subscribe to the same topic.
  * In this case, another element is added to the subscription list, differing
  * in the intended publish callback. Also note that the topic filters are not
@@ -94,6 +112,40 @@ typedef struct subscriptionElement
     const char * pcSubscriptionFilterString;
 } SubscriptionElement_t;
 
+/**
+ * @brief A level of a subscribed topic filter in the topic trie.
+ *
+ * Levels are identified by their length and a hash so that the trie does not
+ * reference the filter strings: a collision only costs an extra call to
+ * MQTT_MatchTopic, which confirms every candidate before dispatch.
+ */
+typedef struct subscriptionTrieNode
+{
+    uint32_t ulLevelHash;
+    uint32_t ulSubscriptions; /* Bit n set: element n ends at this level. */
+    uint16_t usLevelLength;
+    uint16_t usUsers;         /* Filters going through this level, 0 when the node is free. */
+    uint16_t usFirstChild;    /* 0 when there are no children, node 0 is the root. */
+    uint16_t usNextSibling;
+    uint8_t ucKind;
+} SubscriptionTrieNode_t;
+
+/**
+ * @brief Subscriptions and the topic trie indexing them.
+ *
+ * Incoming publishes are dispatched by walking the trie one topic level at a
+ * time, so the cost depends on the topic depth rather than on the number of
+ * subscriptions.
+ *
+ * This subscription manager implementation expects the list to be initialized
+ * to 0.
+ */
+typedef struct subscriptionList
+{
+    SubscriptionElement_t xSubscriptions[ SUBSCRIPTION_MANAGER_MAX_SUBSCRIPTIONS ];
+    SubscriptionTrieNode_t xNodes[ SUBSCRIPTION_MANAGER_MAX_TRIE_NODES ];
+} SubscriptionList_t;
+
 /**
  * @brief Add a subscription to the subscription list.
  *
@@ -101,15 +153,16 @@ typedef struct subscriptionElement
  * context-callback pairs. However, a single context-callback pair may only be
  * associated to the same topic filter once.
  *
- * @param[in] pxSubscriptionList  The pointer to the subscription list array.
+ * @param[in] pxSubscriptionList  The pointer to the subscription list.
  * @param[in] pcTopicFilterString Topic filter string of subscription.
  * @param[in] usTopicFilterLength Length of topic filter string.
  * @param[in] pxIncomingPublishCallback Callback function for the subscription.
  * @param[in] pvIncomingPublishCallbackContext Context for the subscription callback.
  *
- * @return `true` if subscription added or exists, `false` if insufficient memory.
+ * @return `true` if subscription added or exists, `false` if insufficient memory
+ * or the filter has more than SUBSCRIPTION_MANAGER_MAX_FILTER_LEVELS levels.
  */
-bool SubscriptionManager_AddSubscription( SubscriptionElement_t * pxSubscriptionList,
+bool SubscriptionManager_AddSubscription( SubscriptionList_t * pxSubscriptionList,
                                           const char * pcTopicFilterString,
                                           uint16_t usTopicFilterLength,
                                           IncomingPubCallback_t pxIncomingPublishCallback,
@@ -121,11 +174,11 @@ bool SubscriptionManager_AddSubscription( SubscriptionElement_t * pxSubscription
  * @note If the topic filter exists multiple times in the subscription list,
  * then every instance of the subscription will be removed.
  *
- * @param[in] pxSubscriptionList  The pointer to the subscription list array.
+ * @param[in] pxSubscriptionList  The pointer to the subscription list.
  * @param[in] pcTopicFilterString Topic filter of subscription.
  * @param[in] usTopicFilterLength Length of topic filter.
  */
-void SubscriptionManager_RemoveSubscription( SubscriptionElement_t * pxSubscriptionList,
+void SubscriptionManager_RemoveSubscription( SubscriptionList_t * pxSubscriptionList,
                                              const char * pcTopicFilterString,
                                              uint16_t usTopicFilterLength );
 
@@ -133,13 +186,13 @@ void SubscriptionManager_RemoveSubscription( SubscriptionElement_t * pxSubscript
  * @brief Handle incoming publishes by invoking the callbacks registered
  * for the incoming publish's topic filter.
  *
- * @param[in] pxSubscriptionList  The pointer to the subscription list array.
+ * @param[in] pxSubscriptionList  The pointer to the subscription list.
  * @param[in] pxPublishInfo Info of incoming publish.
  *
  * @return `true` if an application callback could be invoked;
  *  `false` otherwise.
  */
-bool SubscriptionManager_HandleIncomingPublishes( SubscriptionElement_t * pxSubscriptionList,
+bool SubscriptionManager_HandleIncomingPublishes( SubscriptionList_t * pxSubscriptionList,
                                                   MQTTPublishInfo_t * pxPublishInfo );
 
 #endif /* MQTT_SUBSCRIPTION_MANAGER_H */
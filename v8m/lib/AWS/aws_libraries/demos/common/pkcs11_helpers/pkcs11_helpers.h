@@ -51,5 +51,17 @@
 BaseType_t xPkcs11GenerateRandomNumber( uint8_t * pusRandomNumBuffer,
                                         size_t xBufferLength );
 
+/**
+ * @brief Version of the objects stored by the PKCS11 module.
+ *
+ * Implemented by the PKCS11 module. The value changes after every
+ * C_CreateObject, C_DestroyObject and C_GenerateKeyPair call, so callers
+ * that cache data derived from stored objects (e.g. parsed certificates)
+ * can tell when it is out of date.
+ *
+ * @return Current object version.
+ */
+uint32_t ulPkcs11GetObjectVersion( void );
+
 
 #endif /* ifndef PKCS11_HELPERS_H_ */
@@ -50,6 +50,9 @@
 #include "aws_clientcredential_keys.h"
 #include "iot_default_root_certificates.h"
 
+/* TLS include. */
+#include "iot_tls.h"
+
 /* Key provisioning include. */
 #include "aws_dev_mode_key_provisioning.h"
 
@@ -1280,6 +1283,10 @@ CK_RV vAlternateKeyProvisioning( ProvisioningParams_t * xParams )
         xResult = xProvisionDevice( xSession, xParams );
 
         pxFunctionList->C_CloseSession( xSession );
+
+        /* Connections must not keep using the previous certificates. Cached
+         * TLS sessions are bound to the device certificate and can be kept. */
+        TLS_FlushCertificateCache();
     }
 
     return xResult;
@@ -96,6 +96,52 @@
  */
 #define NETWORK_MANAGER_TASK_STACK_SIZE          ( configMINIMAL_STACK_SIZE * 4 )
 
+#if TCPIP_NETWORK_ENABLED
+
+/**
+ * @brief Maximum number of servers registered with the connection manager.
+ */
+    #define NETWORK_MANAGER_MAX_ENDPOINTS                 ( 2 )
+
+/**
+ * @brief Maximum time a dial waits for the host name of the server to be resolved.
+ */
+    #define NETWORK_MANAGER_DNS_WAIT_MS                   ( 10000U )
+
+/**
+ * @brief Time after which a connection dialed in the background and not taken is closed.
+ * Servers drop connections on which the application protocol does not start soon enough.
+ */
+    #define NETWORK_MANAGER_WARM_CONNECTION_MAX_AGE_MS    ( 5000U )
+
+/**
+ * @brief Maximum time a connect waits for the background dial to the same server.
+ */
+    #define NETWORK_MANAGER_DIAL_WAIT_MS                  ( 30000U )
+
+/**
+ * @brief Priority of the task dialing connections in the background.
+ */
+    #define NETWORK_MANAGER_DIALER_TASK_PRIORITY          ( osPriorityNormal )
+
+/**
+ * @brief Stack size of the task dialing connections in the background, it runs TLS handshakes.
+ */
+    #define NETWORK_MANAGER_DIALER_TASK_STACK_SIZE        ( configMINIMAL_STACK_SIZE * 2 )
+
+/**
+ * @brief Event flag waking up the dialer task.
+ */
+    #define NETWORK_MANAGER_DIALER_WAKE                   ( 1UL << 0 )
+
+/**
+ * @brief Event flag set when the dial to a server is over. It is cleared when
+ * a dial starts, not by the callers waiting for it, so all of them wake up.
+ */
+    #define NETWORK_MANAGER_DIAL_DONE( index )            ( 1UL << ( ( index ) + 1 ) )
+
+#endif /* if TCPIP_NETWORK_ENABLED */
+
 /**
  * @brief Structure holds information for each network and the runtime state of it.
  */
@@ -138,6 +184,45 @@ typedef struct IotNetworkEvent
     IotNetworkEventType_t eventType;
 } IotNetworkEvent_t;
 
+#if TCPIP_NETWORK_ENABLED
+
+/**
+ * @brief Each compilation unit that consumes the NetworkContext must define it.
+ */
+    struct NetworkContext
+    {
+        SecureSocketsTransportParams_t * pParams;
+    };
+
+/**
+ * @brief State of the connection dialed in the background to a server.
+ */
+    typedef enum IotNMConnectionState
+    {
+        eConnectionIdle = 0,
+        eConnectionDialing,
+        eConnectionReady
+    } IotNMConnectionState_t;
+
+/**
+ * @brief Structure holds a server registered with the connection manager.
+ */
+    typedef struct IotNMEndpoint
+    {
+        bool isActive;
+        bool keepWarm;
+        bool warmRequested;
+        ServerInfo_t serverInfo;
+        SocketsConfig_t socketsConfig;
+        uint32_t lastAddress; /* Address of the last connection, 0 if none. */
+        IotNMConnectionState_t warmState;
+        uint32_t warmTimestamp;
+        SecureSocketsTransportParams_t warmParams;
+        Socket_t userSocket; /* Connection returned by AwsIotNetworkManager_Connect(). */
+    } IotNMEndpoint_t;
+
+#endif /* if TCPIP_NETWORK_ENABLED */
+
 /**
  * @brief Network manager object, holds the list of supported networks and the list of network state change subscriptions.
  */
@@ -149,6 +234,11 @@ typedef struct IotNetworkManager
     osMessageQueueId_t eventQueue;
     osMutexId_t globalMutex;
     osMutexId_t subscriptionsMutex;
+    #if TCPIP_NETWORK_ENABLED
+        IotNMEndpoint_t endpoints[ NETWORK_MANAGER_MAX_ENDPOINTS ];
+        osMutexId_t endpointsMutex;
+        osEventFlagsId_t dialerFlags;
+    #endif
 } IotNetworkManagerInfo_t;
 
 #if BLE_ENABLED
@@ -263,6 +353,59 @@ static void prvDispatch( uint32_t networkType,
  */
 static void _initializeTCPIPCredentials( void );
 
+#if TCPIP_NETWORK_ENABLED
+
+/**
+ * @brief Create the objects of the connection manager and start the dialer task.
+ *
+ * @return pdTRUE or pdFALSE.
+ */
+    static BaseType_t prvConnectionsInit( void );
+
+/**
+ * @brief Update the connection manager on a state change of a TCP/IP network.
+ *
+ * @param[in] state New state of the network.
+ */
+    static void prvConnectionsNetworkChanged( AwsIotNetworkState_t state );
+
+/**
+ * @brief Get the registered server matching a server info.
+ *
+ * @param[in] pServerInfo Server info to match.
+ * @return Pointer to the server. NULL if it is not registered.
+ */
+    static IotNMEndpoint_t * prvGetEndpoint( const ServerInfo_t * pServerInfo );
+
+/**
+ * @brief Dial a connection to a registered server.
+ *
+ * The address of the last connection to the server is raced with the addresses its
+ * host name resolves to. Resolved addresses are cached by the secure sockets layer.
+ *
+ * @param[in] pEndpoint The server.
+ * @param[out] pNetworkContext The network context to connect.
+ * @return The status of the connection.
+ */
+    static TransportSocketStatus_t prvDialEndpoint( IotNMEndpoint_t * pEndpoint,
+                                                    NetworkContext_t * pNetworkContext );
+
+/**
+ * @brief Close the connection dialed in the background to a server.
+ *
+ * @param[in] pEndpoint The server.
+ */
+    static void prvCloseWarmConnection( IotNMEndpoint_t * pEndpoint );
+
+/**
+ * @brief Task dialing connections to servers in the background.
+ *
+ * @param[in] pvParams Unused.
+ */
+    static void prvConnectionDialerTask( void * pvParams );
+
+#endif /* if TCPIP_NETWORK_ENABLED */
+
 /**
  * @brief The credentials placeholder for a TCP/IP network.
  *
@@ -851,6 +994,13 @@ static void prvNetworkManagerTask( void * pvParams )
 
             if( stateChange )
             {
+                #if TCPIP_NETWORK_ENABLED
+                    if( ( event.networkType & AWSIOT_NETWORK_TYPE_TCP_IP ) != 0 )
+                    {
+                        prvConnectionsNetworkChanged( pNetwork->state );
+                    }
+                #endif
+
                 osMutexAcquire( networkManager.subscriptionsMutex, osWaitForever );
                 prvDispatch( event.networkType, pNetwork->state );
                 osMutexRelease( networkManager.subscriptionsMutex );
@@ -890,6 +1040,291 @@ static void _initializeTCPIPCredentials( void )
 
 /*-----------------------------------------------------------*/
 
+#if TCPIP_NETWORK_ENABLED
+
+    static BaseType_t prvConnectionsInit( void )
+    {
+        BaseType_t status = pdTRUE;
+
+        networkManager.endpointsMutex = osMutexNew( NULL );
+
+        if( networkManager.endpointsMutex == NULL )
+        {
+            IotLogError( "Failed to create endpoints mutex for network manager." );
+            status = pdFALSE;
+        }
+
+        if( status == pdTRUE )
+        {
+            networkManager.dialerFlags = osEventFlagsNew( NULL );
+
+            if( networkManager.dialerFlags == NULL )
+            {
+                IotLogError( "Failed to create dialer event flags for network manager." );
+                status = pdFALSE;
+            }
+        }
+
+        if( status == pdTRUE )
+        {
+            osThreadAttr_t attr = {
+                .name = "NetworkDialer",
+                .stack_size = NETWORK_MANAGER_DIALER_TASK_STACK_SIZE,
+                .priority = NETWORK_MANAGER_DIALER_TASK_PRIORITY
+            };
+
+            if( osThreadNew( prvConnectionDialerTask, NULL, &attr ) == NULL )
+            {
+                IotLogError( "Failed to create network manager dialer task." );
+                status = pdFALSE;
+            }
+        }
+
+        return status;
+    }
+
+/*-----------------------------------------------------------*/
+
+    static void prvConnectionsNetworkChanged( AwsIotNetworkState_t state )
+    {
+        size_t index;
+        IotNMEndpoint_t * pEndpoint;
+
+        osMutexAcquire( networkManager.endpointsMutex, osWaitForever );
+
+        for( index = 0; index < NETWORK_MANAGER_MAX_ENDPOINTS; index++ )
+        {
+            pEndpoint = &networkManager.endpoints[ index ];
+
+            if( pEndpoint->isActive == false )
+            {
+                continue;
+            }
+
+            if( state == eNetworkStateConnected )
+            {
+                /* Get a connection ready for the servers which have lost theirs. */
+                if( ( pEndpoint->keepWarm == true ) && ( pEndpoint->userSocket == NULL ) )
+                {
+                    pEndpoint->warmRequested = true;
+                }
+            }
+            else
+            {
+                /* The network may come back with different routes. */
+                pEndpoint->lastAddress = 0;
+
+                if( pEndpoint->warmState == eConnectionReady )
+                {
+                    prvCloseWarmConnection( pEndpoint );
+                }
+            }
+        }
+
+        osMutexRelease( networkManager.endpointsMutex );
+
+        if( state == eNetworkStateConnected )
+        {
+            ( void ) osEventFlagsSet( networkManager.dialerFlags, NETWORK_MANAGER_DIALER_WAKE );
+        }
+    }
+
+/*-----------------------------------------------------------*/
+
+    static IotNMEndpoint_t * prvGetEndpoint( const ServerInfo_t * pServerInfo )
+    {
+        size_t index;
+        IotNMEndpoint_t * pEndpoint = NULL;
+
+        for( index = 0; index < NETWORK_MANAGER_MAX_ENDPOINTS; index++ )
+        {
+            if( ( networkManager.endpoints[ index ].isActive == true ) &&
+                ( networkManager.endpoints[ index ].serverInfo.port == pServerInfo->port ) &&
+                ( networkManager.endpoints[ index ].serverInfo.hostNameLength == pServerInfo->hostNameLength ) &&
+                ( strncmp( networkManager.endpoints[ index ].serverInfo.pHostName,
+                           pServerInfo->pHostName,
+                           pServerInfo->hostNameLength ) == 0 ) )
+            {
+                pEndpoint = &networkManager.endpoints[ index ];
+                break;
+            }
+        }
+
+        return pEndpoint;
+    }
+
+/*-----------------------------------------------------------*/
+
+    static TransportSocketStatus_t prvDialEndpoint( IotNMEndpoint_t * pEndpoint,
+                                                    NetworkContext_t * pNetworkContext )
+    {
+        TransportSocketStatus_t status;
+        uint32_t addresses[ SOCKETS_CONNECT_ANY_MAX_ADDRESSES ];
+        uint32_t resolved[ SOCKETS_CONNECT_ANY_MAX_ADDRESSES ];
+        int32_t numResolved;
+        size_t numAddresses = 0;
+        size_t connected = 0;
+        size_t index;
+
+        osMutexAcquire( networkManager.endpointsMutex, osWaitForever );
+
+        if( pEndpoint->lastAddress != 0 )
+        {
+            addresses[ numAddresses++ ] = pEndpoint->lastAddress;
+        }
+
+        osMutexRelease( networkManager.endpointsMutex );
+
+        numResolved = SOCKETS_GetHostAddresses( pEndpoint->serverInfo.pHostName,
+                                                resolved,
+                                                SOCKETS_CONNECT_ANY_MAX_ADDRESSES,
+                                                NETWORK_MANAGER_DNS_WAIT_MS );
+
+        for( index = 0; ( numResolved > 0 ) && ( index < ( size_t ) numResolved ); index++ )
+        {
+            if( ( numAddresses < SOCKETS_CONNECT_ANY_MAX_ADDRESSES ) &&
+                ( ( numAddresses == 0 ) || ( resolved[ index ] != addresses[ 0 ] ) ) )
+            {
+                addresses[ numAddresses++ ] = resolved[ index ];
+            }
+        }
+
+        if( numAddresses == 0 )
+        {
+            IotLogError( "Failed to resolve %s.", pEndpoint->serverInfo.pHostName );
+            status = TRANSPORT_SOCKET_STATUS_DNS_FAILURE;
+        }
+        else
+        {
+            if( numResolved <= 0 )
+            {
+                IotLogWarn( "Failed to resolve %s, using the previous address.", pEndpoint->serverInfo.pHostName );
+            }
+
+            status = SecureSocketsTransport_ConnectAny( pNetworkContext,
+                                                        &pEndpoint->serverInfo,
+                                                        &pEndpoint->socketsConfig,
+                                                        addresses,
+                                                        numAddresses,
+                                                        &connected );
+
+            osMutexAcquire( networkManager.endpointsMutex, osWaitForever );
+
+            /* The server may have moved, only race the resolved addresses on the next attempt. */
+            pEndpoint->lastAddress = ( status == TRANSPORT_SOCKET_STATUS_SUCCESS ) ? addresses[ connected ] : 0;
+
+            osMutexRelease( networkManager.endpointsMutex );
+        }
+
+        return status;
+    }
+
+/*-----------------------------------------------------------*/
+
+    static void prvCloseWarmConnection( IotNMEndpoint_t * pEndpoint )
+    {
+        NetworkContext_t networkContext = { .pParams = &pEndpoint->warmParams };
+
+        ( void ) SecureSocketsTransport_Disconnect( &networkContext );
+        pEndpoint->warmState = eConnectionIdle;
+    }
+
+/*-----------------------------------------------------------*/
+
+    static void prvConnectionDialerTask( void * pvParams )
+    {
+        uint32_t timeout = osWaitForever;
+        uint32_t maxAge = pdMS_TO_TICKS( NETWORK_MANAGER_WARM_CONNECTION_MAX_AGE_MS );
+        uint32_t age;
+        size_t index;
+        size_t dialIndex;
+        IotNMEndpoint_t * pEndpoint;
+        NetworkContext_t networkContext;
+        TransportSocketStatus_t status;
+        bool networkConnected;
+
+        ( void ) pvParams;
+
+        for( ; ; )
+        {
+            ( void ) osEventFlagsWait( networkManager.dialerFlags, NETWORK_MANAGER_DIALER_WAKE, osFlagsWaitAny, timeout );
+
+            timeout = osWaitForever;
+            dialIndex = NETWORK_MANAGER_MAX_ENDPOINTS;
+            networkConnected = ( ( AwsIotNetworkManager_GetConnectedNetworks() & AWSIOT_NETWORK_TYPE_TCP_IP ) != 0 );
+
+            osMutexAcquire( networkManager.endpointsMutex, osWaitForever );
+
+            for( index = 0; index < NETWORK_MANAGER_MAX_ENDPOINTS; index++ )
+            {
+                pEndpoint = &networkManager.endpoints[ index ];
+
+                if( pEndpoint->warmState == eConnectionReady )
+                {
+                    age = osKernelGetTickCount() - pEndpoint->warmTimestamp;
+
+                    if( age >= maxAge )
+                    {
+                        IotLogInfo( "Closing unused connection to %s.", pEndpoint->serverInfo.pHostName );
+                        prvCloseWarmConnection( pEndpoint );
+                    }
+                    else if( ( maxAge - age ) < timeout )
+                    {
+                        timeout = maxAge - age;
+                    }
+                }
+
+                if( ( dialIndex == NETWORK_MANAGER_MAX_ENDPOINTS ) &&
+                    ( networkConnected == true ) &&
+                    ( pEndpoint->isActive == true ) &&
+                    ( pEndpoint->warmRequested == true ) &&
+                    ( pEndpoint->warmState == eConnectionIdle ) &&
+                    ( pEndpoint->userSocket == NULL ) )
+                {
+                    pEndpoint->warmRequested = false;
+                    pEndpoint->warmState = eConnectionDialing;
+                    ( void ) osEventFlagsClear( networkManager.dialerFlags, NETWORK_MANAGER_DIAL_DONE( index ) );
+                    dialIndex = index;
+                }
+            }
+
+            osMutexRelease( networkManager.endpointsMutex );
+
+            if( dialIndex < NETWORK_MANAGER_MAX_ENDPOINTS )
+            {
+                pEndpoint = &networkManager.endpoints[ dialIndex ];
+                networkContext.pParams = &pEndpoint->warmParams;
+
+                IotLogInfo( "Dialing %s in the background.", pEndpoint->serverInfo.pHostName );
+
+                status = prvDialEndpoint( pEndpoint, &networkContext );
+
+                osMutexAcquire( networkManager.endpointsMutex, osWaitForever );
+
+                if( status == TRANSPORT_SOCKET_STATUS_SUCCESS )
+                {
+                    pEndpoint->warmState = eConnectionReady;
+                    pEndpoint->warmTimestamp = osKernelGetTickCount();
+                }
+                else
+                {
+                    pEndpoint->warmState = eConnectionIdle;
+                }
+
+                osMutexRelease( networkManager.endpointsMutex );
+
+                ( void ) osEventFlagsSet( networkManager.dialerFlags, NETWORK_MANAGER_DIAL_DONE( dialIndex ) );
+
+                /* Look for other servers to dial and schedule the expiry of this connection. */
+                timeout = 0;
+            }
+        }
+    }
+
+#endif /* if TCPIP_NETWORK_ENABLED */
+
+/*-----------------------------------------------------------*/
+
 BaseType_t AwsIotNetworkManager_Init( void )
 {
     BaseType_t status = pdTRUE;
@@ -931,6 +1366,13 @@ BaseType_t AwsIotNetworkManager_Init( void )
             }
         }
 
+        #if TCPIP_NETWORK_ENABLED
+            if( status == pdTRUE )
+            {
+                status = prvConnectionsInit();
+            }
+        #endif
+
         if( status == pdTRUE )
         {
             osThreadAttr_t attr = {
@@ -1207,3 +1649,196 @@ void * AwsIotNetworkManager_GetConnectionParams( uint32_t networkType )
 
     return pConnectionParams;
 }
+
+#if TCPIP_NETWORK_ENABLED
+
+    BaseType_t AwsIotNetworkManager_AddEndpoint( const ServerInfo_t * pxServerInfo,
+                                                 const SocketsConfig_t * pxSocketsConfig,
+                                                 bool xKeepWarm )
+    {
+        BaseType_t ret = pdFALSE;
+        bool added = false;
+        size_t index;
+        IotNMEndpoint_t * pEndpoint;
+
+        osMutexAcquire( networkManager.endpointsMutex, osWaitForever );
+
+        if( prvGetEndpoint( pxServerInfo ) != NULL )
+        {
+            ret = pdTRUE;
+        }
+        else
+        {
+            for( index = 0; index < NETWORK_MANAGER_MAX_ENDPOINTS; index++ )
+            {
+                pEndpoint = &networkManager.endpoints[ index ];
+
+                if( pEndpoint->isActive == false )
+                {
+                    memset( pEndpoint, 0x00, sizeof( IotNMEndpoint_t ) );
+                    pEndpoint->serverInfo = *pxServerInfo;
+                    pEndpoint->socketsConfig = *pxSocketsConfig;
+                    pEndpoint->keepWarm = xKeepWarm;
+                    pEndpoint->warmRequested = xKeepWarm;
+                    pEndpoint->warmState = eConnectionIdle;
+                    pEndpoint->isActive = true;
+                    added = true;
+                    ret = pdTRUE;
+                    break;
+                }
+            }
+        }
+
+        osMutexRelease( networkManager.endpointsMutex );
+
+        if( ret == pdFALSE )
+        {
+            IotLogError( "Not enough memory to store new endpoint." );
+        }
+
+        if( ( added == true ) && ( xKeepWarm == true ) )
+        {
+            ( void ) osEventFlagsSet( networkManager.dialerFlags, NETWORK_MANAGER_DIALER_WAKE );
+        }
+
+        return ret;
+    }
+
+    TransportSocketStatus_t AwsIotNetworkManager_Connect( NetworkContext_t * pxNetworkContext,
+                                                          const ServerInfo_t * pxServerInfo,
+                                                          const SocketsConfig_t * pxSocketsConfig )
+    {
+        TransportSocketStatus_t status = TRANSPORT_SOCKET_STATUS_CONNECT_FAILURE;
+        IotNMEndpoint_t * pEndpoint = NULL;
+        bool connected = false;
+        bool ownsDial = false;
+        size_t index;
+
+        if( ( pxNetworkContext == NULL ) || ( pxNetworkContext->pParams == NULL ) || ( pxServerInfo == NULL ) )
+        {
+            return TRANSPORT_SOCKET_STATUS_INVALID_PARAMETER;
+        }
+
+        osMutexAcquire( networkManager.endpointsMutex, osWaitForever );
+        pEndpoint = prvGetEndpoint( pxServerInfo );
+        osMutexRelease( networkManager.endpointsMutex );
+
+        if( pEndpoint == NULL )
+        {
+            return SecureSocketsTransport_Connect( pxNetworkContext, pxServerInfo, pxSocketsConfig );
+        }
+
+        index = ( size_t ) ( pEndpoint - networkManager.endpoints );
+
+        osMutexAcquire( networkManager.endpointsMutex, osWaitForever );
+
+        if( pEndpoint->warmState == eConnectionDialing )
+        {
+            /* Join the dial in progress rather than starting another one. */
+            osMutexRelease( networkManager.endpointsMutex );
+            ( void ) osEventFlagsWait( networkManager.dialerFlags,
+                                       NETWORK_MANAGER_DIAL_DONE( index ),
+                                       osFlagsWaitAny | osFlagsNoClear,
+                                       pdMS_TO_TICKS( NETWORK_MANAGER_DIAL_WAIT_MS ) );
+            osMutexAcquire( networkManager.endpointsMutex, osWaitForever );
+        }
+
+        if( pEndpoint->warmState == eConnectionReady )
+        {
+            /* The connection must not have been closed by the server while waiting. */
+            if( ( ( osKernelGetTickCount() - pEndpoint->warmTimestamp ) < pdMS_TO_TICKS( NETWORK_MANAGER_WARM_CONNECTION_MAX_AGE_MS ) ) &&
+                ( SOCKETS_Poll( pEndpoint->warmParams.tcpSocket, 0 ) == 0 ) )
+            {
+                pxNetworkContext->pParams->tcpSocket = pEndpoint->warmParams.tcpSocket;
+                pEndpoint->warmState = eConnectionIdle;
+                status = TRANSPORT_SOCKET_STATUS_SUCCESS;
+                connected = true;
+            }
+            else
+            {
+                prvCloseWarmConnection( pEndpoint );
+            }
+        }
+
+        if( ( connected == false ) && ( pEndpoint->warmState == eConnectionIdle ) )
+        {
+            /* Callers arriving meanwhile wait for this dial, as for the dialer task's. */
+            pEndpoint->warmState = eConnectionDialing;
+            ( void ) osEventFlagsClear( networkManager.dialerFlags, NETWORK_MANAGER_DIAL_DONE( index ) );
+            ownsDial = true;
+        }
+
+        osMutexRelease( networkManager.endpointsMutex );
+
+        if( connected == false )
+        {
+            status = prvDialEndpoint( pEndpoint, pxNetworkContext );
+        }
+
+        osMutexAcquire( networkManager.endpointsMutex, osWaitForever );
+
+        if( ownsDial == true )
+        {
+            pEndpoint->warmState = eConnectionIdle;
+        }
+
+        if( status == TRANSPORT_SOCKET_STATUS_SUCCESS )
+        {
+            pEndpoint->userSocket = pxNetworkContext->pParams->tcpSocket;
+            pEndpoint->warmRequested = false;
+        }
+
+        osMutexRelease( networkManager.endpointsMutex );
+
+        if( ownsDial == true )
+        {
+            ( void ) osEventFlagsSet( networkManager.dialerFlags, NETWORK_MANAGER_DIAL_DONE( index ) );
+        }
+
+        return status;
+    }
+
+    TransportSocketStatus_t AwsIotNetworkManager_Disconnect( NetworkContext_t * pxNetworkContext )
+    {
+        TransportSocketStatus_t status;
+        Socket_t tcpSocket = SOCKETS_INVALID_SOCKET;
+        bool wake = false;
+        size_t index;
+
+        if( ( pxNetworkContext != NULL ) && ( pxNetworkContext->pParams != NULL ) )
+        {
+            tcpSocket = pxNetworkContext->pParams->tcpSocket;
+        }
+
+        status = SecureSocketsTransport_Disconnect( pxNetworkContext );
+
+        osMutexAcquire( networkManager.endpointsMutex, osWaitForever );
+
+        for( index = 0; index < NETWORK_MANAGER_MAX_ENDPOINTS; index++ )
+        {
+            if( ( networkManager.endpoints[ index ].isActive == true ) &&
+                ( networkManager.endpoints[ index ].userSocket != NULL ) &&
+                ( networkManager.endpoints[ index ].userSocket == tcpSocket ) )
+            {
+                networkManager.endpoints[ index ].userSocket = NULL;
+
+                /* The connection is likely to be re-established, start dialing now. */
+                if( networkManager.endpoints[ index ].keepWarm == true )
+                {
+                    networkManager.endpoints[ index ].warmRequested = true;
+                    wake = true;
+                }
+            }
+        }
+
+        osMutexRelease( networkManager.endpointsMutex );
+
+        if( wake == true )
+        {
+            ( void ) osEventFlagsSet( networkManager.dialerFlags, NETWORK_MANAGER_DIALER_WAKE );
+        }
+
+        return status;
+    }
+
+#endif /* if TCPIP_NETWORK_ENABLED */
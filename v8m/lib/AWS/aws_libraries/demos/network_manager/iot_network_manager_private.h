@@ -186,4 +186,57 @@ uint32_t AwsIotNetworkManager_DisableNetwork( uint32_t ulNetworkTypes );
  */
 BaseType_t AwsIotNetworkManager_Init( void );
 
+#if TCPIP_NETWORK_ENABLED
+
+    #include "transport_secure_sockets.h"
+
+/**
+ * @brief Register a server with the connection manager.
+ *
+ * The connection manager remembers the addresses of the server between connections
+ * and races them when connecting. If @p xKeepWarm is true, a connection is also dialed
+ * in the background whenever the server has none, i.e. when it is registered or when a
+ * connection to it is closed, so that AwsIotNetworkManager_Connect() can return it
+ * straight away. A background connection not taken within
+ * NETWORK_MANAGER_WARM_CONNECTION_MAX_AGE_MS is closed.
+ *
+ * The parameters are copied, the strings and certificates they point to must stay valid.
+ * Registering a server again has no effect.
+ *
+ * @param[in] pxServerInfo The server.
+ * @param[in] pxSocketsConfig Configuration of the connections to the server.
+ * @param[in] xKeepWarm Whether to dial connections in the background.
+ * @return pdTRUE or pdFALSE if too many servers are registered.
+ */
+    BaseType_t AwsIotNetworkManager_AddEndpoint( const ServerInfo_t * pxServerInfo,
+                                                 const SocketsConfig_t * pxSocketsConfig,
+                                                 bool xKeepWarm );
+
+/**
+ * @brief Connect to a server, like SecureSocketsTransport_Connect().
+ *
+ * For a registered server, a connection dialed in the background is returned if one
+ * is ready or being dialed. Otherwise the remembered addresses of the server are
+ * raced with the address it resolves to. Other servers are connected to directly.
+ *
+ * @param[out] pxNetworkContext The network context to connect.
+ * @param[in] pxServerInfo The server.
+ * @param[in] pxSocketsConfig Configuration of the connection, the one given at
+ * registration is used for registered servers.
+ * @return The status of SecureSocketsTransport_Connect().
+ */
+    TransportSocketStatus_t AwsIotNetworkManager_Connect( NetworkContext_t * pxNetworkContext,
+                                                          const ServerInfo_t * pxServerInfo,
+                                                          const SocketsConfig_t * pxSocketsConfig );
+
+/**
+ * @brief Close a connection opened with AwsIotNetworkManager_Connect().
+ *
+ * @param[in] pxNetworkContext The network context to disconnect.
+ * @return The status of SecureSocketsTransport_Disconnect().
+ */
+    TransportSocketStatus_t AwsIotNetworkManager_Disconnect( NetworkContext_t * pxNetworkContext );
+
+#endif /* if TCPIP_NETWORK_ENABLED */
+
 #endif /* LIB_AWS_INCLUDE_AWS_IOT_NETWORK_H_ */
@@ -45,6 +45,54 @@
 
 /**@} */
 
+/**
+ * @brief Number of parsed certificate chains shared between connections: the
+ * client chain plus one entry per distinct set of trusted roots. Set to 0 to
+ * read and parse the certificates on every connection.
+ */
+#ifndef tlsconfigCERTIFICATE_CACHE_ENTRIES
+    #define tlsconfigCERTIFICATE_CACHE_ENTRIES      ( 3 )
+#endif
+
+/**
+ * @brief Number of TLS sessions kept for resumption, one per endpoint and
+ * client certificate. Set to 0 to do a full handshake on every connection.
+ */
+#ifndef tlsconfigSESSION_CACHE_ENTRIES
+    #define tlsconfigSESSION_CACHE_ENTRIES          ( 2 )
+#endif
+
+/**
+ * @brief Longest endpoint name that can be cached, including the terminator.
+ */
+#ifndef tlsconfigSESSION_CACHE_HOSTNAME_LENGTH
+    #define tlsconfigSESSION_CACHE_HOSTNAME_LENGTH  ( 96 )
+#endif
+
+/**
+ * @brief Space reserved for one serialized session, session ticket included.
+ * Sessions that do not fit are not cached.
+ */
+#ifndef tlsconfigSESSION_CACHE_MAX_SESSION_SIZE
+    #define tlsconfigSESSION_CACHE_MAX_SESSION_SIZE ( 512 )
+#endif
+
+/**
+ * @brief Keep the session cache in PSA protected storage so that sessions
+ * survive a reboot. The stored copy is only rewritten when a server issues a
+ * new ticket or a full handshake negotiates a new session.
+ */
+#ifndef tlsconfigSESSION_CACHE_PERSIST
+    #define tlsconfigSESSION_CACHE_PERSIST          ( 1 )
+#endif
+
+/**
+ * @brief Protected storage UID of the persisted session cache.
+ */
+#ifndef tlsconfigSESSION_CACHE_UID
+    #define tlsconfigSESSION_CACHE_UID              ( ( psa_storage_uid_t ) 9 )
+#endif
+
 /**
  * @brief Defines callback type for receiving bytes from the network.
  *
@@ -132,6 +180,18 @@ BaseType_t TLS_Recv( void * pvContext,
                      unsigned char * pucReadBuffer,
                      size_t xReadLength );
 
+/**
+ * @brief Returns the number of bytes already decrypted and waiting to be read.
+ *
+ * Such bytes do not make the underlying socket readable, so callers waiting for
+ * data must check them before blocking on the socket.
+ *
+ * @param pvContext Opaque context handle for TLS library.
+ *
+ * @return Number of bytes TLS_Recv can return without reading from the network.
+ */
+size_t TLS_GetBytesAvailable( void * pvContext );
+
 /**
  * @brief Writes the requested number of bytes to the secure connection.
  *
@@ -152,6 +212,24 @@ BaseType_t TLS_Send( void * pvContext,
  */
 void TLS_Cleanup( void * pvContext );
 
+/**
+ * @brief Drops every cached TLS session, including the persisted copy.
+ *
+ * The next connection to each endpoint does a full handshake. Sessions are
+ * already bound to the client certificate they were negotiated with, this is
+ * for cases such as a rotated private key or a changed trust anchor.
+ */
+void TLS_FlushSessionCache( void );
+
+/**
+ * @brief Drops the cached client certificate chain and trusted roots.
+ *
+ * Certificates created or destroyed through PKCS #11 already make the cache
+ * stale. This is for credentials changed by other means; the next connection
+ * then reads them again.
+ */
+void TLS_FlushCertificateCache( void );
+
 /**
  * @brief callback to verify the expiration date of the certificate
  *
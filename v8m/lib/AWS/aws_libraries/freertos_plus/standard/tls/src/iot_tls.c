@@ -34,6 +34,7 @@
 #include "aws_clientcredential_keys.h"
 #include "iot_default_root_certificates.h"
 #include "core_pki_utils.h"
+#include "pkcs11_helpers.h"
 
 /* mbedTLS includes. */
 #include "mbedtls/platform.h"
@@ -44,6 +45,17 @@
 #include "mbedtls/pk.h"
 #include "mbedtls/pk_internal.h"
 #include "mbedtls/debug.h"
+#include "mbedtls/version.h"
+
+#if ( tlsconfigSESSION_CACHE_ENTRIES > 0 )
+    #if ( MBEDTLS_VERSION_NUMBER < 0x02130000 )
+        #error "The TLS session cache needs mbedtls_ssl_session_save(), available from mbed TLS 2.19."
+    #endif
+
+    #if ( tlsconfigSESSION_CACHE_PERSIST == 1 )
+        #include "psa/protected_storage.h"
+    #endif
+#endif
 
 #ifdef MBEDTLS_DEBUG_C
     #define tlsDEBUG_VERBOSE    4
@@ -59,6 +71,9 @@
 
 #define ERRNO_NOSPACE 28
 
+/* Size of the client certificate digest that a cached session is bound to. */
+#define TLS_CLIENT_IDENTITY_SIZE    ( 32 )
+
 /**
  * @brief Represents string to be logged when mbedTLS returned error
  * does not contain a high-level code.
@@ -103,6 +118,10 @@ static const char * pNoLowLevelMbedTlsCodeStr = "<No-Low-Level-Code>";
  * @param[out] xMbedSslConfig Configuration context for mbedTLS.
  * @param[out] xMbedX509CA Server certificate context for mbedTLS.
  * @param[out] xMbedX509Cli Client certificate context for mbedTLS.
+ * @param[out] pxMbedX509CA Server certificates in use, xMbedX509CA or a cached chain.
+ * @param[out] pxMbedX509Cli Client certificates in use, xMbedX509Cli or a cached chain.
+ * @param[out] pvCachedCA Certificate cache entry holding pxMbedX509CA, if any.
+ * @param[out] pvCachedCli Certificate cache entry holding pxMbedX509Cli, if any.
  * @param[out] mbedPkAltCtx RSA crypto implementation context for mbedTLS.
  * @param[out] pxP11FunctionList PKCS#11 function list structure.
  * @param[out] xP11Session PKCS#11 session context.
@@ -126,6 +145,10 @@ typedef struct TLSContext
     mbedtls_ssl_config xMbedSslConfig;
     mbedtls_x509_crt xMbedX509CA;
     mbedtls_x509_crt xMbedX509Cli;
+    mbedtls_x509_crt * pxMbedX509CA;  /* Either xMbedX509CA or a cached chain. */
+    mbedtls_x509_crt * pxMbedX509Cli; /* Either xMbedX509Cli or a cached chain. */
+    void * pvCachedCA;
+    void * pvCachedCli;
     mbedtls_pk_context xMbedPkCtx;
     mbedtls_pk_info_t xMbedPkInfo;
     mbedtls_ctr_drbg_context xMbedDrbgCtx;
@@ -135,6 +158,10 @@ typedef struct TLSContext
     CK_SESSION_HANDLE xP11Session;
     CK_OBJECT_HANDLE xP11PrivateKey;
     CK_KEY_TYPE xKeyType;
+
+    /* Session resumption. */
+    uint8_t ucClientIdentity[ TLS_CLIENT_IDENTITY_SIZE ];
+    BaseType_t xSessionOffered;
 } TLSContext_t;
 
 #define TLS_HANDSHAKE_NOT_STARTED    ( 0 )      /* Must be 0 */
@@ -490,6 +517,394 @@ static int prvReadCertificateIntoContext( TLSContext_t * pxTlsContext,
 
 /*-----------------------------------------------------------*/
 
+/**
+ * @brief Parse the root certificates to trust: either the default set or the
+ * override given to TLS_Init.
+ *
+ * @param[in] pxCtx Caller TLS context.
+ * @param[out] pxChain Initialized certificate context receiving the roots.
+ *
+ * @return Zero on success.
+ */
+static int prvParseServerCertificates( TLSContext_t * pxCtx,
+                                       mbedtls_x509_crt * pxChain )
+{
+    int xResult = 0;
+
+    if( NULL != pxCtx->pcServerCertificate )
+    {
+        xResult = mbedtls_x509_crt_parse( pxChain,
+                                          ( const unsigned char * ) pxCtx->pcServerCertificate,
+                                          pxCtx->ulServerCertificateLength );
+
+        if( 0 != xResult )
+        {
+            TLS_PRINT( ( "ERROR: Failed to parse custom server certificates %s : %s \r\n",
+                         mbedtlsHighLevelCodeOrDefault( xResult ),
+                         mbedtlsLowLevelCodeOrDefault( xResult ) ) );
+        }
+    }
+    else
+    {
+        xResult = mbedtls_x509_crt_parse( pxChain,
+                                          ( const unsigned char * ) tlsVERISIGN_ROOT_CERTIFICATE_PEM,
+                                          tlsVERISIGN_ROOT_CERTIFICATE_LENGTH );
+
+        if( 0 == xResult )
+        {
+            xResult = mbedtls_x509_crt_parse( pxChain,
+                                              ( const unsigned char * ) tlsATS1_ROOT_CERTIFICATE_PEM,
+                                              tlsATS1_ROOT_CERTIFICATE_LENGTH );
+
+            if( 0 == xResult )
+            {
+                xResult = mbedtls_x509_crt_parse( pxChain,
+                                                  ( const unsigned char * ) tlsATS3_ROOT_CERTIFICATE_PEM,
+                                                  tlsATS3_ROOT_CERTIFICATE_LENGTH );
+
+                if( 0 == xResult )
+                {
+                    xResult = mbedtls_x509_crt_parse( pxChain,
+                                                      ( const unsigned char * ) tlsSTARFIELD_ROOT_CERTIFICATE_PEM,
+                                                      tlsSTARFIELD_ROOT_CERTIFICATE_LENGTH );
+                }
+            }
+        }
+
+        if( 0 != xResult )
+        {
+            /* Default root certificates should be in aws_default_root_certificate.h */
+            TLS_PRINT( ( "ERROR: Failed to parse default server certificates %s : %s \r\n",
+                         mbedtlsHighLevelCodeOrDefault( xResult ),
+                         mbedtlsLowLevelCodeOrDefault( xResult ) ) );
+        }
+    }
+
+    return xResult;
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Read the device certificate, and the JITR issuer certificate if
+ * present, from PKCS #11 into an mbedTLS certificate chain.
+ *
+ * @param[in] pxCtx Caller TLS context, logged in to PKCS #11.
+ * @param[out] pxChain Initialized certificate context receiving the chain.
+ *
+ * @return Zero on success.
+ */
+static int prvParseClientCertificates( TLSContext_t * pxCtx,
+                                       mbedtls_x509_crt * pxChain )
+{
+    BaseType_t xResult = CKR_OK;
+    char * pcJitrCertificate = keyJITR_DEVICE_CERTIFICATE_AUTHORITY_PEM;
+
+    /* Get the handle of the device client certificate. */
+    xResult = prvReadCertificateIntoContext( pxCtx,
+                                             pkcs11configLABEL_DEVICE_CERTIFICATE_FOR_TLS,
+                                             CKO_CERTIFICATE,
+                                             pxChain );
+
+    /* Add a Just-in-Time Registration (JITR) device issuer certificate, if
+     * present, to the TLS context handle. */
+    if( xResult == CKR_OK )
+    {
+        /* Prioritize a statically defined certificate over one in storage. */
+        if( ( NULL != pcJitrCertificate ) &&
+            ( 0 != strcmp( "", pcJitrCertificate ) ) )
+        {
+            xResult = mbedtls_x509_crt_parse( pxChain,
+                                              ( const unsigned char * ) pcJitrCertificate,
+                                              1 + strlen( pcJitrCertificate ) );
+        }
+        else
+        {
+            /* Check for a device JITR certificate in storage. */
+            xResult = prvReadCertificateIntoContext( pxCtx,
+                                                     pkcs11configLABEL_JITP_CERTIFICATE,
+                                                     CKO_CERTIFICATE,
+                                                     pxChain );
+
+            /* It is optional to have a JITR certificate in storage. */
+            if( CKR_OBJECT_HANDLE_INVALID == xResult )
+            {
+                xResult = CKR_OK;
+            }
+        }
+    }
+
+    return xResult;
+}
+
+/*-----------------------------------------------------------*/
+
+#if ( tlsconfigCERTIFICATE_CACHE_ENTRIES > 0 ) || ( tlsconfigSESSION_CACHE_ENTRIES > 0 )
+
+/**
+ * @brief Take a cache mutex, creating it on first use.
+ *
+ * Several connections can be opened concurrently (MQTT, HTTP) so creation is
+ * done with the scheduler locked.
+ */
+    static BaseType_t prvCacheMutexAcquire( osMutexId_t * pxMutex )
+    {
+        int32_t lKernelState;
+
+        if( NULL == *pxMutex )
+        {
+            lKernelState = osKernelLock();
+
+            if( NULL == *pxMutex )
+            {
+                *pxMutex = osMutexNew( NULL );
+            }
+
+            ( void ) osKernelRestoreLock( lKernelState );
+        }
+
+        if( ( NULL == *pxMutex ) ||
+            ( osMutexAcquire( *pxMutex, osWaitForever ) != osOK ) )
+        {
+            return pdFALSE;
+        }
+
+        return pdTRUE;
+    }
+
+#endif
+
+/*-----------------------------------------------------------*/
+
+typedef enum TLSCertificateCacheKind
+{
+    eTLSCertificateCacheFree = 0,
+    eTLSCertificateCacheServer,
+    eTLSCertificateCacheClient
+} TLSCertificateCacheKind_t;
+
+#if ( tlsconfigCERTIFICATE_CACHE_ENTRIES > 0 )
+
+/*
+ * Certificate cache.
+ *
+ * Parsed root and client chains are shared by every connection, so MQTT and
+ * HTTP connections only pay for the PKCS #11 reads and the PEM/DER decoding
+ * once. mbedTLS only reads a chain during the handshake; an entry is reference
+ * counted for the duration of TLS_Connect and freed once it is stale and unused.
+ * An entry is also stale once the PKCS #11 object version it was parsed at has
+ * changed, so certificates written by provisioning, OTA or JITP are picked up
+ * by the next connection.
+ */
+
+    typedef struct TLSCertificateCacheEntry
+    {
+        TLSCertificateCacheKind_t xKind;
+        uint8_t ucKey[ 32 ]; /* SHA-256 of the PEM roots, zero for the default set and the client chain. */
+        uint32_t ulUsers;
+        uint32_t ulObjectVersion; /* PKCS #11 object version the chain was read at. */
+        BaseType_t xStale;
+        mbedtls_x509_crt xChain;
+    } TLSCertificateCacheEntry_t;
+
+    static TLSCertificateCacheEntry_t xCertificateCache[ tlsconfigCERTIFICATE_CACHE_ENTRIES ];
+    static osMutexId_t xCertificateCacheMutex = NULL;
+
+/*-----------------------------------------------------------*/
+
+    static void prvCertificateCacheEvict( TLSCertificateCacheEntry_t * pxEntry )
+    {
+        mbedtls_x509_crt_free( &pxEntry->xChain );
+        memset( pxEntry, 0, sizeof( *pxEntry ) );
+    }
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Get a shared, parsed certificate chain, parsing it on a cache miss.
+ *
+ * @return The cache entry, or NULL. plResult is only non-zero when parsing
+ * failed; otherwise no entry was available and the caller parses its own copy.
+ */
+    static TLSCertificateCacheEntry_t * prvCertificateCacheAcquire( TLSContext_t * pxCtx,
+                                                                    TLSCertificateCacheKind_t xKind,
+                                                                    const uint8_t * pucKey,
+                                                                    int ( * xParse )( TLSContext_t *, mbedtls_x509_crt * ),
+                                                                    int * plResult )
+    {
+        TLSCertificateCacheEntry_t * pxEntry = NULL;
+        TLSCertificateCacheEntry_t * pxCandidate;
+        BaseType_t xHit = pdFALSE;
+        uint32_t ulObjectVersion;
+        size_t i;
+
+        *plResult = 0;
+
+        if( pdFALSE == prvCacheMutexAcquire( &xCertificateCacheMutex ) )
+        {
+            return NULL;
+        }
+
+        /* Read before parsing: an object changed while parsing makes the entry stale. */
+        ulObjectVersion = ulPkcs11GetObjectVersion();
+
+        for( i = 0; ( i < tlsconfigCERTIFICATE_CACHE_ENTRIES ) && ( pdFALSE == xHit ); i++ )
+        {
+            pxCandidate = &xCertificateCache[ i ];
+
+            if( ( pxCandidate->ulObjectVersion != ulObjectVersion ) &&
+                ( pxCandidate->xKind != eTLSCertificateCacheFree ) )
+            {
+                if( pxCandidate->ulUsers == 0U )
+                {
+                    prvCertificateCacheEvict( pxCandidate );
+                }
+                else
+                {
+                    pxCandidate->xStale = pdTRUE;
+                }
+            }
+
+            if( ( pxCandidate->xKind == xKind ) &&
+                ( pdFALSE == pxCandidate->xStale ) &&
+                ( memcmp( pxCandidate->ucKey, pucKey, sizeof( pxCandidate->ucKey ) ) == 0 ) )
+            {
+                pxEntry = pxCandidate;
+                xHit = pdTRUE;
+            }
+            else if( ( pxCandidate->ulUsers == 0U ) &&
+                     ( ( NULL == pxEntry ) || ( pxCandidate->xKind == eTLSCertificateCacheFree ) ) )
+            {
+                /* Slot to parse into on a miss, preferably a free one. */
+                pxEntry = pxCandidate;
+            }
+        }
+
+        if( pdFALSE != xHit )
+        {
+            *plResult = 0;
+        }
+        else if( NULL != pxEntry )
+        {
+            prvCertificateCacheEvict( pxEntry );
+            mbedtls_x509_crt_init( &pxEntry->xChain );
+
+            *plResult = xParse( pxCtx, &pxEntry->xChain );
+
+            if( 0 == *plResult )
+            {
+                pxEntry->xKind = xKind;
+                memcpy( pxEntry->ucKey, pucKey, sizeof( pxEntry->ucKey ) );
+                pxEntry->ulObjectVersion = ulObjectVersion;
+            }
+            else
+            {
+                prvCertificateCacheEvict( pxEntry );
+                pxEntry = NULL;
+            }
+        }
+
+        if( NULL != pxEntry )
+        {
+            pxEntry->ulUsers++;
+        }
+
+        ( void ) osMutexRelease( xCertificateCacheMutex );
+
+        return pxEntry;
+    }
+
+/*-----------------------------------------------------------*/
+
+    static void prvCertificateCacheRelease( TLSCertificateCacheEntry_t * pxEntry )
+    {
+        if( ( NULL == pxEntry ) ||
+            ( pdFALSE == prvCacheMutexAcquire( &xCertificateCacheMutex ) ) )
+        {
+            return;
+        }
+
+        pxEntry->ulUsers--;
+
+        if( ( pxEntry->ulUsers == 0U ) && ( pdFALSE != pxEntry->xStale ) )
+        {
+            prvCertificateCacheEvict( pxEntry );
+        }
+
+        ( void ) osMutexRelease( xCertificateCacheMutex );
+    }
+
+#endif /* if ( tlsconfigCERTIFICATE_CACHE_ENTRIES > 0 ) */
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Get the certificate chain to use for a connection, from the cache
+ * when possible, otherwise parsed into pxPrivate.
+ *
+ * @param[in] pxCtx Caller TLS context.
+ * @param[in] xKind Server roots or client chain.
+ * @param[in] pucKey Identifies the chain within its kind.
+ * @param[in] xParse Parser used on a cache miss.
+ * @param[in] pxPrivate Context owned chain used when nothing can be cached.
+ * @param[out] ppxChain Chain to configure mbedTLS with.
+ * @param[out] ppvEntry Cache entry to release with prvReleaseCertificates().
+ *
+ * @return Zero on success.
+ */
+static int prvAcquireCertificates( TLSContext_t * pxCtx,
+                                   TLSCertificateCacheKind_t xKind,
+                                   const uint8_t * pucKey,
+                                   int ( * xParse )( TLSContext_t *, mbedtls_x509_crt * ),
+                                   mbedtls_x509_crt * pxPrivate,
+                                   mbedtls_x509_crt ** ppxChain,
+                                   void ** ppvEntry )
+{
+    int lResult = 0;
+
+    #if ( tlsconfigCERTIFICATE_CACHE_ENTRIES > 0 )
+        TLSCertificateCacheEntry_t * pxEntry;
+    #endif
+
+    *ppvEntry = NULL;
+    *ppxChain = pxPrivate;
+
+    #if ( tlsconfigCERTIFICATE_CACHE_ENTRIES > 0 )
+        pxEntry = prvCertificateCacheAcquire( pxCtx, xKind, pucKey, xParse, &lResult );
+
+        if( NULL != pxEntry )
+        {
+            *ppvEntry = pxEntry;
+            *ppxChain = &pxEntry->xChain;
+
+            return 0;
+        }
+
+        if( 0 != lResult )
+        {
+            return lResult;
+        }
+    #else
+        ( void ) xKind;
+        ( void ) pucKey;
+    #endif
+
+    return xParse( pxCtx, pxPrivate );
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvReleaseCertificates( void ** ppvEntry )
+{
+    #if ( tlsconfigCERTIFICATE_CACHE_ENTRIES > 0 )
+        prvCertificateCacheRelease( ( TLSCertificateCacheEntry_t * ) *ppvEntry );
+    #endif
+
+    *ppvEntry = NULL;
+}
+
+/*-----------------------------------------------------------*/
+
 /**
  * @brief Helper for setting up potentially hardware-based cryptographic context
  * for the client TLS certificate and private key.
@@ -503,10 +918,11 @@ static int prvInitializeClientCredential( TLSContext_t * pxCtx )
     BaseType_t xResult = CKR_OK;
     CK_ATTRIBUTE xTemplate[ 2 ];
     mbedtls_pk_type_t xKeyAlgo = ( mbedtls_pk_type_t ) ~0;
-    char * pcJitrCertificate = keyJITR_DEVICE_CERTIFICATE_AUTHORITY_PEM;
+    const uint8_t ucClientKey[ 32 ] = { 0 };
 
     /* Initialize the mbed contexts. */
     mbedtls_x509_crt_init( &pxCtx->xMbedX509Cli );
+    pxCtx->pxMbedX509Cli = &pxCtx->xMbedX509Cli;
 
     if( pxCtx->xP11Session == CK_INVALID_HANDLE )
     {
@@ -581,48 +997,23 @@ static int prvInitializeClientCredential( TLSContext_t * pxCtx )
         pxCtx->xMbedPkCtx.pk_ctx = pxCtx;
     }
 
-    /* Get the handle of the device client certificate. */
+    /* Get the device client certificate chain, parsed by an earlier connection if possible. */
     if( xResult == CKR_OK )
     {
-        xResult = prvReadCertificateIntoContext( pxCtx,
-                                                 pkcs11configLABEL_DEVICE_CERTIFICATE_FOR_TLS,
-                                                 CKO_CERTIFICATE,
-                                                 &pxCtx->xMbedX509Cli );
-    }
-
-    /* Add a Just-in-Time Registration (JITR) device issuer certificate, if
-     * present, to the TLS context handle. */
-    if( xResult == CKR_OK )
-    {
-        /* Prioritize a statically defined certificate over one in storage. */
-        if( ( NULL != pcJitrCertificate ) &&
-            ( 0 != strcmp( "", pcJitrCertificate ) ) )
-        {
-            xResult = mbedtls_x509_crt_parse( &pxCtx->xMbedX509Cli,
-                                              ( const unsigned char * ) pcJitrCertificate,
-                                              1 + strlen( pcJitrCertificate ) );
-        }
-        else
-        {
-            /* Check for a device JITR certificate in storage. */
-            xResult = prvReadCertificateIntoContext( pxCtx,
-                                                     pkcs11configLABEL_JITP_CERTIFICATE,
-                                                     CKO_CERTIFICATE,
-                                                     &pxCtx->xMbedX509Cli );
-
-            /* It is optional to have a JITR certificate in storage. */
-            if( CKR_OBJECT_HANDLE_INVALID == xResult )
-            {
-                xResult = CKR_OK;
-            }
-        }
+        xResult = prvAcquireCertificates( pxCtx,
+                                          eTLSCertificateCacheClient,
+                                          ucClientKey,
+                                          prvParseClientCertificates,
+                                          &pxCtx->xMbedX509Cli,
+                                          &pxCtx->pxMbedX509Cli,
+                                          &pxCtx->pvCachedCli );
     }
 
     /* Attach the client certificate(s) and private key to the TLS configuration. */
     if( 0 == xResult )
     {
         xResult = mbedtls_ssl_conf_own_cert( &pxCtx->xMbedSslConfig,
-                                             &pxCtx->xMbedX509Cli,
+                                             pxCtx->pxMbedX509Cli,
                                              &pxCtx->xMbedPkCtx );
     }
 
@@ -674,6 +1065,321 @@ static int prvEntropyCallback( void * tlsContext,
     return ret;
 }
 
+#if ( tlsconfigSESSION_CACHE_ENTRIES > 0 )
+
+/*
+ * Session cache.
+ *
+ * Sessions are stored serialized so the same buffer can be written to protected
+ * storage. An entry is keyed by the endpoint name and by a digest of the client
+ * certificate, a resumed session skips both the server certificate chain
+ * verification and the private key signature.
+ */
+
+    #define tlsSESSION_CACHE_MAGIC    ( 0x53534C54UL ) /* "TLSS" */
+
+    typedef struct TLSSessionCacheEntry
+    {
+        char cHostName[ tlsconfigSESSION_CACHE_HOSTNAME_LENGTH ];
+        uint8_t ucClientIdentity[ TLS_CLIENT_IDENTITY_SIZE ];
+        uint32_t ulLastUsed;
+        uint8_t ucTicketDigest[ 32 ]; /* SHA-256 of the ticket, or of the session ID without one. */
+        uint32_t ulSessionLength;     /* 0 when the entry is free. */
+        uint8_t ucSession[ tlsconfigSESSION_CACHE_MAX_SESSION_SIZE ];
+    } TLSSessionCacheEntry_t;
+
+    typedef struct TLSSessionCache
+    {
+        uint32_t ulMagic;
+        uint32_t ulUseCounter;
+        TLSSessionCacheEntry_t xEntries[ tlsconfigSESSION_CACHE_ENTRIES ];
+    } TLSSessionCache_t;
+
+    static TLSSessionCache_t xSessionCache;
+    static osMutexId_t xSessionCacheMutex = NULL;
+
+/* Serialization buffer, only used with the cache mutex held. */
+    static uint8_t ucSessionScratch[ tlsconfigSESSION_CACHE_MAX_SESSION_SIZE ];
+
+/*-----------------------------------------------------------*/
+
+    static void prvSessionCacheSave( void )
+    {
+        #if ( tlsconfigSESSION_CACHE_PERSIST == 1 )
+            psa_status_t uxStatus = psa_ps_set( tlsconfigSESSION_CACHE_UID,
+                                                sizeof( xSessionCache ),
+                                                &xSessionCache,
+                                                PSA_STORAGE_FLAG_NONE );
+
+            if( uxStatus != PSA_SUCCESS )
+            {
+                TLS_PRINT( ( "WARN: Failed to persist the TLS session cache: %d\r\n", ( int ) uxStatus ) );
+            }
+        #endif
+    }
+
+/*-----------------------------------------------------------*/
+
+    static void prvSessionCacheRestore( void )
+    {
+        #if ( tlsconfigSESSION_CACHE_PERSIST == 1 )
+            size_t xReadLength = 0;
+
+            if( ( psa_ps_get( tlsconfigSESSION_CACHE_UID,
+                              0,
+                              sizeof( xSessionCache ),
+                              &xSessionCache,
+                              &xReadLength ) == PSA_SUCCESS ) &&
+                ( xReadLength == sizeof( xSessionCache ) ) &&
+                ( xSessionCache.ulMagic == tlsSESSION_CACHE_MAGIC ) )
+            {
+                return;
+            }
+        #endif
+
+        /* Nothing usable was stored, e.g. the cache layout changed. */
+        memset( &xSessionCache, 0, sizeof( xSessionCache ) );
+        xSessionCache.ulMagic = tlsSESSION_CACHE_MAGIC;
+    }
+
+/*-----------------------------------------------------------*/
+
+    static BaseType_t prvSessionCacheLock( void )
+    {
+        if( pdFALSE == prvCacheMutexAcquire( &xSessionCacheMutex ) )
+        {
+            return pdFALSE;
+        }
+
+        /* The persisted cache is loaded on first use. */
+        if( xSessionCache.ulMagic != tlsSESSION_CACHE_MAGIC )
+        {
+            prvSessionCacheRestore();
+        }
+
+        return pdTRUE;
+    }
+
+/*-----------------------------------------------------------*/
+
+    static void prvSessionCacheUnlock( void )
+    {
+        ( void ) osMutexRelease( xSessionCacheMutex );
+    }
+
+/*-----------------------------------------------------------*/
+
+    static TLSSessionCacheEntry_t * prvSessionCacheFind( const TLSContext_t * pxCtx )
+    {
+        TLSSessionCacheEntry_t * pxEntry = NULL;
+        size_t i;
+
+        for( i = 0; i < tlsconfigSESSION_CACHE_ENTRIES; i++ )
+        {
+            if( ( xSessionCache.xEntries[ i ].ulSessionLength != 0U ) &&
+                ( strcmp( xSessionCache.xEntries[ i ].cHostName, pxCtx->pcDestination ) == 0 ) &&
+                ( memcmp( xSessionCache.xEntries[ i ].ucClientIdentity,
+                          pxCtx->ucClientIdentity,
+                          TLS_CLIENT_IDENTITY_SIZE ) == 0 ) )
+            {
+                pxEntry = &xSessionCache.xEntries[ i ];
+                break;
+            }
+        }
+
+        return pxEntry;
+    }
+
+/*-----------------------------------------------------------*/
+
+    static BaseType_t prvSessionCacheUsable( const TLSContext_t * pxCtx )
+    {
+        return ( NULL != pxCtx->pcDestination ) &&
+               ( strlen( pxCtx->pcDestination ) < tlsconfigSESSION_CACHE_HOSTNAME_LENGTH );
+    }
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Offer the cached session for this endpoint, if any, in the ClientHello.
+ *
+ * If the server no longer knows the session it simply does a full handshake.
+ */
+    static void prvSessionCacheOffer( TLSContext_t * pxCtx )
+    {
+        TLSSessionCacheEntry_t * pxEntry;
+        mbedtls_ssl_session xSession;
+
+        pxCtx->xSessionOffered = pdFALSE;
+
+        if( ( pdFALSE == prvSessionCacheUsable( pxCtx ) ) ||
+            ( pdFALSE == prvSessionCacheLock() ) )
+        {
+            return;
+        }
+
+        pxEntry = prvSessionCacheFind( pxCtx );
+
+        if( NULL != pxEntry )
+        {
+            mbedtls_ssl_session_init( &xSession );
+
+            if( ( mbedtls_ssl_session_load( &xSession, pxEntry->ucSession, pxEntry->ulSessionLength ) == 0 ) &&
+                ( mbedtls_ssl_set_session( &pxCtx->xMbedSslCtx, &xSession ) == 0 ) )
+            {
+                pxEntry->ulLastUsed = ++xSessionCache.ulUseCounter;
+                pxCtx->xSessionOffered = pdTRUE;
+            }
+            else
+            {
+                /* Written by another mbed TLS version or configuration. */
+                pxEntry->ulSessionLength = 0U;
+                prvSessionCacheSave();
+            }
+
+            mbedtls_ssl_session_free( &xSession );
+        }
+
+        prvSessionCacheUnlock();
+    }
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Store the session negotiated by a successful handshake.
+ *
+ * The protected storage copy is only rewritten when the ticket changed, a
+ * resumed session with no new ticket costs no flash write. The serialized
+ * session cannot be compared for this: mbed TLS puts a random session ID in
+ * every ClientHello that offers a ticket.
+ */
+    static void prvSessionCacheStore( TLSContext_t * pxCtx )
+    {
+        TLSSessionCacheEntry_t * pxEntry;
+        mbedtls_ssl_session xSession;
+        uint8_t ucTicketDigest[ 32 ];
+        size_t xLength = 0;
+        size_t i;
+        int lResult;
+
+        if( ( pdFALSE == prvSessionCacheUsable( pxCtx ) ) ||
+            ( pdFALSE == prvSessionCacheLock() ) )
+        {
+            return;
+        }
+
+        mbedtls_ssl_session_init( &xSession );
+        lResult = mbedtls_ssl_get_session( &pxCtx->xMbedSslCtx, &xSession );
+
+        if( 0 == lResult )
+        {
+            #if defined( MBEDTLS_SSL_SESSION_TICKETS )
+                if( xSession.ticket_len > 0U )
+                {
+                    lResult = mbedtls_sha256_ret( xSession.ticket, xSession.ticket_len, ucTicketDigest, 0 );
+                }
+                else
+            #endif
+            {
+                lResult = mbedtls_sha256_ret( xSession.id, xSession.id_len, ucTicketDigest, 0 );
+            }
+        }
+
+        if( 0 == lResult )
+        {
+            lResult = mbedtls_ssl_session_save( &xSession,
+                                                ucSessionScratch,
+                                                sizeof( ucSessionScratch ),
+                                                &xLength );
+        }
+
+        mbedtls_ssl_session_free( &xSession );
+
+        if( 0 == lResult )
+        {
+            pxEntry = prvSessionCacheFind( pxCtx );
+
+            if( NULL == pxEntry )
+            {
+                /* Reuse a free entry or evict the least recently used one. */
+                pxEntry = &xSessionCache.xEntries[ 0 ];
+
+                for( i = 1; ( i < tlsconfigSESSION_CACHE_ENTRIES ) && ( pxEntry->ulSessionLength != 0U ); i++ )
+                {
+                    if( ( xSessionCache.xEntries[ i ].ulSessionLength == 0U ) ||
+                        ( xSessionCache.xEntries[ i ].ulLastUsed < pxEntry->ulLastUsed ) )
+                    {
+                        pxEntry = &xSessionCache.xEntries[ i ];
+                    }
+                }
+
+                strcpy( pxEntry->cHostName, pxCtx->pcDestination );
+                memcpy( pxEntry->ucClientIdentity, pxCtx->ucClientIdentity, TLS_CLIENT_IDENTITY_SIZE );
+                pxEntry->ulSessionLength = 0U;
+            }
+
+            pxEntry->ulLastUsed = ++xSessionCache.ulUseCounter;
+
+            if( ( pxEntry->ulSessionLength == 0U ) ||
+                ( memcmp( pxEntry->ucTicketDigest, ucTicketDigest, sizeof( ucTicketDigest ) ) != 0 ) )
+            {
+                memcpy( pxEntry->ucSession, ucSessionScratch, xLength );
+                memcpy( pxEntry->ucTicketDigest, ucTicketDigest, sizeof( ucTicketDigest ) );
+                pxEntry->ulSessionLength = ( uint32_t ) xLength;
+                prvSessionCacheSave();
+            }
+        }
+        else if( MBEDTLS_ERR_SSL_BUFFER_TOO_SMALL == lResult )
+        {
+            TLS_PRINT( ( "WARN: TLS session of %u bytes not cached, see tlsconfigSESSION_CACHE_MAX_SESSION_SIZE.\r\n",
+                         ( unsigned ) xLength ) );
+        }
+
+        prvSessionCacheUnlock();
+    }
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Drop the session for this endpoint after the server rejected it.
+ *
+ * A server that does not know the session simply does a full handshake. An
+ * offered session is only dropped when the handshake failed because of the
+ * server, with an alert or a bad abbreviated handshake. Network errors and
+ * timeouts keep it for the next attempt.
+ */
+    static void prvSessionCacheDiscard( TLSContext_t * pxCtx,
+                                        int lHandshakeResult )
+    {
+        TLSSessionCacheEntry_t * pxEntry;
+
+        if( ( pdFALSE == pxCtx->xSessionOffered ) ||
+            ( ( MBEDTLS_ERR_SSL_FATAL_ALERT_MESSAGE != lHandshakeResult ) &&
+              ( MBEDTLS_ERR_SSL_BAD_HS_SERVER_HELLO != lHandshakeResult ) &&
+              ( MBEDTLS_ERR_SSL_BAD_HS_CHANGE_CIPHER_SPEC != lHandshakeResult ) &&
+              ( MBEDTLS_ERR_SSL_BAD_HS_FINISHED != lHandshakeResult ) &&
+              ( MBEDTLS_ERR_SSL_INVALID_MAC != lHandshakeResult ) ) ||
+            ( pdFALSE == prvSessionCacheLock() ) )
+        {
+            return;
+        }
+
+        pxEntry = prvSessionCacheFind( pxCtx );
+
+        if( NULL != pxEntry )
+        {
+            pxEntry->ulSessionLength = 0U;
+            prvSessionCacheSave();
+        }
+
+        pxCtx->xSessionOffered = pdFALSE;
+        prvSessionCacheUnlock();
+    }
+
+#endif /* if ( tlsconfigSESSION_CACHE_ENTRIES > 0 ) */
+
+/*-----------------------------------------------------------*/
+
 /*
  * Interface routines.
  */
@@ -772,60 +1478,36 @@ BaseType_t TLS_Connect( void * pvContext )
     BaseType_t xResult = 0;
     CK_RV xPKCSResult = CKR_OK;
     TLSContext_t * pxCtx = ( TLSContext_t * ) pvContext; /*lint !e9087 !e9079 Allow casting void* to other types. */
+    uint8_t ucServerKey[ 32 ];
 
     /* Initialize mbedTLS structures. */
     mbedtls_ssl_init( &pxCtx->xMbedSslCtx );
     mbedtls_ssl_config_init( &pxCtx->xMbedSslConfig );
     mbedtls_x509_crt_init( &pxCtx->xMbedX509CA );
+    pxCtx->pxMbedX509CA = &pxCtx->xMbedX509CA;
+    pxCtx->pxMbedX509Cli = &pxCtx->xMbedX509Cli;
+
+    /* Decode the root certificate: either the default or the override. The
+     * parsed roots are shared with other connections trusting the same set. */
+    memset( ucServerKey, 0, sizeof( ucServerKey ) );
 
-    /* Decode the root certificate: either the default or the override. */
     if( NULL != pxCtx->pcServerCertificate )
     {
-        xResult = mbedtls_x509_crt_parse( &pxCtx->xMbedX509CA,
-                                          ( const unsigned char * ) pxCtx->pcServerCertificate,
-                                          pxCtx->ulServerCertificateLength );
-
-        if( 0 != xResult )
-        {
-            TLS_PRINT( ( "ERROR: Failed to parse custom server certificates %s : %s \r\n",
-                         mbedtlsHighLevelCodeOrDefault( xResult ),
-                         mbedtlsLowLevelCodeOrDefault( xResult ) ) );
-        }
+        xResult = mbedtls_sha256_ret( ( const unsigned char * ) pxCtx->pcServerCertificate,
+                                      pxCtx->ulServerCertificateLength,
+                                      ucServerKey,
+                                      0 );
     }
-    else
-    {
-        xResult = mbedtls_x509_crt_parse( &pxCtx->xMbedX509CA,
-                                          ( const unsigned char * ) tlsVERISIGN_ROOT_CERTIFICATE_PEM,
-                                          tlsVERISIGN_ROOT_CERTIFICATE_LENGTH );
-
-        if( 0 == xResult )
-        {
-            xResult = mbedtls_x509_crt_parse( &pxCtx->xMbedX509CA,
-                                              ( const unsigned char * ) tlsATS1_ROOT_CERTIFICATE_PEM,
-                                              tlsATS1_ROOT_CERTIFICATE_LENGTH );
-
-            if( 0 == xResult )
-            {
-                xResult = mbedtls_x509_crt_parse( &pxCtx->xMbedX509CA,
-                                                  ( const unsigned char * ) tlsATS3_ROOT_CERTIFICATE_PEM,
-                                                  tlsATS3_ROOT_CERTIFICATE_LENGTH );
-
-                if( 0 == xResult )
-                {
-                    xResult = mbedtls_x509_crt_parse( &pxCtx->xMbedX509CA,
-                                                      ( const unsigned char * ) tlsSTARFIELD_ROOT_CERTIFICATE_PEM,
-                                                      tlsSTARFIELD_ROOT_CERTIFICATE_LENGTH );
-                }
-            }
-        }
 
-        if( 0 != xResult )
-        {
-            /* Default root certificates should be in aws_default_root_certificate.h */
-            TLS_PRINT( ( "ERROR: Failed to parse default server certificates %s : %s \r\n",
-                         mbedtlsHighLevelCodeOrDefault( xResult ),
-                         mbedtlsLowLevelCodeOrDefault( xResult ) ) );
-        }
+    if( 0 == xResult )
+    {
+        xResult = prvAcquireCertificates( pxCtx,
+                                          eTLSCertificateCacheServer,
+                                          ucServerKey,
+                                          prvParseServerCertificates,
+                                          &pxCtx->xMbedX509CA,
+                                          &pxCtx->pxMbedX509CA,
+                                          &pxCtx->pvCachedCA );
     }
 
     /* Start with protocol defaults. */
@@ -858,7 +1540,7 @@ BaseType_t TLS_Connect( void * pvContext )
         mbedtls_ssl_conf_rng( &pxCtx->xMbedSslConfig, &prvGenerateRandomBytes, pxCtx ); /*lint !e546 Nothing wrong here. */
 
         /* Set issuer certificate. */
-        mbedtls_ssl_conf_ca_chain( &pxCtx->xMbedSslConfig, &pxCtx->xMbedX509CA, NULL );
+        mbedtls_ssl_conf_ca_chain( &pxCtx->xMbedSslConfig, pxCtx->pxMbedX509CA, NULL );
 
         /* Configure the SSL context to contain device credentials (eg device cert
          * and private key) obtained from the PKCS #11 layer.  The result of
@@ -869,6 +1551,20 @@ BaseType_t TLS_Connect( void * pvContext )
          * that do not require mutual authentication. If the server does
          * require mutual authentication, the handshake will fail. */
         xPKCSResult = prvInitializeClientCredential( pxCtx );
+
+        #if ( tlsconfigSESSION_CACHE_ENTRIES > 0 )
+            /* Bind cached sessions to the device certificate so that a new
+             * identity never resumes a session negotiated with the old one. */
+            memset( pxCtx->ucClientIdentity, 0, sizeof( pxCtx->ucClientIdentity ) );
+
+            if( ( CKR_OK == xPKCSResult ) && ( NULL != pxCtx->pxMbedX509Cli->raw.p ) )
+            {
+                ( void ) mbedtls_sha256_ret( pxCtx->pxMbedX509Cli->raw.p,
+                                             pxCtx->pxMbedX509Cli->raw.len,
+                                             pxCtx->ucClientIdentity,
+                                             0 );
+            }
+        #endif
     }
 
     if( ( 0 == xResult ) && ( NULL != pxCtx->ppcAlpnProtocols ) )
@@ -912,6 +1608,13 @@ BaseType_t TLS_Connect( void * pvContext )
         xResult = mbedtls_ssl_set_hostname( &pxCtx->xMbedSslCtx, pxCtx->pcDestination );
     }
 
+    #if ( tlsconfigSESSION_CACHE_ENTRIES > 0 )
+        if( 0 == xResult )
+        {
+            prvSessionCacheOffer( pxCtx );
+        }
+    #endif
+
     /* Set the socket callbacks. */
     if( 0 == xResult )
     {
@@ -930,6 +1633,9 @@ BaseType_t TLS_Connect( void * pvContext )
                 /* There was an unexpected error. Per mbedTLS API documentation,
                  * ensure that upstream clean-up code doesn't accidentally use
                  * a context that failed the handshake. */
+                #if ( tlsconfigSESSION_CACHE_ENTRIES > 0 )
+                    prvSessionCacheDiscard( pxCtx, xResult );
+                #endif
                 prvFreeContext( pxCtx );
 
                 if( xPKCSResult != CKR_OK )
@@ -959,6 +1665,10 @@ BaseType_t TLS_Connect( void * pvContext )
     if( 0 == xResult )
     {
         pxCtx->xTLSHandshakeState = TLS_HANDSHAKE_SUCCESSFUL;
+
+        #if ( tlsconfigSESSION_CACHE_ENTRIES > 0 )
+            prvSessionCacheStore( pxCtx );
+        #endif
     }
     else if( xResult > 0 )
     {
@@ -967,7 +1677,9 @@ BaseType_t TLS_Connect( void * pvContext )
         xResult = TLS_ERROR_HANDSHAKE_FAILED;
     }
 
-    /* Free up allocated memory. */
+    /* Free up allocated memory. Cached chains stay parsed for the next connection. */
+    prvReleaseCertificates( &pxCtx->pvCachedCA );
+    prvReleaseCertificates( &pxCtx->pvCachedCli );
     mbedtls_x509_crt_free( &pxCtx->xMbedX509CA );
     mbedtls_x509_crt_free( &pxCtx->xMbedX509Cli );
 
@@ -987,7 +1699,9 @@ BaseType_t TLS_Recv( void * pvContext,
     if( ( NULL != pxCtx ) && ( TLS_HANDSHAKE_SUCCESSFUL == pxCtx->xTLSHandshakeState ) )
     {
         /* This routine will return however many bytes are returned from from mbedtls_ssl_read
-         * immediately unless MBEDTLS_ERR_SSL_WANT_READ is returned, in which case we try again. */
+         * immediately unless MBEDTLS_ERR_SSL_WANT_READ is returned, in which case we try again.
+         * Records already decrypted are drained too, as they can no longer be detected by
+         * waiting on the socket. */
         do
         {
             xResult = mbedtls_ssl_read( &pxCtx->xMbedSslCtx,
@@ -1003,7 +1717,9 @@ BaseType_t TLS_Recv( void * pvContext,
             /* If xResult == 0, then no data was received (and there is no error).
              * The secure sockets API supports non-blocking read, so stop the loop,
              * but don't flag an error. */
-        } while( xResult == MBEDTLS_ERR_SSL_WANT_READ );
+        } while( ( xResult == MBEDTLS_ERR_SSL_WANT_READ ) ||
+                 ( ( xResult > 0 ) && ( xRead < xReadLength ) &&
+                   ( mbedtls_ssl_get_bytes_avail( &pxCtx->xMbedSslCtx ) > 0U ) ) );
     }
     else
     {
@@ -1025,6 +1741,21 @@ BaseType_t TLS_Recv( void * pvContext,
 
 /*-----------------------------------------------------------*/
 
+size_t TLS_GetBytesAvailable( void * pvContext )
+{
+    TLSContext_t * pxCtx = ( TLSContext_t * ) pvContext; /*lint !e9087 !e9079 Allow casting void* to other types. */
+    size_t xAvailable = 0;
+
+    if( ( NULL != pxCtx ) && ( TLS_HANDSHAKE_SUCCESSFUL == pxCtx->xTLSHandshakeState ) )
+    {
+        xAvailable = mbedtls_ssl_get_bytes_avail( &pxCtx->xMbedSslCtx );
+    }
+
+    return xAvailable;
+}
+
+/*-----------------------------------------------------------*/
+
 BaseType_t TLS_Send( void * pvContext,
                      const unsigned char * pucMsg,
                      size_t xMsgLength )
@@ -1096,3 +1827,48 @@ void TLS_setDateIsInThePastFunction( DateIsInThePast_t DateIsInThePast )
 {
     pDateIsInThePast = DateIsInThePast;
 }
+
+/*-----------------------------------------------------------*/
+
+void TLS_FlushSessionCache( void )
+{
+    #if ( tlsconfigSESSION_CACHE_ENTRIES > 0 )
+        if( pdTRUE == prvSessionCacheLock() )
+        {
+            memset( xSessionCache.xEntries, 0, sizeof( xSessionCache.xEntries ) );
+
+            #if ( tlsconfigSESSION_CACHE_PERSIST == 1 )
+                ( void ) psa_ps_remove( tlsconfigSESSION_CACHE_UID );
+            #endif
+
+            prvSessionCacheUnlock();
+        }
+    #endif
+}
+
+/*-----------------------------------------------------------*/
+
+void TLS_FlushCertificateCache( void )
+{
+    #if ( tlsconfigCERTIFICATE_CACHE_ENTRIES > 0 )
+        size_t i;
+
+        if( pdTRUE == prvCacheMutexAcquire( &xCertificateCacheMutex ) )
+        {
+            for( i = 0; i < tlsconfigCERTIFICATE_CACHE_ENTRIES; i++ )
+            {
+                /* Chains still used by a handshake are freed on release. */
+                if( xCertificateCache[ i ].ulUsers == 0U )
+                {
+                    prvCertificateCacheEvict( &xCertificateCache[ i ] );
+                }
+                else
+                {
+                    xCertificateCache[ i ].xStale = pdTRUE;
+                }
+            }
+
+            ( void ) osMutexRelease( xCertificateCacheMutex );
+        }
+    #endif
+}
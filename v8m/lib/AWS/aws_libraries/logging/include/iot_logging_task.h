@@ -40,6 +40,9 @@
  *
  * Called once to create the logging task and queue.  Must be called before any
  * calls to vLoggingPrintf().
+ *
+ * When configLOGGING_DEFERRED_FORMATTING is 1, messages are held in a ring of
+ * configLOGGING_DEFERRED_BUFFER_SIZE bytes instead and uxQueueLength is unused.
  */
 BaseType_t xLoggingTaskInitialize( uint16_t usStackSize,
                                    UBaseType_t uxPriority,
@@ -35,6 +35,8 @@
 /* Standard includes. */
 #include <stdio.h>
 #include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
 #include <string.h>
 
 #define configLOGGING_MAX_MESSAGE_LENGTH 200
@@ -43,9 +45,84 @@
     #error configLOGGING_INCLUDE_TIME_AND_TASK_NAME must be defined to use this logging file.  Set configLOGGING_INCLUDE_TIME_AND_TASK_NAME to 1 to prepend a time stamp, message number and the name of the calling task to each logged message.  Otherwise set to 0.
 #endif
 
+/* Set to 1 to have the logging task format the messages. The calling task only
+ * records the format string, a time stamp and the raw arguments in a ring. */
+#ifndef configLOGGING_DEFERRED_FORMATTING
+    #define configLOGGING_DEFERRED_FORMATTING    0
+#endif
+
+/* Size in bytes of the ring holding the deferred log records. */
+#ifndef configLOGGING_DEFERRED_BUFFER_SIZE
+    #define configLOGGING_DEFERRED_BUFFER_SIZE    2048
+#endif
+
 /* A block time of 0 just means don't block. */
 #define loggingDONT_BLOCK    0
 
+#if ( configLOGGING_DEFERRED_FORMATTING == 1 )
+
+/* Atomic operations. */
+    #include "bootstrap/mbed_atomic.h"
+
+    #if ( ( configLOGGING_DEFERRED_BUFFER_SIZE & ( configLOGGING_DEFERRED_BUFFER_SIZE - 1 ) ) != 0 ) || \
+    ( configLOGGING_DEFERRED_BUFFER_SIZE > 0x1000000 )
+        #error configLOGGING_DEFERRED_BUFFER_SIZE must be a power of two no larger than 16MB.
+    #endif
+
+/* Layout of the header word of a deferred log record. A record is ready to be
+ * output once its header is written with loggingRECORD_COMMITTED set. */
+    #define loggingRECORD_LENGTH_MASK    0x00FFFFFFUL
+    #define loggingRECORD_LEVEL_SHIFT    24
+    #define loggingRECORD_LEVEL_MASK     0x0FUL
+    #define loggingRECORD_RAW            ( 1UL << 29 )
+    #define loggingRECORD_PADDING        ( 1UL << 30 )
+    #define loggingRECORD_COMMITTED      ( 1UL << 31 )
+
+/* Records are aligned on 8 bytes so 64-bit arguments can be read in place. */
+    #define loggingRECORD_ALIGNMENT      8UL
+    #define loggingRECORD_ALIGN( x )     ( ( ( x ) + loggingRECORD_ALIGNMENT - 1UL ) & ~( loggingRECORD_ALIGNMENT - 1UL ) )
+
+/* Event flag set when a record is committed while the logging task waits. */
+    #define loggingRECORD_FLAG           0x1UL
+
+/* Longest conversion specification handled, e.g. "%-+#0*.*llx". */
+    #define loggingMAX_SPEC_LENGTH       32
+
+/*
+ * A deferred log record, followed in the ring by the raw arguments of the
+ * message in the order of the format string. String arguments are copied.
+ */
+    typedef struct LoggingRecord
+    {
+        volatile uint32_t ulHeader;
+        uint32_t ulTimeStamp;
+        const char * pcFormat;
+        const char * pcFile;
+        uint32_t ulLine;
+        char cTaskName[ configMAX_TASK_NAME_LEN ];
+    } LoggingRecord_t;
+
+/*
+ * Type of the argument consumed by a conversion specification.
+ */
+    typedef enum LoggingArgument
+    {
+        eLoggingArgNone,      /* Literal '%' or invalid specification. */
+        eLoggingArgSkip,      /* Unsupported conversion, the argument is dropped. */
+        eLoggingArgInt,
+        eLoggingArgLong,
+        eLoggingArgLongLong,
+        eLoggingArgIntMax,
+        eLoggingArgSize,
+        eLoggingArgPtrDiff,
+        eLoggingArgPointer,
+        eLoggingArgDouble,
+        eLoggingArgLongDouble,
+        eLoggingArgString
+    } LoggingArgument_t;
+
+#endif /* configLOGGING_DEFERRED_FORMATTING == 1 */
+
 /*
  * Wrapper functions for vsnprintf and snprintf to return the actual number of
  * characters written.
@@ -81,6 +158,83 @@ static int snprintf_safe( char * s,
                           const char * format,
                           ... );
 
+/*
+ * Writes the metadata of a log message: message number, time stamp and task
+ * name, level and source location. Returns the number of characters written.
+ */
+static size_t prvWriteMetadata( char * pcBuffer,
+                                uint8_t usLoggingLevel,
+                                uint32_t ulTimeStamp,
+                                const char * pcTaskName,
+                                const char * pcFile,
+                                size_t fileLineNo,
+                                const char * pcFormat );
+
+/*
+ * Terminates a log message with a newline. Returns the new length of the
+ * message.
+ */
+static size_t prvWriteNewline( char * pcBuffer,
+                               size_t xLength,
+                               const char * pcFormat );
+
+/*
+ * Returns the name of the calling task, or "None" before the kernel starts.
+ */
+static const char * prvGetTaskName( void );
+
+#if ( configLOGGING_DEFERRED_FORMATTING == 1 )
+
+/*
+ * Parses the conversion specification that follows a '%' in a format string.
+ * Returns the length of the specification, sets the type of the argument it
+ * consumes and the number of '*' width and precision arguments before it.
+ */
+    static size_t prvParseConversion( const char * pcSpec,
+                                      LoggingArgument_t * pxArgument,
+                                      size_t * pxStars );
+
+/*
+ * Copies the arguments of a format string into a record. With a NULL record,
+ * only returns the number of bytes the arguments take.
+ */
+    static size_t prvEncodeArguments( const char * pcFormat,
+                                      va_list args,
+                                      uint8_t * pucArguments );
+
+/*
+ * Formats a message from its format string and the arguments copied by
+ * prvEncodeArguments(). Returns the number of characters written.
+ */
+    static size_t prvFormatArguments( const char * pcFormat,
+                                      const uint8_t * pucArguments,
+                                      char * pcBuffer,
+                                      size_t xBufferLength );
+
+/*
+ * Writes a log record into the ring, or drops it if the ring is full.
+ */
+    static void prvLoggingDeferCommon( uint8_t usLoggingLevel,
+                                       uint32_t ulFlags,
+                                       const char * pcFile,
+                                       size_t fileLineNo,
+                                       const char * pcFormat,
+                                       va_list args );
+
+/*
+ * Writes a log record output without metadata.
+ */
+    static void prvLoggingDeferRaw( const char * pcFormat,
+                                    ... );
+
+/*
+ * Outputs the oldest committed record of the ring. Returns pdFALSE if there
+ * is none.
+ */
+    static BaseType_t prvOutputNextRecord( void );
+
+#endif /* configLOGGING_DEFERRED_FORMATTING == 1 */
+
 /*-----------------------------------------------------------*/
 
 /*
@@ -99,11 +253,34 @@ static void prvLoggingTask( void * pvParameters );
 
 /*-----------------------------------------------------------*/
 
+#if ( configLOGGING_DEFERRED_FORMATTING == 1 )
+
+/*
+ * The ring of deferred log records. The head and tail are free running byte
+ * counters, the head is advanced by the tasks logging and the tail by the
+ * logging task once a record is output.
+ */
+    static uint64_t ullRecords[ configLOGGING_DEFERRED_BUFFER_SIZE / sizeof( uint64_t ) ];
+    static volatile uint32_t ulRecordsHead = 0;
+    static volatile uint32_t ulRecordsTail = 0;
+
+/* Number of records dropped because the ring was full. */
+    static volatile uint32_t ulRecordsDropped = 0;
+
+/* Set while the logging task waits for a record to be committed. */
+    static volatile uint32_t ulLoggingTaskWaiting = 0;
+
+    static osThreadId_t xLoggingTask = NULL;
+
+#else /* if ( configLOGGING_DEFERRED_FORMATTING == 1 ) */
+
 /*
  * The queue used to pass pointers to log messages from the task that created
  * the message to the task that will performs the output.
  */
-static osMessageQueueId_t xQueue = NULL;
+    static osMessageQueueId_t xQueue = NULL;
+
+#endif /* if ( configLOGGING_DEFERRED_FORMATTING == 1 ) */
 
 /*-----------------------------------------------------------*/
 
@@ -167,25 +344,45 @@ BaseType_t xLoggingTaskInitialize( uint16_t usStackSize,
         .stack_size = usStackSize,
         .priority = uxPriority
     };
-    /* Ensure the logging task has not been created already. */
-    if( xQueue == NULL )
-    {
-        /* Create the queue used to pass pointers to strings to the logging task. */
-        xQueue = osMessageQueueNew( uxQueueLength, sizeof( char ** ), NULL );
-
-        if( xQueue != NULL )
+    #if ( configLOGGING_DEFERRED_FORMATTING == 1 )
         {
-            if( osThreadNew( prvLoggingTask, NULL, &threadAttr ) != NULL )
+            /* The records are held in a fixed ring, there is no queue. */
+            ( void ) uxQueueLength;
+
+            /* Ensure the logging task has not been created already. */
+            if( xLoggingTask == NULL )
             {
-                xReturn = osOK;
+                xLoggingTask = osThreadNew( prvLoggingTask, NULL, &threadAttr );
+
+                if( xLoggingTask != NULL )
+                {
+                    xReturn = osOK;
+                }
             }
-            else
+        }
+    #else /* if ( configLOGGING_DEFERRED_FORMATTING == 1 ) */
+        {
+            /* Ensure the logging task has not been created already. */
+            if( xQueue == NULL )
             {
-                /* Could not create the task, so delete the queue again. */
-                osMessageQueueDelete( xQueue );
+                /* Create the queue used to pass pointers to strings to the logging task. */
+                xQueue = osMessageQueueNew( uxQueueLength, sizeof( char ** ), NULL );
+
+                if( xQueue != NULL )
+                {
+                    if( osThreadNew( prvLoggingTask, NULL, &threadAttr ) != NULL )
+                    {
+                        xReturn = osOK;
+                    }
+                    else
+                    {
+                        /* Could not create the task, so delete the queue again. */
+                        osMessageQueueDelete( xQueue );
+                    }
+                }
             }
         }
-    }
+    #endif /* if ( configLOGGING_DEFERRED_FORMATTING == 1 ) */
 
     return xReturn == osOK ? pdPASS : pdFAIL;
 }
@@ -196,166 +393,793 @@ static void prvLoggingTask( void * pvParameters )
     /* Disable unused parameter warning. */
     ( void ) pvParameters;
 
-    char * pcReceivedString = NULL;
+    #if ( configLOGGING_DEFERRED_FORMATTING == 1 )
+        {
+            for( ; ; )
+            {
+                if( prvOutputNextRecord() == pdFALSE )
+                {
+                    /* Announce the wait before checking the ring one last time, a
+                     * record committed after the check comes with the event flag. */
+                    core_util_atomic_store_u32( &ulLoggingTaskWaiting, 1U );
 
-    for( ; ; )
-    {
-        /* Block to wait for the next string to print. */
-        if( osMessageQueueGet( xQueue, &pcReceivedString, NULL, osWaitForever ) == osOK )
+                    if( prvOutputNextRecord() == pdFALSE )
+                    {
+                        ( void ) osThreadFlagsWait( loggingRECORD_FLAG, osFlagsWaitAny, osWaitForever );
+                    }
+
+                    core_util_atomic_store_u32( &ulLoggingTaskWaiting, 0U );
+                }
+            }
+        }
+    #else /* if ( configLOGGING_DEFERRED_FORMATTING == 1 ) */
         {
-            print_log( pcReceivedString );
+            char * pcReceivedString = NULL;
+
+            for( ; ; )
+            {
+                /* Block to wait for the next string to print. */
+                if( osMessageQueueGet( xQueue, &pcReceivedString, NULL, osWaitForever ) == osOK )
+                {
+                    print_log( pcReceivedString );
 
-            vPortFree( ( void * ) pcReceivedString );
+                    vPortFree( ( void * ) pcReceivedString );
+                }
+            }
         }
+    #endif /* if ( configLOGGING_DEFERRED_FORMATTING == 1 ) */
+}
+
+/*-----------------------------------------------------------*/
+
+static const char * prvGetTaskName( void )
+{
+    const char * pcTaskName = NULL;
+
+    if( osKernelGetState() != osKernelInactive )
+    {
+        pcTaskName = osThreadGetName( osThreadGetId() );
+    }
+
+    if( pcTaskName == NULL )
+    {
+        pcTaskName = "None";
     }
+
+    return pcTaskName;
 }
 
 /*-----------------------------------------------------------*/
 
-static void prvLoggingPrintfCommon( uint8_t usLoggingLevel,
-                                    const char * pcFile,
-                                    size_t fileLineNo,
-                                    const char * pcFormat,
-                                    va_list args )
+static size_t prvWriteMetadata( char * pcBuffer,
+                                uint8_t usLoggingLevel,
+                                uint32_t ulTimeStamp,
+                                const char * pcTaskName,
+                                const char * pcFile,
+                                size_t fileLineNo,
+                                const char * pcFormat )
 {
     size_t xLength = 0;
-    char * pcPrintString = NULL;
+    const char * pcLevelString = NULL;
 
-    configASSERT( usLoggingLevel <= LOG_DEBUG );
-    configASSERT( pcFormat != NULL );
-    configASSERT( configLOGGING_MAX_MESSAGE_LENGTH > 0 );
+    /* Add metadata of task name and tick time for a new log message. */
+    if( strcmp( pcFormat, "\n" ) != 0 )
+    {
+        static BaseType_t xMessageNumber = 0;
+
+        /* Add a time stamp and the name of the calling task to the
+         * start of the log. */
+        xLength += snprintf_safe( pcBuffer, configLOGGING_MAX_MESSAGE_LENGTH, "%lu %lu [%s] ",
+                                  ( unsigned long ) xMessageNumber++,
+                                  ( unsigned long ) ulTimeStamp,
+                                  pcTaskName );
+    }
 
-    /* The queue is created by xLoggingTaskInitialize().  Check
-     * xLoggingTaskInitialize() has been called. */
-    configASSERT( (uint32_t) xQueue );
+    /* Choose the string for the log level metadata for the log message. */
+    switch( usLoggingLevel )
+    {
+        case LOG_ERROR:
+            pcLevelString = "ERROR";
+            break;
+
+        case LOG_WARN:
+            pcLevelString = "WARN";
+            break;
 
-    /* Allocate a buffer to hold the log message. */
-    pcPrintString = pvPortMalloc( configLOGGING_MAX_MESSAGE_LENGTH );
+        case LOG_INFO:
+            pcLevelString = "INFO";
+            break;
 
-    if( pcPrintString != NULL )
+        case LOG_DEBUG:
+            pcLevelString = "DEBUG";
+    }
+
+    /* Add the chosen log level information as prefix for the message. */
+    if( ( pcLevelString != NULL ) && ( xLength < configLOGGING_MAX_MESSAGE_LENGTH ) )
     {
-        const char * pcLevelString = NULL;
-        size_t ulFormatLen = 0UL;
+        xLength += snprintf_safe( pcBuffer + xLength, configLOGGING_MAX_MESSAGE_LENGTH - xLength, "[%s] ", pcLevelString );
+    }
 
-        /* Add metadata of task name and tick time for a new log message. */
-        if( strcmp( pcFormat, "\n" ) != 0 )
+    /* If provided, add the source file and line number metadata in the message. */
+    if( ( pcFile != NULL ) && ( xLength < configLOGGING_MAX_MESSAGE_LENGTH ) )
+    {
+        /* If a file path is provided, extract only the file name from the string
+         * by looking for '/' or '\' directory seperator. */
+        const char * pcFileName = NULL;
+
+        /* Check if file path contains "\" as the directory separator. */
+        if( strrchr( pcFile, '\\' ) != NULL )
         {
-            /* Add metadata of task name and tick count if config is enabled. */
-                {
-                    const char * pcTaskName = NULL;
-                    const char * pcNoTask = "None";
-                    static BaseType_t xMessageNumber = 0;
+            pcFileName = strrchr( pcFile, '\\' ) + 1;
+        }
+        /* Check if file path contains "/" as the directory separator. */
+        else if( strrchr( pcFile, '/' ) != NULL )
+        {
+            pcFileName = strrchr( pcFile, '/' ) + 1;
+        }
+        else
+        {
+            /* File path contains only file name. */
+            pcFileName = pcFile;
+        }
 
-                    /* Add a time stamp and the name of the calling task to the
-                     * start of the log. */
-                    if( osKernelGetState() != osKernelInactive )
-                    {
-                        pcTaskName = osThreadGetName( osThreadGetId() );
-                    }
+        xLength += snprintf_safe( pcBuffer + xLength, configLOGGING_MAX_MESSAGE_LENGTH - xLength, "[%s:%d] ", pcFileName, fileLineNo );
+        configASSERT( xLength > 0 );
+    }
 
-                    if ( pcTaskName == NULL )
-                    {
-                        pcTaskName = pcNoTask;
-                    }
+    return xLength;
+}
 
-                    xLength += snprintf_safe( pcPrintString, configLOGGING_MAX_MESSAGE_LENGTH, "%lu %lu [%s] ",
-                                              ( unsigned long ) xMessageNumber++,
-                                              ( unsigned long ) OS_Tick_GetCount(),
-                                              pcTaskName );
-                }
+/*-----------------------------------------------------------*/
+
+static size_t prvWriteNewline( char * pcBuffer,
+                               size_t xLength,
+                               const char * pcFormat )
+{
+    size_t ulFormatLen = 0UL;
+
+    /* Add newline characters if the message does not end with them.*/
+    ulFormatLen = strlen( pcFormat );
+
+    if( ( ulFormatLen >= 2 ) &&
+        ( strncmp( pcFormat + ulFormatLen, "\r\n", 2 ) != 0 ) &&
+        ( xLength < configLOGGING_MAX_MESSAGE_LENGTH ) )
+    {
+        xLength += snprintf_safe( pcBuffer + xLength, configLOGGING_MAX_MESSAGE_LENGTH - xLength, "%s", "\r\n" );
+    }
+
+    return xLength;
+}
+
+/*-----------------------------------------------------------*/
+
+#if ( configLOGGING_DEFERRED_FORMATTING == 1 )
+
+    static size_t prvParseConversion( const char * pcSpec,
+                                      LoggingArgument_t * pxArgument,
+                                      size_t * pxStars )
+    {
+        size_t xIndex = 0;
+        size_t xLongs = 0;
+        char cLength = '\0';
+        char cConversion = '\0';
+
+        *pxArgument = eLoggingArgNone;
+        *pxStars = 0;
+
+        /* Flags. */
+        while( ( pcSpec[ xIndex ] != '\0' ) && ( strchr( "-+ #0", pcSpec[ xIndex ] ) != NULL ) )
+        {
+            xIndex++;
         }
 
-        /* Choose the string for the log level metadata for the log message. */
-        switch( usLoggingLevel )
+        /* Field width and precision, either of which may be taken from an argument. */
+        if( pcSpec[ xIndex ] == '*' )
         {
-            case LOG_ERROR:
-                pcLevelString = "ERROR";
-                break;
+            ( *pxStars )++;
+            xIndex++;
+        }
 
-            case LOG_WARN:
-                pcLevelString = "WARN";
-                break;
+        while( ( pcSpec[ xIndex ] >= '0' ) && ( pcSpec[ xIndex ] <= '9' ) )
+        {
+            xIndex++;
+        }
 
-            case LOG_INFO:
-                pcLevelString = "INFO";
-                break;
+        if( pcSpec[ xIndex ] == '.' )
+        {
+            xIndex++;
+
+            if( pcSpec[ xIndex ] == '*' )
+            {
+                ( *pxStars )++;
+                xIndex++;
+            }
 
-            case LOG_DEBUG:
-                pcLevelString = "DEBUG";
+            while( ( pcSpec[ xIndex ] >= '0' ) && ( pcSpec[ xIndex ] <= '9' ) )
+            {
+                xIndex++;
+            }
         }
 
-        /* Add the chosen log level information as prefix for the message. */
-        if( ( pcLevelString != NULL ) && ( xLength < configLOGGING_MAX_MESSAGE_LENGTH ) )
+        /* Length modifier. */
+        while( ( pcSpec[ xIndex ] != '\0' ) && ( strchr( "hljztL", pcSpec[ xIndex ] ) != NULL ) )
         {
-            xLength += snprintf_safe( pcPrintString + xLength, configLOGGING_MAX_MESSAGE_LENGTH - xLength, "[%s] ", pcLevelString );
+            cLength = pcSpec[ xIndex ];
+
+            if( cLength == 'l' )
+            {
+                xLongs++;
+            }
+
+            xIndex++;
         }
 
-        /* If provided, add the source file and line number metadata in the message. */
-        if( ( pcFile != NULL ) && ( xLength < configLOGGING_MAX_MESSAGE_LENGTH ) )
+        cConversion = pcSpec[ xIndex ];
+
+        if( cConversion != '\0' )
         {
-            /* If a file path is provided, extract only the file name from the string
-             * by looking for '/' or '\' directory seperator. */
-            const char * pcFileName = NULL;
+            xIndex++;
 
-            /* Check if file path contains "\" as the directory separator. */
-            if( strrchr( pcFile, '\\' ) != NULL )
+            if( strchr( "diouxXc", cConversion ) != NULL )
+            {
+                switch( cLength )
+                {
+                    case 'l':
+                        *pxArgument = ( ( xLongs > 1 ) && ( cConversion != 'c' ) ) ? eLoggingArgLongLong :
+                                      ( cConversion != 'c' ) ? eLoggingArgLong : eLoggingArgInt;
+                        break;
+
+                    case 'j':
+                        *pxArgument = eLoggingArgIntMax;
+                        break;
+
+                    case 'z':
+                        *pxArgument = eLoggingArgSize;
+                        break;
+
+                    case 't':
+                        *pxArgument = eLoggingArgPtrDiff;
+                        break;
+
+                    default:
+                        /* char and short are promoted to int. */
+                        *pxArgument = eLoggingArgInt;
+                        break;
+                }
+            }
+            else if( strchr( "eEfFgGaA", cConversion ) != NULL )
             {
-                pcFileName = strrchr( pcFile, '\\' ) + 1;
+                *pxArgument = ( cLength == 'L' ) ? eLoggingArgLongDouble : eLoggingArgDouble;
             }
-            /* Check if file path contains "/" as the directory separator. */
-            else if( strrchr( pcFile, '/' ) != NULL )
+            else if( cConversion == 's' )
             {
-                pcFileName = strrchr( pcFile, '/' ) + 1;
+                /* Wide strings are not copied. */
+                *pxArgument = ( cLength == 'l' ) ? eLoggingArgSkip : eLoggingArgString;
+            }
+            else if( cConversion == 'p' )
+            {
+                *pxArgument = eLoggingArgPointer;
+            }
+            else if( cConversion == 'n' )
+            {
+                *pxArgument = eLoggingArgSkip;
             }
             else
             {
-                /* File path contains only file name. */
-                pcFileName = pcFile;
+                /* Literal '%' or unknown conversion, no argument is consumed. */
+            }
+        }
+
+        return xIndex;
+    }
+
+/*-----------------------------------------------------------*/
+
+    #define loggingENCODE_ARGUMENT( xType )                                          \
+    {                                                                                \
+        xType xValue = va_arg( args, xType );                                        \
+                                                                                     \
+        if( pucArguments != NULL )                                                   \
+        {                                                                            \
+            memcpy( pucArguments + xOffset, &xValue, sizeof( xType ) );              \
+        }                                                                            \
+                                                                                     \
+        xOffset += sizeof( xType );                                                  \
+    }
+
+    static size_t prvEncodeArguments( const char * pcFormat,
+                                      va_list args,
+                                      uint8_t * pucArguments )
+    {
+        size_t xOffset = 0;
+        size_t xStringBudget = configLOGGING_MAX_MESSAGE_LENGTH;
+        size_t xStars = 0;
+        LoggingArgument_t xArgument;
+        const char * pcSpec = strchr( pcFormat, '%' );
+
+        while( pcSpec != NULL )
+        {
+            pcSpec += 1 + prvParseConversion( pcSpec + 1, &xArgument, &xStars );
+
+            for( ; xStars > 0; xStars-- )
+            {
+                loggingENCODE_ARGUMENT( int );
             }
 
-            xLength += snprintf_safe( pcPrintString + xLength, configLOGGING_MAX_MESSAGE_LENGTH - xLength, "[%s:%d] ", pcFileName, fileLineNo );
-            configASSERT( xLength > 0 );
+            switch( xArgument )
+            {
+                case eLoggingArgInt:
+                    loggingENCODE_ARGUMENT( int );
+                    break;
+
+                case eLoggingArgLong:
+                    loggingENCODE_ARGUMENT( long );
+                    break;
+
+                case eLoggingArgLongLong:
+                    loggingENCODE_ARGUMENT( long long );
+                    break;
+
+                case eLoggingArgIntMax:
+                    loggingENCODE_ARGUMENT( intmax_t );
+                    break;
+
+                case eLoggingArgSize:
+                    loggingENCODE_ARGUMENT( size_t );
+                    break;
+
+                case eLoggingArgPtrDiff:
+                    loggingENCODE_ARGUMENT( ptrdiff_t );
+                    break;
+
+                case eLoggingArgPointer:
+                    loggingENCODE_ARGUMENT( void * );
+                    break;
+
+                case eLoggingArgDouble:
+                    loggingENCODE_ARGUMENT( double );
+                    break;
+
+                case eLoggingArgLongDouble:
+                    loggingENCODE_ARGUMENT( long double );
+                    break;
+
+                case eLoggingArgString:
+                   {
+                       /* The string may not outlive the call, so copy it. All the strings
+                        * of a message together are bounded by the message length. */
+                       const char * pcString = va_arg( args, const char * );
+                       size_t xStringLength = 0;
+
+                       if( pcString == NULL )
+                       {
+                           pcString = "(null)";
+                       }
+
+                       while( ( xStringLength < xStringBudget ) && ( pcString[ xStringLength ] != '\0' ) )
+                       {
+                           xStringLength++;
+                       }
+
+                       xStringBudget -= xStringLength;
+
+                       if( pucArguments != NULL )
+                       {
+                           memcpy( pucArguments + xOffset, pcString, xStringLength );
+                           pucArguments[ xOffset + xStringLength ] = '\0';
+                       }
+
+                       xOffset += xStringLength + 1;
+                   }
+                   break;
+
+                case eLoggingArgSkip:
+                    ( void ) va_arg( args, void * );
+                    break;
+
+                default:
+                    /* No argument. */
+                    break;
+            }
+
+            pcSpec = strchr( pcSpec, '%' );
         }
 
-        if( xLength < configLOGGING_MAX_MESSAGE_LENGTH )
+        return xOffset;
+    }
+
+/*-----------------------------------------------------------*/
+
+    #define loggingFORMAT_ARGUMENT( xType )                                                          \
+    {                                                                                                \
+        xType xValue;                                                                                \
+                                                                                                     \
+        memcpy( &xValue, pucArguments + xOffset, sizeof( xType ) );                                  \
+        xOffset += sizeof( xType );                                                                  \
+                                                                                                     \
+        if( xSpecFits == pdTRUE )                                                                    \
+        {                                                                                            \
+            xLength += snprintf_safe( pcBuffer + xLength, xBufferLength - xLength, cSpec, xValue );  \
+        }                                                                                            \
+    }
+
+    static size_t prvFormatArguments( const char * pcFormat,
+                                      const uint8_t * pucArguments,
+                                      char * pcBuffer,
+                                      size_t xBufferLength )
+    {
+        char cSpec[ loggingMAX_SPEC_LENGTH ];
+        size_t xLength = 0;
+        size_t xOffset = 0;
+        size_t xSpecLength = 0;
+        size_t xStars = 0;
+        size_t xIndex = 0;
+        size_t xCopied = 0;
+        BaseType_t xSpecFits = pdTRUE;
+        LoggingArgument_t xArgument;
+        const char * pcChar = pcFormat;
+
+        configASSERT( xBufferLength > 0 );
+
+        while( ( *pcChar != '\0' ) && ( xLength < ( xBufferLength - 1 ) ) )
         {
-            xLength += vsnprintf_safe( pcPrintString + xLength, configLOGGING_MAX_MESSAGE_LENGTH - xLength, pcFormat, args );
+            if( *pcChar != '%' )
+            {
+                pcBuffer[ xLength++ ] = *pcChar++;
+            }
+            else
+            {
+                xSpecLength = prvParseConversion( pcChar + 1, &xArgument, &xStars );
+
+                /* Rebuild the conversion specification with the '*' replaced by the
+                 * values recorded for them, a single argument is formatted at a time. */
+                xSpecFits = ( ( xSpecLength + 1 + ( xStars * 11 ) ) < sizeof( cSpec ) ) ? pdTRUE : pdFALSE;
+                xCopied = 0;
+
+                for( xIndex = 0; xIndex <= xSpecLength; xIndex++ )
+                {
+                    if( pcChar[ xIndex ] == '*' )
+                    {
+                        int lStar;
+
+                        memcpy( &lStar, pucArguments + xOffset, sizeof( int ) );
+                        xOffset += sizeof( int );
+
+                        if( xSpecFits == pdTRUE )
+                        {
+                            xCopied += snprintf_safe( cSpec + xCopied, sizeof( cSpec ) - xCopied, "%d", lStar );
+                        }
+                    }
+                    else if( xSpecFits == pdTRUE )
+                    {
+                        cSpec[ xCopied++ ] = pcChar[ xIndex ];
+                    }
+                }
+
+                if( xSpecFits == pdTRUE )
+                {
+                    cSpec[ xCopied ] = '\0';
+                }
+
+                switch( xArgument )
+                {
+                    case eLoggingArgInt:
+                        loggingFORMAT_ARGUMENT( int );
+                        break;
+
+                    case eLoggingArgLong:
+                        loggingFORMAT_ARGUMENT( long );
+                        break;
+
+                    case eLoggingArgLongLong:
+                        loggingFORMAT_ARGUMENT( long long );
+                        break;
+
+                    case eLoggingArgIntMax:
+                        loggingFORMAT_ARGUMENT( intmax_t );
+                        break;
+
+                    case eLoggingArgSize:
+                        loggingFORMAT_ARGUMENT( size_t );
+                        break;
+
+                    case eLoggingArgPtrDiff:
+                        loggingFORMAT_ARGUMENT( ptrdiff_t );
+                        break;
+
+                    case eLoggingArgPointer:
+                        loggingFORMAT_ARGUMENT( void * );
+                        break;
+
+                    case eLoggingArgDouble:
+                        loggingFORMAT_ARGUMENT( double );
+                        break;
+
+                    case eLoggingArgLongDouble:
+                        loggingFORMAT_ARGUMENT( long double );
+                        break;
+
+                    case eLoggingArgString:
+                       {
+                           const char * pcString = ( const char * ) ( pucArguments + xOffset );
+
+                           xOffset += strlen( pcString ) + 1;
+
+                           if( xSpecFits == pdTRUE )
+                           {
+                               xLength += snprintf_safe( pcBuffer + xLength, xBufferLength - xLength, cSpec, pcString );
+                           }
+                       }
+                       break;
+
+                    case eLoggingArgNone:
+
+                        if( pcChar[ xSpecLength ] == '%' )
+                        {
+                            pcBuffer[ xLength++ ] = '%';
+                        }
+
+                        break;
+
+                    default:
+                        /* The argument was not recorded. */
+                        break;
+                }
+
+                pcChar += xSpecLength + 1;
+            }
         }
 
-        /* Add newline characters if the message does not end with them.*/
-        ulFormatLen = strlen( pcFormat );
+        pcBuffer[ xLength ] = '\0';
+
+        return xLength;
+    }
+
+/*-----------------------------------------------------------*/
+
+    static void prvLoggingDeferCommon( uint8_t usLoggingLevel,
+                                       uint32_t ulFlags,
+                                       const char * pcFile,
+                                       size_t fileLineNo,
+                                       const char * pcFormat,
+                                       va_list args )
+    {
+        va_list xSizingArgs;
+        uint8_t * pucRecords = ( uint8_t * ) ullRecords;
+        LoggingRecord_t * pxRecord = NULL;
+        BaseType_t xReserved = pdFALSE;
+        uint32_t ulRecordLength = 0;
+        uint32_t ulHead = 0;
+        uint32_t ulOffset = 0;
+        uint32_t ulPadding = 0;
+
+        va_copy( xSizingArgs, args );
+        ulRecordLength = ( uint32_t ) loggingRECORD_ALIGN( sizeof( LoggingRecord_t ) + prvEncodeArguments( pcFormat, xSizingArgs, NULL ) );
+        va_end( xSizingArgs );
+
+        /* Reserve room for the record. A record does not wrap around the end of the
+         * ring, the end of the ring is skipped with a padding record instead. */
+        ulHead = core_util_atomic_load_u32( &ulRecordsHead );
+
+        for( ; ; )
+        {
+            ulOffset = ulHead & ( configLOGGING_DEFERRED_BUFFER_SIZE - 1UL );
+            ulPadding = ( ( ulOffset + ulRecordLength ) > configLOGGING_DEFERRED_BUFFER_SIZE ) ?
+                        ( configLOGGING_DEFERRED_BUFFER_SIZE - ulOffset ) : 0UL;
+
+            if( ( ulHead + ulPadding + ulRecordLength - core_util_atomic_load_u32( &ulRecordsTail ) ) > configLOGGING_DEFERRED_BUFFER_SIZE )
+            {
+                /* The ring is full, do not block the caller. */
+                core_util_atomic_incr_u32( &ulRecordsDropped, 1U );
+                break;
+            }
+
+            if( core_util_atomic_cas_u32( &ulRecordsHead, &ulHead, ulHead + ulPadding + ulRecordLength ) )
+            {
+                xReserved = pdTRUE;
+                break;
+            }
+        }
 
-        if( ( ulFormatLen >= 2 ) &&
-            ( strncmp( pcFormat + ulFormatLen, "\r\n", 2 ) != 0 ) &&
-            ( xLength < configLOGGING_MAX_MESSAGE_LENGTH ) )
+        if( xReserved == pdTRUE )
         {
-            xLength += snprintf_safe( pcPrintString + xLength, configLOGGING_MAX_MESSAGE_LENGTH - xLength, "%s", "\r\n" );
+            if( ulPadding != 0UL )
+            {
+                pxRecord = ( LoggingRecord_t * ) &pucRecords[ ulOffset ];
+                core_util_atomic_store_u32( &pxRecord->ulHeader, loggingRECORD_COMMITTED | loggingRECORD_PADDING | ulPadding );
+                ulOffset = 0;
+            }
+
+            /* The task name is copied, the task may be deleted before the
+             * record is output. */
+            pxRecord = ( LoggingRecord_t * ) &pucRecords[ ulOffset ];
+            pxRecord->ulTimeStamp = ( uint32_t ) OS_Tick_GetCount();
+            pxRecord->pcFormat = pcFormat;
+            strncpy( pxRecord->cTaskName, prvGetTaskName(), sizeof( pxRecord->cTaskName ) - 1U );
+            pxRecord->cTaskName[ sizeof( pxRecord->cTaskName ) - 1U ] = '\0';
+            pxRecord->pcFile = pcFile;
+            pxRecord->ulLine = ( uint32_t ) fileLineNo;
+
+            ( void ) prvEncodeArguments( pcFormat, args, ( uint8_t * ) &pxRecord[ 1 ] );
+
+            /* Publish the record to the logging task. */
+            core_util_atomic_store_u32( &pxRecord->ulHeader,
+                                        loggingRECORD_COMMITTED | ulFlags |
+                                        ( ( uint32_t ) usLoggingLevel << loggingRECORD_LEVEL_SHIFT ) |
+                                        ulRecordLength );
+
+            if( ( core_util_atomic_load_u32( &ulLoggingTaskWaiting ) != 0U ) &&
+                ( core_util_atomic_exchange_u32( &ulLoggingTaskWaiting, 0U ) != 0U ) )
+            {
+                ( void ) osThreadFlagsSet( xLoggingTask, loggingRECORD_FLAG );
+            }
         }
+    }
+
+/*-----------------------------------------------------------*/
 
-        /* The standard says that snprintf writes the terminating NULL
-         * character. Just re-write it in case some buggy implementation does
-         * not. */
-        configASSERT( xLength < configLOGGING_MAX_MESSAGE_LENGTH );
-        pcPrintString[ xLength ] = '\0';
+    static void prvLoggingDeferRaw( const char * pcFormat,
+                                    ... )
+    {
+        va_list args;
 
-        /* Only send the buffer to the logging task if it is
-         * not empty. */
-        if( xLength > 0 )
+        va_start( args, pcFormat );
+        prvLoggingDeferCommon( LOG_NONE, loggingRECORD_RAW, NULL, 0, pcFormat, args );
+        va_end( args );
+    }
+
+/*-----------------------------------------------------------*/
+
+    static BaseType_t prvOutputNextRecord( void )
+    {
+        static char cMessage[ configLOGGING_MAX_MESSAGE_LENGTH ];
+        uint8_t * pucRecords = ( uint8_t * ) ullRecords;
+        uint32_t ulTail = ulRecordsTail;
+        uint32_t ulHeader = 0;
+        uint32_t ulDropped = 0;
+        size_t xLength = 0;
+        LoggingRecord_t * pxRecord = NULL;
+        BaseType_t xOutput = pdFALSE;
+
+        if( ulTail != core_util_atomic_load_u32( &ulRecordsHead ) )
         {
-            /* Send the string to the logging task for IO. */
-            if( osMessageQueuePut( xQueue, &pcPrintString, 0U, loggingDONT_BLOCK ) != osOK )
+            pxRecord = ( LoggingRecord_t * ) &pucRecords[ ulTail & ( configLOGGING_DEFERRED_BUFFER_SIZE - 1UL ) ];
+            ulHeader = core_util_atomic_load_u32( &pxRecord->ulHeader );
+
+            /* A record reserved but not yet committed holds back the records after it. */
+            if( ( ulHeader & loggingRECORD_COMMITTED ) != 0UL )
             {
-                /* The buffer was not sent so must be freed again. */
-                vPortFree( ( void * ) pcPrintString );
+                if( ( ulHeader & loggingRECORD_PADDING ) == 0UL )
+                {
+                    if( ( ulHeader & loggingRECORD_RAW ) == 0UL )
+                    {
+                        xLength = prvWriteMetadata( cMessage,
+                                                    ( uint8_t ) ( ( ulHeader >> loggingRECORD_LEVEL_SHIFT ) & loggingRECORD_LEVEL_MASK ),
+                                                    pxRecord->ulTimeStamp,
+                                                    pxRecord->cTaskName,
+                                                    pxRecord->pcFile,
+                                                    pxRecord->ulLine,
+                                                    pxRecord->pcFormat );
+                    }
+
+                    if( xLength < configLOGGING_MAX_MESSAGE_LENGTH )
+                    {
+                        xLength += prvFormatArguments( pxRecord->pcFormat,
+                                                       ( const uint8_t * ) &pxRecord[ 1 ],
+                                                       cMessage + xLength,
+                                                       configLOGGING_MAX_MESSAGE_LENGTH - xLength );
+                    }
+
+                    if( ( ulHeader & loggingRECORD_RAW ) == 0UL )
+                    {
+                        xLength = prvWriteNewline( cMessage, xLength, pxRecord->pcFormat );
+                    }
+
+                    configASSERT( xLength < configLOGGING_MAX_MESSAGE_LENGTH );
+                    cMessage[ xLength ] = '\0';
+
+                    if( xLength > 0 )
+                    {
+                        print_log( "%s", cMessage );
+                    }
+                }
+
+                /* Clear the record so that a record reserved later at the same place
+                 * is not seen as committed before it is. */
+                memset( ( void * ) pxRecord, 0x00, ulHeader & loggingRECORD_LENGTH_MASK );
+                core_util_atomic_store_u32( &ulRecordsTail, ulTail + ( ulHeader & loggingRECORD_LENGTH_MASK ) );
+
+                xOutput = pdTRUE;
             }
         }
-        else
+
+        if( core_util_atomic_load_u32( &ulRecordsDropped ) != 0U )
         {
-            /* The buffer was not sent, so it must be
-             * freed. */
-            vPortFree( ( void * ) pcPrintString );
+            ulDropped = core_util_atomic_exchange_u32( &ulRecordsDropped, 0U );
+            print_log( "[%lu log messages dropped]", ( unsigned long ) ulDropped );
         }
+
+        return xOutput;
     }
+
+#endif /* configLOGGING_DEFERRED_FORMATTING == 1 */
+
+/*-----------------------------------------------------------*/
+
+static void prvLoggingPrintfCommon( uint8_t usLoggingLevel,
+                                    const char * pcFile,
+                                    size_t fileLineNo,
+                                    const char * pcFormat,
+                                    va_list args )
+{
+    configASSERT( usLoggingLevel <= LOG_DEBUG );
+    configASSERT( pcFormat != NULL );
+    configASSERT( configLOGGING_MAX_MESSAGE_LENGTH > 0 );
+
+    #if ( configLOGGING_DEFERRED_FORMATTING == 1 )
+        {
+            /* The logging task is created by xLoggingTaskInitialize().  Check
+             * xLoggingTaskInitialize() has been called. */
+            configASSERT( ( uint32_t ) xLoggingTask );
+
+            /* Only record the arguments, the logging task formats the message. */
+            prvLoggingDeferCommon( usLoggingLevel, 0UL, pcFile, fileLineNo, pcFormat, args );
+        }
+    #else /* if ( configLOGGING_DEFERRED_FORMATTING == 1 ) */
+        {
+            size_t xLength = 0;
+            char * pcPrintString = NULL;
+
+            /* The queue is created by xLoggingTaskInitialize().  Check
+             * xLoggingTaskInitialize() has been called. */
+            configASSERT( ( uint32_t ) xQueue );
+
+            /* Allocate a buffer to hold the log message. */
+            pcPrintString = pvPortMalloc( configLOGGING_MAX_MESSAGE_LENGTH );
+
+            if( pcPrintString != NULL )
+            {
+                xLength = prvWriteMetadata( pcPrintString,
+                                            usLoggingLevel,
+                                            ( uint32_t ) OS_Tick_GetCount(),
+                                            prvGetTaskName(),
+                                            pcFile,
+                                            fileLineNo,
+                                            pcFormat );
+
+                if( xLength < configLOGGING_MAX_MESSAGE_LENGTH )
+                {
+                    xLength += vsnprintf_safe( pcPrintString + xLength, configLOGGING_MAX_MESSAGE_LENGTH - xLength, pcFormat, args );
+                }
+
+                xLength = prvWriteNewline( pcPrintString, xLength, pcFormat );
+
+                /* The standard says that snprintf writes the terminating NULL
+                 * character. Just re-write it in case some buggy implementation does
+                 * not. */
+                configASSERT( xLength < configLOGGING_MAX_MESSAGE_LENGTH );
+                pcPrintString[ xLength ] = '\0';
+
+                /* Only send the buffer to the logging task if it is
+                 * not empty. */
+                if( xLength > 0 )
+                {
+                    /* Send the string to the logging task for IO. */
+                    if( osMessageQueuePut( xQueue, &pcPrintString, 0U, loggingDONT_BLOCK ) != osOK )
+                    {
+                        /* The buffer was not sent so must be freed again. */
+                        vPortFree( ( void * ) pcPrintString );
+                    }
+                }
+                else
+                {
+                    /* The buffer was not sent, so it must be
+                     * freed. */
+                    vPortFree( ( void * ) pcPrintString );
+                }
+            }
+        }
+    #endif /* if ( configLOGGING_DEFERRED_FORMATTING == 1 ) */
 }
 
 /*-----------------------------------------------------------*/
@@ -453,27 +1277,40 @@ void vLoggingPrintf( const char * pcFormat,
 
 void vLoggingPrint( const char * pcMessage )
 {
-    char * pcPrintString = NULL;
-    size_t xLength = 0;
+    #if ( configLOGGING_DEFERRED_FORMATTING == 1 )
+        {
+            /* The logging task is created by xLoggingTaskInitialize().  Check
+             * xLoggingTaskInitialize() has been called. */
+            configASSERT( ( uint32_t ) xLoggingTask );
 
-    /* The queue is created by xLoggingTaskInitialize().  Check
-     * xLoggingTaskInitialize() has been called. */
-    configASSERT( (uint32_t) xQueue );
+            /* The message is copied into the record as is, without metadata. */
+            prvLoggingDeferRaw( "%s", pcMessage );
+        }
+    #else /* if ( configLOGGING_DEFERRED_FORMATTING == 1 ) */
+        {
+            char * pcPrintString = NULL;
+            size_t xLength = 0;
 
-    xLength = strlen( pcMessage ) + 1;
-    pcPrintString = pvPortMalloc( xLength );
+            /* The queue is created by xLoggingTaskInitialize().  Check
+             * xLoggingTaskInitialize() has been called. */
+            configASSERT( (uint32_t) xQueue );
 
-    if( pcPrintString != NULL )
-    {
-        strncpy( pcPrintString, pcMessage, xLength );
+            xLength = strlen( pcMessage ) + 1;
+            pcPrintString = pvPortMalloc( xLength );
 
-        /* Send the string to the logging task for IO. */
-        if( osMessageQueuePut( xQueue, &pcPrintString, 0u, loggingDONT_BLOCK ) != osOK )
-        {
-            /* The buffer was not sent so must be freed again. */
-            vPortFree( ( void * ) pcPrintString );
+            if( pcPrintString != NULL )
+            {
+                strncpy( pcPrintString, pcMessage, xLength );
+
+                /* Send the string to the logging task for IO. */
+                if( osMessageQueuePut( xQueue, &pcPrintString, 0u, loggingDONT_BLOCK ) != osOK )
+                {
+                    /* The buffer was not sent so must be freed again. */
+                    vPortFree( ( void * ) pcPrintString );
+                }
+            }
         }
-    }
+    #endif /* if ( configLOGGING_DEFERRED_FORMATTING == 1 ) */
 }
 
 /*-----------------------------------------------------------*/
@@ -45,21 +45,21 @@
 /* Includes helpers for managing MQTT subscriptions. */
 #include "mqtt_subscription_manager.h"
 
-/* Retry utilities include. */
-#include "backoff_algorithm.h"
+/* Keep-alive interval and reconnect backoff adapted to the link. */
+#include "mqtt_link_monitor.h"
 
 /* Include PKCS11 helper for random number generation. */
 #include "pkcs11_helpers.h"
 
-/*Include backoff algorithm header for retry logic.*/
-#include "backoff_algorithm.h"
-
 /* Transport interface include. */
 #include "transport_interface.h"
 
 /* Transport interface implementation include header for TLS. */
 #include "transport_secure_sockets.h"
 
+/* Network manager, for the connection to the broker. */
+#include "iot_network_manager_private.h"
+
 /* Include header for connection configurations. */
 #include "aws_clientcredential.h"
 
@@ -79,6 +79,10 @@
 /* OTA Library Interface include. */
 #include "ota_os_cmsisrtos.h"
 #include "ota_mqtt_interface.h"
+#include "ota_http_interface.h"
+
+/* Pipelined range requests for OTA over HTTP. */
+#include "http_range_pipeline.h"
 
 /* PAL abstraction layer APIs. */
 #include "ota_pal.h"
@@ -264,23 +268,6 @@ extern void OTA_HookStop(void);
  */
 #define otaexampleUNSUBSCRIBE_AFTER_OTA_SHUTDOWN    ( 1U )
 
-/**
- * @brief The maximum number of retries for network operation with server.
- */
-#define RETRY_MAX_ATTEMPTS                          ( BACKOFF_ALGORITHM_RETRY_FOREVER )
-
-/**
- * @brief The maximum back-off delay (in milliseconds) for retrying failed
- * operation with server.
- */
-#define RETRY_MAX_BACKOFF_DELAY_MS                  ( 5000U )
-
-/**
- * @brief The base back-off delay (in milliseconds) to use for network operation
- * retry attempts.
- */
-#define RETRY_BACKOFF_BASE_MS                       ( 500U )
-
 /**
  * @brief ALPN (Application-Layer Protocol Negotiation) protocol name for AWS
  * IoT MQTT.
@@ -297,6 +284,44 @@ extern void OTA_HookStop(void);
  */
 #define AWS_IOT_MQTT_ALPN_LENGTH                    ( ( uint16_t ) ( sizeof( AWS_IOT_MQTT_ALPN ) - 1 ) )
 
+/**
+ * @brief Root CA of the server hosting the update file for OTA over HTTP.
+ */
+#ifndef democonfigHTTPS_ROOT_CA_PEM
+    #define democonfigHTTPS_ROOT_CA_PEM    democonfigROOT_CA_PEM
+#endif
+
+/**
+ * @brief Number of block requests kept in flight on the OTA over HTTP connection.
+ *
+ * Each request costs a round trip, so blocks are requested ahead of the OTA
+ * agent and their responses queue up on the connection.
+ */
+#ifndef otaexampleHTTP_PIPELINE_DEPTH
+    #define otaexampleHTTP_PIPELINE_DEPTH           ( 4U )
+#endif
+
+/**
+ * @brief Transport timeout in milliseconds for the OTA over HTTP connection.
+ */
+#define otaexampleHTTP_SEND_RECV_TIMEOUT_MS         ( 5000U )
+
+/**
+ * @brief Maximum length of the host name of the update file URL.
+ */
+#define otaexampleHTTP_MAX_HOST_LEN                 ( 128U )
+
+/**
+ * @brief Size of the buffer requests are serialized in. Pre-signed URLs carry
+ * a long query string.
+ */
+#define otaexampleHTTP_REQUEST_BUFFER_SIZE          ( 2048U )
+
+/**
+ * @brief Size of the buffer response headers are received in.
+ */
+#define otaexampleHTTP_RESPONSE_BUFFER_SIZE         ( 1024U )
+
 /**
  * @brief Timeout for receiving CONNACK packet in milli seconds.
  */
@@ -310,6 +335,9 @@ extern void OTA_HookStop(void);
  * Control Packets being sent does not exceed the this Keep Alive value. In the
  * absence of sending any other Control Packets, the Client MUST send a
  * PINGREQ Packet.
+ *
+ * This is the interval of the first connection, the following ones use the
+ * interval chosen by the link monitor.
  */
 #define MQTT_KEEP_ALIVE_INTERVAL_SECONDS            ( 120U )
 
@@ -339,23 +367,6 @@ extern void OTA_HookStop(void);
  */
 #define MQTT_AGENT_MS_TO_WAIT_FOR_NOTIFICATION      ( 5000U )
 
-/**
- * @brief The maximum back-off delay (in milliseconds) for retrying connection
- * to server.
- */
-#define CONNECTION_RETRY_MAX_BACKOFF_DELAY_MS       ( 5000U )
-
-/**
- * @brief The base back-off delay (in milliseconds) to use for connection retry
- * attempts.
- */
-#define CONNECTION_RETRY_BACKOFF_BASE_MS            ( 500U )
-
-/**
- * @brief The maximum number of retries for connecting to server.
- */
-#define CONNECTION_RETRY_MAX_ATTEMPTS               ( 5U )
-
 /**
  * @brief Number of milliseconds in a second.
  */
@@ -435,13 +446,13 @@ static MQTTAgentMessageContext_t xCommandQueue;
 static MQTTAgentMessageInterface_t xMessageInterface;
 
 /**
- * @brief The global array of subscription elements.
+ * @brief The global list of subscriptions.
  *
- * @note The subscription manager implementation expects that the array of the
- * subscription elements used for storing subscriptions to be initialized to 0.
- * As this is a global array, it will be intialized to 0 by default.
+ * @note The subscription manager implementation expects that the list used
+ * for storing subscriptions to be initialized to 0. As this is a global
+ * variable, it will be intialized to 0 by default.
  */
-static SubscriptionElement_t pxGlobalSubscriptionList[ SUBSCRIPTION_MANAGER_MAX_SUBSCRIPTIONS ];
+static SubscriptionList_t xGlobalSubscriptionList;
 
 /**
  * @brief The parameters for the network context using a TLS channel.
@@ -453,6 +464,63 @@ static SecureSocketsTransportParams_t xSecureSocketsTransportParams;
  */
 static NetworkContext_t xNetworkContextMqtt;
 
+/**
+ * @brief Observations of the link to the broker, used to choose the keep-alive
+ * interval and the delay between connection attempts.
+ */
+static MQTTLinkMonitor_t xLinkMonitor;
+
+#if ( configENABLED_DATA_PROTOCOLS & OTA_DATA_OVER_HTTP )
+
+/**
+ * @brief The parameters for the network context of the OTA over HTTP connection.
+ */
+    static SecureSocketsTransportParams_t xHttpSecureSocketsTransportParams;
+
+/**
+ * @brief Network connection context used for OTA over HTTP.
+ */
+    static NetworkContext_t xNetworkContextHttp;
+
+/**
+ * @brief Transport interface of the OTA over HTTP connection.
+ */
+    static TransportInterface_t xHttpTransport;
+
+/**
+ * @brief Range requests in flight on the OTA over HTTP connection.
+ */
+    static HTTPRangePipeline_t xHttpPipeline;
+
+/**
+ * @brief URL of the update file, owned by the OTA agent.
+ */
+    static const char * pcHttpUrl;
+
+/**
+ * @brief Host name of the update file URL, NULL-terminated for the transport.
+ */
+    static char pcHttpHost[ otaexampleHTTP_MAX_HOST_LEN + 1U ];
+
+/**
+ * @brief Port of the update file URL.
+ */
+    static uint16_t usHttpPort;
+
+/**
+ * @brief Start of the next range to request.
+ */
+    static uint32_t ulHttpNextRangeStart;
+
+/**
+ * @brief Whether the OTA over HTTP connection is established.
+ */
+    static bool xHttpConnected;
+
+    static uint8_t pucHttpRequestBuffer[ otaexampleHTTP_REQUEST_BUFFER_SIZE ];
+    static uint8_t pucHttpResponseBuffer[ otaexampleHTTP_RESPONSE_BUFFER_SIZE ];
+#endif /* if ( configENABLED_DATA_PROTOCOLS & OTA_DATA_OVER_HTTP ) */
+
 /**
  * @brief Semaphore for synchronizing buffer operations.
  */
@@ -679,14 +747,58 @@ static BaseType_t prvResumeOTA( void );
  */
 static void prvSetOtaInterfaces( OtaInterfaces_t * pxOtaInterfaces );
 
+#if ( configENABLED_DATA_PROTOCOLS & OTA_DATA_OVER_HTTP )
+
+/**
+ * @brief Establish the OTA over HTTP connection to #pcHttpHost.
+ *
+ * @return true on success.
+ */
+    static bool prvHttpConnect( void );
+
+/**
+ * @brief Close the OTA over HTTP connection, if established.
+ */
+    static void prvHttpDisconnect( void );
+
+/**
+ * @brief Connect to the server hosting the update file, for OTA over HTTP.
+ *
+ * @param[in] pcUrl Pre-signed URL of the update file.
+ *
+ * @return OtaHttpSuccess or OtaHttpInitFailed.
+ */
+    static OtaHttpStatus_t prvHttpInit( char * pcUrl );
 
 /**
- * @brief Calculate and perform an exponential backoff with jitter delay for
- * the next retry attempt of a failed network operation with the server.
+ * @brief Fetch a block of the update file and pass it to the OTA agent.
+ *
+ * Requests for the following blocks are sent ahead so that their responses are
+ * already on the way when the agent asks for them.
+ *
+ * @param[in] ulRangeStart First byte of the block.
+ * @param[in] ulRangeEnd Last byte of the block.
  *
- * The function generates a random number, calculates the next backoff period
- * with the generated random number, and performs the backoff delay operation if
- * the number of retries have not exhausted.
+ * @return OtaHttpSuccess or OtaHttpRequestFailed.
+ */
+    static OtaHttpStatus_t prvHttpRequest( uint32_t ulRangeStart,
+                                           uint32_t ulRangeEnd );
+
+/**
+ * @brief Close the connection used for OTA over HTTP.
+ *
+ * @return OtaHttpSuccess.
+ */
+    static OtaHttpStatus_t prvHttpDeinit( void );
+#endif /* if ( configENABLED_DATA_PROTOCOLS & OTA_DATA_OVER_HTTP ) */
+
+
+/**
+ * @brief Calculate and perform a jittered backoff delay for the next attempt to
+ * connect to the broker.
+ *
+ * The function generates a random number, gets the next backoff period from the
+ * link monitor with the generated random number, and performs the backoff delay.
  *
  * @note The PKCS11 module is used to generate the random number as it allows
  * access to a True Random Number Generator (TRNG) if the vendor platform
@@ -694,16 +806,27 @@ static void prvSetOtaInterfaces( OtaInterfaces_t * pxOtaInterfaces );
  * device-specific entropy source so that probability of collisions from devices
  * in connection retries is mitigated.
  *
- * @note The backoff period is calculated using the backoffAlgorithm library.
- *
- * @param[in, out] pxRetryAttempts The context to use for backoff period
- * calculation with the backoffAlgorithm library.
+ * @return pdPASS if the backoff delay was performed; otherwise pdFAIL if there
+ * was failure in random number generation.
+ */
+static BaseType_t prvBackoffForRetry( void );
+
+/**
+ * @brief Log the decisions of the link monitor and the observations they are
+ * based on.
+ */
+static void prvLogLinkMetrics( void );
+
+/**
+ * @brief Receive a command for the MQTT agent, after reporting the traffic
+ * recorded by the MQTT context to the link monitor.
  *
- * @return pdPASS if calculating the backoff period was successful; otherwise
- * pdFAIL if there was failure in random number generation OR all retry attempts
- * had exhausted.
+ * The agent calls this on every pass of its loop, between the runs of the MQTT
+ * process loop, so the context is sampled in the task that updates it.
  */
-static BaseType_t prvBackoffForRetry( BackoffAlgorithmContext_t * pxRetryParams );
+static bool prvAgentMessageReceive( MQTTAgentMessageContext_t * pxMsgCtx,
+                                    MQTTAgentCommand_t ** ppxReceivedCommand,
+                                    uint32_t ulBlockTimeMs );
 
 /* Callbacks used to handle different events. */
 
@@ -1043,7 +1166,7 @@ static void prvIncomingPublishCallback( MQTTAgentContext_t * pxMqttAgentContext,
 
     /* Fan out the incoming publishes to the callbacks registered using
      * subscription manager. */
-    xPublishHandled = SubscriptionManager_HandleIncomingPublishes( ( SubscriptionElement_t * ) pxMqttAgentContext->pIncomingCallbackContext,
+    xPublishHandled = SubscriptionManager_HandleIncomingPublishes( ( SubscriptionList_t * ) pxMqttAgentContext->pIncomingCallbackContext,
                                                                    pxPublishInfo );
 
     /* If there are no callbacks to handle the incoming publishes,
@@ -1180,7 +1303,7 @@ static void prvRegisterOTACallback( const char * pcTopicFilter,
         {
             /* Add subscription so that incoming publishes are routed to the
              * application callback. */
-            xSubscriptionAdded = SubscriptionManager_AddSubscription( ( SubscriptionElement_t * ) xGlobalMqttAgentContext.pIncomingCallbackContext,
+            xSubscriptionAdded = SubscriptionManager_AddSubscription( ( SubscriptionList_t * ) xGlobalMqttAgentContext.pIncomingCallbackContext,
                                                                       pcTopicFilter,
                                                                       usTopicFilterLength,
                                                                       xOtaTopicFilterCallbacks[ usIndex ].xCallback,
@@ -1230,7 +1353,7 @@ static void prvMQTTUnsubscribeCompleteCallback( MQTTAgentCommandContext_t * pxCo
 
         /* Add subscription so that incoming publishes are routed to the
          * application callback. */
-        SubscriptionManager_RemoveSubscription( ( SubscriptionElement_t * ) xGlobalMqttAgentContext.pIncomingCallbackContext,
+        SubscriptionManager_RemoveSubscription( ( SubscriptionList_t * ) xGlobalMqttAgentContext.pIncomingCallbackContext,
                                                 pxSubscribeArgs->pSubscribeInfo->pTopicFilter,
                                                 pxSubscribeArgs->pSubscribeInfo->topicFilterLength );
 
@@ -1250,15 +1373,14 @@ static void prvMQTTUnsubscribeCompleteCallback( MQTTAgentCommandContext_t * pxCo
 }
 /*-----------------------------------------------------------*/
 
-static BaseType_t prvBackoffForRetry( BackoffAlgorithmContext_t * pxRetryParams )
+static BaseType_t prvBackoffForRetry( void )
 {
     BaseType_t xReturnStatus = pdFAIL;
-    uint16_t usNextRetryBackOff = 0U;
-    BackoffAlgorithmStatus_t xBackoffAlgStatus = BackoffAlgorithmSuccess;
+    uint32_t ulNextRetryBackOff = 0U;
 
     /**
      * To calculate the backoff period for the next retry attempt, we will
-     * generate a random number to provide to the backoffAlgorithm library.
+     * generate a random number to provide to the link monitor.
      *
      * Note: The PKCS11 module is used to generate the random number as it allows
      * access to a True Random Number Generator (TRNG) if the vendor platform
@@ -1272,23 +1394,14 @@ static BaseType_t prvBackoffForRetry( BackoffAlgorithmContext_t * pxRetryParams
                                      sizeof( ulRandomNum ) ) == osOK )
     {
         /* Get back-off value (in milliseconds) for the next retry attempt. */
-        xBackoffAlgStatus = BackoffAlgorithm_GetNextBackoff( pxRetryParams, ulRandomNum, &usNextRetryBackOff );
+        ulNextRetryBackOff = MQTTLinkMonitor_NextBackoffMs( &xLinkMonitor, ulRandomNum );
 
-        if( xBackoffAlgStatus == BackoffAlgorithmRetriesExhausted )
-        {
-            LogError( ( "All retry attempts have exhausted. Operation will not be retried" ) );
-        }
-        else if( xBackoffAlgStatus == BackoffAlgorithmSuccess )
-        {
-            /* Perform the backoff delay. */
-            osDelay( pdMS_TO_TICKS( usNextRetryBackOff ) );
+        LogInfo( ( "Retrying connection to broker in %lu ms.", ulNextRetryBackOff ) );
 
-            xReturnStatus = pdPASS;
+        /* Perform the backoff delay. */
+        osDelay( pdMS_TO_TICKS( ulNextRetryBackOff ) );
 
-            LogInfo( ( "Retry attempt %lu out of maximum retry attempts %lu.",
-                       ( pxRetryParams->attemptsDone + 1 ),
-                       pxRetryParams->maxRetryAttempts ) );
-        }
+        xReturnStatus = pdPASS;
     }
     else
     {
@@ -1299,6 +1412,25 @@ static BaseType_t prvBackoffForRetry( BackoffAlgorithmContext_t * pxRetryParams
 }
 /*-----------------------------------------------------------*/
 
+static void prvLogLinkMetrics( void )
+{
+    const MQTTLinkMetrics_t * pxMetrics = MQTTLinkMonitor_GetMetrics( &xLinkMonitor );
+
+    LogInfo( ( "Link: keep-alive %u s (idle survived %u s, timed out %u s), RTT %lu/%lu ms, "
+               "connect loss %u/1000, backoff %lu ms, %lu connections, %lu failures, %lu keep-alive timeouts.",
+               pxMetrics->usKeepAliveSeconds,
+               pxMetrics->usIdleSurvivedSeconds,
+               pxMetrics->usIdleTimeoutSeconds,
+               pxMetrics->ulRttMs,
+               pxMetrics->ulRttVarMs,
+               pxMetrics->usLossPermille,
+               pxMetrics->ulLastBackoffMs,
+               pxMetrics->ulConnections,
+               pxMetrics->ulConnectFailures,
+               pxMetrics->ulKeepAliveTimeouts ) );
+}
+/*-----------------------------------------------------------*/
+
 static uint32_t prvGetTimeMs( void )
 {
     uint32_t xTickCount = 0;
@@ -1318,6 +1450,21 @@ static uint32_t prvGetTimeMs( void )
 }
 /*-----------------------------------------------------------*/
 
+static bool prvAgentMessageReceive( MQTTAgentMessageContext_t * pxMsgCtx,
+                                    MQTTAgentCommand_t ** ppxReceivedCommand,
+                                    uint32_t ulBlockTimeMs )
+{
+    const MQTTContext_t * pxMqttContext = &( xGlobalMqttAgentContext.mqttContext );
+
+    MQTTLinkMonitor_Activity( &xLinkMonitor,
+                              pxMqttContext->lastPacketTxTime,
+                              pxMqttContext->lastPacketRxTime,
+                              prvGetTimeMs() );
+
+    return Agent_MessageReceive( pxMsgCtx, ppxReceivedCommand, ulBlockTimeMs );
+}
+/*-----------------------------------------------------------*/
+
 static MQTTStatus_t prvMqttAgentInit( void )
 {
     static TransportInterface_t xTransport;
@@ -1325,15 +1472,18 @@ static MQTTStatus_t prvMqttAgentInit( void )
     static MQTTFixedBuffer_t xFixedBuffer = { .pBuffer = pucNetworkBuffer, .size = MQTT_AGENT_NETWORK_BUFFER_SIZE };
 
     LogDebug( ( "Creating command queue." ) );
-    xCommandQueue.queue = osMessageQueueNew( MQTT_AGENT_COMMAND_QUEUE_LENGTH, 
-                                             sizeof( MQTTAgentCommand_t * ), 
-                                             NULL );
+
+    if( !Agent_MessageContextInit( &xCommandQueue, MQTT_AGENT_COMMAND_QUEUE_LENGTH ) )
+    {
+        LogError( ( "Failed to create the MQTT agent command queue." ) );
+        return MQTTNoMemory;
+    }
 
     /* Initialize the agent task pool. */
     Agent_InitializePool();
 
     xMessageInterface.pMsgCtx = &xCommandQueue;
-    xMessageInterface.recv = Agent_MessageReceive;
+    xMessageInterface.recv = prvAgentMessageReceive;
     xMessageInterface.send = Agent_MessageSend;
     xMessageInterface.getCommand = Agent_GetCommand;
     xMessageInterface.releaseCommand = Agent_ReleaseCommand;
@@ -1343,6 +1493,7 @@ static MQTTStatus_t prvMqttAgentInit( void )
     xTransport.pNetworkContext = &xNetworkContextMqtt;
     xTransport.send = SecureSocketsTransport_Send;
     xTransport.recv = SecureSocketsTransport_Recv;
+    xTransport.writev = SecureSocketsTransport_Writev;
 
     /* Initialize MQTT Agent. */
     xReturn = MQTTAgent_Init( &xGlobalMqttAgentContext,
@@ -1351,8 +1502,8 @@ static MQTTStatus_t prvMqttAgentInit( void )
                               &xTransport,
                               prvGetTimeMs,
                               prvIncomingPublishCallback,
-                              /* Context to pass into the callback. Passing the pointer to subscription array. */
-                              pxGlobalSubscriptionList );
+                              /* Context to pass into the callback. Passing the pointer to subscription list. */
+                              &xGlobalSubscriptionList );
 
     return xReturn;
 }
@@ -1364,7 +1515,6 @@ static BaseType_t prvCreateSocketConnectionToMQTTBroker( NetworkContext_t * pxNe
     SocketsConfig_t xSocketsConfig = { 0 };
     BaseType_t xStatus = pdPASS;
     TransportSocketStatus_t xNetworkStatus = TRANSPORT_SOCKET_STATUS_SUCCESS;
-    BackoffAlgorithmContext_t xReconnectParams;
 
     /* Set the credentials for establishing a TLS connection. */
     /* Initializer server information. */
@@ -1382,15 +1532,13 @@ static BaseType_t prvCreateSocketConnectionToMQTTBroker( NetworkContext_t * pxNe
     xSocketsConfig.sendTimeoutMs = otaexampleMQTT_TRANSPORT_SEND_RECV_TIMEOUT_MS;
     xSocketsConfig.recvTimeoutMs = otaexampleMQTT_TRANSPORT_SEND_RECV_TIMEOUT_MS;
 
-    /* Initialize reconnect attempts and interval. */
-    BackoffAlgorithm_InitializeParams( &xReconnectParams,
-                                       RETRY_BACKOFF_BASE_MS,
-                                       RETRY_MAX_BACKOFF_DELAY_MS,
-                                       RETRY_MAX_ATTEMPTS );
+    /* Let the network manager remember the broker addresses and dial the broker again
+     * in the background as soon as the connection is closed. */
+    ( void ) AwsIotNetworkManager_AddEndpoint( &xServerInfo, &xSocketsConfig, true );
 
     /* Attempt to connect to MQTT broker. If connection fails, retry after
-     * a timeout. Timeout value will exponentially increase till maximum
-     * attempts are reached.
+     * a timeout chosen by the link monitor, which grows with the consecutive
+     * failures and with the failure rate of the link.
      */
     do
     {
@@ -1401,13 +1549,14 @@ static BaseType_t prvCreateSocketConnectionToMQTTBroker( NetworkContext_t * pxNe
                    democonfigMQTT_BROKER_ENDPOINT,
                    democonfigMQTT_BROKER_PORT ) );
         /* Attempt to create a mutually authenticated TLS connection. */
-        xNetworkStatus = SecureSocketsTransport_Connect( pxNetworkContext,
-                                                         &xServerInfo,
-                                                         &xSocketsConfig );
+        xNetworkStatus = AwsIotNetworkManager_Connect( pxNetworkContext,
+                                                       &xServerInfo,
+                                                       &xSocketsConfig );
 
         if( xNetworkStatus != TRANSPORT_SOCKET_STATUS_SUCCESS )
         {
-            xStatus = prvBackoffForRetry( &xReconnectParams );
+            MQTTLinkMonitor_ConnectAttempt( &xLinkMonitor, false, 0, prvGetTimeMs() );
+            xStatus = prvBackoffForRetry();
         }
     } while( ( xNetworkStatus != TRANSPORT_SOCKET_STATUS_SUCCESS ) && ( xStatus == pdPASS ) );
 
@@ -1425,6 +1574,7 @@ static MQTTStatus_t prvMQTTConnect( void )
 {
     MQTTStatus_t xMqttStatus = MQTTBadParameter;
     MQTTConnectInfo_t xConnectInfo = { 0 };
+    uint32_t ulStartTimeMs;
 
     bool xSessionPresent = false;
 
@@ -1447,12 +1597,20 @@ static MQTTStatus_t prvMQTTConnect( void )
      * It is the responsibility of the Client to ensure that the interval between
      * Control Packets being sent does not exceed the this Keep Alive value. In the
      * absence of sending any other Control Packets, the Client MUST send a
-     * PINGREQ Packet. */
-    xConnectInfo.keepAliveSeconds = MQTT_KEEP_ALIVE_INTERVAL_SECONDS;
+     * PINGREQ Packet. The link monitor keeps it just below the time after which
+     * the path to the broker drops idle connections. */
+    xConnectInfo.keepAliveSeconds = MQTTLinkMonitor_KeepAliveSeconds( &xLinkMonitor );
 
-    /* Send MQTT CONNECT packet to broker. */
+    /* Send MQTT CONNECT packet to broker, the time to CONNACK is a round trip. */
+    ulStartTimeMs = prvGetTimeMs();
     xMqttStatus = MQTT_Connect( &xGlobalMqttAgentContext.mqttContext, &xConnectInfo, NULL, CONNACK_RECV_TIMEOUT_MS, &xSessionPresent );
 
+    MQTTLinkMonitor_ConnectAttempt( &xLinkMonitor,
+                                    ( xMqttStatus == MQTTSuccess ),
+                                    prvGetTimeMs() - ulStartTimeMs,
+                                    prvGetTimeMs() );
+    prvLogLinkMetrics();
+
     return xMqttStatus;
 }
 /*-----------------------------------------------------------*/
@@ -1500,6 +1658,9 @@ static BaseType_t prvConnectToMQTTBroker( void )
             xStatus = pdFAIL;
             LogError( ( "Failed creating an MQTT connection to %s.",
                         democonfigMQTT_BROKER_ENDPOINT ) );
+
+            /* The caller retries immediately with a new TLS session. */
+            ( void ) prvBackoffForRetry();
         }
         else
         {
@@ -1537,7 +1698,7 @@ static void prvDisconnectFromMQTTBroker( void )
                        pdMS_TO_TICKS( MQTT_AGENT_MS_TO_WAIT_FOR_NOTIFICATION ) );
 
     /* End TLS session, then close TCP connection. */
-    ( void ) SecureSocketsTransport_Disconnect( &xNetworkContextMqtt );
+    ( void ) AwsIotNetworkManager_Disconnect( &xNetworkContextMqtt );
 }
 /*-----------------------------------------------------------*/
 
@@ -1694,6 +1855,213 @@ static OtaMqttStatus_t prvMqttUnSubscribe( const char * pcTopicFilter,
 }
 /*-----------------------------------------------------------*/
 
+#if ( configENABLED_DATA_PROTOCOLS & OTA_DATA_OVER_HTTP )
+
+    static bool prvHttpConnect( void )
+    {
+        ServerInfo_t xServerInfo = { 0 };
+        SocketsConfig_t xSocketsConfig = { 0 };
+        TransportSocketStatus_t xNetworkStatus;
+
+        xServerInfo.pHostName = pcHttpHost;
+        xServerInfo.hostNameLength = strlen( pcHttpHost );
+        xServerInfo.port = usHttpPort;
+
+        xSocketsConfig.enableTls = true;
+        xSocketsConfig.pAlpnProtos = NULL;
+        xSocketsConfig.maxFragmentLength = 0;
+        xSocketsConfig.disableSni = false;
+        xSocketsConfig.pRootCa = democonfigHTTPS_ROOT_CA_PEM;
+        xSocketsConfig.rootCaSize = sizeof( democonfigHTTPS_ROOT_CA_PEM );
+        xSocketsConfig.sendTimeoutMs = otaexampleHTTP_SEND_RECV_TIMEOUT_MS;
+        xSocketsConfig.recvTimeoutMs = otaexampleHTTP_SEND_RECV_TIMEOUT_MS;
+
+        xNetworkContextHttp.pParams = &xHttpSecureSocketsTransportParams;
+
+        LogInfo( ( "Creating a TLS connection to %s:%u.", pcHttpHost, ( unsigned ) usHttpPort ) );
+
+        xNetworkStatus = SecureSocketsTransport_Connect( &xNetworkContextHttp,
+                                                         &xServerInfo,
+                                                         &xSocketsConfig );
+
+        xHttpConnected = ( xNetworkStatus == TRANSPORT_SOCKET_STATUS_SUCCESS );
+
+        if( xHttpConnected == false )
+        {
+            LogError( ( "Failed to connect to the HTTP server: status=%d.", xNetworkStatus ) );
+        }
+
+        httpRangePipelineReset( &xHttpPipeline );
+
+        return xHttpConnected;
+    }
+
+/*-----------------------------------------------------------*/
+
+    static void prvHttpDisconnect( void )
+    {
+        if( xHttpConnected == true )
+        {
+            ( void ) SecureSocketsTransport_Disconnect( &xNetworkContextHttp );
+            xHttpConnected = false;
+        }
+    }
+
+/*-----------------------------------------------------------*/
+
+    static OtaHttpStatus_t prvHttpInit( char * pcUrl )
+    {
+        HTTPStatus_t xHttpStatus;
+        const char * pcHostName;
+        size_t xHostNameLen;
+        bool xSecure;
+
+        prvHttpDisconnect();
+
+        pcHttpUrl = pcUrl;
+
+        xHttpTransport.pNetworkContext = &xNetworkContextHttp;
+        xHttpTransport.send = SecureSocketsTransport_Send;
+        xHttpTransport.recv = SecureSocketsTransport_Recv;
+
+        xHttpStatus = httpRangePipelineInit( &xHttpPipeline,
+                                             &xHttpTransport,
+                                             pcHttpUrl,
+                                             strlen( pcHttpUrl ),
+                                             pucHttpRequestBuffer,
+                                             sizeof( pucHttpRequestBuffer ),
+                                             pucHttpResponseBuffer,
+                                             sizeof( pucHttpResponseBuffer ) );
+
+        if( xHttpStatus != HTTPSuccess )
+        {
+            LogError( ( "Invalid OTA file URL: status=%s.", HTTPClient_strerror( xHttpStatus ) ) );
+            return OtaHttpInitFailed;
+        }
+
+        /* The URL was parsed by the pipeline. */
+        httpRangePipelineServer( &xHttpPipeline, &pcHostName, &xHostNameLen, &usHttpPort, &xSecure );
+
+        if( xSecure == false )
+        {
+            LogError( ( "OTA file URL is not HTTPS." ) );
+            return OtaHttpInitFailed;
+        }
+
+        if( xHostNameLen > otaexampleHTTP_MAX_HOST_LEN )
+        {
+            LogError( ( "OTA file host name is too long." ) );
+            return OtaHttpInitFailed;
+        }
+
+        memcpy( pcHttpHost, pcHostName, xHostNameLen );
+        pcHttpHost[ xHostNameLen ] = '\0';
+
+        ulHttpNextRangeStart = 0;
+
+        return prvHttpConnect() ? OtaHttpSuccess : OtaHttpInitFailed;
+    }
+
+/*-----------------------------------------------------------*/
+
+    static OtaHttpStatus_t prvHttpRequest( uint32_t ulRangeStart,
+                                           uint32_t ulRangeEnd )
+    {
+        HTTPStatus_t xHttpStatus = HTTPSuccess;
+        OtaEventData_t * pxEventData;
+        OtaEventMsg_t xEventMsg = { 0 };
+        uint32_t ulTotalSize;
+        uint32_t ulEnd;
+        size_t xBodyLen = 0;
+
+        /* A block other than the next one in flight means the agent is retrying,
+         * the responses queued on the connection are stale. */
+        if( ( xHttpConnected == false ) ||
+            ( ( httpRangePipelineInFlight( &xHttpPipeline ) > 0U ) &&
+              ( httpRangePipelineNextStart( &xHttpPipeline ) != ulRangeStart ) ) )
+        {
+            prvHttpDisconnect();
+
+            if( prvHttpConnect() == false )
+            {
+                return OtaHttpRequestFailed;
+            }
+        }
+
+        if( httpRangePipelineInFlight( &xHttpPipeline ) == 0U )
+        {
+            xHttpStatus = httpRangePipelineSend( &xHttpPipeline, ulRangeStart, ulRangeEnd );
+            ulHttpNextRangeStart = ulRangeEnd + 1U;
+        }
+
+        /* Ranges past the end of the file would fail, so only pipeline once the
+         * server told the size of the file. */
+        ulTotalSize = httpRangePipelineTotalSize( &xHttpPipeline );
+
+        while( ( xHttpStatus == HTTPSuccess ) && ( ulTotalSize != 0U ) &&
+               ( ulHttpNextRangeStart < ulTotalSize ) &&
+               ( httpRangePipelineInFlight( &xHttpPipeline ) < otaexampleHTTP_PIPELINE_DEPTH ) )
+        {
+            ulEnd = ulHttpNextRangeStart + otaconfigFILE_BLOCK_SIZE - 1U;
+
+            if( ulEnd >= ulTotalSize )
+            {
+                ulEnd = ulTotalSize - 1U;
+            }
+
+            xHttpStatus = httpRangePipelineSend( &xHttpPipeline, ulHttpNextRangeStart, ulEnd );
+            ulHttpNextRangeStart = ulEnd + 1U;
+        }
+
+        pxEventData = prvOtaEventBufferGet();
+
+        if( pxEventData == NULL )
+        {
+            LogError( ( "Error: No OTA data buffers available." ) );
+            return OtaHttpRequestFailed;
+        }
+
+        if( xHttpStatus == HTTPSuccess )
+        {
+            /* The body is received straight into the event buffer. */
+            xHttpStatus = httpRangePipelineReceive( &xHttpPipeline,
+                                                    pxEventData->data,
+                                                    sizeof( pxEventData->data ),
+                                                    &xBodyLen );
+        }
+
+        if( xHttpStatus != HTTPSuccess )
+        {
+            LogError( ( "Failed to fetch bytes %u-%u of the OTA file: status=%s.",
+                        ( unsigned int ) ulRangeStart,
+                        ( unsigned int ) ulRangeEnd,
+                        HTTPClient_strerror( xHttpStatus ) ) );
+            prvOtaEventBufferFree( pxEventData );
+            prvHttpDisconnect();
+            return OtaHttpRequestFailed;
+        }
+
+        pxEventData->dataLength = xBodyLen;
+        xEventMsg.eventId = OtaAgentEventReceivedFileBlock;
+        xEventMsg.pEventData = pxEventData;
+
+        OTA_SignalEvent( &xEventMsg );
+
+        return OtaHttpSuccess;
+    }
+
+/*-----------------------------------------------------------*/
+
+    static OtaHttpStatus_t prvHttpDeinit( void )
+    {
+        prvHttpDisconnect();
+
+        return OtaHttpSuccess;
+    }
+
+/*-----------------------------------------------------------*/
+#endif /* if ( configENABLED_DATA_PROTOCOLS & OTA_DATA_OVER_HTTP ) */
+
 static void prvSetOtaInterfaces( OtaInterfaces_t * pxOtaInterfaces )
 {
     /* Initialize OTA library OS Interface. */
@@ -1712,6 +2080,13 @@ static void prvSetOtaInterfaces( OtaInterfaces_t * pxOtaInterfaces )
     pxOtaInterfaces->mqtt.publish = prvMqttPublish;
     pxOtaInterfaces->mqtt.unsubscribe = prvMqttUnSubscribe;
 
+    #if ( configENABLED_DATA_PROTOCOLS & OTA_DATA_OVER_HTTP )
+        /* Initialize the OTA library HTTP Interface.*/
+        pxOtaInterfaces->http.init = prvHttpInit;
+        pxOtaInterfaces->http.request = prvHttpRequest;
+        pxOtaInterfaces->http.deinit = prvHttpDeinit;
+    #endif
+
     /* Initialize the OTA library PAL Interface.*/
     pxOtaInterfaces->pal.getPlatformImageState = otaPal_GetPlatformImageState;
     pxOtaInterfaces->pal.setPlatformImageState = otaPal_SetPlatformImageState;
@@ -1757,6 +2132,13 @@ static void prvMQTTAgentTask( void * pParam )
          * The socket will also be disconnected by the caller. */
         if( xMQTTStatus != MQTTSuccess )
         {
+            /* A keep-alive timeout is how a path dropping idle connections shows. */
+            MQTTLinkMonitor_ConnectionLost( &xLinkMonitor,
+                                            ( xMQTTStatus == MQTTKeepAliveTimeout ),
+                                            prvGetTimeMs() );
+            LogInfo( ( "Connection to broker lost: %s.", MQTT_Status_strerror( xMQTTStatus ) ) );
+            prvLogLinkMetrics();
+
             xResult = prvSuspendOTA();
             configASSERT( xResult == pdPASS );
 
@@ -1766,7 +2148,7 @@ static void prvMQTTAgentTask( void * pParam )
                 LogInfo( ( "Reconnecting TCP." ) );
 
                 /* Reconnect TCP. */
-                ( void ) SecureSocketsTransport_Disconnect( &xNetworkContextMqtt );
+                ( void ) AwsIotNetworkManager_Disconnect( &xNetworkContextMqtt );
 
                 LogInfo( ( "Connecting to MQTT broker." ) );
 
@@ -2016,6 +2398,8 @@ int RunOtaCoreMqttDemo( bool xAwsIotMqttMode,
 
     if( xDemoStatus == pdPASS )
     {
+        MQTTLinkMonitor_Init( &xLinkMonitor, MQTT_KEEP_ALIVE_INTERVAL_SECONDS );
+
         while( prvConnectToMQTTBroker() != pdPASS )
         {
             LogError( ( "Failed to initialize MQTT, retrying" ) );
@@ -2066,7 +2450,7 @@ int RunOtaCoreMqttDemo( bool xAwsIotMqttMode,
      * Remvove callback for receiving messages intended for OTA agent from broker,
      * for which the topic has not been subscribed for.
      */
-    SubscriptionManager_RemoveSubscription( ( SubscriptionElement_t * ) xGlobalMqttAgentContext.pIncomingCallbackContext,
+    SubscriptionManager_RemoveSubscription( ( SubscriptionList_t * ) xGlobalMqttAgentContext.pIncomingCallbackContext,
                                             otaexampleDEFAULT_TOPIC_FILTER,
                                             otaexampleDEFAULT_TOPIC_FILTER_LENGTH );
 
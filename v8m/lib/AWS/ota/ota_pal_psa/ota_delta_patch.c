@@ -0,0 +1,391 @@
+/*
+ * Copyright (c) 2023 Arm Limited. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+/**
+ * @file ota_delta_patch.c
+ * @brief Streaming applier for bsdiff-style delta images.
+ */
+
+#include <string.h>
+
+#include "ota_delta_patch.h"
+
+static uint32_t prvReadU32( const uint8_t * pucData )
+{
+    return ( uint32_t ) pucData[ 0 ] |
+           ( ( uint32_t ) pucData[ 1 ] << 8 ) |
+           ( ( uint32_t ) pucData[ 2 ] << 16 ) |
+           ( ( uint32_t ) pucData[ 3 ] << 24 );
+}
+
+/* Append input to the scratch buffer until it holds ulNeeded bytes. Returns the bytes consumed. */
+static uint32_t prvCollect( OtaDeltaContext_t * pxContext,
+                            const uint8_t * pucData,
+                            uint32_t ulLength,
+                            uint32_t ulNeeded )
+{
+    uint32_t ulCopy = ulNeeded - pxContext->ulScratchLength;
+
+    if( ulCopy > ulLength )
+    {
+        ulCopy = ulLength;
+    }
+
+    ( void ) memcpy( &pxContext->ucScratch[ pxContext->ulScratchLength ], pucData, ulCopy );
+    pxContext->ulScratchLength += ulCopy;
+
+    return ulCopy;
+}
+
+static OtaDeltaStatus_t prvFlush( OtaDeltaContext_t * pxContext )
+{
+    if( pxContext->ulOutputLength == 0U )
+    {
+        return OtaDeltaSuccess;
+    }
+
+    if( pxContext->xWriteTarget( pxContext->pvCallbackContext,
+                                 pxContext->ulWrittenLength,
+                                 pxContext->ucOutput,
+                                 pxContext->ulOutputLength ) == false )
+    {
+        return OtaDeltaTargetWriteFailed;
+    }
+
+    pxContext->ulWrittenLength += pxContext->ulOutputLength;
+    pxContext->ulOutputLength = 0;
+
+    return OtaDeltaSuccess;
+}
+
+static OtaDeltaStatus_t prvOutputByte( OtaDeltaContext_t * pxContext,
+                                       uint8_t ucByte )
+{
+    if( pxContext->ulTargetOffset >= pxContext->xHeader.ulTargetSize )
+    {
+        return OtaDeltaCorruptPatch;
+    }
+
+    pxContext->ucOutput[ pxContext->ulOutputLength++ ] = ucByte;
+    pxContext->ulTargetOffset++;
+
+    if( pxContext->ulOutputLength == sizeof( pxContext->ucOutput ) )
+    {
+        return prvFlush( pxContext );
+    }
+
+    return OtaDeltaSuccess;
+}
+
+static OtaDeltaStatus_t prvSourceByte( OtaDeltaContext_t * pxContext,
+                                       uint8_t * pucByte )
+{
+    uint32_t ulOffset = pxContext->ulSourceOffset;
+    uint32_t ulLength;
+
+    if( ulOffset >= pxContext->xHeader.ulSourceSize )
+    {
+        return OtaDeltaCorruptPatch;
+    }
+
+    if( ( ulOffset < pxContext->ulSourceCacheOffset ) ||
+        ( ulOffset >= ( pxContext->ulSourceCacheOffset + pxContext->ulSourceCacheLength ) ) )
+    {
+        ulLength = pxContext->xHeader.ulSourceSize - ulOffset;
+
+        if( ulLength > sizeof( pxContext->ucSource ) )
+        {
+            ulLength = sizeof( pxContext->ucSource );
+        }
+
+        if( pxContext->xReadSource( pxContext->pvCallbackContext, ulOffset, pxContext->ucSource, ulLength ) == false )
+        {
+            pxContext->ulSourceCacheLength = 0;
+            return OtaDeltaSourceReadFailed;
+        }
+
+        pxContext->ulSourceCacheOffset = ulOffset;
+        pxContext->ulSourceCacheLength = ulLength;
+    }
+
+    *pucByte = pxContext->ucSource[ ulOffset - pxContext->ulSourceCacheOffset ];
+    pxContext->ulSourceOffset++;
+
+    return OtaDeltaSuccess;
+}
+
+/* Emit one diff byte: the source byte plus ucDelta. */
+static OtaDeltaStatus_t prvDiffByte( OtaDeltaContext_t * pxContext,
+                                     uint8_t ucDelta )
+{
+    OtaDeltaStatus_t xStatus;
+    uint8_t ucSourceByte = 0;
+
+    xStatus = prvSourceByte( pxContext, &ucSourceByte );
+
+    if( xStatus == OtaDeltaSuccess )
+    {
+        xStatus = prvOutputByte( pxContext, ( uint8_t ) ( ucSourceByte + ucDelta ) );
+    }
+
+    if( xStatus == OtaDeltaSuccess )
+    {
+        pxContext->ulDiffRemaining--;
+    }
+
+    return xStatus;
+}
+
+/* Move to the next non-empty section of the current record, or to the next record. */
+static OtaDeltaStatus_t prvNextSection( OtaDeltaContext_t * pxContext )
+{
+    int64_t llSourceOffset;
+
+    if( pxContext->ulDiffRemaining > 0U )
+    {
+        pxContext->eState = OtaDeltaStateDiff;
+    }
+    else if( pxContext->ulExtraRemaining > 0U )
+    {
+        pxContext->eState = OtaDeltaStateExtra;
+    }
+    else
+    {
+        llSourceOffset = ( int64_t ) pxContext->ulSourceOffset + pxContext->lSeek;
+
+        if( ( llSourceOffset < 0 ) || ( llSourceOffset > ( int64_t ) pxContext->xHeader.ulSourceSize ) )
+        {
+            return OtaDeltaCorruptPatch;
+        }
+
+        pxContext->ulSourceOffset = ( uint32_t ) llSourceOffset;
+        pxContext->lSeek = 0;
+        pxContext->ulScratchLength = 0;
+        pxContext->eState = ( pxContext->ulTargetOffset == pxContext->xHeader.ulTargetSize ) ?
+                            OtaDeltaStateDone : OtaDeltaStateControl;
+    }
+
+    return OtaDeltaSuccess;
+}
+
+static OtaDeltaStatus_t prvParseHeader( OtaDeltaContext_t * pxContext )
+{
+    const uint8_t * pucHeader = pxContext->ucScratch;
+
+    if( prvReadU32( &pucHeader[ 0 ] ) != OTA_DELTA_MAGIC )
+    {
+        return OtaDeltaBadHeader;
+    }
+
+    pxContext->xHeader.ulSourceSize = prvReadU32( &pucHeader[ 4 ] );
+    pxContext->xHeader.ulTargetSize = prvReadU32( &pucHeader[ 8 ] );
+    ( void ) memcpy( pxContext->xHeader.ucSourceDigest, &pucHeader[ 12 ], OTA_DELTA_DIGEST_SIZE );
+    ( void ) memcpy( pxContext->xHeader.ucTargetDigest, &pucHeader[ 12 + OTA_DELTA_DIGEST_SIZE ], OTA_DELTA_DIGEST_SIZE );
+
+    if( pxContext->xHeader.ulTargetSize == 0U )
+    {
+        return OtaDeltaBadHeader;
+    }
+
+    if( ( pxContext->xCheckHeader != NULL ) &&
+        ( pxContext->xCheckHeader( pxContext->pvCallbackContext, &pxContext->xHeader ) == false ) )
+    {
+        return OtaDeltaSourceMismatch;
+    }
+
+    pxContext->ulScratchLength = 0;
+    pxContext->eState = OtaDeltaStateControl;
+
+    return OtaDeltaSuccess;
+}
+
+static OtaDeltaStatus_t prvParseControl( OtaDeltaContext_t * pxContext )
+{
+    uint32_t ulDiffLength = prvReadU32( &pxContext->ucScratch[ 0 ] );
+    uint32_t ulExtraLength = prvReadU32( &pxContext->ucScratch[ 4 ] );
+    uint32_t ulRemaining = pxContext->xHeader.ulTargetSize - pxContext->ulTargetOffset;
+
+    if( ( ulDiffLength > ulRemaining ) || ( ulExtraLength > ( ulRemaining - ulDiffLength ) ) )
+    {
+        return OtaDeltaCorruptPatch;
+    }
+
+    /* A record must make progress, otherwise a corrupt patch could loop forever. */
+    if( ( ulDiffLength == 0U ) && ( ulExtraLength == 0U ) )
+    {
+        return OtaDeltaCorruptPatch;
+    }
+
+    pxContext->ulDiffRemaining = ulDiffLength;
+    pxContext->ulExtraRemaining = ulExtraLength;
+    pxContext->lSeek = ( int32_t ) prvReadU32( &pxContext->ucScratch[ 8 ] );
+
+    return prvNextSection( pxContext );
+}
+
+OtaDeltaStatus_t OtaDelta_Init( OtaDeltaContext_t * pxContext,
+                                OtaDeltaReadSource_t xReadSource,
+                                OtaDeltaWriteTarget_t xWriteTarget,
+                                OtaDeltaCheckHeader_t xCheckHeader,
+                                void * pvCallbackContext )
+{
+    if( ( pxContext == NULL ) || ( xReadSource == NULL ) || ( xWriteTarget == NULL ) )
+    {
+        return OtaDeltaBadParameter;
+    }
+
+    ( void ) memset( pxContext, 0, sizeof( *pxContext ) );
+    pxContext->xReadSource = xReadSource;
+    pxContext->xWriteTarget = xWriteTarget;
+    pxContext->xCheckHeader = xCheckHeader;
+    pxContext->pvCallbackContext = pvCallbackContext;
+    pxContext->eState = OtaDeltaStateHeader;
+
+    return OtaDeltaSuccess;
+}
+
+OtaDeltaStatus_t OtaDelta_Write( OtaDeltaContext_t * pxContext,
+                                 const uint8_t * pucData,
+                                 uint32_t ulLength )
+{
+    OtaDeltaStatus_t xStatus = OtaDeltaSuccess;
+    uint32_t ulIndex = 0;
+    uint32_t ulRun;
+    uint8_t ucByte;
+
+    if( ( pxContext == NULL ) || ( ( pucData == NULL ) && ( ulLength > 0U ) ) )
+    {
+        return OtaDeltaBadParameter;
+    }
+
+    while( ( xStatus == OtaDeltaSuccess ) && ( ulIndex < ulLength ) )
+    {
+        switch( pxContext->eState )
+        {
+            case OtaDeltaStateHeader:
+                ulIndex += prvCollect( pxContext, &pucData[ ulIndex ], ulLength - ulIndex, OTA_DELTA_HEADER_SIZE );
+
+                if( pxContext->ulScratchLength == OTA_DELTA_HEADER_SIZE )
+                {
+                    xStatus = prvParseHeader( pxContext );
+                }
+
+                break;
+
+            case OtaDeltaStateControl:
+                ulIndex += prvCollect( pxContext, &pucData[ ulIndex ], ulLength - ulIndex, OTA_DELTA_CONTROL_SIZE );
+
+                if( pxContext->ulScratchLength == OTA_DELTA_CONTROL_SIZE )
+                {
+                    xStatus = prvParseControl( pxContext );
+                }
+
+                break;
+
+            case OtaDeltaStateDiff:
+                ucByte = pucData[ ulIndex++ ];
+
+                if( pxContext->xZeroRunPending == true )
+                {
+                    pxContext->xZeroRunPending = false;
+                    ulRun = ( uint32_t ) ucByte + 1U;
+
+                    if( ulRun > pxContext->ulDiffRemaining )
+                    {
+                        xStatus = OtaDeltaCorruptPatch;
+                    }
+
+                    while( ( xStatus == OtaDeltaSuccess ) && ( ulRun > 0U ) )
+                    {
+                        xStatus = prvDiffByte( pxContext, 0U );
+                        ulRun--;
+                    }
+                }
+                else if( ucByte == 0U )
+                {
+                    pxContext->xZeroRunPending = true;
+                }
+                else
+                {
+                    xStatus = prvDiffByte( pxContext, ucByte );
+                }
+
+                if( ( xStatus == OtaDeltaSuccess ) && ( pxContext->xZeroRunPending == false ) &&
+                    ( pxContext->ulDiffRemaining == 0U ) )
+                {
+                    xStatus = prvNextSection( pxContext );
+                }
+
+                break;
+
+            case OtaDeltaStateExtra:
+                ulRun = ulLength - ulIndex;
+
+                if( ulRun > pxContext->ulExtraRemaining )
+                {
+                    ulRun = pxContext->ulExtraRemaining;
+                }
+
+                pxContext->ulExtraRemaining -= ulRun;
+
+                while( ( xStatus == OtaDeltaSuccess ) && ( ulRun > 0U ) )
+                {
+                    xStatus = prvOutputByte( pxContext, pucData[ ulIndex++ ] );
+                    ulRun--;
+                }
+
+                if( ( xStatus == OtaDeltaSuccess ) && ( pxContext->ulExtraRemaining == 0U ) )
+                {
+                    xStatus = prvNextSection( pxContext );
+                }
+
+                break;
+
+            case OtaDeltaStateDone:
+            default:
+                /* Trailing data after the last record. */
+                xStatus = OtaDeltaCorruptPatch;
+                break;
+        }
+    }
+
+    return xStatus;
+}
+
+OtaDeltaStatus_t OtaDelta_Finish( OtaDeltaContext_t * pxContext )
+{
+    OtaDeltaStatus_t xStatus;
+
+    if( pxContext == NULL )
+    {
+        return OtaDeltaBadParameter;
+    }
+
+    xStatus = prvFlush( pxContext );
+
+    if( ( xStatus == OtaDeltaSuccess ) && ( pxContext->eState != OtaDeltaStateDone ) )
+    {
+        xStatus = OtaDeltaIncomplete;
+    }
+
+    return xStatus;
+}
@@ -0,0 +1,171 @@
+/*
+ * Copyright (c) 2023 Arm Limited. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+/**
+ * @file ota_delta_patch.h
+ * @brief Streaming applier for bsdiff-style delta images.
+ *
+ * The patch is consumed in arbitrary sized chunks, in order, and the target image
+ * is produced through a write callback using a fixed amount of RAM. The applier has
+ * no RTOS or PSA dependency so it can be built and tested on a host.
+ *
+ * Patch layout (all integers little-endian):
+ *
+ *   header:  uint32 magic "OTAD", uint32 source size, uint32 target size,
+ *            uint8[32] source SHA-256, uint8[32] target SHA-256
+ *   records: uint32 diff length, uint32 extra length, int32 source seek,
+ *            diff data, extra data
+ *
+ * As in bsdiff, each diff byte is added to the source byte at the current source
+ * offset, extra bytes are copied to the target as is and the source offset is then
+ * moved by the seek value. Diff data is zero run-length encoded: a 0x00 byte is
+ * followed by a count byte N and stands for N + 1 unchanged source bytes.
+ */
+
+#ifndef OTA_DELTA_PATCH_H_
+#define OTA_DELTA_PATCH_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define OTA_DELTA_MAGIC                 ( 0x4441544FUL ) /* "OTAD" */
+#define OTA_DELTA_DIGEST_SIZE           ( 32U )
+#define OTA_DELTA_HEADER_SIZE           ( 12U + ( 2U * OTA_DELTA_DIGEST_SIZE ) )
+#define OTA_DELTA_CONTROL_SIZE          ( 12U )
+
+/* Size of the buffer that batches target writes. */
+#ifndef OTA_DELTA_OUTPUT_BUFFER_SIZE
+#define OTA_DELTA_OUTPUT_BUFFER_SIZE    ( 512U )
+#endif
+
+/* Size of the buffer that caches source reads. */
+#ifndef OTA_DELTA_SOURCE_BUFFER_SIZE
+#define OTA_DELTA_SOURCE_BUFFER_SIZE    ( 256U )
+#endif
+
+typedef enum OtaDeltaStatus
+{
+    OtaDeltaSuccess = 0,
+    OtaDeltaBadParameter,
+    OtaDeltaBadHeader,
+    OtaDeltaSourceMismatch,
+    OtaDeltaCorruptPatch,
+    OtaDeltaSourceReadFailed,
+    OtaDeltaTargetWriteFailed,
+    OtaDeltaIncomplete
+} OtaDeltaStatus_t;
+
+typedef struct OtaDeltaHeader
+{
+    uint32_t ulSourceSize;
+    uint32_t ulTargetSize;
+    uint8_t ucSourceDigest[ OTA_DELTA_DIGEST_SIZE ];
+    uint8_t ucTargetDigest[ OTA_DELTA_DIGEST_SIZE ];
+} OtaDeltaHeader_t;
+
+/* Read ulLength bytes of the running (source) image at ulOffset. */
+typedef bool ( * OtaDeltaReadSource_t )( void * pvContext,
+                                         uint32_t ulOffset,
+                                         uint8_t * pucBuffer,
+                                         uint32_t ulLength );
+
+/* Write ulLength bytes of the reconstructed (target) image at ulOffset. Writes are sequential. */
+typedef bool ( * OtaDeltaWriteTarget_t )( void * pvContext,
+                                          uint32_t ulOffset,
+                                          const uint8_t * pucData,
+                                          uint32_t ulLength );
+
+/* Called once the header is parsed. Returning false rejects the patch, e.g. when the
+ * source digest does not match the running image. */
+typedef bool ( * OtaDeltaCheckHeader_t )( void * pvContext,
+                                          const OtaDeltaHeader_t * pxHeader );
+
+typedef enum OtaDeltaState
+{
+    OtaDeltaStateHeader = 0,
+    OtaDeltaStateControl,
+    OtaDeltaStateDiff,
+    OtaDeltaStateExtra,
+    OtaDeltaStateDone
+} OtaDeltaState_t;
+
+typedef struct OtaDeltaContext
+{
+    OtaDeltaReadSource_t xReadSource;
+    OtaDeltaWriteTarget_t xWriteTarget;
+    OtaDeltaCheckHeader_t xCheckHeader;
+    void * pvCallbackContext;
+
+    OtaDeltaState_t eState;
+    OtaDeltaHeader_t xHeader;
+
+    /* Accumulates the header and the record controls across chunk boundaries. */
+    uint8_t ucScratch[ OTA_DELTA_HEADER_SIZE ];
+    uint32_t ulScratchLength;
+
+    uint32_t ulDiffRemaining;
+    uint32_t ulExtraRemaining;
+    int32_t lSeek;
+    bool xZeroRunPending;
+
+    uint32_t ulSourceOffset;
+    uint32_t ulTargetOffset;
+
+    uint8_t ucSource[ OTA_DELTA_SOURCE_BUFFER_SIZE ];
+    uint32_t ulSourceCacheOffset;
+    uint32_t ulSourceCacheLength;
+
+    uint8_t ucOutput[ OTA_DELTA_OUTPUT_BUFFER_SIZE ];
+    uint32_t ulOutputLength;
+    uint32_t ulWrittenLength;
+} OtaDeltaContext_t;
+
+/**
+ * @brief Prepare a context for a new patch.
+ *
+ * @param[out] pxContext Context to initialise.
+ * @param[in] xReadSource Source image reader.
+ * @param[in] xWriteTarget Target image writer.
+ * @param[in] xCheckHeader Optional header validation callback, may be NULL.
+ * @param[in] pvCallbackContext Passed as is to the callbacks.
+ */
+OtaDeltaStatus_t OtaDelta_Init( OtaDeltaContext_t * pxContext,
+                                OtaDeltaReadSource_t xReadSource,
+                                OtaDeltaWriteTarget_t xWriteTarget,
+                                OtaDeltaCheckHeader_t xCheckHeader,
+                                void * pvCallbackContext );
+
+/**
+ * @brief Apply the next chunk of the patch.
+ *
+ * Chunks must be supplied in order but can have any size.
+ */
+OtaDeltaStatus_t OtaDelta_Write( OtaDeltaContext_t * pxContext,
+                                 const uint8_t * pucData,
+                                 uint32_t ulLength );
+
+/**
+ * @brief Flush the remaining output and check that the whole target was produced.
+ */
+OtaDeltaStatus_t OtaDelta_Finish( OtaDeltaContext_t * pxContext );
+
+#endif /* OTA_DELTA_PATCH_H_ */
@@ -50,6 +50,18 @@
 /* PSA services. */
 #include "psa/update.h"
 #include "psa/crypto.h"
+#include "psa/protected_storage.h"
+
+#if ( OTA_PAL_DELTA_UPDATE == 1 )
+    #include "ota_delta_patch.h"
+
+    #ifndef OTA_PAL_DELTA_SOURCE_ADDRESS
+        /* The running non-secure image, including its MCUboot header, is the patch source. */
+        #include "region_defs.h"
+        #define OTA_PAL_DELTA_SOURCE_ADDRESS     ( NS_PARTITION_START )
+        #define OTA_PAL_DELTA_SOURCE_MAX_SIZE    ( NS_PARTITION_SIZE )
+    #endif
+#endif /* OTA_PAL_DELTA_UPDATE == 1 */
 
 /***********************************************************************
  *
@@ -59,12 +71,49 @@
 
 #define ECDSA_SHA256_RAW_SIGNATURE_LENGTH     ( 64 )
 
+/* Chunk size used to hash the running image before applying a patch. */
+#define OTA_PAL_DELTA_SOURCE_HASH_CHUNK       ( 4096U )
+
+/* Marks a valid download progress record ("OTAR"). */
+#define OTA_PAL_RESUME_STATE_MAGIC            ( 0x4F544152UL )
+
 /***********************************************************************
  *
  * Structures
  *
  **********************************************************************/
 
+#if ( OTA_PAL_RESUME_DOWNLOAD == 1 )
+/**
+ * @brief Download progress record kept in PSA protected storage.
+ *
+ * The bitmap uses the OTA agent convention: a set bit is a block still to be received.
+ */
+typedef struct OtaPalResumeState
+{
+    uint32_t ulMagic;
+    psa_fwu_component_t uxComponent;
+    uint32_t ulFileSize;
+    uint32_t ulBlocksRemaining;
+    uint16_t usBitmapSize;
+    uint8_t ucJobName[ OTA_JOB_ID_MAX_SIZE ];
+    uint8_t ucBitmap[ OTA_MAX_BLOCK_BITMAP_SIZE ];
+} OtaPalResumeState_t;
+#endif /* OTA_PAL_RESUME_DOWNLOAD == 1 */
+
+#if ( OTA_PAL_DELTA_UPDATE == 1 ) && ( OTA_PAL_DELTA_REORDER_BLOCKS > 0 )
+/**
+ * @brief Block of a delta image kept until the blocks before it are applied.
+ */
+typedef struct OtaPalDeltaBlock
+{
+    bool xUsed;
+    uint32_t ulOffset;
+    uint32_t ulLength;
+    uint8_t ucData[ otaconfigFILE_BLOCK_SIZE ];
+} OtaPalDeltaBlock_t;
+#endif /* ( OTA_PAL_DELTA_UPDATE == 1 ) && ( OTA_PAL_DELTA_REORDER_BLOCKS > 0 ) */
+
 /***********************************************************************
  *
  * Variables
@@ -101,6 +150,46 @@ extern psa_key_handle_t xOTACodeVerifyKeyHandle;
     static uint8_t ucECDSARAWSignature[ ECDSA_SHA256_RAW_SIGNATURE_LENGTH ] = { 0 };
 #endif /* !defined( OTA_PAL_CODE_SIGNING_ALGO ) || ( OTA_PAL_CODE_SIGNING_ALGO == OTA_PAL_CODE_SIGNING_ECDSA ) */
 
+#if ( OTA_PAL_RESUME_DOWNLOAD == 1 )
+    /* RAM copy of the progress record of the download in progress. */
+    static OtaPalResumeState_t xResumeState = { 0 };
+
+    /* Blocks written since the progress record was last saved. */
+    static uint32_t ulResumeUnsavedBlocks = 0;
+#endif /* OTA_PAL_RESUME_DOWNLOAD == 1 */
+
+#if ( OTA_PAL_DELTA_UPDATE == 1 )
+    /* Patch applier state of the delta image being received. */
+    static OtaDeltaContext_t xDeltaContext;
+
+    /* Running digest of the reconstructed image. */
+    static psa_hash_operation_t xDeltaHash = PSA_HASH_OPERATION_INIT;
+
+    /* Offset in the patch file of the next block to apply. Patches are applied in order. */
+    static uint32_t ulDeltaPatchOffset = 0;
+
+    static bool xDeltaActive = false;
+
+    /* The whole patch was applied and the reconstructed image verified. */
+    static bool xDeltaComplete = false;
+
+    #if ( OTA_PAL_DELTA_REORDER_BLOCKS > 0 )
+        /* Blocks received ahead of the next block to apply. */
+        static OtaPalDeltaBlock_t xDeltaReorder[ OTA_PAL_DELTA_REORDER_BLOCKS ];
+    #endif
+
+    /* A block received ahead of the next block to apply did not fit in the reorder buffer.
+     * The agent counts it as received, so the patch is downloaded again from the start. */
+    static bool xDeltaRestart = false;
+
+    /* The OTA agent was asked to fetch the job document again. */
+    static bool xDeltaRestartSignalled = false;
+
+    #define otaPalDELTA_ACTIVE()    ( xDeltaActive )
+#else
+    #define otaPalDELTA_ACTIVE()    ( false )
+#endif /* OTA_PAL_DELTA_UPDATE == 1 */
+
 /***********************************************************************
  *
  * Functions
@@ -229,6 +318,501 @@ static OtaPalStatus_t PortConvertFilePathtoPSAComponentID ( OtaFileContext_t * c
     return OTA_PAL_COMBINE_ERR( OtaPalRxFileCreateFailed, 0 );
 }
 
+/* Write image data to the candidate slot in chunks the update service accepts. */
+static bool prvWriteImage( uint32_t ulOffset,
+                           const uint8_t * pucData,
+                           uint32_t ulLength )
+{
+    uint32_t ulWriteLength, ulDoneLength = 0;
+
+    while( ulLength > 0 )
+    {
+        ulWriteLength = ulLength <= PSA_FWU_MAX_WRITE_SIZE ?
+                        ulLength : PSA_FWU_MAX_WRITE_SIZE;
+        /* Call the TF-M Firmware Update service to write image data. */
+        if( psa_fwu_write( xOTAComponentID,
+                           ( size_t ) ulOffset + ulDoneLength,
+                           ( const void * )( pucData + ulDoneLength ),
+                           ( size_t ) ulWriteLength ) != PSA_SUCCESS )
+        {
+            return false;
+        }
+        ulLength -= ulWriteLength;
+        ulDoneLength += ulWriteLength;
+    }
+
+    return true;
+}
+
+#if ( OTA_PAL_DELTA_UPDATE == 1 )
+
+static bool prvDeltaReadSource( void * pvContext,
+                                uint32_t ulOffset,
+                                uint8_t * pucBuffer,
+                                uint32_t ulLength )
+{
+    ( void ) pvContext;
+
+    if( ( ulOffset > OTA_PAL_DELTA_SOURCE_MAX_SIZE ) || ( ulLength > ( OTA_PAL_DELTA_SOURCE_MAX_SIZE - ulOffset ) ) )
+    {
+        return false;
+    }
+
+    /* The running image is memory mapped. */
+    ( void ) memcpy( pucBuffer, ( const uint8_t * ) ( OTA_PAL_DELTA_SOURCE_ADDRESS ) + ulOffset, ulLength );
+    return true;
+}
+
+static bool prvDeltaWriteTarget( void * pvContext,
+                                 uint32_t ulOffset,
+                                 const uint8_t * pucData,
+                                 uint32_t ulLength )
+{
+    ( void ) pvContext;
+
+    if( psa_hash_update( &xDeltaHash, pucData, ulLength ) != PSA_SUCCESS )
+    {
+        return false;
+    }
+
+    return prvWriteImage( ulOffset, pucData, ulLength );
+}
+
+/* Make sure the patch was produced against the image that is currently running. */
+static bool prvDeltaCheckHeader( void * pvContext,
+                                 const OtaDeltaHeader_t * pxHeader )
+{
+    psa_hash_operation_t xSourceHash = PSA_HASH_OPERATION_INIT;
+    uint8_t ucDigest[ OTA_DELTA_DIGEST_SIZE ];
+    size_t xDigestLength = 0;
+    uint32_t ulOffset = 0;
+    uint32_t ulLength;
+    psa_status_t uxStatus;
+
+    ( void ) pvContext;
+
+    if( pxHeader->ulSourceSize > OTA_PAL_DELTA_SOURCE_MAX_SIZE )
+    {
+        LogError( ( "Delta image source size %u is too large.", ( unsigned int ) pxHeader->ulSourceSize ) );
+        return false;
+    }
+
+    uxStatus = psa_hash_setup( &xSourceHash, PSA_ALG_SHA_256 );
+
+    while( ( uxStatus == PSA_SUCCESS ) && ( ulOffset < pxHeader->ulSourceSize ) )
+    {
+        ulLength = pxHeader->ulSourceSize - ulOffset;
+        if( ulLength > OTA_PAL_DELTA_SOURCE_HASH_CHUNK )
+        {
+            ulLength = OTA_PAL_DELTA_SOURCE_HASH_CHUNK;
+        }
+
+        uxStatus = psa_hash_update( &xSourceHash,
+                                    ( const uint8_t * ) ( OTA_PAL_DELTA_SOURCE_ADDRESS ) + ulOffset,
+                                    ulLength );
+        ulOffset += ulLength;
+    }
+
+    if( uxStatus == PSA_SUCCESS )
+    {
+        uxStatus = psa_hash_finish( &xSourceHash, ucDigest, sizeof( ucDigest ), &xDigestLength );
+    }
+    else
+    {
+        ( void ) psa_hash_abort( &xSourceHash );
+    }
+
+    if( ( uxStatus != PSA_SUCCESS ) ||
+        ( xDigestLength != OTA_DELTA_DIGEST_SIZE ) ||
+        ( memcmp( ucDigest, pxHeader->ucSourceDigest, OTA_DELTA_DIGEST_SIZE ) != 0 ) )
+    {
+        LogError( ( "Delta image was not created against the running image." ) );
+        return false;
+    }
+
+    return true;
+}
+
+static bool prvDeltaStart( void )
+{
+    ( void ) psa_hash_abort( &xDeltaHash );
+    xDeltaHash = psa_hash_operation_init();
+
+    if( psa_hash_setup( &xDeltaHash, PSA_ALG_SHA_256 ) != PSA_SUCCESS )
+    {
+        return false;
+    }
+
+    if( OtaDelta_Init( &xDeltaContext,
+                       prvDeltaReadSource,
+                       prvDeltaWriteTarget,
+                       prvDeltaCheckHeader,
+                       NULL ) != OtaDeltaSuccess )
+    {
+        ( void ) psa_hash_abort( &xDeltaHash );
+        return false;
+    }
+
+    ulDeltaPatchOffset = 0;
+    xDeltaActive = true;
+    xDeltaComplete = false;
+#if ( OTA_PAL_DELTA_REORDER_BLOCKS > 0 )
+    ( void ) memset( xDeltaReorder, 0, sizeof( xDeltaReorder ) );
+#endif
+    xDeltaRestart = false;
+    xDeltaRestartSignalled = false;
+
+    return true;
+}
+
+static void prvDeltaStop( void )
+{
+    if( xDeltaActive == true )
+    {
+        ( void ) psa_hash_abort( &xDeltaHash );
+        xDeltaActive = false;
+    }
+}
+
+/* Feed the next block of the patch to the applier and verify the reconstructed image after the
+ * last one. */
+static bool prvDeltaApply( const uint8_t * pucData,
+                           uint32_t ulLength,
+                           uint32_t ulFileSize )
+{
+    OtaDeltaStatus_t xStatus;
+    uint8_t ucDigest[ OTA_DELTA_DIGEST_SIZE ];
+    size_t xDigestLength = 0;
+
+    xStatus = OtaDelta_Write( &xDeltaContext, pucData, ulLength );
+    if( xStatus != OtaDeltaSuccess )
+    {
+        LogError( ( "Failed to apply delta image: %d.", xStatus ) );
+        return false;
+    }
+
+    ulDeltaPatchOffset += ulLength;
+
+    if( ulDeltaPatchOffset >= ulFileSize )
+    {
+        xStatus = OtaDelta_Finish( &xDeltaContext );
+        if( xStatus != OtaDeltaSuccess )
+        {
+            LogError( ( "Delta image is incomplete: %d.", xStatus ) );
+            return false;
+        }
+
+        if( ( psa_hash_finish( &xDeltaHash, ucDigest, sizeof( ucDigest ), &xDigestLength ) != PSA_SUCCESS ) ||
+            ( xDigestLength != OTA_DELTA_DIGEST_SIZE ) ||
+            ( memcmp( ucDigest, xDeltaContext.xHeader.ucTargetDigest, OTA_DELTA_DIGEST_SIZE ) != 0 ) )
+        {
+            LogError( ( "Reconstructed image digest does not match the delta image." ) );
+            return false;
+        }
+
+        xDeltaComplete = true;
+    }
+
+    return true;
+}
+
+/* Keep a block received ahead of the next one to apply, or give up on this download. */
+static void prvDeltaDefer( uint32_t ulOffset,
+                           const uint8_t * pucData,
+                           uint32_t ulLength )
+{
+#if ( OTA_PAL_DELTA_REORDER_BLOCKS > 0 )
+    uint32_t ulIndex;
+    OtaPalDeltaBlock_t * pxFree = NULL;
+
+    for( ulIndex = 0; ulIndex < OTA_PAL_DELTA_REORDER_BLOCKS; ulIndex++ )
+    {
+        if( xDeltaReorder[ ulIndex ].xUsed == false )
+        {
+            pxFree = ( pxFree == NULL ) ? &xDeltaReorder[ ulIndex ] : pxFree;
+        }
+        else if( xDeltaReorder[ ulIndex ].ulOffset == ulOffset )
+        {
+            /* Already kept. */
+            return;
+        }
+    }
+
+    if( ( pxFree != NULL ) && ( ulLength <= sizeof( pxFree->ucData ) ) )
+    {
+        ( void ) memcpy( pxFree->ucData, pucData, ulLength );
+        pxFree->ulOffset = ulOffset;
+        pxFree->ulLength = ulLength;
+        pxFree->xUsed = true;
+        return;
+    }
+#else
+    ( void ) ulOffset;
+    ( void ) pucData;
+    ( void ) ulLength;
+#endif
+
+    if( xDeltaRestart == false )
+    {
+        LogWarn( ( "Delta image block at offset %u received too early to keep, downloading the image again.",
+                   ( unsigned int ) ulOffset ) );
+        xDeltaRestart = true;
+    }
+}
+
+/* Have the OTA agent fetch the job document again. This creates the file anew, which starts the
+ * patch from scratch, and is the only way for a block the agent already counts as received to
+ * be sent again. Retried with the next block if the event queue is full. */
+static void prvDeltaRequestRestart( void )
+{
+    OtaEventMsg_t xEventMsg = { 0 };
+
+    if( xDeltaRestartSignalled == true )
+    {
+        return;
+    }
+
+    xEventMsg.eventId = OtaAgentEventRequestJobDocument;
+    xDeltaRestartSignalled = OTA_SignalEvent( &xEventMsg );
+}
+
+/* Apply a block of the patch, in patch order whatever the order the blocks arrive in. */
+static bool prvDeltaWriteBlock( OtaFileContext_t * const pFileContext,
+                                uint32_t ulOffset,
+                                const uint8_t * pucData,
+                                uint32_t ulLength )
+{
+    bool xApplied = true;
+    uint32_t ulSkip;
+#if ( OTA_PAL_DELTA_REORDER_BLOCKS > 0 )
+    uint32_t ulIndex;
+#endif
+
+    if( xDeltaRestart == true )
+    {
+        /* Nothing past the dropped block can be applied. */
+        prvDeltaRequestRestart();
+        return true;
+    }
+
+    if( ( xDeltaComplete == true ) || ( ( ulOffset + ulLength ) <= ulDeltaPatchOffset ) )
+    {
+        LogDebug( ( "Delta image block at offset %u was already applied.", ( unsigned int ) ulOffset ) );
+        return true;
+    }
+
+    if( ulOffset > ulDeltaPatchOffset )
+    {
+        prvDeltaDefer( ulOffset, pucData, ulLength );
+
+        if( xDeltaRestart == true )
+        {
+            prvDeltaRequestRestart();
+        }
+
+        return true;
+    }
+
+    ulSkip = ulDeltaPatchOffset - ulOffset;
+    if( prvDeltaApply( pucData + ulSkip, ulLength - ulSkip, pFileContext->fileSize ) == false )
+    {
+        return false;
+    }
+
+#if ( OTA_PAL_DELTA_REORDER_BLOCKS > 0 )
+    /* Apply the blocks kept in the reorder buffer which follow. */
+    while( ( xApplied == true ) && ( xDeltaComplete == false ) )
+    {
+        xApplied = false;
+
+        for( ulIndex = 0; ulIndex < OTA_PAL_DELTA_REORDER_BLOCKS; ulIndex++ )
+        {
+            OtaPalDeltaBlock_t * pxBlock = &xDeltaReorder[ ulIndex ];
+
+            if( ( pxBlock->xUsed == true ) && ( ( pxBlock->ulOffset + pxBlock->ulLength ) <= ulDeltaPatchOffset ) )
+            {
+                pxBlock->xUsed = false;
+            }
+            else if( ( pxBlock->xUsed == true ) && ( pxBlock->ulOffset <= ulDeltaPatchOffset ) )
+            {
+                pxBlock->xUsed = false;
+                ulSkip = ulDeltaPatchOffset - pxBlock->ulOffset;
+
+                if( prvDeltaApply( &pxBlock->ucData[ ulSkip ], pxBlock->ulLength - ulSkip, pFileContext->fileSize ) == false )
+                {
+                    return false;
+                }
+
+                xApplied = true;
+            }
+        }
+    }
+#else
+    ( void ) xApplied;
+#endif
+
+    /* The agent counts this block as its last one: every block must have been applied. */
+    if( ( pFileContext->blocksRemaining == 1U ) && ( xDeltaComplete == false ) )
+    {
+        LogError( ( "Delta image ended at offset %u of %u.",
+                    ( unsigned int ) ulDeltaPatchOffset, ( unsigned int ) pFileContext->fileSize ) );
+        return false;
+    }
+
+    return true;
+}
+
+#endif /* OTA_PAL_DELTA_UPDATE == 1 */
+
+#if ( OTA_PAL_RESUME_DOWNLOAD == 1 )
+
+static void prvResumeStateSave( void )
+{
+    psa_status_t uxStatus;
+
+    uxStatus = psa_ps_set( OTA_PAL_RESUME_STATE_UID,
+                           sizeof( xResumeState ),
+                           &xResumeState,
+                           PSA_STORAGE_FLAG_NONE );
+    if( uxStatus != PSA_SUCCESS )
+    {
+        /* Not fatal: the download carries on, it just resumes from an older point. */
+        LogWarn( ( "Failed to save OTA download progress: %d.", uxStatus ) );
+    }
+
+    ulResumeUnsavedBlocks = 0;
+}
+
+static void prvResumeStateClear( void )
+{
+    psa_status_t uxStatus;
+
+    ( void ) memset( &xResumeState, 0, sizeof( xResumeState ) );
+    ulResumeUnsavedBlocks = 0;
+
+    uxStatus = psa_ps_remove( OTA_PAL_RESUME_STATE_UID );
+    if( ( uxStatus != PSA_SUCCESS ) && ( uxStatus != PSA_ERROR_DOES_NOT_EXIST ) )
+    {
+        LogWarn( ( "Failed to remove OTA download progress: %d.", uxStatus ) );
+    }
+}
+
+/**
+ * @brief Restore the progress of an interrupted download of the same job.
+ *
+ * On success the block bitmap and the remaining block count of pFileContext are
+ * overwritten with the saved ones so the OTA agent only requests missing blocks.
+ *
+ * @return true if the download was resumed, false if it must start from scratch.
+ */
+static bool prvResumeStateRestore( OtaFileContext_t * const pFileContext,
+                                   psa_fwu_component_t uxComponent )
+{
+    OtaPalResumeState_t xSaved = { 0 };
+    psa_fwu_component_info_t xComponentInfo = { 0 };
+    size_t xReadLength = 0;
+
+    if( ( pFileContext->pJobName == NULL ) || ( pFileContext->pRxBlockBitmap == NULL ) )
+    {
+        return false;
+    }
+
+    if( ( psa_ps_get( OTA_PAL_RESUME_STATE_UID, 0, sizeof( xSaved ), &xSaved, &xReadLength ) != PSA_SUCCESS ) ||
+        ( xReadLength != sizeof( xSaved ) ) ||
+        ( xSaved.ulMagic != OTA_PAL_RESUME_STATE_MAGIC ) )
+    {
+        return false;
+    }
+
+    if( ( xSaved.uxComponent != uxComponent ) ||
+        ( xSaved.ulFileSize != pFileContext->fileSize ) ||
+        ( xSaved.usBitmapSize > pFileContext->blockBitmapMaxSize ) ||
+        ( xSaved.usBitmapSize > sizeof( xSaved.ucBitmap ) ) ||
+        ( strncmp( ( const char * ) xSaved.ucJobName,
+                   ( const char * ) pFileContext->pJobName,
+                   sizeof( xSaved.ucJobName ) ) != 0 ) )
+    {
+        LogInfo( ( "Saved OTA download progress belongs to another job, discarding it." ) );
+        return false;
+    }
+
+    /* The candidate image written so far is only usable if the update service kept it. */
+    if( ( psa_fwu_query( uxComponent, &xComponentInfo ) != PSA_SUCCESS ) ||
+        ( xComponentInfo.state != PSA_FWU_WRITING ) )
+    {
+        LogInfo( ( "Candidate image is not in WRITING state, restarting the download." ) );
+        return false;
+    }
+
+    ( void ) memcpy( pFileContext->pRxBlockBitmap, xSaved.ucBitmap, xSaved.usBitmapSize );
+    pFileContext->blocksRemaining = xSaved.ulBlocksRemaining;
+    ( void ) memcpy( &xResumeState, &xSaved, sizeof( xResumeState ) );
+    ulResumeUnsavedBlocks = 0;
+
+    LogInfo( ( "Resuming OTA download with %u blocks remaining.", ( unsigned int ) xSaved.ulBlocksRemaining ) );
+    return true;
+}
+
+/* Start a new progress record from the freshly initialised OTA agent bitmap. */
+static void prvResumeStateStart( OtaFileContext_t * const pFileContext,
+                                 psa_fwu_component_t uxComponent )
+{
+    uint16_t usBitmapSize = ( uint16_t ) ( ( ( ( pFileContext->fileSize + otaconfigFILE_BLOCK_SIZE - 1U ) >>
+                                                otaconfigLOG2_FILE_BLOCK_SIZE ) + 7U ) >> 3U );
+
+    ( void ) memset( &xResumeState, 0, sizeof( xResumeState ) );
+    ulResumeUnsavedBlocks = 0;
+
+    if( ( pFileContext->pJobName == NULL ) ||
+        ( pFileContext->pRxBlockBitmap == NULL ) ||
+        ( usBitmapSize > sizeof( xResumeState.ucBitmap ) ) ||
+        ( usBitmapSize > pFileContext->blockBitmapMaxSize ) )
+    {
+        /* The download is not resumable, make sure no stale record is left. */
+        prvResumeStateClear();
+        return;
+    }
+
+    xResumeState.ulMagic = OTA_PAL_RESUME_STATE_MAGIC;
+    xResumeState.uxComponent = uxComponent;
+    xResumeState.ulFileSize = pFileContext->fileSize;
+    xResumeState.ulBlocksRemaining = pFileContext->blocksRemaining;
+    xResumeState.usBitmapSize = usBitmapSize;
+    ( void ) strncpy( ( char * ) xResumeState.ucJobName,
+                      ( const char * ) pFileContext->pJobName,
+                      sizeof( xResumeState.ucJobName ) - 1U );
+    ( void ) memcpy( xResumeState.ucBitmap, pFileContext->pRxBlockBitmap, usBitmapSize );
+
+    prvResumeStateSave();
+}
+
+/* Record a written block and save the progress every OTA_PAL_RESUME_SAVE_INTERVAL_BLOCKS blocks. */
+static void prvResumeStateBlockWritten( uint32_t ulOffset )
+{
+    uint32_t ulBlockIndex = ulOffset >> otaconfigLOG2_FILE_BLOCK_SIZE;
+    uint32_t ulByte = ulBlockIndex >> 3U;
+    uint8_t ucBitMask = ( uint8_t ) ( 1U << ( ulBlockIndex & 7U ) );
+
+    if( ( xResumeState.ulMagic != OTA_PAL_RESUME_STATE_MAGIC ) || ( ulByte >= xResumeState.usBitmapSize ) )
+    {
+        return;
+    }
+
+    if( ( xResumeState.ucBitmap[ ulByte ] & ucBitMask ) != 0U )
+    {
+        xResumeState.ucBitmap[ ulByte ] &= ( uint8_t ) ~ucBitMask;
+        xResumeState.ulBlocksRemaining--;
+        ulResumeUnsavedBlocks++;
+    }
+
+    if( ulResumeUnsavedBlocks >= OTA_PAL_RESUME_SAVE_INTERVAL_BLOCKS )
+    {
+        prvResumeStateSave();
+    }
+}
+
+#endif /* OTA_PAL_RESUME_DOWNLOAD == 1 */
+
 /**
  * @brief Abort an OTA transfer.
  *
@@ -295,6 +879,14 @@ OtaPalStatus_t otaPal_Abort( OtaFileContext_t * const pFileContext )
             retStatus = OTA_PAL_COMBINE_ERR( OtaPalAbortFailed, 1 );
         }
 
+#if ( OTA_PAL_RESUME_DOWNLOAD == 1 )
+        /* An aborted job must not be resumed later. */
+        prvResumeStateClear();
+#endif
+#if ( OTA_PAL_DELTA_UPDATE == 1 )
+        prvDeltaStop();
+#endif
+
         pxSystemContext = NULL;
         xOTAComponentID = 0;
         pFileContext->pFile = NULL;
@@ -345,12 +937,54 @@ OtaPalStatus_t otaPal_CreateFileForRx( OtaFileContext_t * const pFileContext )
         return OTA_PAL_COMBINE_ERR( OtaPalRxFileCreateFailed, 0 );
     }
 
+#if ( OTA_PAL_DELTA_UPDATE == 1 )
+    prvDeltaStop();
+
+    if( pFileContext->fileType == OTA_PAL_FILE_TYPE_DELTA )
+    {
+    #ifdef FWU_COMPONENT_ID_NONSECURE
+        /* Only the non-secure image can be read back from here to serve as the patch source. */
+        if( ( uxComponent != FWU_COMPONENT_ID_NONSECURE ) || ( prvDeltaStart() == false ) )
+    #endif
+        {
+            LogError( ( "Delta images are not supported for this component." ) );
+            return OTA_PAL_COMBINE_ERR( OtaPalRxFileCreateFailed, 0 );
+        }
+    }
+#endif
+
+#if ( OTA_PAL_RESUME_DOWNLOAD == 1 )
+    /* Continue the candidate image of an interrupted download of the same job. The patch
+     * applier state lives in RAM only, so delta images always start from scratch. */
+    if( ( otaPalDELTA_ACTIVE() == false ) && ( prvResumeStateRestore( pFileContext, uxComponent ) == true ) )
+    {
+        pxSystemContext = pFileContext;
+        xOTAComponentID = uxComponent;
+        pFileContext->pFile = &xOTAComponentID;
+        return OTA_PAL_COMBINE_ERR( OtaPalSuccess, 0 );
+    }
+#endif
+
     /* Trigger a FWU process. Image manifest is bundled within the image. */
     if( psa_fwu_start( uxComponent, NULL, 0 ) != PSA_SUCCESS )
     {
+#if ( OTA_PAL_DELTA_UPDATE == 1 )
+        prvDeltaStop();
+#endif
         return OTA_PAL_COMBINE_ERR( OtaPalRxFileCreateFailed, 0 );
     }
 
+#if ( OTA_PAL_RESUME_DOWNLOAD == 1 )
+    if( otaPalDELTA_ACTIVE() == true )
+    {
+        prvResumeStateClear();
+    }
+    else
+    {
+        prvResumeStateStart( pFileContext, uxComponent );
+    }
+#endif
+
     pxSystemContext = pFileContext;
     xOTAComponentID = uxComponent;
     pFileContext->pFile = &xOTAComponentID;
@@ -464,27 +1098,26 @@ int16_t otaPal_WriteBlock( OtaFileContext_t * const pFileContext,
                            uint8_t * const pcData,
                            uint32_t ulBlockSize )
 {
-    uint32_t ulWriteLength, ulDoneLength = 0;
+    uint32_t ulDoneLength = ulBlockSize;
 
     if( (pFileContext == NULL) || (pFileContext != pxSystemContext ) || ( xOTAComponentID >= FWU_COMPONENT_NUMBER ) )
     {
         return -1;
     }
 
-    while (ulBlockSize > 0)
+#if ( OTA_PAL_DELTA_UPDATE == 1 )
+    if( xDeltaActive == true )
     {
-        ulWriteLength = ulBlockSize <= PSA_FWU_MAX_WRITE_SIZE ?
-                        ulBlockSize : PSA_FWU_MAX_WRITE_SIZE;
-        /* Call the TF-M Firmware Update service to write image data. */
-        if( psa_fwu_write( xOTAComponentID,
-                           ( size_t ) ulOffset + ulDoneLength,
-                           ( const void * )(pcData + ulDoneLength),
-                           ( size_t ) ulWriteLength ) != PSA_SUCCESS )
+        if( prvDeltaWriteBlock( pFileContext, ulOffset, pcData, ulBlockSize ) == false )
         {
             return -1;
         }
-        ulBlockSize -= ulWriteLength;
-        ulDoneLength += ulWriteLength;
+    }
+    else
+#endif
+    if( prvWriteImage( ulOffset, pcData, ulBlockSize ) == false )
+    {
+        return -1;
     }
 
     /* If this is the last block, call 'psa_fwu_fnish()' to mark image ready for installation. */
@@ -495,7 +1128,18 @@ int16_t otaPal_WriteBlock( OtaFileContext_t * const pFileContext,
         {
             return -1;
         }
+
+#if ( OTA_PAL_RESUME_DOWNLOAD == 1 )
+        /* The candidate image is complete, there is nothing left to resume. */
+        prvResumeStateClear();
+#endif
     }
+#if ( OTA_PAL_RESUME_DOWNLOAD == 1 )
+    else
+    {
+        prvResumeStateBlockWritten( ulOffset );
+    }
+#endif
 
     return ulDoneLength;
 }
@@ -54,6 +54,42 @@
 #endif
 
 
+/* Persist the download progress in PSA protected storage so that an interrupted
+ * download resumes from the last saved block instead of restarting. */
+#ifndef OTA_PAL_RESUME_DOWNLOAD
+#define OTA_PAL_RESUME_DOWNLOAD    ( 1 )
+#endif
+
+/* UID of the download progress record in PSA protected storage. */
+#ifndef OTA_PAL_RESUME_STATE_UID
+#define OTA_PAL_RESUME_STATE_UID   ( ( psa_storage_uid_t )8 )
+#endif
+
+/* Number of written blocks between two updates of the progress record. */
+#ifndef OTA_PAL_RESUME_SAVE_INTERVAL_BLOCKS
+#define OTA_PAL_RESUME_SAVE_INTERVAL_BLOCKS   ( 8U )
+#endif
+
+
+/* Accept delta images for the non-secure component. A delta image is a patch against
+ * the running image, announced by OTA_PAL_FILE_TYPE_DELTA as fileType in the job
+ * document. See ota_delta_patch.h for the patch format. */
+#ifndef OTA_PAL_DELTA_UPDATE
+#define OTA_PAL_DELTA_UPDATE       ( 1 )
+#endif
+
+/* Blocks of a delta image received before a block which comes earlier in the patch are
+ * kept in RAM until it arrives, up to this number. If one does not fit, the OTA agent is
+ * made to fetch the job document again and the delta image is downloaded from the start.
+ * Each block takes otaconfigFILE_BLOCK_SIZE bytes. */
+#ifndef OTA_PAL_DELTA_REORDER_BLOCKS
+#define OTA_PAL_DELTA_REORDER_BLOCKS    ( 2U )
+#endif
+
+#define OTA_PAL_FILE_TYPE_FULL     ( 0U )
+#define OTA_PAL_FILE_TYPE_DELTA    ( 1U )
+
+
 /**
  * @brief Abort an OTA transfer.
  *
@@ -0,0 +1,227 @@
+#!/usr/bin/env python
+
+"""
+Copyright (c) 2023 Arm Limited. All rights reserved.
+SPDX-License-Identifier: Apache-2.0
+
+Create a delta image for the PSA OTA PAL (see lib/AWS/ota/ota_pal_psa/ota_delta_patch.h).
+
+The source is the signed image currently running on the device and the target is the
+signed update image. As in bsdiff, the target is split into regions that approximately
+match a region of the source at some offset, encoded as byte differences, and regions
+with no match, copied as is. Approximate matches are found by extending exact matches
+of MATCH_LENGTH bytes or more, so code moved by an insertion still encodes as mostly
+unchanged bytes. Unchanged bytes are encoded as zero runs.
+"""
+
+import argparse
+import hashlib
+import struct
+
+MAGIC = 0x4441544F  # "OTAD"
+
+# Shortest exact match used to align the target with the source.
+MATCH_LENGTH = 8
+# Source offsets kept for each MATCH_LENGTH-byte string, to bound the index on padding.
+MAX_CANDIDATES = 16
+
+
+def encode_diff(source, target):
+    out = bytearray()
+    i = 0
+    while i < len(target):
+        delta = (target[i] - source[i]) & 0xFF
+        if delta != 0:
+            out.append(delta)
+            i += 1
+            continue
+        run = 1
+        while i + run < len(target) and run < 256 and target[i + run] == source[i + run]:
+            run += 1
+        out += bytes([0, run - 1])
+        i += run
+    return out
+
+
+def index_source(source):
+    index = {}
+    for i in range(len(source) - MATCH_LENGTH + 1):
+        positions = index.setdefault(source[i : i + MATCH_LENGTH], [])
+        if len(positions) < MAX_CANDIDATES:
+            positions.append(i)
+    return index
+
+
+def match_length(source, source_offset, target, target_offset):
+    length = 0
+    limit = min(len(source) - source_offset, len(target) - target_offset)
+    # Compare in chunks first, slices compare at C speed.
+    chunk = 64
+    while length + chunk <= limit and (
+        source[source_offset + length : source_offset + length + chunk]
+        == target[target_offset + length : target_offset + length + chunk]
+    ):
+        length += chunk
+    while length < limit and source[source_offset + length] == target[target_offset + length]:
+        length += 1
+    return length
+
+
+def search(index, source, target, scan, aligned):
+    """Longest exact match of target[scan:] in the source, as (length, source offset)."""
+    best_length, best_pos = 0, 0
+    candidates = index.get(target[scan : scan + MATCH_LENGTH], [])
+    # The source offset of the current alignment is tried too, it may not be indexed.
+    if 0 <= aligned < len(source):
+        candidates = [aligned] + candidates
+    for pos in candidates:
+        length = match_length(source, pos, target, scan)
+        if length > best_length:
+            best_length, best_pos = length, pos
+    if best_length < MATCH_LENGTH:
+        return 0, 0
+    return best_length, best_pos
+
+
+def diff_records(source, target):
+    """Split the target in bsdiff records, as (diff length, extra length, seek, source offset, target offset)."""
+    index = index_source(source)
+    records = []
+    scan = length = pos = 0
+    last_scan = last_pos = last_offset = 0
+
+    while scan < len(target):
+        old_score = 0
+        scan += length
+        scsc = scan
+        while scan < len(target):
+            length, pos = search(index, source, target, scan, scan + last_offset)
+            while scsc < scan + length:
+                if scsc + last_offset < len(source) and source[scsc + last_offset] == target[scsc]:
+                    old_score += 1
+                scsc += 1
+            # Stop at a match which is better than the current alignment.
+            if (length == old_score and length != 0) or length > old_score + MATCH_LENGTH:
+                break
+            if scan + last_offset < len(source) and source[scan + last_offset] == target[scan]:
+                old_score -= 1
+            scan += 1
+
+        if length == old_score and scan != len(target):
+            continue
+
+        # Extend the previous alignment forward while more bytes match than not.
+        score = best = length_forward = 0
+        i = 0
+        while last_scan + i < scan and last_pos + i < len(source):
+            if source[last_pos + i] == target[last_scan + i]:
+                score += 1
+            i += 1
+            if score * 2 - i > best * 2 - length_forward:
+                best, length_forward = score, i
+
+        # Extend the new match backward in the same way.
+        length_back = 0
+        if scan < len(target):
+            score = best = 0
+            i = 1
+            while scan >= last_scan + i and pos >= i:
+                if source[pos - i] == target[scan - i]:
+                    score += 1
+                if score * 2 - i > best * 2 - length_back:
+                    best, length_back = score, i
+                i += 1
+
+        # Split an overlap where it matches best.
+        if last_scan + length_forward > scan - length_back:
+            overlap = (last_scan + length_forward) - (scan - length_back)
+            score = best = split = 0
+            for i in range(overlap):
+                if target[last_scan + length_forward - overlap + i] == source[last_pos + length_forward - overlap + i]:
+                    score += 1
+                if target[scan - length_back + i] == source[pos - length_back + i]:
+                    score -= 1
+                if score > best:
+                    best, split = score, i + 1
+            length_forward += split - overlap
+            length_back -= split
+
+        extra = (scan - length_back) - (last_scan + length_forward)
+        seek = (pos - length_back) - (last_pos + length_forward)
+        records.append([length_forward, extra, seek, last_pos, last_scan])
+
+        last_scan = scan - length_back
+        last_pos = pos - length_back
+        last_offset = pos - scan
+
+    return records
+
+
+def create_patch(source, target):
+    header = struct.pack(
+        "<III",
+        MAGIC,
+        len(source),
+        len(target),
+    )
+    header += hashlib.sha256(source).digest() + hashlib.sha256(target).digest()
+
+    body = bytearray()
+    last_control = None
+    pending_seek = 0
+    for diff_length, extra_length, seek, source_offset, target_offset in diff_records(source, target):
+        if diff_length == 0 and extra_length == 0:
+            # The applier rejects empty records, their seek is merged into the previous one.
+            if last_control is None:
+                pending_seek += seek
+            else:
+                previous = struct.unpack_from("<IIi", body, last_control)
+                struct.pack_into("<IIi", body, last_control, previous[0], previous[1], previous[2] + seek)
+            continue
+        if pending_seek != 0:
+            if diff_length == 0:
+                # The source offset is not used before the seek of this record.
+                seek += pending_seek
+            else:
+                # Copy the first byte as extra data to move the source offset before the diff.
+                last_control = len(body)
+                body += struct.pack("<IIi", 0, 1, pending_seek + 1) + target[target_offset : target_offset + 1]
+                diff_length -= 1
+                source_offset += 1
+                target_offset += 1
+            pending_seek = 0
+            if diff_length == 0 and extra_length == 0:
+                previous = struct.unpack_from("<IIi", body, last_control)
+                struct.pack_into("<IIi", body, last_control, previous[0], previous[1], previous[2] + seek)
+                continue
+        last_control = len(body)
+        body += struct.pack("<IIi", diff_length, extra_length, seek)
+        body += encode_diff(
+            source[source_offset : source_offset + diff_length], target[target_offset : target_offset + diff_length]
+        )
+        body += target[target_offset + diff_length : target_offset + diff_length + extra_length]
+
+    return header + body
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Create a delta image for the PSA OTA PAL")
+    parser.add_argument("source", help="signed image running on the device")
+    parser.add_argument("target", help="signed update image")
+    parser.add_argument("output", help="delta image to upload as the OTA file")
+    args = parser.parse_args()
+
+    with open(args.source, "rb") as f:
+        source = f.read()
+    with open(args.target, "rb") as f:
+        target = f.read()
+
+    patch = create_patch(source, target)
+    with open(args.output, "wb") as f:
+        f.write(patch)
+
+    print(f"Delta image: {len(patch)} bytes for a {len(target)} bytes target image")
+
+
+if __name__ == "__main__":
+    main()